@@ -0,0 +1,114 @@
+/**************************************************************************************************
+  Filename:       AlpacaActions.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    device specific Alpaca Action / SupportedActions handlers
+**************************************************************************************************/
+#include "AlpacaActions.h"
+#include <ArduinoJson.h>
+#include <SLog.h>
+
+AlpacaActions alpaca_actions;
+
+AlpacaActions::AlpacaActions() : _num_actions(0), _server_transaction_id(0)
+{
+	// constructor
+}
+
+bool AlpacaActions::Add(const char *device_type, const char *name, AlpacaAction_t action)
+{
+	if( _num_actions >= ACTIONS_MAX ) {
+		SLOG_ERROR_PRINTF("ERROR! Too many actions, %s/%s not added\n", device_type, name);
+		return false;
+	}
+
+	_actions[_num_actions].device_type = device_type;
+	_actions[_num_actions].name = name;
+	_actions[_num_actions].action = action;
+	_num_actions++;
+
+	return true;
+}
+
+void AlpacaActions::Begin(AsyncWebServer *server)
+{
+	for(uint8_t i = 0; i < _num_actions; i++) {
+		const char *type = _actions[i].device_type;
+		bool seen = false;
+
+		for(uint8_t j = 0; j < i; j++)
+			seen |= (strcmp(type, _actions[j].device_type) == 0);
+		if( seen )
+			continue;
+
+		// registered before the server's own handlers, so these take precedence
+		String base = String("/api/v1/") + type + "/0/";
+		SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%saction\"\n", base.c_str());
+
+		server->on((base + "action").c_str(), HTTP_PUT, [this, type](AsyncWebServerRequest *request)
+				   { _handleAction(request, type); });
+		server->on((base + "supportedactions").c_str(), HTTP_GET, [this, type](AsyncWebServerRequest *request)
+				   { _handleSupportedActions(request, type); });
+	}
+}
+
+String AlpacaActions::GetParam(AsyncWebServerRequest *request, const char *name)
+{
+	for(size_t i = 0; i < request->params(); i++) {
+		const AsyncWebParameter *p = request->getParam(i);
+		if( p->name().equalsIgnoreCase(name) )
+			return p->value();
+	}
+	return String();
+}
+
+void AlpacaActions::_handleAction(AsyncWebServerRequest *request, const char *device_type)
+{
+	String name = GetParam(request, "Action");
+	String value;
+	int32_t error = ALPACA_ERR_NOT_IMPLEMENTED;
+
+	name.toLowerCase();
+	value = "Action " + name + " is not implemented";
+
+	for(uint8_t i = 0; i < _num_actions; i++) {
+		if( strcmp(_actions[i].device_type, device_type) == 0 && name == _actions[i].name ) {
+			value = "";
+			error = _actions[i].action(GetParam(request, "Parameters"), value);
+			break;
+		}
+	}
+
+	_send(request, value, error, false);
+}
+
+void AlpacaActions::_handleSupportedActions(AsyncWebServerRequest *request, const char *device_type)
+{
+	_send(request, device_type, 0, true);
+}
+
+void AlpacaActions::_send(AsyncWebServerRequest *request, const String &value, int32_t error, bool value_is_array)
+{
+	JsonDocument doc;
+	String body;
+
+	if( value_is_array ) {								// SupportedActions, value is the device type
+		JsonArray arr = doc["Value"].to<JsonArray>();
+		for(uint8_t i = 0; i < _num_actions; i++)
+			if( value == _actions[i].device_type )
+				arr.add(_actions[i].name);
+	} else if( error == 0 ) {
+		doc["Value"] = value;
+	} else {
+		doc["Value"] = "";
+	}
+
+	doc["ClientTransactionID"] = (uint32_t)GetParam(request, "ClientTransactionID").toInt();
+	doc["ServerTransactionID"] = NextServerTransactionID();
+	doc["ErrorNumber"] = error;
+	doc["ErrorMessage"] = (error == 0) ? "" : value;
+
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+}
@@ -0,0 +1,54 @@
+/**************************************************************************************************
+  Filename:       AlpacaActions.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    device specific Alpaca Action / SupportedActions handlers
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <ESPAsyncWebServer.h>
+
+#define ACTIONS_MAX             16          // actions of all devices
+
+#define ALPACA_ERR_NOT_IMPLEMENTED  0x400
+#define ALPACA_ERR_INVALID_VALUE    0x401
+#define ALPACA_ERR_NOT_CONNECTED    0x407
+#define ALPACA_ERR_INVALID_OP       0x40B
+
+// returns an Alpaca error number, 0 on success. value is the Action response, or the error message
+typedef std::function<int32_t(const String &parameters, String &value)> AlpacaAction_t;
+
+typedef std::function<uint32_t()> AlpacaTransactionID_t;	// next ServerTransactionID of the Alpaca server
+
+class AlpacaActions
+{
+private:
+	typedef struct {
+		const char *device_type;			// "dome", "switch", ...
+		const char *name;					// lowercase action name
+		AlpacaAction_t action;
+	} Action_t;
+
+	Action_t _actions[ACTIONS_MAX];
+	uint8_t _num_actions;
+	uint32_t _server_transaction_id;		// until SetTransactionCounter()
+	AlpacaTransactionID_t _next_transaction_id;
+
+	void _handleAction(AsyncWebServerRequest *request, const char *device_type);
+	void _handleSupportedActions(AsyncWebServerRequest *request, const char *device_type);
+	void _send(AsyncWebServerRequest *request, const String &value, int32_t error, bool value_is_array);
+
+public:
+	AlpacaActions();
+	bool Add(const char *device_type, const char *name, AlpacaAction_t action);	// before Begin()
+	void Begin(AsyncWebServer *server);		// call before AlpacaServer::RegisterCallbacks()
+
+	void SetTransactionCounter(AlpacaTransactionID_t next) { _next_transaction_id = next; }	// share the server's counter
+	uint32_t NextServerTransactionID() { return _next_transaction_id ? _next_transaction_id() : ++_server_transaction_id; }
+
+	static String GetParam(AsyncWebServerRequest *request, const char *name);	// case insensitive Alpaca parameter
+};
+
+extern AlpacaActions alpaca_actions;
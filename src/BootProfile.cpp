@@ -0,0 +1,64 @@
+/**************************************************************************************************
+  Filename:       BootProfile.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    timestamps of the boot phases, reported on /stats/boot
+**************************************************************************************************/
+#include "BootProfile.h"
+#include <ArduinoJson.h>
+#include <SLog.h>
+#include "IoTask.h"
+
+BootProfile boot_profile;
+
+BootProfile::BootProfile() : _num_phases(0)
+{
+	// constructor
+}
+
+void BootProfile::Mark(const char *name)
+{
+	if( _num_phases >= BOOT_PROFILE_PHASES )
+		return;
+
+	_phases[_num_phases].name = name;
+	_phases[_num_phases].us = (uint32_t)esp_timer_get_time();
+	_num_phases++;
+}
+
+uint32_t BootProfile::Get(const char *name)
+{
+	for(uint8_t i = 0; i < _num_phases; i++)
+		if( strcmp(_phases[i].name, name) == 0 )
+			return _phases[i].us;
+	return 0;
+}
+
+void BootProfile::Begin(AsyncWebServer *server)
+{
+	server->on(BOOT_PROFILE_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _report(request); });
+	SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\"\n", BOOT_PROFILE_URL);
+}
+
+void BootProfile::_report(AsyncWebServerRequest *request)
+{
+	JsonDocument doc;
+	String body;
+	uint32_t prev = 0;
+
+	doc["reset_reason"] = (int)esp_reset_reason();
+	doc["io_first_cycle_us"] = io_task_stats().first_cycle_us;
+	JsonArray arr = doc["phases"].to<JsonArray>();
+
+	for(uint8_t i = 0; i < _num_phases; i++) {
+		JsonObject obj = arr.add<JsonObject>();
+		obj["name"] = _phases[i].name;
+		obj["at_us"] = _phases[i].us;
+		obj["took_us"] = _phases[i].us - prev;
+		prev = _phases[i].us;
+	}
+
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+}
@@ -0,0 +1,35 @@
+/**************************************************************************************************
+  Filename:       BootProfile.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    timestamps of the boot phases, reported on /stats/boot
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#define BOOT_PROFILE_URL        "/stats/boot"
+#define BOOT_PROFILE_PHASES     16
+
+typedef struct {
+	const char *name;
+	uint32_t us;							// since reset
+} BootPhase_t;
+
+class BootProfile
+{
+private:
+	BootPhase_t _phases[BOOT_PROFILE_PHASES];
+	uint8_t _num_phases;
+
+	void _report(AsyncWebServerRequest *request);
+
+public:
+	BootProfile();
+	void Mark(const char *name);			// end of a phase, from setup() and loop() only
+	void Begin(AsyncWebServer *server);
+	uint32_t Get(const char *name);			// us of a phase, 0 if not reached yet
+};
+
+extern BootProfile boot_profile;
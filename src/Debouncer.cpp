@@ -0,0 +1,59 @@
+/**************************************************************************************************
+  Filename:       Debouncer.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    bit parallel debouncer for the 165 input word, vertical counters with per bit
+                  stability count and rising/falling edge masks
+**************************************************************************************************/
+#include "Debouncer.h"
+
+Debouncer::Debouncer() : _state(0), _c0(0), _c1(0), _c2(0), _c3(0), _t0(0xffff), _t1(0), _t2(0), _t3(0), _rise(0), _fall(0)
+{
+	// constructor, all bits change after 1 sample
+}
+
+void Debouncer::SetSamples(uint16_t mask, uint8_t samples)
+{
+	if( samples < 1 ) samples = 1;
+	if( samples > DEBOUNCE_MAX_SAMPLES ) samples = DEBOUNCE_MAX_SAMPLES;
+
+	_t0 = (samples & 1) ? (_t0 | mask) : (_t0 & ~mask);
+	_t1 = (samples & 2) ? (_t1 | mask) : (_t1 & ~mask);
+	_t2 = (samples & 4) ? (_t2 | mask) : (_t2 & ~mask);
+	_t3 = (samples & 8) ? (_t3 | mask) : (_t3 & ~mask);
+}
+
+void Debouncer::Reset(uint16_t state)
+{
+	_state = state;
+	_c0 = _c1 = _c2 = _c3 = 0;
+	_rise = _fall = 0;
+}
+
+uint16_t Debouncer::Update(uint16_t raw)
+{
+	uint16_t delta = raw ^ _state;				// bits that differ from debounced state
+	uint16_t k0 = _c0 & delta;					// carries of the increment
+	uint16_t k1 = _c1 & k0;
+	uint16_t k2 = _c2 & k1;
+	uint16_t stable;
+
+	_c0 = (_c0 ^ delta) & delta;				// count up differing bits, reset the others
+	_c1 = (_c1 ^ k0) & delta;
+	_c2 = (_c2 ^ k1) & delta;
+	_c3 = (_c3 ^ k2) & delta;
+
+	stable = delta & ~((_c0 ^ _t0) | (_c1 ^ _t1) | (_c2 ^ _t2) | (_c3 ^ _t3));	// counter reached stability count
+
+	_state ^= stable;
+	_rise = stable & _state;
+	_fall = stable & ~_state;
+
+	_c0 &= ~stable;
+	_c1 &= ~stable;
+	_c2 &= ~stable;
+	_c3 &= ~stable;
+
+	return stable;
+}
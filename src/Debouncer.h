@@ -0,0 +1,31 @@
+/**************************************************************************************************
+  Filename:       Debouncer.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    bit parallel debouncer for the 165 input word, vertical counters with per bit
+                  stability count and rising/falling edge masks
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+#define DEBOUNCE_MAX_SAMPLES    15      // 4 bit vertical counters
+
+class Debouncer
+{
+private:
+	uint16_t _state;						// debounced inputs
+	uint16_t _c0, _c1, _c2, _c3;			// vertical counters, bit planes 0..3
+	uint16_t _t0, _t1, _t2, _t3;			// stability count of each bit, bit planes 0..3
+	uint16_t _rise, _fall;					// edges of the last Update()
+
+public:
+	Debouncer();
+	void SetSamples(uint16_t mask, uint8_t samples);	// consecutive samples required for bits in mask, 1~15
+	void Reset(uint16_t state);				// force debounced state, clears counters and edges
+	uint16_t Update(uint16_t raw);			// feed one sample, returns mask of bits that changed
+
+	uint16_t GetState() { return _state; }
+	uint16_t GetRise() { return _rise; }
+	uint16_t GetFall() { return _fall; }
+};
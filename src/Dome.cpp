@@ -6,12 +6,21 @@
   Description:    Dome Device implementation
 **************************************************************************************************/
 #include "Dome.h"
+#include "SettingsJournal.h"
+#include "EventLog.h"
+#include <Preferences.h>
 
 const char *const Dome::k_shutter_state_str[5] = {"Open", "Closed", "Opening", "Closing", "Error"};
 
 Dome::Dome() : AlpacaDome()
 {
 	// constructor
+	d_shutter = AlpacaShutterStatus_t::kError;
+	d_slewing = false;
+	d_prev_shutter = d_shutter;
+	d_prev_slewing = d_slewing;
+	d_version = 0;
+	d_travel_reset = false;
 }
 
 void Dome::Begin()
@@ -19,12 +28,19 @@ void Dome::Begin()
     // init Dome
     AlpacaDome::Begin();
 
+	alpaca_actions.Add("dome", "relaylatency", [this](const String &parameters, String &value)
+					   { return _actionRelayLatency(parameters, value); });
+	alpaca_actions.Add("dome", "travelstats", [this](const String &parameters, String &value)
+					   { return _actionTravelStats(parameters, value); });
+
+	_travelLoad();
+
 	// init shutter status
 	if( d_use_switch )
 	{
-		if( d_switch_closed )
+		if( _switch_closed() )
 			d_shutter = AlpacaShutterStatus_t::kClosed;
-		else if( d_switch_opened )
+		else if( _switch_opened() )
 			d_shutter = AlpacaShutterStatus_t::kOpen;
 		else
 			d_shutter = AlpacaShutterStatus_t::kError;
@@ -33,41 +49,67 @@ void Dome::Begin()
 	{
 		d_shutter = AlpacaShutterStatus_t::kError;
 	}
+	d_prev_shutter = d_shutter;							// starting state is not a transition
+	d_prev_slewing = d_slewing;
 }
 
 void Dome::Loop()
 {
-	if( d_use_switch ) {
-		if(( d_shutter == AlpacaShutterStatus_t::kOpening ) || ( d_shutter == AlpacaShutterStatus_t::kClosing )) {
-			if(( millis() - d_timer_ini ) > (d_timeout * 1000 ))		// timeout!!!!!!!!!!!
-			{
-				SLOG_ERROR_PRINTF("ERROR! Dome timeout!");
-				d_shutter = AlpacaShutterStatus_t::kError;			// set error status
-				d_slewing = false;
-				d_timer_ini = 0;
-				d_timer_end = 0;
-				d_relay_close = false;							// turn relays OFF
-				d_relay_open = false;
-				return;
-			}
-		}
+	if( d_travel_reset ) {								// requested by the travelstats action
+		memset(d_travel, 0, sizeof(d_travel));
+		_travelSave();
+		d_travel_reset = false;
+	}
 
-		if(( d_shutter == AlpacaShutterStatus_t::kOpening ) && ( d_switch_opened ))
-		{
+	_loop();
+
+	if(( d_shutter != d_prev_shutter ) || ( d_slewing != d_prev_slewing )) {	// also catches changes from the web handlers
+		event_log.Add(EVLOG_SRC_DOME, (uint8_t)d_shutter, ( d_slewing ? 1 : 0 ) | ((uint32_t)d_prev_shutter << 8));
+		d_prev_shutter = d_shutter;
+		d_prev_slewing = d_slewing;
+		_changed();
+	}
+}
+
+void Dome::_loop()
+{
+	if( d_use_switch ) {
+		if(( d_shutter == AlpacaShutterStatus_t::kOpening ) && ( _switch_opened() ))	// arrival first, a limit switch
+		{																				// reached with the deadline is no fault
+			_travelDone( millis() - d_timer_ini );
 			d_shutter = AlpacaShutterStatus_t::kOpen;
 			d_slewing = false;
 			d_relay_close = false;		// turn relays OFF
 			d_relay_open = false;
 			SLOG_INFO_PRINTF("Dome open.");
+			return;
 		}
 		
-		if(( d_shutter == AlpacaShutterStatus_t::kClosing ) && ( d_switch_closed ))
+		if(( d_shutter == AlpacaShutterStatus_t::kClosing ) && ( _switch_closed() ))
 		{
+			_travelDone( millis() - d_timer_ini );
 			d_shutter = AlpacaShutterStatus_t::kClosed;
 			d_slewing = false;
 			d_relay_close = false;		// turn relays OFF
 			d_relay_open = false;
 			SLOG_INFO_PRINTF("Dome closed.");
+			return;
+		}
+
+		if(( d_shutter == AlpacaShutterStatus_t::kOpening ) || ( d_shutter == AlpacaShutterStatus_t::kClosing )) {
+			if(( millis() - d_timer_ini ) > (d_timeout * 1000 ))		// timeout!!!!!!!!!!!
+			{
+				SLOG_ERROR_PRINTF("ERROR! Dome timeout!");
+				d_shutter = AlpacaShutterStatus_t::kError;			// set error status
+				d_slewing = false;
+				d_timer_ini = 0;
+				d_timer_end = 0;
+				d_relay_close = false;							// turn relays OFF
+				d_relay_open = false;
+				return;
+			}
+
+			_travelCheck( millis() - d_timer_ini );				// stalled or late: fault, relays OFF
 		}
 	} else {
 		if(( d_shutter == AlpacaShutterStatus_t::kOpening ) && ( millis() > d_timer_end ))
@@ -98,6 +140,7 @@ const bool Dome::_putAbort()	// stops shutter motor, sets _shutter to error, set
 	d_timer_end = 0;
 	d_relay_close = false;		// turn relays OFF
 	d_relay_open = false;
+	_changed();					// cached shutterstatus/slewing are stale now, not at the next Loop()
 	SLOG_INFO_PRINTF("Dome Halted.");
 	
 	return true;
@@ -117,9 +160,11 @@ const bool Dome::_putClose()
 		d_shutter = AlpacaShutterStatus_t::kClosing;
 		d_timer_ini = millis();
 		d_timer_end = d_timer_ini + d_timeout * 1000;
+		_travelStart();
 
 		d_relay_close = true;		// turn close relays ON
 		d_relay_open = false;		// turn open relays OFF
+		_changed();
 		SLOG_INFO_PRINTF("Dome command close received.");
 	}
 	
@@ -141,9 +186,11 @@ const bool Dome::_putOpen()
 		d_shutter = AlpacaShutterStatus_t::kOpening;
 		d_timer_ini = millis();
 		d_timer_end = d_timer_ini + d_timeout * 1000;
+		_travelStart();
 
 		d_relay_close = false;			// turn close relays OFF
 		d_relay_open = true;			// turn open relays ON
+		_changed();
 	}
 	
 	return true;
@@ -159,6 +206,151 @@ const bool Dome::_getSlewing()
     return d_slewing;
 }
 
+// Action "relaylatency": histogram of limit switch to relay off latency, Parameters "reset" clears it
+int32_t Dome::_actionRelayLatency(const String &parameters, String &value)
+{
+	const IoLatencyHist_t &h = io_latency_hist();
+	JsonDocument doc;
+
+	doc["count"] = h.count;
+	doc["last_us"] = h.last_us;
+	doc["max_us"] = h.max_us;
+	doc["fast_cycles"] = io_task_stats().fast_cycles;
+	JsonArray buckets = doc["buckets"].to<JsonArray>();		// bucket i: latency < 2^i us
+	for(uint32_t i = 0; i < IO_LAT_BUCKETS; i++)
+		buckets.add(h.bucket[i]);
+	serializeJson(doc, value);
+
+	if( parameters.equalsIgnoreCase("reset") )
+		io_latency_reset();
+
+	return 0;
+}
+
+// Action "travelstats": learned travel times and faults per direction, Parameters "reset" clears them
+int32_t Dome::_actionTravelStats(const String &parameters, String &value)
+{
+	static const char *const dir_str[2] = {"open", "close"};
+	JsonDocument doc;
+
+	for(uint32_t i = 0; i < 2; i++) {
+		JsonObject obj = doc[dir_str[i]].to<JsonObject>();
+		obj["runs"] = d_travel[i].runs;
+		obj["avg_ms"] = d_travel[i].avg_ms;
+		obj["last_ms"] = d_travel[i].last_ms;
+		obj["min_ms"] = d_travel[i].min_ms;
+		obj["max_ms"] = d_travel[i].max_ms;
+		obj["stalls"] = d_travel[i].stalls;
+		obj["early"] = d_travel[i].early;
+		obj["late"] = d_travel[i].late;
+	}
+	serializeJson(doc, value);
+
+	if( parameters.equalsIgnoreCase("reset") )
+		d_travel_reset = true;							// cleared by Loop(), which owns d_travel
+
+	return 0;
+}
+
+// half width of the tolerance band around the learned travel time
+static uint32_t travel_band(const DomeTravel_t &t)
+{
+	uint32_t band = t.avg_ms * DOME_TRAVEL_TOLERANCE / 100;
+
+	return ( band > DOME_TRAVEL_MARGIN_MS ) ? band : DOME_TRAVEL_MARGIN_MS;
+}
+
+void Dome::_travelStart()
+{
+	uint16_t start_bit = ( d_shutter == AlpacaShutterStatus_t::kOpening ) ? BIT_FC_CLOSE : BIT_FC_OPEN;
+
+	d_full_travel = ( io_edges.state & start_bit ) != 0;		// partial travels are checked but not learned
+	d_released = false;
+}
+
+// check a running movement against the model, returns false after a fault
+bool Dome::_travelCheck(uint32_t elapsed)
+{
+	bool opening = ( d_shutter == AlpacaShutterStatus_t::kOpening );
+	DomeTravel_t &t = d_travel[opening ? DOME_TRAVEL_OPEN : DOME_TRAVEL_CLOSE];
+
+	if(( io_edges.state & ( opening ? BIT_FC_CLOSE : BIT_FC_OPEN )) == 0 )
+		d_released = true;
+
+	if( d_full_travel && !d_released && ( elapsed > DOME_RELEASE_MS )) {
+		t.stalls++;
+		_travelFault("stalled, limit switch not released");
+		return false;
+	}
+
+	if(( t.runs >= DOME_TRAVEL_MIN_RUNS ) && ( elapsed > t.avg_ms + travel_band(t) )) {
+		t.late++;
+		_travelFault("late, limit switch not reached");
+		return false;
+	}
+
+	return true;
+}
+
+// limit switch reached, learn the travel time
+void Dome::_travelDone(uint32_t elapsed)
+{
+	bool opening = ( d_shutter == AlpacaShutterStatus_t::kOpening );
+	DomeTravel_t &t = d_travel[opening ? DOME_TRAVEL_OPEN : DOME_TRAVEL_CLOSE];
+
+	t.last_ms = elapsed;
+
+	if( !d_full_travel )
+		return;
+
+	if(( t.runs >= DOME_TRAVEL_MIN_RUNS ) && ( elapsed + travel_band(t) < t.avg_ms )) {
+		t.early++;												// not learned
+		SLOG_WARNING_PRINTF("WARNING! Dome arrived early, %u ms, expected %u ms\n", elapsed, t.avg_ms);
+	} else {
+		t.avg_ms = ( t.runs == 0 ) ? elapsed : (uint32_t)((int32_t)t.avg_ms + ((int32_t)elapsed - (int32_t)t.avg_ms) / 4);
+		if(( t.runs == 0 ) || ( elapsed < t.min_ms )) t.min_ms = elapsed;
+		if( elapsed > t.max_ms ) t.max_ms = elapsed;
+		t.runs++;
+	}
+
+	_travelSave();
+}
+
+void Dome::_travelFault(const char *reason)
+{
+	SLOG_ERROR_PRINTF("ERROR! Dome %s!\n", reason);
+	d_shutter = AlpacaShutterStatus_t::kError;			// set error status
+	d_slewing = false;
+	d_timer_ini = 0;
+	d_timer_end = 0;
+	d_relay_close = false;								// turn relays OFF
+	d_relay_open = false;
+
+	_travelSave();
+}
+
+void Dome::_travelLoad()
+{
+	Preferences prefs;
+
+	memset(d_travel, 0, sizeof(d_travel));
+	if( prefs.begin("dome", true) ) {
+		if( prefs.getBytesLength("travel") == sizeof(d_travel) )
+			prefs.getBytes("travel", d_travel, sizeof(d_travel));
+		prefs.end();
+	}
+}
+
+void Dome::_travelSave()
+{
+	Preferences prefs;
+
+	if( prefs.begin("dome", false) ) {
+		prefs.putBytes("travel", d_travel, sizeof(d_travel));
+		prefs.end();
+	}
+}
+
 // read settings from flash
 void Dome::AlpacaReadJson(JsonObject &root)
 {
@@ -196,4 +388,23 @@ void Dome::AlpacaWriteJson(JsonObject &root)
 
 	Serial.print("AlpacaWrite "); Serial.println(d_use_switch);
     DBG_JSON_PRINTFJ(SLOG_NOTICE, root, "...DOME WRITE END root=<%s>\n", _ser_json_);
-}
\ No newline at end of file
+}
+
+// one key of Dome_Configuration from the settings journal, same limits as AlpacaReadJson()
+bool Dome::ApplySetting(const char *section, const char *key, JsonVariantConst value)
+{
+	int32_t to;
+
+	if( strcmp(section, "Dome_Configuration") != 0 )
+		return false;
+
+	if( strcmp(key, "Use_limit_switches") == 0 )
+		return settings_bool(value, d_use_switch);
+
+	if(( strcmp(key, "Shutter_timeout") == 0 ) && settings_int(value, 1, 300, to)) {
+		d_timeout = to;
+		return true;
+	}
+
+	return false;
+}
@@ -6,6 +6,8 @@
 **************************************************************************************************/
 #pragma once
 #include "AlpacaDome.h"
+#include "IoTask.h"
+#include "AlpacaActions.h"
 
 // ASCOM / ALPACA ShutterStatus Enumeration
 /*
@@ -19,7 +21,24 @@ enum struct ShutterStatus_t
 };
 */
 
-extern bool d_switch_opened, d_switch_closed;
+#define DOME_TRAVEL_TOLERANCE   20          // % band around the learned travel time
+#define DOME_TRAVEL_MARGIN_MS   2000        // minimum half width of the band
+#define DOME_TRAVEL_MIN_RUNS    3           // travels learned before the band is enforced
+#define DOME_RELEASE_MS         5000        // start limit switch must release within, else stall
+
+enum { DOME_TRAVEL_OPEN = 0, DOME_TRAVEL_CLOSE };
+
+typedef struct {						// learned travel of one direction, persisted in NVS
+	uint32_t runs;						// completed travels
+	uint32_t avg_ms;					// moving average of travel time
+	uint32_t last_ms;
+	uint32_t min_ms;
+	uint32_t max_ms;
+	uint32_t stalls;					// start limit switch not released
+	uint32_t early;						// arrived before the band
+	uint32_t late;						// not arrived at the end of the band
+} DomeTravel_t;
+
 extern bool d_relay_open, d_relay_close;
 
 class Dome : public AlpacaDome
@@ -32,6 +51,13 @@ private:
 	int32_t d_timeout;					// open/close timeout
 	int32_t d_timer_ini;					// timer init of movement
 	int32_t d_timer_end;					// timer init of movement
+	bool d_full_travel;					// movement started on the opposite limit switch
+	bool d_released;					// start limit switch released
+	AlpacaShutterStatus_t d_prev_shutter;	// state seen by the previous Loop()
+	bool d_prev_slewing;
+	volatile uint32_t d_version;		// incremented when shutter status or slewing change
+	DomeTravel_t d_travel[2];			// DOME_TRAVEL_OPEN, DOME_TRAVEL_CLOSE, updated by Loop() only
+	volatile bool d_travel_reset;		// set by the travelstats action
 
 	const bool _putAbort();				// to be implemented here
 	const bool _putClose();
@@ -41,7 +67,21 @@ private:
 	void AlpacaReadJson(JsonObject &root);
 	void AlpacaWriteJson(JsonObject &root);
 
+	int32_t _actionRelayLatency(const String &parameters, String &value);
+	int32_t _actionTravelStats(const String &parameters, String &value);
+
+	void _loop();
+	void _changed() { __atomic_fetch_add(&d_version, 1, __ATOMIC_RELEASE); }	// from loop() and the web handlers
+	void _travelStart();
+	bool _travelCheck(uint32_t elapsed);
+	void _travelDone(uint32_t elapsed);
+	void _travelFault(const char *reason);
+	void _travelLoad();
+	void _travelSave();
+
 	void _dome_use_limit(bool use_lim) { d_use_switch = use_lim; };
+	bool _switch_opened() { return (io_edges.state & BIT_FC_OPEN) != 0; }		// debounced limit switches
+	bool _switch_closed() { return (io_edges.state & BIT_FC_CLOSE) != 0; }
 
 	static const char *const k_shutter_state_str[5];
 
@@ -49,4 +89,9 @@ public:
 	Dome();
 	void Begin();
 	void Loop();
+
+	AlpacaShutterStatus_t GetShutter() { return d_shutter; }
+	bool GetSlewing() { return d_slewing; }
+	uint32_t GetVersion() { return d_version; }
+	bool ApplySetting(const char *section, const char *key, JsonVariantConst value);	// from the settings journal
 };
@@ -0,0 +1,422 @@
+/**************************************************************************************************
+  Filename:       EventLog.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    append only binary log of shutter, safety and switch transitions on LittleFS
+**************************************************************************************************/
+#include "EventLog.h"
+#include <memory>
+#include <LittleFS.h>
+#include <rom/crc.h>
+#include <ArduinoJson.h>
+#include <SLog.h>
+
+#define EVLOG_MAGIC         0x314C5645      // "EVL1"
+#define EVLOG_RECORDS       ((EVLOG_SEGMENT_SIZE - sizeof(Segment_t)) / sizeof(EventRecord_t))	// per segment
+#define EVLOG_ROW_SIZE      48              // longest JSON row
+
+EventLog event_log;
+
+static const char *const k_sources = "[\"system\",\"dome\",\"safemon\",\"switch\"]";	// EVLOG_SRC_x
+
+// range query in progress, owned by the chunked response
+typedef struct {
+	struct {
+		uint8_t slot;
+		uint32_t seq;
+		uint16_t count;						// records when the query started
+	} seg[EVLOG_SEGMENTS];					// oldest first
+	uint8_t num_segs;
+	uint8_t i;								// segment being read
+	uint16_t rec;							// next record of segment i
+	EventRecord_t queue[EVLOG_QUEUE];		// events not written yet, streamed last
+	uint8_t num_queued;
+	uint8_t q;
+	bool all;								// every boot, else only boot
+	bool bin;								// raw records instead of JSON rows
+	uint16_t boot;
+	uint32_t from, to;
+	uint32_t rows;
+	uint8_t phase;							// 0: head, 1: rows, 2: done
+} EvQuery_t;
+
+static uint32_t record_crc(const EventRecord_t &r)
+{
+	return crc32_le(0, (const uint8_t *)&r, offsetof(EventRecord_t, crc));
+}
+
+static bool query_match(const EvQuery_t &q, const EventRecord_t &r)
+{
+	return ( q.all || ( r.boot == q.boot )) && ( r.t_ms >= q.from ) && ( r.t_ms <= q.to );
+}
+
+// one record as raw bytes or as a JSON row, 0 if it does not fit in size
+static size_t query_row(EvQuery_t &q, const EventRecord_t &r, uint8_t *buffer, size_t size)
+{
+	char row[EVLOG_ROW_SIZE];
+	int n;
+
+	if( q.bin ) {
+		if( size < sizeof(r) )
+			return 0;
+		memcpy(buffer, &r, sizeof(r));
+		return sizeof(r);
+	}
+
+	n = snprintf(row, sizeof(row), "%s[%u,%u,%u,%u,%u]", q.rows ? "," : "", r.boot, r.t_ms, r.source, r.code, r.payload);
+	if( (size_t)n > size )
+		return 0;
+	memcpy(buffer, row, n);
+	q.rows++;
+	return n;
+}
+
+EventLog::EventLog() : _slot(0), _boot(0), _num_queued(0), _first_queued_ms(0), _mutex(NULL)
+{
+	memset(_index, 0, sizeof(_index));
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+void EventLog::_fileName(uint8_t slot, char *name, size_t size)
+{
+	snprintf(name, size, EVLOG_FILE, slot);
+}
+
+// rebuilds the index of one slot, false if the segment cannot take more records (torn tail)
+bool EventLog::_scanSegment(uint8_t slot)
+{
+	char name[16];
+	Segment_t h;
+	EventRecord_t r;
+	Index_t &idx = _index[slot];
+	bool intact = true;
+	int32_t last;
+
+	_fileName(slot, name, sizeof(name));
+	File f = LittleFS.open(name, "r");
+	if( !f )
+		return true;
+
+	if(( f.read((uint8_t *)&h, sizeof(h)) != sizeof(h) ) || ( h.magic != EVLOG_MAGIC ) ||
+	   ( h.record_size != sizeof(EventRecord_t) ) || ( crc32_le(0, (const uint8_t *)&h, offsetof(Segment_t, crc)) != h.crc )) {
+		f.close();
+		return true;										// not a segment, recycled like an empty slot
+	}
+
+	idx.seq = h.seq;
+	if( _boot < h.boot )
+		_boot = h.boot;
+
+	last = (int32_t)((f.size() - sizeof(h)) / sizeof(r)) - 1;
+	if(( f.size() - sizeof(h) ) % sizeof(r) != 0 ) {		// power lost in the middle of a record
+		_stats.torn++;
+		intact = false;
+	}
+
+	for( ; last >= 0; last--) {								// last complete record with a good CRC
+		f.seek(sizeof(h) + last * sizeof(r));
+		if(( f.read((uint8_t *)&r, sizeof(r)) == sizeof(r) ) && ( record_crc(r) == r.crc ))
+			break;
+		_stats.torn++;
+		intact = false;
+	}
+
+	if( last >= 0 ) {
+		idx.count = last + 1;
+		idx.last = ev_key(r.boot, r.t_ms);
+		if( _boot < r.boot )
+			_boot = r.boot;
+
+		f.seek(sizeof(h));
+		f.read((uint8_t *)&r, sizeof(r));
+		idx.first = ev_key(r.boot, r.t_ms);
+	}
+
+	f.close();
+	return intact && ( idx.count < EVLOG_RECORDS );
+}
+
+// starts a new segment in slot, the segment it held before is lost
+bool EventLog::_openSegment(uint8_t slot, uint32_t seq)
+{
+	char name[16];
+	Segment_t h;
+
+	_fileName(slot, name, sizeof(name));
+	File f = LittleFS.open(name, "w");
+	if( !f ) {
+		SLOG_ERROR_PRINTF("ERROR! Cannot open %s\n", name);
+		return false;
+	}
+
+	h.magic = EVLOG_MAGIC;
+	h.seq = seq;
+	h.boot = _boot;
+	h.record_size = sizeof(EventRecord_t);
+	h.crc = crc32_le(0, (const uint8_t *)&h, offsetof(Segment_t, crc));
+	f.write((const uint8_t *)&h, sizeof(h));
+	f.close();
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	if( _index[slot].seq != 0 )
+		_stats.segments_recycled++;
+	_index[slot].seq = seq;
+	_index[slot].count = 0;
+	_index[slot].first = _index[slot].last = 0;
+	_slot = slot;
+	xSemaphoreGive(_mutex);
+
+	return true;
+}
+
+void EventLog::Begin(AsyncWebServer *server)
+{
+	bool open = true;
+	uint32_t events = 0;
+
+	_mutex = xSemaphoreCreateMutex();
+
+	for(uint8_t slot = 0; slot < EVLOG_SEGMENTS; slot++) {
+		bool more = _scanSegment(slot);
+
+		if(( _index[slot].seq != 0 ) && ( _index[slot].seq >= _index[_slot].seq )) {	// newest segment is appended
+			_slot = slot;
+			open = more;
+		}
+		events += _index[slot].count;
+	}
+	_boot++;
+
+	if( _index[_slot].seq == 0 )
+		_openSegment(0, 1);
+	else if( !open )										// full, or torn: never append after a bad record
+		_openSegment((_slot + 1) % EVLOG_SEGMENTS, _index[_slot].seq + 1);
+
+	server->on(EVLOG_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _handleGet(request); });
+	server->on(EVLOG_STATS_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _handleStats(request); });
+	SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\"\n", EVLOG_URL);
+	SLOG_PRINTF(SLOG_INFO, "EVENT LOG boot=%u events=%u torn=%u\n", _boot, events, _stats.torn);
+
+	Add(EVLOG_SRC_SYSTEM, EVLOG_BOOT, (uint32_t)esp_reset_reason());
+}
+
+void EventLog::Add(uint8_t source, uint8_t code, uint32_t payload)
+{
+	EventRecord_t r;
+
+	if( _mutex == NULL )									// before Begin()
+		return;
+
+	r.t_ms = millis();
+	r.payload = payload;
+	r.boot = _boot;
+	r.source = source;
+	r.code = code;
+	r.crc = record_crc(r);
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	if( _num_queued < EVLOG_QUEUE ) {
+		if( _num_queued == 0 )
+			_first_queued_ms = r.t_ms;
+		_queue[_num_queued++] = r;
+		_stats.added++;
+	} else
+		_stats.dropped++;
+	xSemaphoreGive(_mutex);
+}
+
+// appends n records, one open/write per segment touched
+void EventLog::_write(const EventRecord_t *r, uint8_t n)
+{
+	char name[16];
+
+	while( n > 0 ) {
+		if(( _index[_slot].count >= EVLOG_RECORDS ) &&
+		   !_openSegment((_slot + 1) % EVLOG_SEGMENTS, _index[_slot].seq + 1))
+			return;
+
+		uint8_t m = min((uint32_t)n, (uint32_t)(EVLOG_RECORDS - _index[_slot].count));
+
+		_fileName(_slot, name, sizeof(name));
+		File f = LittleFS.open(name, "a");
+		if( !f ) {
+			SLOG_ERROR_PRINTF("ERROR! Cannot open %s\n", name);
+			return;
+		}
+		m = f.write((const uint8_t *)r, m * sizeof(EventRecord_t)) / sizeof(EventRecord_t);
+		f.close();
+		if( m == 0 )
+			return;
+
+		xSemaphoreTake(_mutex, portMAX_DELAY);
+		Index_t &idx = _index[_slot];
+		if( idx.count == 0 )
+			idx.first = ev_key(r[0].boot, r[0].t_ms);
+		idx.last = ev_key(r[m - 1].boot, r[m - 1].t_ms);
+		idx.count += m;
+		xSemaphoreGive(_mutex);
+
+		_stats.written += m;
+		r += m;
+		n -= m;
+	}
+	_stats.flushes++;
+}
+
+void EventLog::Loop(uint32_t now)
+{
+	EventRecord_t batch[EVLOG_QUEUE];
+	uint8_t n;
+
+	if(( _num_queued == 0 ) || (( _num_queued < EVLOG_QUEUE / 2 ) && ( now - _first_queued_ms < EVLOG_FLUSH_MS )))
+		return;
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);				// the flash write runs without the lock
+	n = _num_queued;
+	memcpy(batch, _queue, n * sizeof(EventRecord_t));
+	_num_queued = 0;
+	xSemaphoreGive(_mutex);
+
+	_write(batch, n);
+}
+
+// rows [boot, t_ms, source, code, payload] of the segments overlapping the range, then of the queue
+void EventLog::_handleGet(AsyncWebServerRequest *request)
+{
+	std::shared_ptr<EvQuery_t> q = std::make_shared<EvQuery_t>();
+	String boot = request->hasParam("boot") ? request->getParam("boot")->value() : String(_boot);
+	uint64_t lo, hi;
+
+	memset(q.get(), 0, sizeof(EvQuery_t));
+	q->all = ( boot == "all" );
+	q->boot = boot.toInt();
+	q->from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+	q->to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), NULL, 10) : UINT32_MAX;
+	q->bin = request->hasParam("format") && ( request->getParam("format")->value() == "bin" );
+	lo = ev_key(q->boot, q->from);
+	hi = ev_key(q->boot, q->to);
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	for(uint8_t slot = 0; slot < EVLOG_SEGMENTS; slot++) {
+		const Index_t &idx = _index[slot];
+		uint8_t j;
+
+		if(( idx.seq == 0 ) || ( idx.count == 0 ) || ( !q->all && (( idx.last < lo ) || ( idx.first > hi ))))
+			continue;
+
+		for(j = q->num_segs; ( j > 0 ) && ( q->seg[j - 1].seq > idx.seq ); j--)	// sorted by seq
+			q->seg[j] = q->seg[j - 1];
+		q->seg[j].slot = slot;
+		q->seg[j].seq = idx.seq;
+		q->seg[j].count = idx.count;
+		q->num_segs++;
+	}
+	memcpy(q->queue, _queue, _num_queued * sizeof(EventRecord_t));
+	q->num_queued = _num_queued;
+	_stats.queries++;
+	xSemaphoreGive(_mutex);
+
+	AsyncWebServerResponse *response = request->beginChunkedResponse(q->bin ? "application/octet-stream" : "application/json",
+		[this, q](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+			size_t len = 0, n;
+
+			if( q->phase == 0 ) {
+				if( !q->bin ) {
+					int head = snprintf((char *)buffer, max_len, "{\"boot\":%u,\"now_ms\":%u,\"sources\":%s,\"rows\":[", _boot, (uint32_t)millis(), k_sources);
+					if( (size_t)head >= max_len )
+						return RESPONSE_TRY_AGAIN;
+					len = head;
+				}
+				q->phase = 1;
+			}
+
+			while(( q->phase == 1 ) && ( q->i < q->num_segs )) {	// segments still on flash
+				char name[16];
+				Segment_t h;
+				EventRecord_t r;
+
+				_fileName(q->seg[q->i].slot, name, sizeof(name));
+				File f = LittleFS.open(name, "r");
+				if( !f || ( f.read((uint8_t *)&h, sizeof(h)) != sizeof(h) ) || ( h.seq != q->seg[q->i].seq )) {
+					if( f ) f.close();								// recycled since the query started
+					q->i++;
+					q->rec = 0;
+					continue;
+				}
+
+				f.seek(sizeof(h) + q->rec * sizeof(r));
+				while( q->rec < q->seg[q->i].count ) {
+					if( max_len - len < EVLOG_ROW_SIZE ) {
+						f.close();
+						return len ? len : RESPONSE_TRY_AGAIN;
+					}
+					if( f.read((uint8_t *)&r, sizeof(r)) != sizeof(r) )
+						break;
+					q->rec++;
+					if(( record_crc(r) == r.crc ) && query_match(*q, r))
+						len += query_row(*q, r, buffer + len, max_len - len);
+				}
+				f.close();
+				q->i++;
+				q->rec = 0;
+			}
+
+			while(( q->phase == 1 ) && ( q->q < q->num_queued )) {	// events not written yet
+				if( query_match(*q, q->queue[q->q]) ) {
+					if(( n = query_row(*q, q->queue[q->q], buffer + len, max_len - len) ) == 0 )
+						return len ? len : RESPONSE_TRY_AGAIN;
+					len += n;
+				}
+				q->q++;
+			}
+
+			if( q->phase == 1 ) {
+				if( !q->bin ) {
+					if( max_len - len < 2 )
+						return len ? len : RESPONSE_TRY_AGAIN;
+					memcpy(buffer + len, "]}", 2);
+					len += 2;
+				}
+				q->phase = 2;
+			}
+
+			return len;											// 0 once everything is sent
+		});
+	request->send(response);
+}
+
+void EventLog::_handleStats(AsyncWebServerRequest *request)
+{
+	JsonDocument doc;
+	String body;
+
+	doc["boot"] = _boot;
+	doc["added"] = _stats.added;
+	doc["dropped"] = _stats.dropped;
+	doc["written"] = _stats.written;
+	doc["flushes"] = _stats.flushes;
+	doc["segments_recycled"] = _stats.segments_recycled;
+	doc["torn"] = _stats.torn;
+	doc["queries"] = _stats.queries;
+	doc["queued"] = _num_queued;
+	doc["records_per_segment"] = EVLOG_RECORDS;
+	JsonArray arr = doc["segments"].to<JsonArray>();
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	for(uint8_t slot = 0; slot < EVLOG_SEGMENTS; slot++) {
+		const Index_t &idx = _index[slot];
+		JsonObject obj = arr.add<JsonObject>();
+
+		obj["seq"] = idx.seq;
+		obj["count"] = idx.count;
+		obj["first_boot"] = (uint32_t)(idx.first >> 32);
+		obj["first_ms"] = (uint32_t)idx.first;
+		obj["last_boot"] = (uint32_t)(idx.last >> 32);
+		obj["last_ms"] = (uint32_t)idx.last;
+	}
+	xSemaphoreGive(_mutex);
+
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+}
@@ -0,0 +1,97 @@
+/**************************************************************************************************
+  Filename:       EventLog.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    append only binary log of shutter, safety and switch transitions on LittleFS
+                  EVLOG_SEGMENTS rotating segment files of EVLOG_SEGMENT_SIZE bytes, 16 B records
+                  Add() queues in RAM from any task, Loop() writes the queue in batches, the oldest
+                  segment is recycled when the last one is full: bounded size, writes spread over
+                  every segment. A RAM index of the (boot, ms) range of every segment is rebuilt
+                  at boot and lets range queries skip whole segments.
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#define EVLOG_URL               "/events/log"       // GET boot=n|all, from, to in ms since that boot, format=json|bin
+#define EVLOG_STATS_URL         "/stats/events"
+#define EVLOG_FILE              "/evlog%u.bin"      // segment slot
+#define EVLOG_SEGMENTS          8
+#define EVLOG_SEGMENT_SIZE      16384               // 128 kB of the spiffs partition in total
+#define EVLOG_QUEUE             32                  // events waiting for the flash write
+#define EVLOG_FLUSH_MS          1000                // oldest queued event written after
+
+enum {									// EventRecord_t.source
+	EVLOG_SRC_SYSTEM = 0,				// code EVLOG_BOOT, payload esp_reset_reason()
+	EVLOG_SRC_DOME,						// code shutter status, payload slewing | previous shutter status << 8
+	EVLOG_SRC_SAFEMON,					// code 0 safe, 1 unsafe, payload inputs | previous inputs << 16
+	EVLOG_SRC_SWITCH					// code switch id, payload value written
+};
+
+enum { EVLOG_BOOT = 0 };
+
+typedef struct __attribute__((packed)) {
+	uint32_t t_ms;							// millis() of the event
+	uint32_t payload;
+	uint16_t boot;							// boot number, orders events of different boots
+	uint8_t source;							// EVLOG_SRC_x
+	uint8_t code;
+	uint32_t crc;							// CRC32 of the fields above
+} EventRecord_t;
+
+typedef struct {
+	uint32_t added;
+	uint32_t dropped;						// queue full
+	uint32_t written;
+	uint32_t flushes;
+	uint32_t segments_recycled;
+	uint32_t torn;							// bad records found at boot
+	uint32_t queries;
+} EventLogStats_t;
+
+class EventLog
+{
+private:
+	typedef struct __attribute__((packed)) {
+		uint32_t magic;
+		uint32_t seq;						// segment sequence, oldest segment has the lowest
+		uint16_t boot;						// boot that opened the segment
+		uint16_t record_size;
+		uint32_t crc;						// CRC32 of the fields above
+	} Segment_t;
+
+	typedef struct {
+		uint32_t seq;						// 0: slot not in use
+		uint16_t count;						// records
+		uint64_t first, last;				// ev_key() of the first and last record
+	} Index_t;
+
+	Index_t _index[EVLOG_SEGMENTS];
+	uint8_t _slot;							// segment being appended
+	uint16_t _boot;
+	EventRecord_t _queue[EVLOG_QUEUE];
+	uint8_t _num_queued;
+	uint32_t _first_queued_ms;
+	SemaphoreHandle_t _mutex;				// Add() from the web server task, index read by queries
+	EventLogStats_t _stats;
+
+	static void _fileName(uint8_t slot, char *name, size_t size);
+	bool _scanSegment(uint8_t slot);
+	bool _openSegment(uint8_t slot, uint32_t seq);
+	void _write(const EventRecord_t *r, uint8_t n);
+	void _handleGet(AsyncWebServerRequest *request);
+	void _handleStats(AsyncWebServerRequest *request);
+
+public:
+	EventLog();
+	void Begin(AsyncWebServer *server);		// after LittleFS is mounted, logs the boot event
+	void Add(uint8_t source, uint8_t code, uint32_t payload);	// O(1), never touches the flash
+	void Loop(uint32_t now);				// from loop(): writes the queued events
+	uint16_t GetBoot() { return _boot; }
+	const EventLogStats_t &GetStats() { return _stats; }
+};
+
+static inline uint64_t ev_key(uint16_t boot, uint32_t t_ms) { return ((uint64_t)boot << 32) | t_ms; }
+
+extern EventLog event_log;
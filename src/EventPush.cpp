@@ -0,0 +1,96 @@
+/**************************************************************************************************
+  Filename:       EventPush.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Server-Sent Events on /events for Dome, SafetyMonitor, Switch and weather changes
+**************************************************************************************************/
+#include "EventPush.h"
+#include "WeatherSnapshot.h"
+
+EventPush event_push;
+
+EventPush::EventPush() : _source(EVENTS_URL), _dome(NULL), _switch(NULL), _safemon(NULL), _seq(0),
+	_dome_version(0), _safemon_version(0), _switch_version(0), _weather_version(0), _resync(false)
+{
+	// constructor
+}
+
+void EventPush::Begin(AsyncWebServer *server, Dome *dome, Switch *sw, SafetyMonitor *safemon)
+{
+	_dome = dome;
+	_switch = sw;
+	_safemon = safemon;
+
+	_source.onConnect([this](AsyncEventSourceClient *client) { _resync = true; });
+	server->addHandler(&_source);
+	SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\"\n", EVENTS_URL);
+}
+
+void EventPush::_send(const char *event, JsonDocument &doc)
+{
+	char buf[384];
+
+	doc["seq"] = ++_seq;
+	serializeJson(doc, buf, sizeof(buf));
+	_source.send(buf, event, _seq);
+}
+
+void EventPush::Loop()
+{
+	bool all = _resync;
+
+	if( all )
+		_resync = false;
+	else if( _source.count() == 0 ) {					// nobody listening, skip rendering
+		_dome_version = _dome->GetVersion();
+		_safemon_version = _safemon->GetVersion();
+		_switch_version = _switch->GetVersion();
+		_weather_version = weather_snapshot.GetVersion();
+		return;
+	}
+
+	if( all || ( _dome->GetVersion() != _dome_version )) {
+		JsonDocument doc;
+		_dome_version = _dome->GetVersion();
+		doc["v"] = _dome_version;
+		doc["shutter"] = (int)_dome->GetShutter();
+		doc["slewing"] = _dome->GetSlewing();
+		_send("dome", doc);
+	}
+
+	if( all || ( _safemon->GetVersion() != _safemon_version )) {
+		JsonDocument doc;
+		_safemon_version = _safemon->GetVersion();
+		doc["v"] = _safemon_version;
+		doc["issafe"] = _safemon->IsSafe();
+		doc["inputs"] = _safemon_inputs;
+		_send("safemon", doc);
+	}
+
+	if( all || ( _switch->GetVersion() != _switch_version )) {
+		JsonDocument doc;
+		_switch_version = _switch->GetVersion();
+		doc["v"] = _switch_version;
+		JsonArray values = doc["values"].to<JsonArray>();
+		_switch->GetValues(values);
+		_send("switch", doc);
+	}
+
+	if( all || ( weather_snapshot.GetVersion() != _weather_version )) {
+		JsonDocument doc;
+		WeatherSnapshot w;
+		_weather_version = weather_snapshot.Read(w);
+		doc["v"] = _weather_version;
+		doc["tsky"] = w.values.tsky;
+		doc["tair"] = w.values.tair;
+		doc["wind"] = w.values.wind;
+		doc["hum"] = w.values.hum;
+		doc["rain"] = w.values.rain;
+		doc["light"] = w.values.light;
+		doc["clouds"] = w.values.clouds;
+		doc["stars"] = w.values.stars;
+		doc["age_ms"] = weather_age_ms(w);
+		_send("weather", doc);
+	}
+}
@@ -0,0 +1,43 @@
+/**************************************************************************************************
+  Filename:       EventPush.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Server-Sent Events on /events for Dome, SafetyMonitor, Switch and weather changes
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "Dome.h"
+#include "Switch.h"
+#include "SafetyMonitor.h"
+
+#define EVENTS_URL          "/events"
+
+/*
+ * Each event carries an increasing id (SSE "id:" field, also "seq" in the data) and the
+ * version counter of its source. A client that reconnects gets the full state again.
+ * Events: "dome" {shutter, slewing}, "safemon" {issafe, inputs}, "switch" {values[]},
+ * "weather" {tsky, tair, wind, hum, rain, light, clouds, stars, age_ms}
+ */
+class EventPush
+{
+private:
+	AsyncEventSource _source;
+	Dome *_dome;
+	Switch *_switch;
+	SafetyMonitor *_safemon;
+	uint32_t _seq;							// id of the last event sent
+	uint32_t _dome_version, _safemon_version, _switch_version, _weather_version;
+	volatile bool _resync;					// client connected, send all states
+
+	void _send(const char *event, JsonDocument &doc);
+
+public:
+	EventPush();
+	void Begin(AsyncWebServer *server, Dome *dome, Switch *sw, SafetyMonitor *safemon);
+	void Loop();							// from loop(), sends one event per changed source
+	uint32_t GetSeq() { return _seq; }
+};
+
+extern EventPush event_push;
@@ -0,0 +1,437 @@
+/**************************************************************************************************
+  Filename:       IoTask.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    real time hardware I/O task: shift registers, roof relays, safety inputs, PWM
+**************************************************************************************************/
+#include "IoTask.h"
+#include "ShiftRegister.h"
+#include "Scheduler.h"
+#include "SafetyMonitor.h"
+#include "Debouncer.h"
+#include "PwmOutput.h"
+
+Snapshot<IoInputs_t> io_inputs;
+Snapshot<IoOutputs_t> io_outputs;
+
+// shift register transport, see SR_BUS_TYPE in defines.h
+#if SR_BUS_TYPE == SR_BUS_SPI
+static ShiftRegisterSpi sr_bus;
+#elif SR_BUS_TYPE == SR_BUS_GPIO
+static ShiftRegisterGpio sr_bus;
+#else
+static ShiftRegisterBitBang sr_bus;
+#endif
+
+static TaskHandle_t io_task_handle;
+static IoTaskStats_t io_stats;
+
+// state below is owned by the I/O task
+static IoOutputs_t out;							// last consistent outputs from loop()
+static Debouncer _debouncer;					// 165 inputs, sampled every DEBOUNCE_PERIOD_MS
+static Debouncer _fc_debouncer;					// limit switches, every sample: IO_FAST_PERIOD_MS while the roof moves
+static uint32_t _slow_ms;						// last sample fed to _debouncer
+static uint16_t _raw_in;						// last raw sample, for the latency measurement
+static uint16_t _shift_reg_in, _shift_reg_out, _prev_shift_reg_out;
+static uint16_t _in_rise, _in_fall;				// edges not yet handled by the cycle
+static uint8_t _safemon_hw;						// SAFEMON_RAIN_BIT, SAFEMON_POWER_BIT
+static bool _safemon_armed, _power_armed;		// rain/power evaluation enabled in previous cycle
+static bool _fast;								// roof moving, sample and latch at IO_FAST_PERIOD_MS
+static uint16_t _lat_relay;						// relay waiting to be cut by its limit switch
+static uint32_t _lat_start_us;					// raw limit switch edge
+static IoLatencyHist_t _lat_hist;
+static volatile bool _lat_reset;
+static uint8_t _prev_sw_pwm[4];
+static PwmOutput _pwm;							// PWM 1..4
+
+static const PwmChannelConfig_t _pwm_config[4] = {
+	{OUT_PIN_PWM0, PWM0_FREQ, PWM0_BITS, PWM0_CURVE, PWM_FADE_MS},
+	{OUT_PIN_PWM1, PWM1_FREQ, PWM1_BITS, PWM1_CURVE, PWM_FADE_MS},
+	{OUT_PIN_PWM2, PWM2_FREQ, PWM2_BITS, PWM2_CURVE, PWM_FADE_MS},
+	{OUT_PIN_PWM3, PWM3_FREQ, PWM3_BITS, PWM3_CURVE, PWM_FADE_MS}
+};
+
+static Scheduler io_sched;						// timers of the I/O task
+static int8_t t_shreg_in, t_shreg_out, t_led;	// periodic: shift registers and CPU LED
+static int8_t t_rain, t_power;					// one-shot: rain delay, power delay
+
+// read inputs from shift register 165, returns uint16_t value
+static uint16_t read_shift_register( void )
+{
+	uint16_t v = sr_bus.Read();
+
+	return ((~v) & 0x3fff);
+}
+
+// put value on the shift registers 595
+static void write_shift_register( uint16_t value )
+{
+	sr_bus.Write( value );
+}
+
+// start a latency measurement on the raw edge of a limit switch while its relay is on
+static void latency_sample(uint16_t raw)
+{
+	uint16_t rise = raw & ~_raw_in;
+	uint16_t fall = ~raw & _raw_in;
+
+	_raw_in = raw;
+
+	if(( rise & BIT_FC_OPEN ) && ( _prev_shift_reg_out & BIT_ROOF_OPEN )) {
+		_lat_relay = BIT_ROOF_OPEN;
+		_lat_start_us = micros();
+	}
+	if(( rise & BIT_FC_CLOSE ) && ( _prev_shift_reg_out & BIT_ROOF_CLOSE )) {
+		_lat_relay = BIT_ROOF_CLOSE;
+		_lat_start_us = micros();
+	}
+
+	if((( fall & BIT_FC_OPEN ) && ( _lat_relay == BIT_ROOF_OPEN )) ||		// bounce, restart from next edge
+	   (( fall & BIT_FC_CLOSE ) && ( _lat_relay == BIT_ROOF_CLOSE )))
+		_lat_relay = 0;
+}
+
+// relay written to the 595, record the latency if it was cut after its limit switch
+static void latency_latch(void)
+{
+	if(( _lat_relay == 0 ) || ( _prev_shift_reg_out & _lat_relay ))
+		return;
+
+	uint32_t us = micros() - _lat_start_us;
+	uint32_t b = (us == 0) ? 0 : 32 - __builtin_clz(us);
+
+	_lat_relay = 0;
+	_lat_hist.count++;
+	_lat_hist.last_us = us;
+	if( us > _lat_hist.max_us )
+		_lat_hist.max_us = us;
+	_lat_hist.bucket[(b < IO_LAT_BUCKETS) ? b : IO_LAT_BUCKETS - 1]++;
+}
+
+// limit switches take every sample, the other inputs keep DEBOUNCE_PERIOD_MS in fast poll
+// so that their stability time (samples * period) does not change while the roof moves
+static void task_shreg_in(uint32_t now)
+{
+	const uint16_t fc = BIT_FC_OPEN | BIT_FC_CLOSE;
+	uint16_t raw = read_shift_register();
+
+	latency_sample(raw);
+	_fc_debouncer.Update(raw & fc);
+	_in_rise |= _fc_debouncer.GetRise();
+	_in_fall |= _fc_debouncer.GetFall();
+
+	if( !_fast || ( now - _slow_ms >= DEBOUNCE_PERIOD_MS )) {
+		_slow_ms = now;
+		_debouncer.Update(raw & ~fc);
+		_in_rise |= _debouncer.GetRise();
+		_in_fall |= _debouncer.GetFall();
+	}
+	_shift_reg_in = _debouncer.GetState() | _fc_debouncer.GetState();
+}
+
+static void task_shreg_out(uint32_t now)
+{
+	if( _shift_reg_out != _prev_shift_reg_out )       	// write only if changed
+	{
+		_prev_shift_reg_out = _shift_reg_out;
+		write_shift_register( _shift_reg_out );
+		latency_latch();
+	}
+}
+
+// while a roof relay is on, sample the limit switches at IO_FAST_PERIOD_MS
+static void set_fast_poll(bool fast, uint32_t now)
+{
+	if( fast == _fast )
+		return;
+
+	_fast = fast;
+	io_sched.SetPeriod(t_shreg_in, fast ? IO_FAST_PERIOD_MS : DEBOUNCE_PERIOD_MS, now);
+}
+
+static void task_led(uint32_t now)
+{
+	_shift_reg_out ^= BIT_CPU_OK;						// CPU LED 500ms ON, 500ms OFF
+}
+
+static void task_rain(uint32_t now)
+{
+	_safemon_hw |= SAFEMON_RAIN_BIT;					// rain persisted for rain_delay
+}
+
+static void task_power(uint32_t now)
+{
+	_safemon_hw |= SAFEMON_POWER_BIT;					// power outage persisted for power_delay
+}
+
+// roof relays, from Dome commands or from manual buttons if no client is connected
+static void io_dome(void)
+{
+	bool d_switch_closed = (_shift_reg_in & BIT_FC_CLOSE) != 0;
+	bool d_switch_opened = (_shift_reg_in & BIT_FC_OPEN) != 0;
+
+	if( out.dome_connected ) {
+		_shift_reg_out |= BIT_DOME;							// Dome connected LED ON
+
+		if( out.relay_close && !d_switch_closed ){			// handle close relay bit in the out shift register
+			_shift_reg_out |= BIT_ROOF_CLOSE;
+			_shift_reg_out &= ~BIT_ROOF_OPEN;
+		} else {
+			_shift_reg_out &= ~BIT_ROOF_CLOSE;
+		}
+
+		if( out.relay_open && !d_switch_opened) {			// handle open relay bit in the out shift register
+			_shift_reg_out |= BIT_ROOF_OPEN;
+			_shift_reg_out &= ~BIT_ROOF_CLOSE;
+		} else {
+			_shift_reg_out &= ~BIT_ROOF_OPEN;
+		}
+	} else {
+		_shift_reg_out &= ~BIT_DOME;		// Dome connected LED OFF
+
+#if RAIN_AUTO_CLOSE
+		if( _safemon_hw & SAFEMON_RAIN_BIT ) {			// no client to act on IsSafe, close on confirmed rain
+			if( !d_switch_closed ) {
+				_shift_reg_out |= BIT_ROOF_CLOSE;
+				_shift_reg_out &= ~BIT_ROOF_OPEN;
+			} else
+				_shift_reg_out &= ~(BIT_ROOF_CLOSE | BIT_ROOF_OPEN);	// and ignore the open button
+			return;
+		}
+#endif
+
+		bool d_close_button = (_shift_reg_in & BIT_BUTTON_CLOSE) != 0;	// if no clients connected, handle manual buttons
+		bool d_open_button = (_shift_reg_in & BIT_BUTTON_OPEN) != 0;
+
+		// set relays if conditions are met
+		if( d_close_button && !d_open_button && !d_switch_closed ) {
+			_shift_reg_out |= BIT_ROOF_CLOSE; 			// set close relay bit in the shift register
+			_shift_reg_out &= ~BIT_ROOF_OPEN;			// be sure to clear OPEN RELAY bit
+		}
+		else if( !d_close_button && d_open_button && !d_switch_opened ) {
+			_shift_reg_out |= BIT_ROOF_OPEN;   			// set open relay bit in the shift register
+			_shift_reg_out &= ~BIT_ROOF_CLOSE;			// be sure to clear CLOSE RELAY bit
+		} else {
+			_shift_reg_out &= ~BIT_ROOF_CLOSE;			// bclear CLOSE RELAY bit
+			_shift_reg_out &= ~BIT_ROOF_OPEN;			// clear OPEN RELAY bit
+		}
+	}
+}
+
+// rain and power inputs, with their delays. Evaluated with or without SafetyMonitor clients, so
+// that the rain close works during a Wi-Fi outage, once setup() has published the delays. Driven
+// by input edges, an input already active when the evaluation gets enabled counts as a rising edge.
+static void io_safemon(uint32_t now)
+{
+	uint16_t rise = _in_rise;
+	uint16_t fall = _in_fall;
+	bool power_armed = out.power_delay_ms > 0;							// enter only if power delay is > 0
+
+	if( out.safemon_connected )
+		_shift_reg_out |= BIT_SAFEMON; 									// Sefemon connected LED ON
+	else
+		_shift_reg_out &= ~BIT_SAFEMON;									// Sefemon connected LED OFF
+
+	if( !out.settings ) {												// rain delay not published yet, don't close on 0
+		io_sched.Stop(t_rain);
+		io_sched.Stop(t_power);
+		return;
+	}
+
+	if( !_safemon_armed )
+		rise |= _shift_reg_in & BIT_SAFE_RAIN;
+	if( power_armed && !_power_armed )
+		rise |= _shift_reg_in & BIT_SAFE_POWER;
+
+	if( rise & BIT_SAFE_RAIN )											// rain signal, start counting the rain delay
+		io_sched.Start(t_rain, out.rain_delay_ms, now);					// if alarm persists for rain_delay, set UNSAFE
+
+	if( fall & BIT_SAFE_RAIN ) {
+		io_sched.Stop(t_rain);											// clear timer and flag
+		_safemon_hw &= ~SAFEMON_RAIN_BIT;
+	}
+
+	if( power_armed ) {
+		if( rise & BIT_SAFE_POWER )
+			io_sched.Start(t_power, out.power_delay_ms, now);
+
+		if( fall & BIT_SAFE_POWER ) {
+			io_sched.Stop(t_power);
+			_safemon_hw &= ~SAFEMON_POWER_BIT;
+		}
+	} else {
+		io_sched.Stop(t_power);
+		_safemon_hw &= ~SAFEMON_POWER_BIT;
+	}
+
+	_safemon_armed = true;
+	_power_armed = power_armed;
+}
+
+// OUT 1..8 and PWM 1..4
+static void io_switch(uint32_t now)
+{
+	if( out.switch_connected )
+	{
+		uint32_t i;
+
+		_shift_reg_out |= BIT_SWITCH;		// Switch connected LED ON
+
+		for(i=0; i<8; i++)
+		{
+			if( out.sw_out & (1 << i) )                 // set out bits according to requested outputs
+				_shift_reg_out |= (BIT_OUT_0 >> i);
+			else
+				_shift_reg_out &= ~(BIT_OUT_0 >> i);
+		}
+
+		for(i=0; i<4; i++)
+		{
+			if( _prev_sw_pwm[i] != out.sw_pwm[i] ) {			// update pwm only if different
+				_prev_sw_pwm[i] = out.sw_pwm[i];
+				_pwm.Set(i, out.sw_pwm[i]);
+			}
+		}
+	} else {
+		uint32_t i;
+
+		_shift_reg_out &= ~BIT_SWITCH;						// Switch connected LED OFF
+
+		_shift_reg_out &= BIT_OUT_CLEAR;                  	// clear all OUT bits
+
+		for(i=0; i<4; i++)
+		{
+			if( _prev_sw_pwm[i] != 0 ) {
+				_prev_sw_pwm[i] = 0;                        // clear all PWMs
+				_pwm.Set(i, 0);
+			}
+		}
+	}
+
+	_pwm.Update(now);										// ramps run in the LEDC hardware
+}
+
+static void io_cycle(uint32_t now)
+{
+	IoOutputs_t o;
+	IoInputs_t in;
+
+	if( io_outputs.TryRead(o) )							// keep previous outputs while loop() is writing
+		out = o;
+
+	io_sched.Run(now);									// sample inputs, latch outputs, timers
+
+	io_dome();
+	io_safemon(now);
+	io_switch(now);
+
+	if(( _shift_reg_out ^ _prev_shift_reg_out ) & ( BIT_ROOF_OPEN | BIT_ROOF_CLOSE | (uint16_t)~BIT_OUT_CLEAR ))
+		task_shreg_out(now);							// latch relays and OUTs now, don't wait for the 100ms refresh
+
+	set_fast_poll(( _shift_reg_out & ( BIT_ROOF_OPEN | BIT_ROOF_CLOSE )) || out.relay_open || out.relay_close, now);
+
+	if( _lat_reset ) {
+		memset(&_lat_hist, 0, sizeof(_lat_hist));
+		_lat_reset = false;
+	}
+
+	_in_rise = 0;										// edges handled
+	_in_fall = 0;
+
+	in.shift_reg_in = _shift_reg_in;
+	in.safemon_inputs = _safemon_hw;
+	in.cycles = ++io_stats.cycles;
+	if( in.cycles == 1 )
+		io_stats.first_cycle_us = (uint32_t)esp_timer_get_time();		// inputs sampled, relays serviced
+	if( _fast )
+		io_stats.fast_cycles++;
+	io_inputs.Write(in);
+}
+
+static void io_task(void *param)
+{
+	uint32_t next_us = micros();
+
+	for(;;) {
+		uint32_t period_us = (_fast ? IO_FAST_PERIOD_MS : IO_TASK_PERIOD_MS) * 1000;
+		uint32_t start = micros();
+		int32_t late = (int32_t)(start - next_us);
+
+		if( late >= 0 ) {								// periodic cycle, not an early wake up
+			if( (uint32_t)late > io_stats.max_jitter_us )
+				io_stats.max_jitter_us = late;
+
+			next_us += period_us;
+			if( (int32_t)(start - next_us) >= 0 )		// missed a whole period, don't burst
+				next_us = start + period_us;
+		}
+
+		io_cycle(millis());
+
+		if( _fast && (int32_t)(next_us - start) > IO_FAST_PERIOD_MS * 1000 )	// entered fast poll, don't finish the slow period
+			next_us = start + IO_FAST_PERIOD_MS * 1000;
+
+		io_stats.last_exec_us = micros() - start;
+		if( io_stats.last_exec_us > io_stats.max_exec_us )
+			io_stats.max_exec_us = io_stats.last_exec_us;
+
+		int32_t wait_us = (int32_t)(next_us - micros());
+		if( wait_us > 0 )
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((wait_us + 999) / 1000));
+	}
+}
+
+// transports, debouncers and timers, before the first cycle
+static void io_init(uint32_t now)
+{
+	sr_bus.Begin();										// attach SPI peripherals if in use
+	if( !_pwm.Begin(_pwm_config, 4) )
+		log_e("PWM init failed");
+
+	_debouncer.SetSamples(0x00ff, DEBOUNCE_IN);
+	_debouncer.SetSamples(BIT_BUTTON_OPEN | BIT_BUTTON_CLOSE, DEBOUNCE_BUTTON);
+	_debouncer.SetSamples(BIT_SAFE_RAIN | BIT_SAFE_POWER, DEBOUNCE_SAFE);
+	_debouncer.Reset(0);
+	_fc_debouncer.SetSamples(BIT_FC_CLOSE | BIT_FC_OPEN, DEBOUNCE_FC);
+	_fc_debouncer.Reset(0);
+
+	_shift_reg_in = 0;
+	_shift_reg_out = 0;
+	_prev_shift_reg_out = 0;
+	_safemon_hw = 0;
+
+	t_shreg_in = io_sched.AddPeriodic("shreg_in", task_shreg_in, DEBOUNCE_PERIOD_MS, now);	// sample shift register for the debouncer
+	io_sched.Start(t_shreg_in, 0, now);														// first sample in the first cycle
+	t_shreg_out = io_sched.AddPeriodic("shreg_out", task_shreg_out, 100, now);	// write shift register every 100ms
+	t_led = io_sched.AddPeriodic("led", task_led, 500, now);						// blink CPU OK LED
+	t_rain = io_sched.AddOneShot("rain", task_rain);
+	t_power = io_sched.AddOneShot("power", task_power);
+}
+
+void io_task_begin(void)
+{
+	io_init(millis());
+	xTaskCreatePinnedToCore(io_task, "io_task", IO_TASK_STACK, NULL, IO_TASK_PRIORITY, &io_task_handle, IO_TASK_CORE);
+}
+
+void io_task_wake(void)
+{
+	if( io_task_handle != NULL )
+		xTaskNotifyGive(io_task_handle);
+}
+
+const IoTaskStats_t &io_task_stats(void)
+{
+	return io_stats;
+}
+
+const IoLatencyHist_t &io_latency_hist(void)
+{
+	return _lat_hist;
+}
+
+void io_latency_reset(void)
+{
+	_lat_reset = true;
+}
@@ -0,0 +1,64 @@
+/**************************************************************************************************
+  Filename:       IoTask.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    real time hardware I/O task: shift registers, roof relays, safety inputs, PWM
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "defines.h"
+#include "Snapshot.h"
+
+typedef struct {						// published by the I/O task
+	uint16_t shift_reg_in;				// debounced inputs from 165 chain, see BIT_IN_x, BIT_FC_x, BIT_SAFE_x
+	uint8_t safemon_inputs;				// SAFEMON_RAIN_BIT and SAFEMON_POWER_BIT after their delays
+	uint32_t cycles;					// I/O task cycles
+} IoInputs_t;
+
+typedef struct {						// published by loop()
+	bool relay_open;					// roof relays requested by Dome
+	bool relay_close;
+	uint8_t sw_out;						// OUT 1..8 requested by Switch, bit i -> OUT i+1
+	uint8_t sw_pwm[4];					// PWM 1..4 duty 0~100%
+	bool dome_connected;				// devices with connected clients
+	bool switch_connected;
+	bool safemon_connected;
+	uint32_t rain_delay_ms;				// SafetyMonitor settings
+	uint32_t power_delay_ms;
+	bool settings;						// delays above loaded, rain and power evaluated from then on
+} IoOutputs_t;
+
+typedef struct {						// loop() view of the inputs, updated once per pass
+	uint16_t state;						// debounced inputs
+	uint16_t rise;						// inputs set since previous pass
+	uint16_t fall;						// inputs cleared since previous pass
+} IoEdges_t;
+
+#define IO_LAT_BUCKETS      20          // log2 buckets of the relay latency histogram
+
+typedef struct {						// limit switch to roof relay off latency
+	uint32_t count;
+	uint32_t last_us;
+	uint32_t max_us;
+	uint32_t bucket[IO_LAT_BUCKETS];	// bucket 0: 0us, bucket i: 2^(i-1) ~ 2^i-1 us, last bucket: above
+} IoLatencyHist_t;
+
+typedef struct {
+	uint32_t cycles;
+	uint32_t fast_cycles;				// cycles run at IO_FAST_PERIOD_MS
+	uint32_t max_jitter_us;				// worst delay of a cycle start vs its period
+	uint32_t last_exec_us;				// execution time of a cycle
+	uint32_t max_exec_us;
+	uint32_t first_cycle_us;			// end of the first cycle, since reset
+} IoTaskStats_t;
+
+extern Snapshot<IoInputs_t> io_inputs;
+extern Snapshot<IoOutputs_t> io_outputs;
+extern IoEdges_t io_edges;				// defined in main.cpp
+
+void io_task_begin(void);				// call after init_IO(), starts the task pinned to IO_TASK_CORE
+void io_task_wake(void);				// run a cycle now, e.g. after outputs changed
+const IoTaskStats_t &io_task_stats(void);
+const IoLatencyHist_t &io_latency_hist(void);
+void io_latency_reset(void);			// cleared by the I/O task on its next cycle
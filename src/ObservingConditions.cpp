@@ -0,0 +1,168 @@
+/**************************************************************************************************
+  Filename:       ObservingConditions.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Device Alpaca ObservingConditions, readings of the weather station
+                  sensors not fitted to the station (pressure, wind direction, gust, sky quality,
+                  star FWHM) are left to the library, which reports them as not implemented
+**************************************************************************************************/
+#include "ObservingConditions.h"
+#include "SettingsJournal.h"
+
+ObservingConditions::ObservingConditions() : AlpacaObservingConditions(), _average_period(0), _mutex(NULL)
+{
+	// constructor
+}
+
+void ObservingConditions::Begin()
+{
+	_mutex = xSemaphoreCreateMutex();
+	AlpacaObservingConditions::Begin();
+}
+
+void ObservingConditions::Add(const WeatherFrame &f, uint32_t now_ms)
+{
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	_avg.Add(f, now_ms);
+	xSemaphoreGive(_mutex);
+}
+
+const bool ObservingConditions::_putAveragePeriod(double period)
+{
+	if(( period < 0 ) || ( period > OC_MAX_AVERAGE_PERIOD ))
+		return false;
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	_average_period = period;
+	_avg.SetWindow((uint32_t)(period * 3600000.0));
+	xSemaphoreGive(_mutex);
+
+	return true;
+}
+
+// same cost for both cases: last frame from the snapshot, or running sums of the window
+bool ObservingConditions::_value(uint8_t channel, double &value)
+{
+	WeatherSnapshot w;
+	float avg;
+	bool valid;
+
+	weather_snapshot.Read(w);
+	if( w.frames == 0 )
+		return false;
+
+	if( _average_period == 0 ) {
+		value = ws_channel(w.values, channel);
+		return ws_channel_valid(channel, (int16_t)value);
+	}
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	valid = _avg.Average(channel, millis(), avg);
+	xSemaphoreGive(_mutex);
+
+	value = avg;
+	return valid;
+}
+
+const double ObservingConditions::_getCloudCover()
+{
+	double v;
+	return _value(WS_CH_CLOUDS, v) ? v : NAN;					// %
+}
+
+// Magnus formula from temperature and humidity
+const double ObservingConditions::_getDewPoint()
+{
+	double t, h;
+
+	if( !_value(WS_CH_TAIR, t) || !_value(WS_CH_HUM, h) || ( h <= 0 ))
+		return NAN;
+
+	t /= 10.0;
+	double g = log(h / 100.0) + 17.62 * t / (243.12 + t);
+	return 243.12 * g / (17.62 - g);
+}
+
+const double ObservingConditions::_getHumidity()
+{
+	double v;
+	return _value(WS_CH_HUM, v) ? v : NAN;						// %
+}
+
+const double ObservingConditions::_getRainRate()
+{
+	double v;
+	return _value(WS_CH_RAIN, v) ? v : NAN;						// station rain signal, 0 dry
+}
+
+const double ObservingConditions::_getSkyBrightness()
+{
+	double v;
+	return _value(WS_CH_LIGHT, v) ? v : NAN;					// lux
+}
+
+const double ObservingConditions::_getSkyTemperature()
+{
+	double v;
+	return _value(WS_CH_TSKY, v) ? v / 10.0 : NAN;				// 1adu = 0.1°C
+}
+
+const double ObservingConditions::_getTemperature()
+{
+	double v;
+	return _value(WS_CH_TAIR, v) ? v / 10.0 : NAN;				// 1adu = 0.1°C
+}
+
+const double ObservingConditions::_getWindSpeed()
+{
+	double v;
+	return _value(WS_CH_WIND, v) ? v / 3.6 : NAN;				// km/h to m/s
+}
+
+// all sensors come with the same frame, seconds since it was received
+const double ObservingConditions::_getTimeSinceLastUpdate(const char *sensor)
+{
+	WeatherSnapshot w;
+
+	weather_snapshot.Read(w);
+	return (w.frames == 0) ? -1.0 : weather_age_ms(w) / 1000.0;
+}
+
+void ObservingConditions::AlpacaReadJson(JsonObject &root)
+{
+	DBG_JSON_PRINTFJ(SLOG_NOTICE, root, "OBSCOND READ BEGIN (root=<%s>) ...\n", _ser_json_);
+	AlpacaObservingConditions::AlpacaReadJson(root);
+
+	if (JsonObject obj_config = root["ObservingConditions_Configuration"]) {
+		double _ap = obj_config["Average_period"] | _average_period;
+
+		if( !_putAveragePeriod(_ap) )					// validate 0~1h
+			_putAveragePeriod(0);
+
+		SLOG_PRINTF(SLOG_INFO, "...OBSCOND READ END _average_period=%.3f\n", _average_period);
+	} else {
+		SLOG_PRINTF(SLOG_WARNING, "...OBSCOND READ END no configuration\n");
+	}
+}
+
+void ObservingConditions::AlpacaWriteJson(JsonObject &root)
+{
+	SLOG_PRINTF(SLOG_NOTICE, "OBSCOND WRITE BEGIN ...\n");
+	AlpacaObservingConditions::AlpacaWriteJson(root);
+
+	JsonObject obj_config = root["ObservingConditions_Configuration"].to<JsonObject>();
+	obj_config["Average_period"] = _average_period;
+
+	DBG_JSON_PRINTFJ(SLOG_NOTICE, root, "...OBSCOND WRITE END root=<%s>\n", _ser_json_);
+}
+
+// Average_period from the settings journal
+bool ObservingConditions::ApplySetting(const char *section, const char *key, JsonVariantConst value)
+{
+	if(( strcmp(section, "ObservingConditions_Configuration") != 0 ) || ( strcmp(key, "Average_period") != 0 ) ||
+	   !value.is<double>())
+		return false;
+
+	return _putAveragePeriod(value.as<double>());
+}
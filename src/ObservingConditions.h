@@ -0,0 +1,44 @@
+/**************************************************************************************************
+  Filename:       ObservingConditions.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Device Alpaca ObservingConditions, readings of the weather station
+**************************************************************************************************/
+#pragma once
+#include "AlpacaObservingConditions.h"
+#include "WeatherSnapshot.h"
+#include "WindowAverage.h"
+
+#define OC_MAX_AVERAGE_PERIOD   1.0         // hours, WAVG_BUCKETS * WAVG_BUCKET_MS
+
+class ObservingConditions : public AlpacaObservingConditions
+{
+private:
+	WindowAverage _avg;						// Add() in loop(), reads in the web server task
+	double _average_period;					// hours, 0 is instantaneous
+	SemaphoreHandle_t _mutex;
+
+	bool _value(uint8_t channel, double &value);	// averaged or last reading of a channel, raw units
+
+	const bool _putAveragePeriod(double period);
+	const double _getAveragePeriod() { return _average_period; }
+	const double _getCloudCover();
+	const double _getDewPoint();
+	const double _getHumidity();
+	const double _getRainRate();
+	const double _getSkyBrightness();
+	const double _getSkyTemperature();
+	const double _getTemperature();
+	const double _getWindSpeed();
+	const double _getTimeSinceLastUpdate(const char *sensor);
+
+	void AlpacaReadJson(JsonObject &root);
+	void AlpacaWriteJson(JsonObject &root);
+
+public:
+	ObservingConditions();
+	void Begin();
+	void Add(const WeatherFrame &f, uint32_t now_ms);	// from loop() for every valid frame
+	bool ApplySetting(const char *section, const char *key, JsonVariantConst value);	// from the settings journal
+};
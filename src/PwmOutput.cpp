@@ -0,0 +1,115 @@
+/**************************************************************************************************
+  Filename:       PwmOutput.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    PWM outputs on the LEDC peripheral, per channel frequency, resolution and
+                  response curve, duty changes ramped by the hardware fade engine
+**************************************************************************************************/
+#include "PwmOutput.h"
+
+#define PWM_G1(p)   pwm_cie(p)
+#define PWM_G10(p)  PWM_G1(p), PWM_G1(p + 1), PWM_G1(p + 2), PWM_G1(p + 3), PWM_G1(p + 4), \
+                    PWM_G1(p + 5), PWM_G1(p + 6), PWM_G1(p + 7), PWM_G1(p + 8), PWM_G1(p + 9)
+
+static constexpr uint16_t k_pwm_cie[101] = {
+	PWM_G10(0), PWM_G10(10), PWM_G10(20), PWM_G10(30), PWM_G10(40),
+	PWM_G10(50), PWM_G10(60), PWM_G10(70), PWM_G10(80), PWM_G10(90), PWM_G1(100)
+};
+
+static_assert(k_pwm_cie[0] == 0 && k_pwm_cie[100] == 65535, "CIE table end points");
+
+PwmOutput::PwmOutput() : _num_channels(0), _pending(false)
+{
+	// constructor
+}
+
+bool PwmOutput::Begin(const PwmChannelConfig_t *cfg, uint8_t num_channels)
+{
+	if( num_channels > PWM_MAX_CHANNELS )
+		num_channels = PWM_MAX_CHANNELS;
+
+	for(uint8_t i = 0; i < num_channels; i++) {
+		ledc_timer_config_t timer = {};
+		ledc_channel_config_t channel = {};
+
+		_cfg[i] = cfg[i];
+		_target[i] = 0;
+		_applied[i] = 0;
+		_fade_end[i] = 0;
+
+		timer.speed_mode = LEDC_HIGH_SPEED_MODE;
+		timer.duty_resolution = (ledc_timer_bit_t)cfg[i].bits;
+		timer.timer_num = (ledc_timer_t)i;
+		timer.freq_hz = cfg[i].freq_hz;
+		timer.clk_cfg = LEDC_AUTO_CLK;
+		if( ledc_timer_config(&timer) != ESP_OK ) {
+			log_e("PWM %u: %u Hz with %u bits not possible", i, cfg[i].freq_hz, cfg[i].bits);
+			return false;
+		}
+
+		channel.gpio_num = cfg[i].pin;
+		channel.speed_mode = LEDC_HIGH_SPEED_MODE;
+		channel.channel = (ledc_channel_t)i;
+		channel.intr_type = LEDC_INTR_DISABLE;
+		channel.timer_sel = (ledc_timer_t)i;
+		channel.duty = 0;
+		channel.hpoint = 0;
+		if( ledc_channel_config(&channel) != ESP_OK )
+			return false;
+	}
+
+	_num_channels = num_channels;
+
+	return ledc_fade_func_install(0) == ESP_OK;
+}
+
+uint32_t PwmOutput::_duty(uint8_t ch, uint8_t percent)
+{
+	uint32_t g = ( _cfg[ch].curve == PWM_CURVE_CIE ) ? k_pwm_cie[percent] : pwm_linear(percent);
+
+	return (uint32_t)((((uint64_t)g << _cfg[ch].bits) + 32767) / 65535);	// 100% -> 1 << bits, always on
+}
+
+void PwmOutput::Set(uint8_t ch, uint8_t percent)
+{
+	if( ch >= _num_channels )
+		return;
+
+	_target[ch] = ( percent > 100 ) ? 100 : percent;
+	_pending |= ( _target[ch] != _applied[ch] );
+}
+
+void PwmOutput::Update(uint32_t now)
+{
+	if( !_pending )
+		return;
+
+	_pending = false;
+	for(uint8_t ch = 0; ch < _num_channels; ch++) {
+		if( _target[ch] == _applied[ch] )
+			continue;
+
+		if( (int32_t)(now - _fade_end[ch]) < 0 ) {			// a new fade would block until this one ends
+			_pending = true;
+			continue;
+		}
+
+		uint32_t duty = _duty(ch, _target[ch]);
+
+		_applied[ch] = _target[ch];
+		if( _cfg[ch].fade_ms == 0 ) {
+			ledc_set_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch, duty);
+			ledc_update_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch);
+		} else {
+			ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch, duty, _cfg[ch].fade_ms);
+			ledc_fade_start(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch, LEDC_FADE_NO_WAIT);
+			_fade_end[ch] = now + _cfg[ch].fade_ms + 1;
+		}
+	}
+}
+
+uint32_t PwmOutput::GetDuty(uint8_t ch)
+{
+	return ( ch < _num_channels ) ? ledc_get_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch) : 0;
+}
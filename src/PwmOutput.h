@@ -0,0 +1,57 @@
+/**************************************************************************************************
+  Filename:       PwmOutput.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    PWM outputs on the LEDC peripheral, per channel frequency, resolution and
+                  response curve, duty changes ramped by the hardware fade engine
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <driver/ledc.h>
+
+#define PWM_MAX_CHANNELS    4           // one LEDC timer per channel, high speed mode
+
+#define PWM_CURVE_LINEAR    0           // duty proportional to percent, e.g. dew heaters
+#define PWM_CURVE_CIE       1           // CIE 1976 lightness, e.g. LED flat panels
+
+typedef struct {
+	uint8_t pin;
+	uint32_t freq_hz;
+	uint8_t bits;						// duty resolution, freq_hz << bits must not exceed 80MHz
+	uint8_t curve;						// PWM_CURVE_x
+	uint16_t fade_ms;					// ramp time of a duty change, 0 to step
+} PwmChannelConfig_t;
+
+// 0~100% to 16 bit duty, evaluated at compile time for the tables
+constexpr uint16_t pwm_linear(uint32_t p)
+{
+	return (uint16_t)((p * 65535UL + 50) / 100);
+}
+
+constexpr uint16_t pwm_cie(uint32_t p)
+{
+	return (p <= 8) ? (uint16_t)((p * 655350UL + 4516) / 9033)						// L / 903.3
+					: (uint16_t)(((p + 16) * (p + 16) * (p + 16) * 65535ULL + 780448) / 1560896);	// ((L + 16) / 116)^3
+}
+
+class PwmOutput
+{
+private:
+	PwmChannelConfig_t _cfg[PWM_MAX_CHANNELS];
+	uint8_t _num_channels;
+	uint8_t _target[PWM_MAX_CHANNELS];		// requested percent
+	uint8_t _applied[PWM_MAX_CHANNELS];		// percent of the last fade started
+	uint32_t _fade_end[PWM_MAX_CHANNELS];	// millis() when the running fade ends
+	bool _pending;
+
+	uint32_t _duty(uint8_t ch, uint8_t percent);
+
+public:
+	PwmOutput();
+	bool Begin(const PwmChannelConfig_t *cfg, uint8_t num_channels);
+	void Set(uint8_t ch, uint8_t percent);	// 0~100%, applied by Update()
+	void Update(uint32_t now);				// start fades of changed channels, never waits on a running fade
+	uint32_t GetDuty(uint8_t ch);			// current hardware duty
+	uint32_t GetMaxDuty(uint8_t ch) { return 1UL << _cfg[ch].bits; }
+};
@@ -0,0 +1,125 @@
+/**************************************************************************************************
+  Filename:       RequestStats.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    per endpoint request count, latency percentiles and free heap low-water mark,
+                  measured on the device for all web server requests, from the start of the handler
+                  to the response being queued
+**************************************************************************************************/
+#include "RequestStats.h"
+#include <ArduinoJson.h>
+#include <SLog.h>
+
+RequestStats request_stats;
+
+RequestStats::RequestStats() : _hook(this), _num_entries(0), _since_ms(0)
+{
+	// constructor
+}
+
+void RequestStats::Begin(AsyncWebServer *server)
+{
+	Reset();
+	server->addMiddleware(&_hook);
+	server->on(REQSTATS_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _report(request); });
+	SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\"\n", REQSTATS_URL);
+}
+
+void RequestStats::Reset()
+{
+	memset(_entries, 0, sizeof(_entries));
+	strcpy(_entries[REQSTATS_ENDPOINTS].url, "other");
+	_num_entries = 0;
+	_since_ms = millis();
+}
+
+uint8_t RequestStats::_find(const String &url)
+{
+	for(uint8_t i = 0; i < _num_entries; i++)
+		if( url.equalsIgnoreCase(_entries[i].url) )
+			return i;
+
+	if(( _num_entries >= REQSTATS_ENDPOINTS ) || ( url.length() >= REQSTATS_URL_SIZE ))
+		return REQSTATS_ENDPOINTS;
+
+	strcpy(_entries[_num_entries].url, url.c_str());
+	return _num_entries++;
+}
+
+// a request, runs in the async TCP task like the handlers
+void RequestStats::_run(AsyncWebServerRequest *request, ArMiddlewareNext &next)
+{
+	uint32_t start = micros();
+	uint8_t index = _find(request->url());
+	bool put = ( request->method() != HTTP_GET );
+	uint32_t bytes_in = request->contentLength();
+
+	next();										// handler, response queued on return
+	_end(index, put, start, bytes_in);
+}
+
+// handler done
+void RequestStats::_end(uint8_t index, bool put, uint32_t start_us, uint32_t bytes_in)
+{
+	RequestStatsEntry_t &e = _entries[index];
+	uint32_t us = micros() - start_us;
+	uint32_t b = (us == 0) ? 0 : 32 - __builtin_clz(us);
+	uint32_t heap = ESP.getFreeHeap();
+
+	if( put ) e.put++; else e.get++;
+	if( us > e.max_us ) e.max_us = us;
+	if(( e.min_free_heap == 0 ) || ( heap < e.min_free_heap )) e.min_free_heap = heap;
+	if( bytes_in > e.max_bytes_in ) e.max_bytes_in = bytes_in;
+	e.bucket[(b < REQSTATS_BUCKETS) ? b : REQSTATS_BUCKETS - 1]++;
+}
+
+// upper bound in us of the bucket holding the per_mille percentile
+uint32_t RequestStats::_percentile(const RequestStatsEntry_t &e, uint32_t count, uint32_t per_mille)
+{
+	uint32_t rank = (count * per_mille + 999) / 1000;
+	uint32_t sum = 0;
+
+	for(uint32_t i = 0; i < REQSTATS_BUCKETS; i++) {
+		sum += e.bucket[i];
+		if( sum >= rank )
+			return (i == REQSTATS_BUCKETS - 1) ? e.max_us : (1UL << i) - 1;
+	}
+	return e.max_us;
+}
+
+void RequestStats::_report(AsyncWebServerRequest *request)
+{
+	JsonDocument doc;
+	String body;
+
+	doc["period_ms"] = millis() - _since_ms;
+	doc["free_heap"] = ESP.getFreeHeap();
+	doc["min_free_heap"] = ESP.getMinFreeHeap();
+	JsonArray arr = doc["endpoints"].to<JsonArray>();
+
+	for(uint8_t i = 0; i <= REQSTATS_ENDPOINTS; i++) {
+		const RequestStatsEntry_t &e = _entries[i];
+		uint32_t count = e.get + e.put;
+
+		if(( i >= _num_entries && i != REQSTATS_ENDPOINTS ) || ( count == 0 ))
+			continue;
+
+		JsonObject obj = arr.add<JsonObject>();
+		obj["url"] = e.url;
+		obj["get"] = e.get;
+		obj["put"] = e.put;
+		obj["p50_us"] = _percentile(e, count, 500);
+		obj["p99_us"] = _percentile(e, count, 990);
+		obj["p999_us"] = _percentile(e, count, 999);
+		obj["max_us"] = e.max_us;
+		obj["min_free_heap"] = e.min_free_heap;
+		obj["max_bytes_in"] = e.max_bytes_in;
+	}
+
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+
+	if( request->hasParam("reset") )
+		Reset();
+}
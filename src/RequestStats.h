@@ -0,0 +1,58 @@
+/**************************************************************************************************
+  Filename:       RequestStats.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    per endpoint request count, latency percentiles and free heap low-water mark,
+                  measured on the device for all web server requests, from the start of the handler
+                  to the response being queued. A middleware, the request onDisconnect() slot stays
+                  free for the handlers.
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#define REQSTATS_URL            "/stats/requests"   // GET, ?reset=1 clears after reporting
+#define REQSTATS_ENDPOINTS      40          // distinct urls tracked, others counted as "other"
+#define REQSTATS_URL_SIZE       48
+#define REQSTATS_BUCKETS        24          // log2 latency buckets, bucket i: 2^(i-1) ~ 2^i-1 us
+
+typedef struct {
+	char url[REQSTATS_URL_SIZE];
+	uint32_t get, put;						// requests by method
+	uint32_t max_us;
+	uint32_t min_free_heap;					// lowest free heap seen at the end of a request
+	uint32_t max_bytes_in;					// largest request body
+	uint32_t bucket[REQSTATS_BUCKETS];
+} RequestStatsEntry_t;
+
+class RequestStats
+{
+private:
+	class Hook : public AsyncMiddleware		// runs around the handler of every request
+	{
+	private:
+		RequestStats *_stats;
+	public:
+		Hook(RequestStats *stats) : _stats(stats) {}
+		void run(AsyncWebServerRequest *request, ArMiddlewareNext next) override { _stats->_run(request, next); }
+	};
+
+	Hook _hook;
+	RequestStatsEntry_t _entries[REQSTATS_ENDPOINTS + 1];	// last one: other
+	uint8_t _num_entries;
+	uint32_t _since_ms;						// millis() of last reset
+
+	void _run(AsyncWebServerRequest *request, ArMiddlewareNext &next);
+	void _end(uint8_t index, bool put, uint32_t start_us, uint32_t bytes_in);
+	uint8_t _find(const String &url);
+	void _report(AsyncWebServerRequest *request);
+	static uint32_t _percentile(const RequestStatsEntry_t &e, uint32_t count, uint32_t per_mille);
+
+public:
+	RequestStats();
+	void Begin(AsyncWebServer *server);
+	void Reset();
+};
+
+extern RequestStats request_stats;
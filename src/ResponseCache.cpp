@@ -0,0 +1,109 @@
+/**************************************************************************************************
+  Filename:       ResponseCache.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    pre-rendered responses of hot Alpaca GET endpoints, invalidated by device versions
+**************************************************************************************************/
+#include "ResponseCache.h"
+#include "AlpacaActions.h"
+#include <SLog.h>
+
+ResponseCache response_cache;
+
+ResponseCache::ResponseCache() : _num_entries(0), _num_slots(0), _stats({0, 0})
+{
+	// constructor
+}
+
+bool ResponseCache::Add(const char *url, uint8_t num_ids, CacheConnected_t connected, CacheVersion_t version, CacheRender_t render)
+{
+	uint8_t slots = (num_ids == 0) ? 1 : num_ids;
+
+	if(( _num_entries >= RESPONSE_CACHE_ENTRIES ) || ( _num_slots + slots > RESPONSE_CACHE_SLOTS )) {
+		SLOG_ERROR_PRINTF("ERROR! Response cache full, %s not added\n", url);
+		return false;
+	}
+
+	Entry_t &e = _entries[_num_entries++];
+	e.url = url;
+	e.first_slot = _num_slots;
+	e.num_ids = num_ids;
+	e.connected = connected;
+	e.version = version;
+	e.render = render;
+
+	for(uint8_t i = 0; i < slots; i++)
+		_slots[_num_slots++].valid = false;
+
+	return true;
+}
+
+void ResponseCache::Begin(AsyncWebServer *server)
+{
+	for(uint8_t i = 0; i < _num_entries; i++) {
+		Entry_t *e = &_entries[i];
+
+		SLOG_PRINTF(SLOG_INFO, "REGISTER cached handler for \"%s\"\n", e->url);
+		server->on(e->url, HTTP_GET, [this, e](AsyncWebServerRequest *request) { _handle(request, *e); });
+	}
+}
+
+void ResponseCache::_sendError(AsyncWebServerRequest *request, int32_t error, const char *message)
+{
+	char buf[RESPONSE_CACHE_BODY + 24];
+
+	snprintf(buf, sizeof(buf), "{\"Value\":0,\"ClientTransactionID\":%lu,\"ServerTransactionID\":%lu,"
+			 "\"ErrorNumber\":%d,\"ErrorMessage\":\"%s\"}",
+			 (unsigned long)AlpacaActions::GetParam(request, "ClientTransactionID").toInt(),
+			 (unsigned long)alpaca_actions.NextServerTransactionID(), error, message);
+	request->send(200, "application/json", buf);
+}
+
+void ResponseCache::_handle(AsyncWebServerRequest *request, Entry_t &e)
+{
+	uint32_t id = 0;
+	char buf[RESPONSE_CACHE_BODY + 24];
+
+	if( !e.connected() ) {									// same answer as the library handlers
+		_sendError(request, ALPACA_ERR_NOT_CONNECTED, "Not connected");
+		return;
+	}
+
+	if( e.num_ids > 0 ) {
+		String s = AlpacaActions::GetParam(request, "Id");
+		char *end;
+
+		if( s.isEmpty() ) {
+			request->send(400, "text/plain", "Missing parameter Id");
+			return;
+		}
+
+		id = strtoul(s.c_str(), &end, 10);
+		if(( *end != 0 ) || ( id >= e.num_ids )) {
+			_sendError(request, ALPACA_ERR_INVALID_VALUE, "Invalid Id");
+			return;
+		}
+	}
+
+	Slot_t &slot = _slots[e.first_slot + id];
+	uint32_t version = e.version();
+
+	if( !slot.valid || ( slot.version != version )) {		// render once per state change
+		char value[RESPONSE_CACHE_BODY / 2];
+
+		e.render(id, value, sizeof(value));
+		snprintf(slot.body, sizeof(slot.body), "{\"Value\":%s,\"ClientTransactionID\":%%lu,\"ServerTransactionID\":%%lu,"
+				 "\"ErrorNumber\":0,\"ErrorMessage\":\"\"}", value);
+		slot.version = version;
+		slot.valid = true;
+		_stats.renders++;
+	} else {
+		_stats.hits++;
+	}
+
+	snprintf(buf, sizeof(buf), slot.body,
+			 (unsigned long)AlpacaActions::GetParam(request, "ClientTransactionID").toInt(),
+			 (unsigned long)alpaca_actions.NextServerTransactionID());
+	request->send(200, "application/json", buf);
+}
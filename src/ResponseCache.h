@@ -0,0 +1,60 @@
+/**************************************************************************************************
+  Filename:       ResponseCache.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    pre-rendered responses of hot Alpaca GET endpoints, invalidated by device versions
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <ESPAsyncWebServer.h>
+
+#define RESPONSE_CACHE_ENTRIES  8           // endpoints
+#define RESPONSE_CACHE_SLOTS    32          // rendered bodies, one per endpoint or per Id
+#define RESPONSE_CACHE_BODY     128         // size of a rendered body
+
+typedef std::function<uint32_t()> CacheVersion_t;						// state version of the device
+typedef std::function<bool()> CacheConnected_t;							// device has connected clients
+typedef std::function<void(uint32_t id, char *value, size_t size)> CacheRender_t;	// JSON literal of Value
+
+typedef struct {
+	uint32_t hits;
+	uint32_t renders;
+} ResponseCacheStats_t;
+
+class ResponseCache
+{
+private:
+	typedef struct {
+		bool valid;
+		uint32_t version;					// device version of body
+		char body[RESPONSE_CACHE_BODY];		// response with %lu placeholders for the transaction ids
+	} Slot_t;
+
+	typedef struct {
+		const char *url;
+		uint8_t first_slot;
+		uint8_t num_ids;					// 0: no Id parameter
+		CacheConnected_t connected;
+		CacheVersion_t version;
+		CacheRender_t render;
+	} Entry_t;
+
+	Entry_t _entries[RESPONSE_CACHE_ENTRIES];
+	Slot_t _slots[RESPONSE_CACHE_SLOTS];
+	uint8_t _num_entries;
+	uint8_t _num_slots;
+	ResponseCacheStats_t _stats;
+
+	void _handle(AsyncWebServerRequest *request, Entry_t &e);
+	void _sendError(AsyncWebServerRequest *request, int32_t error, const char *message);
+
+public:
+	ResponseCache();
+	bool Add(const char *url, uint8_t num_ids, CacheConnected_t connected, CacheVersion_t version, CacheRender_t render);	// before Begin()
+	void Begin(AsyncWebServer *server);		// call before AlpacaServer::RegisterCallbacks()
+	const ResponseCacheStats_t &GetStats() { return _stats; }
+};
+
+extern ResponseCache response_cache;
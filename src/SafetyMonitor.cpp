@@ -6,13 +6,68 @@
 **************************************************************************************************/
 
 #include "SafetyMonitor.h"
+#include "SettingsJournal.h"
+#include "EventLog.h"
 
 const char *const k_safemon_state_str[2] = {"Safe", "Unsafe"};
+static const char *const k_rule_input_str[5] = {"raw", "ema", "max", "median", "roc"};	// SAFETY_INPUT_x
+
+// one rule per weather channel, its keys in SafetyMonitor_Configuration and the limits accepted.
+// Limits and hysteresis are set in the units of the setup page (°C, %, ...), scale converts them
+// to the units of the channel (0.1 °C for temperatures). Delays of -1 use Weather_delay and
+// Weather_clear_delay.
+static const struct {
+	const char *use, *limit, *hysteresis, *input, *trip_delay, *clear_delay;
+	uint8_t channel;
+	uint8_t cmp;
+	int16_t scale;							// channel units per setup unit
+	int16_t min, max;						// of limit, hysteresis is 0 ~ max - min
+	int16_t limit_default, hysteresis_default;
+	uint16_t bit;
+} k_rule_config[] = {
+	{"Use_sky_temp",    "Sky_temp_limit", "Sky_temp_hysteresis", "Sky_temp_input", "Sky_temp_trip_delay", "Sky_temp_clear_delay",
+	 WS_CH_TSKY,   SAFETY_ABOVE, 10, -50, 50,   0,  2,  SAFEMON_TSKY_BIT},
+	{"Use_air_temp",    "Air_temp_limit", "Air_temp_hysteresis", "Air_temp_input", "Air_temp_trip_delay", "Air_temp_clear_delay",
+	 WS_CH_TAIR,   SAFETY_BELOW, 10, -50, 50,   0,  1,  SAFEMON_TAIR_BIT},
+	{"Use_wind",        "Wind_limit",     "Wind_hysteresis",     "Wind_input",     "Wind_trip_delay",     "Wind_clear_delay",
+	 WS_CH_WIND,   SAFETY_ABOVE, 1,  0,   100,  30, 3,  SAFEMON_WIND_BIT},
+	{"Use_humidity",    "Humidity",       "Humidity_hysteresis", "Humidity_input", "Humidity_trip_delay", "Humidity_clear_delay",
+	 WS_CH_HUM,    SAFETY_ABOVE, 1,  0,   100,  90, 3,  SAFEMON_HUM_BIT},
+	{"Use_rain_sensor", "Rain_limit",     "Rain_hysteresis",     "Rain_input",     "Rain_trip_delay",     "Rain_clear_delay",
+	 WS_CH_RAIN,   SAFETY_ABOVE, 1,  0,   9999, 0,  0,  SAFEMON_WS_RAIN_BIT},
+	{"Use_light",       "Ambient_light",  "Light_hysteresis",    "Light_input",    "Light_trip_delay",    "Light_clear_delay",
+	 WS_CH_LIGHT,  SAFETY_ABOVE, 1,  0,   100,  50, 5,  SAFEMON_LIGHT_BIT},
+	{"Use_clouds",      "Clouds_limit",   "Clouds_hysteresis",   "Clouds_input",   "Clouds_trip_delay",   "Clouds_clear_delay",
+	 WS_CH_CLOUDS, SAFETY_ABOVE, 1,  0,   100,  50, 10, SAFEMON_CLOUDS_BIT},
+	{"Use_stars",       "Stars_limit",    "Stars_hysteresis",    "Stars_input",    "Stars_trip_delay",    "Stars_clear_delay",
+	 WS_CH_STARS,  SAFETY_BELOW, 1,  0,   9999, 10, 5,  SAFEMON_STARS_BIT}
+};
+#define NUM_RULES   (sizeof(k_rule_config) / sizeof(k_rule_config[0]))
 
 SafetyMonitor::SafetyMonitor() : AlpacaSafetyMonitor()
 {
 	// constructor
 	_is_safe = true;
+	_prev_inputs = 0;
+	_version = 0;
+	_weather_delay = 10;
+	_weather_clear_delay = 0;
+
+	for(uint32_t i = 0; i < NUM_RULES; i++) {			// rule i is k_rule_config[i], all disabled
+		_rules.Add(k_rule_config[i].channel, k_rule_config[i].cmp, k_rule_config[i].limit_default * k_rule_config[i].scale,
+				   k_rule_config[i].hysteresis_default * k_rule_config[i].scale, k_rule_config[i].bit);
+		_rule_trip_delay[i] = -1;
+		_rule_clear_delay[i] = -1;
+	}
+	_applyDelays();
+}
+
+// per rule delays, or the Weather_delay / Weather_clear_delay defaults
+void SafetyMonitor::_applyDelays()
+{
+	for(uint32_t i = 0; i < NUM_RULES; i++)
+		_rules.SetDelays(i, (( _rule_trip_delay[i] >= 0 ) ? _rule_trip_delay[i] : _weather_delay) * 1000,
+						 (( _rule_clear_delay[i] >= 0 ) ? _rule_clear_delay[i] : _weather_clear_delay) * 1000);
 }
 
 void SafetyMonitor::Begin()
@@ -22,58 +77,74 @@ void SafetyMonitor::Begin()
 
 void SafetyMonitor::Loop()
 {
+	WeatherSnapshot w;
+	weather_snapshot.Read(w);						// one coherent frame from weather station
+
 	if( is_ws_connected ) {
-		if( _use_tsky ) {
-			if( weather_tsky > _tsky_limit ) {
-				if(tmr_ws_sky_ini == 0) {
-					tmr_ws_sky_ini = millis();
-					tmr_ws_sky_len = _weather_delay * 1000;
-				}
+		uint16_t bits = _rules.Evaluate(w, millis());
+		_safemon_inputs = (_safemon_inputs & ~SAFEMON_WEATHER_BITS) | bits;
+	} else {
+		_safemon_inputs &= ~SAFEMON_WEATHER_BITS;	// mask all weather bits
+		_rules.Reset();
+	}
+	
+	if( _safemon_inputs == 0 )
+		_is_safe = true;
+	else
+		_is_safe = false;
 
-				if(( weather_tsky > _tsky_limit ) && (tmr_ws_sky_ini != 0) && ((millis() - tmr_ws_sky_ini) > tmr_ws_sky_len))
-					_safemon_inputs |= SAFEMON_TSKY_BIT;
-			}
-			else
-			{
-				_safemon_inputs &= ~SAFEMON_TSKY_BIT;
-				tmr_ws_sky_ini = 0;
-			}
-		} else {
-			_safemon_inputs &= ~SAFEMON_TSKY_BIT;
-			tmr_ws_sky_ini = 0;
+	if( _safemon_inputs != _prev_inputs ) {
+		event_log.Add(EVLOG_SRC_SAFEMON, _is_safe ? 0 : 1, _safemon_inputs | ((uint32_t)_prev_inputs << 16));
+		_prev_inputs = _safemon_inputs;
+		_version++;
+	}
+}
+
+// Use_x, x limit, x hysteresis, x input or x delays of a weather rule, false if not a rule key or out of range
+bool SafetyMonitor::_setRuleKey(const char *key, JsonVariantConst value)
+{
+	int32_t v;
+
+	for(uint32_t i = 0; i < NUM_RULES; i++) {
+		SafetyRule_t &r = _rules.Get(i);
+
+		if( strcmp(key, k_rule_config[i].use) == 0 )
+			return settings_bool(value, r.enabled);
+
+		if(( strcmp(key, k_rule_config[i].limit) == 0 ) && settings_int(value, k_rule_config[i].min, k_rule_config[i].max, v)) {
+			r.threshold = (int16_t)(v * k_rule_config[i].scale);
+			return true;
 		}
 
-		if( _use_wind ) {
-			if( weather_wind > _wind_limit ) {
-				if(tmr_ws_wind_ini == 0) {
-					tmr_ws_wind_ini = millis();
-					tmr_ws_wind_len = _weather_delay * 1000;
-				}
+		if(( strcmp(key, k_rule_config[i].trip_delay) == 0 ) && settings_int(value, -1, 600, v)) {
+			_rule_trip_delay[i] = (int16_t)v;
+			_applyDelays();
+			return true;
+		}
 
-				if(( weather_wind > _wind_limit ) && (tmr_ws_wind_ini != 0) && ((millis() - tmr_ws_wind_ini) > tmr_ws_wind_len))
-					_safemon_inputs |= SAFEMON_WIND_BIT;
-			}
-			else
-			{
-				_safemon_inputs &= ~SAFEMON_WIND_BIT;
-				tmr_ws_wind_ini = 0;
+		if(( strcmp(key, k_rule_config[i].clear_delay) == 0 ) && settings_int(value, -1, 600, v)) {
+			_rule_clear_delay[i] = (int16_t)v;
+			_applyDelays();
+			return true;
+		}
+
+		if(( strcmp(key, k_rule_config[i].input) == 0 ) && value.is<const char *>()) {
+			for(uint8_t in = 0; in < sizeof(k_rule_input_str) / sizeof(k_rule_input_str[0]); in++) {
+				if( strcasecmp(value.as<const char *>(), k_rule_input_str[in]) == 0 ) {
+					r.input = in;
+					return true;
+				}
 			}
-		} else {
-			_safemon_inputs &= ~SAFEMON_WIND_BIT;
-			tmr_ws_wind_ini = 0;
+			return false;
 		}
 
-	} else {
-		_safemon_inputs &= 0x3;						// mask all weather bits
-		tmr_ws_sky_ini = 0;
-		tmr_ws_wind_ini = 0;
+		if(( strcmp(key, k_rule_config[i].hysteresis) == 0 ) && settings_int(value, 0, k_rule_config[i].max - k_rule_config[i].min, v)) {
+			r.hysteresis = (int16_t)(v * k_rule_config[i].scale);
+			return true;
+		}
 	}
-	
-	if( _safemon_inputs == 0 )
-		_is_safe = true;
-	else
-		_is_safe = false;
 
+	return false;
 }
 
 const bool SafetyMonitor::_getIsSafe()
@@ -85,22 +156,13 @@ void SafetyMonitor::AlpacaReadJson(JsonObject &root)
 {
 	DBG_JSON_PRINTFJ(SLOG_NOTICE, root, "SAFEMON READ BEGIN (root=<%s>) ...\n", _ser_json_);
 	AlpacaSafetyMonitor::AlpacaReadJson(root);
-	bool _valid;
 
 	if (JsonObject obj_config = root["SafetyMonitor_Configuration"])
 	{
 		uint32_t _rd = obj_config["Rain_delay"] | _rain_delay;
 		uint32_t _pd = obj_config["Power_off_delay"] | _power_delay;
 		uint32_t _wd = obj_config["Weather_delay"] | _weather_delay;
-
-		String _str_st =(obj_config["Use_sky_temp"] | _str_st);
-		int32_t _ts = obj_config["Sky_temp_limit"] | _tsky_limit;
-		String _str_wi =(obj_config["Use_wind"] | _str_wi);
-		uint32_t _wi = obj_config["Wind_limit"] | _wind_limit;
-		String _str_hu =(obj_config["Use_humidity"] | _str_hu);
-		uint32_t _hu = obj_config["Humidity"] | _hum_limit;
-		String _str_li =(obj_config["Use_light"] | _str_li);
-		uint32_t _lig = obj_config["Ambient_light"] | _light_limit;
+		uint32_t _wc = obj_config["Weather_clear_delay"] | _weather_clear_delay;
 
 		if((_rd < 2) || (_rd > 60))       	// validate dalay on rain signal 2~60s
 			_rd = 2;
@@ -110,53 +172,25 @@ void SafetyMonitor::AlpacaReadJson(JsonObject &root)
 
 		if((_wd < 0) || (_wd > 600))		// validate delay for weather station (0 means not in use)
 			_wd = 10;
+
+		if( _wc > 600 )						// validate clear delay of weather rules 0~600
+			_wc = 0;
 		
 		_rain_delay = _rd;
 		_power_delay = _pd;
 		_weather_delay = _wd;
+		_weather_clear_delay = _wc;
 
-		if( !_str_st.isEmpty() ) {						// check if tsky is in use
-			_str_st.toLowerCase();
-			_use_tsky = (_str_st == "true" ? true : false);
-		}
-
-		if(!((_ts < -50) || (_ts > 50))) {			// check if tsky is valid and save
-			_tsky_limit = (int16_t)_ts;
-		}
-
-		if( !_str_wi.isEmpty() ) {						// check if wind is in use
-			_str_wi.toLowerCase();
-			_use_wind = (_str_wi == "true" ? true : false);
-		}
-
-		if(!((_wi < 0) || (_wi > 100))) {			// check if wind is valid and save
-			_wind_limit = (int16_t)_wi;
-		}
-
-		if( !_str_hu.isEmpty() ) {						// check if humidity is in use
-			_str_hu.toLowerCase();
-			_use_hum = (_str_hu == "true" ? true : false);
-		}
-
-		if(!((_hu < 0) || (_hu > 100))) {
-			_hum_limit = (int16_t)_hu;
-		}		
-
-		if( !_str_li.isEmpty() ) {						// check if light is in use
-			_str_li.toLowerCase();
-			_use_light = (_str_li == "true" ? true : false);
-		}
+		for(JsonPair kv : obj_config)		// rule keys, invalid values keep the current setting
+			_setRuleKey(kv.key().c_str(), kv.value());
+		_applyDelays();
 
-		if(!((_lig < 0) || (_lig > 100))) {
-			_light_limit = (int16_t)_lig;
+		for(uint32_t i = 0; i < NUM_RULES; i++) {
+			const SafetyRule_t &r = _rules.Get(i);
+			SLOG_PRINTF(SLOG_INFO, "SAFEMON rule %s %s limit=%i hysteresis=%i input=%s trip=%ums clear=%ums\n", k_rule_config[i].limit,
+						r.enabled ? "in use" : "not used", r.threshold, r.hysteresis, k_rule_input_str[r.input], r.trip_ms, r.clear_ms);
 		}
 
-		char _msg[256];
-		snprintf(_msg, sizeof(_msg), "ReadJson tsky limit %i, tsky in use %s, wind limit %i, wind in use %s", _tsky_limit, _use_tsky ? "Yes" : "No", _wind_limit, _use_wind ? "Yes" : "No");
-		Serial.println(_msg);
-		snprintf(_msg, sizeof(_msg), "         hum limit %i, hum in use %s, light limit %i, light in use %s", _hum_limit, _use_hum ? "Yes" : "No", _light_limit, _use_light ? "Yes" : "No");
-		Serial.println(_msg);
-
 		SLOG_PRINTF(SLOG_INFO, "...SAFEMON READ END _rain_delay=%i _power_delay=%i\n", (int)_rain_delay, (int)_power_delay);
 	} else {
 		SLOG_PRINTF(SLOG_WARNING, "...SAFEMON READ END no configuration\n");
@@ -167,32 +201,49 @@ void SafetyMonitor::AlpacaWriteJson(JsonObject &root)
 {
 	SLOG_PRINTF(SLOG_NOTICE, "SAFEMON WRITE BEGIN ...\n");
 	AlpacaSafetyMonitor::AlpacaWriteJson(root);
-	char buff[16];
 
 	// Config
 	JsonObject obj_config = root["SafetyMonitor_Configuration"].to<JsonObject>();
 	obj_config["Rain_delay"] = _rain_delay;
 	obj_config["Power_off_delay"] = _power_delay;
 	obj_config["Weather_delay"] = _weather_delay;
-
-	obj_config["Use_sky_temp"] = (_use_tsky == true);
-	obj_config["Sky_temp_limit"] = _tsky_limit;
-	obj_config["Use_wind"] = (_use_wind == true);
-	obj_config["Wind_limit"] = _wind_limit;
-	obj_config["Use_humidity"] = (_use_hum == true);
-	obj_config["Humidity"] = _hum_limit;
-	obj_config["Use_light"] = (_use_light == true);
-	obj_config["Ambient_light"] = _light_limit;
-
-	char _msg[256];
-	snprintf(_msg, sizeof(_msg), "WriteJson tsky limit %i, tsky in use %s, wind limit %i, wind in use %s", _tsky_limit, _use_tsky ? "Yes" : "No", _wind_limit, _use_wind ? "Yes" : "No");
-	Serial.println(_msg);
-	snprintf(_msg, sizeof(_msg), "          hum limit %i, hum in use %s, light limit %i, light in use %s", _hum_limit, _use_hum ? "Yes" : "No", _light_limit, _use_light ? "Yes" : "No");
-	Serial.println(_msg);
+	obj_config["Weather_clear_delay"] = _weather_clear_delay;
+
+	for(uint32_t i = 0; i < NUM_RULES; i++) {
+		const SafetyRule_t &r = _rules.Get(i);
+		obj_config[k_rule_config[i].use] = r.enabled;
+		obj_config[k_rule_config[i].limit] = r.threshold / k_rule_config[i].scale;
+		obj_config[k_rule_config[i].hysteresis] = r.hysteresis / k_rule_config[i].scale;
+		obj_config[k_rule_config[i].input] = k_rule_input_str[r.input];
+		obj_config[k_rule_config[i].trip_delay] = _rule_trip_delay[i];
+		obj_config[k_rule_config[i].clear_delay] = _rule_clear_delay[i];
+	}
 
 	DBG_JSON_PRINTFJ(SLOG_NOTICE, root, "...SAFEMON WRITE END root=<%s>\n", _ser_json_);
 }
 
+// one delay or weather rule key from the settings journal, same limits as AlpacaReadJson()
+bool SafetyMonitor::ApplySetting(const char *section, const char *key, JsonVariantConst value)
+{
+	int32_t v;
+
+	if( strcmp(section, "SafetyMonitor_Configuration") != 0 )
+		return false;
+
+	if(( strcmp(key, "Rain_delay") == 0 ) && settings_int(value, 2, 60, v))
+		_rain_delay = v;
+	else if(( strcmp(key, "Power_off_delay") == 0 ) && settings_int(value, 0, 600, v))
+		_power_delay = v;
+	else if(( strcmp(key, "Weather_delay") == 0 ) && settings_int(value, 0, 600, v))
+		_weather_delay = v;
+	else if(( strcmp(key, "Weather_clear_delay") == 0 ) && settings_int(value, 0, 600, v))
+		_weather_clear_delay = v;
+	else
+		return _setRuleKey(key, value);
+
+	_applyDelays();
+	return true;
+}
 
 /*
 void SafetyMonitor::AlpacaReadJson(JsonObject &root)
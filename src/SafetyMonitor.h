@@ -7,6 +7,8 @@
 
 #pragma once
 #include "AlpacaSafetyMonitor.h"
+#include "WeatherSnapshot.h"
+#include "SafetyRules.h"
 
 #define SAFEMON_RAIN_BIT        1
 #define SAFEMON_POWER_BIT       2
@@ -15,30 +17,34 @@
 #define SAFEMON_WIND_BIT        8
 #define SAFEMON_HUM_BIT         16
 #define SAFEMON_LIGHT_BIT       32
+#define SAFEMON_TAIR_BIT        64
+#define SAFEMON_WS_RAIN_BIT     128         // rain channel of the weather station
+#define SAFEMON_CLOUDS_BIT      256
+#define SAFEMON_STARS_BIT       512
+#define SAFEMON_WEATHER_BITS    0x3fc       // all rule bits
 
-extern u_int8_t _safemon_inputs;
+extern uint16_t _safemon_inputs;
 
 extern bool is_ws_connected;
-extern int16_t		weather_tsky;					              // readings from weather station
-extern int16_t		weather_tair;
-extern int16_t		weather_wind;
-extern int16_t		weather_hum;
-extern int16_t		weather_light;
 
 
 class SafetyMonitor : public AlpacaSafetyMonitor
 {
 private:
   bool _is_safe;
+  uint16_t _prev_inputs;                                    // _safemon_inputs seen by the previous Loop()
+  uint32_t _version;                                        // incremented when _safemon_inputs change
   uint32_t _rain_delay;
   uint32_t _power_delay;
-  uint32_t _weather_delay;
-  int16_t _tsky_limit, _wind_limit, _hum_limit, _light_limit;
-  bool _use_tsky, _use_wind, _use_hum, _use_light;
-  uint32_t tmr_ws_sky_ini, tmr_ws_sky_len;		          // weather station timer and alarm duration
-  uint32_t tmr_ws_wind_ini, tmr_ws_wind_len;
+  uint32_t _weather_delay;                                  // default trip delay of the weather rules
+  uint32_t _weather_clear_delay;                            // default clear delay of the weather rules
+  int16_t _rule_trip_delay[SAFETY_MAX_RULES];               // s, -1: _weather_delay
+  int16_t _rule_clear_delay[SAFETY_MAX_RULES];              // s, -1: _weather_clear_delay
+  SafetyRules _rules;                                       // one per weather channel, see k_rule_config
 
   const bool _getIsSafe();
+  bool _setRuleKey(const char *key, JsonVariantConst value);
+  void _applyDelays();
 
   void AlpacaReadJson(JsonObject &root);
   void AlpacaWriteJson(JsonObject &root);
@@ -51,5 +57,8 @@ public:
 	void Loop();
   uint32_t getRainDelay() {return _rain_delay;}
   uint32_t getPowerDelay() {return _power_delay;}
+  bool IsSafe() {return _is_safe;}
+  uint32_t GetVersion() {return _version;}
+  bool ApplySetting(const char *section, const char *key, JsonVariantConst value);	// from the settings journal
 
 };
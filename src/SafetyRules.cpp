@@ -0,0 +1,90 @@
+/**************************************************************************************************
+  Filename:       SafetyRules.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    table driven weather safety rules with hysteresis, trip and clear delays
+**************************************************************************************************/
+#include "SafetyRules.h"
+
+SafetyRules::SafetyRules() : _num_rules(0)
+{
+	// constructor
+}
+
+int8_t SafetyRules::Add(uint8_t channel, uint8_t cmp, int16_t threshold, int16_t hysteresis, uint16_t bit)
+{
+	if( _num_rules >= SAFETY_MAX_RULES )
+		return -1;
+
+	SafetyRule_t &r = _rules[_num_rules];
+	memset(&r, 0, sizeof(r));
+	r.channel = channel;
+	r.cmp = cmp;
+	r.threshold = threshold;
+	r.hysteresis = hysteresis;
+	r.bit = bit;
+
+	return _num_rules++;
+}
+
+void SafetyRules::SetDelays(uint8_t id, uint32_t trip_ms, uint32_t clear_ms)
+{
+	if( id >= _num_rules )
+		return;
+
+	_rules[id].trip_ms = trip_ms;
+	_rules[id].clear_ms = clear_ms;
+}
+
+void SafetyRules::Reset()
+{
+	for(uint8_t i = 0; i < _num_rules; i++) {
+		_rules[i].tripped = false;
+		_rules[i].pending = false;
+	}
+}
+
+uint16_t SafetyRules::Evaluate(const WeatherSnapshot &w, uint32_t now)
+{
+	uint16_t bits = 0;
+
+	for(uint8_t i = 0; i < _num_rules; i++) {
+		SafetyRule_t &r = _rules[i];
+		int16_t v = ws_channel(( r.input == SAFETY_INPUT_RAW ) ? w.values : w.filtered[r.input - 1], r.channel);
+		bool change;
+
+		if( !r.enabled ) {
+			r.tripped = false;
+			r.pending = false;
+			continue;
+		}
+		if( !ws_channel_valid(r.channel, ws_channel(w.values, r.channel)) ) {	// no sensor reading, hold the state
+			if( r.tripped )
+				bits |= r.bit;
+			continue;
+		}
+
+		if( r.tripped )									// back inside the hysteresis band
+			change = ( r.cmp == SAFETY_ABOVE ) ? ( v <= r.threshold - r.hysteresis ) : ( v >= r.threshold + r.hysteresis );
+		else
+			change = ( r.cmp == SAFETY_ABOVE ) ? ( v > r.threshold ) : ( v < r.threshold );
+
+		if( !change )
+			r.pending = false;							// condition interrupted, restart its delay
+		else if( !r.pending ) {
+			r.pending = true;
+			r.since_ms = now;
+		}
+
+		if( r.pending && (( now - r.since_ms ) >= ( r.tripped ? r.clear_ms : r.trip_ms ))) {
+			r.tripped = !r.tripped;
+			r.pending = false;
+		}
+
+		if( r.tripped )
+			bits |= r.bit;
+	}
+
+	return bits;
+}
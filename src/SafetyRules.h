@@ -0,0 +1,54 @@
+/**************************************************************************************************
+  Filename:       SafetyRules.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    table driven weather safety rules with hysteresis, trip and clear delays
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "WeatherSnapshot.h"
+
+#define SAFETY_MAX_RULES        WS_FRAME_FIELDS
+
+enum { SAFETY_ABOVE = 0, SAFETY_BELOW };	// unsafe when the channel is above / below the threshold
+
+enum {									// value compared by a rule, SAFETY_INPUT_x - 1 is WS_FILTER_x
+	SAFETY_INPUT_RAW = 0,
+	SAFETY_INPUT_EMA,
+	SAFETY_INPUT_MAX,
+	SAFETY_INPUT_MEDIAN,
+	SAFETY_INPUT_ROC
+};
+
+typedef struct {
+	uint8_t channel;						// WS_CH_x
+	uint8_t cmp;							// SAFETY_ABOVE, SAFETY_BELOW
+	uint8_t input;							// SAFETY_INPUT_x
+	bool enabled;
+	int16_t threshold;						// trips beyond threshold
+	int16_t hysteresis;						// clears only back beyond threshold -/+ hysteresis
+	uint32_t trip_ms;						// condition must persist to trip
+	uint32_t clear_ms;						// and to clear
+	uint16_t bit;							// output bit while tripped
+	// state
+	bool tripped;
+	bool pending;							// trip or clear condition running since since_ms
+	uint32_t since_ms;
+} SafetyRule_t;
+
+class SafetyRules
+{
+private:
+	SafetyRule_t _rules[SAFETY_MAX_RULES];
+	uint8_t _num_rules;
+
+public:
+	SafetyRules();
+	int8_t Add(uint8_t channel, uint8_t cmp, int16_t threshold, int16_t hysteresis, uint16_t bit);	// disabled
+	SafetyRule_t &Get(uint8_t id) { return _rules[id]; }
+	uint8_t GetNumRules() { return _num_rules; }
+	void SetDelays(uint8_t id, uint32_t trip_ms, uint32_t clear_ms);
+	void Reset();							// clear all rules, e.g. weather station lost
+	uint16_t Evaluate(const WeatherSnapshot &w, uint32_t now);	// one pass over the table, returns tripped bits
+};
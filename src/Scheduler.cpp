@@ -0,0 +1,145 @@
+/**************************************************************************************************
+  Filename:       Scheduler.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    deadline based cooperative scheduler for periodic and one-shot tasks
+**************************************************************************************************/
+#include "Scheduler.h"
+
+// true if deadline 'due' is reached, safe across millis() wrap around
+static inline bool sched_due(uint32_t now, uint32_t due) { return (int32_t)(now - due) >= 0; }
+
+Scheduler::Scheduler() : _num_tasks(0), _idle_task(NULL), _idle_us(0), _load_start_us(0)
+{
+	// constructor
+}
+
+int8_t Scheduler::_add(const char *name, SchedCallback_t callback, uint32_t period, uint32_t delay, bool active, uint32_t now)
+{
+	if( _num_tasks >= SCHED_MAX_TASKS )
+		return -1;
+
+	SchedTask_t &t = _tasks[_num_tasks];
+	t.name = name;
+	t.callback = callback;
+	t.period = period;
+	t.due = now + delay;
+	t.active = active;
+	memset(&t.stats, 0, sizeof(t.stats));
+
+	return _num_tasks++;
+}
+
+int8_t Scheduler::AddPeriodic(const char *name, SchedCallback_t callback, uint32_t period_ms, uint32_t now)
+{
+	return _add(name, callback, period_ms, period_ms, true, now);
+}
+
+int8_t Scheduler::AddOneShot(const char *name, SchedCallback_t callback)
+{
+	return _add(name, callback, 0, 0, false, 0);
+}
+
+void Scheduler::Start(int8_t id, uint32_t delay_ms, uint32_t now)
+{
+	if(( id < 0 ) || ( id >= _num_tasks ))
+		return;
+
+	_tasks[id].due = now + delay_ms;
+	_tasks[id].active = true;
+}
+
+void Scheduler::Stop(int8_t id)
+{
+	if(( id >= 0 ) && ( id < _num_tasks ))
+		_tasks[id].active = false;
+}
+
+void Scheduler::SetPeriod(int8_t id, uint32_t period_ms, uint32_t now)
+{
+	if(( id < 0 ) || ( id >= _num_tasks ) || ( _tasks[id].period == period_ms ))
+		return;
+
+	_tasks[id].period = period_ms;
+	if( (int32_t)(_tasks[id].due - (now + period_ms)) > 0 )		// don't wait the old, longer period
+		_tasks[id].due = now + period_ms;
+}
+
+uint32_t Scheduler::Run(uint32_t now)
+{
+	uint32_t next = SCHED_MAX_IDLE_MS;
+
+	for(uint8_t i = 0; i < _num_tasks; i++) {
+		SchedTask_t &t = _tasks[i];
+
+		if( !t.active )
+			continue;
+
+		if( sched_due(now, t.due) ) {
+			uint32_t late = now - t.due;
+			uint32_t t_exec = micros();
+
+			if( t.period == 0 )
+				t.active = false;							// one-shot, callback may re-arm it
+			else if( late >= t.period )
+				t.due = now + t.period;						// missed deadlines, don't burst
+			else
+				t.due += t.period;
+
+			t.callback(now);
+
+			t_exec = micros() - t_exec;
+			t.stats.runs++;
+			t.stats.last_late_ms = late;
+			if( late > t.stats.max_late_ms ) t.stats.max_late_ms = late;
+			t.stats.last_exec_us = t_exec;
+			if( t_exec > t.stats.max_exec_us ) t.stats.max_exec_us = t_exec;
+
+			if( !t.active )
+				continue;
+		}
+
+		uint32_t wait = sched_due(now, t.due) ? 0 : t.due - now;
+		if( wait < next )
+			next = wait;
+	}
+
+	return next;
+}
+
+void Scheduler::Idle(uint32_t wait_ms)
+{
+	if( wait_ms == 0 )
+		return;
+
+	if( wait_ms > SCHED_MAX_IDLE_MS )
+		wait_ms = SCHED_MAX_IDLE_MS;
+
+	int64_t t = esp_timer_get_time();
+	_idle_task = xTaskGetCurrentTaskHandle();
+	ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+	_idle_us += esp_timer_get_time() - t;
+}
+
+void Scheduler::Wake()
+{
+	if( _idle_task != NULL )
+		xTaskNotifyGive(_idle_task);
+}
+
+uint32_t Scheduler::GetBusyPercent()
+{
+	uint64_t total = esp_timer_get_time() - _load_start_us;
+
+	if(( total == 0 ) || ( _idle_us >= total ))
+		return 0;
+
+	return (uint32_t)(100 * (total - _idle_us) / total);
+}
+
+void Scheduler::ResetLoad()
+{
+	_idle_us = 0;
+	_load_start_us = esp_timer_get_time();
+}
@@ -0,0 +1,64 @@
+/**************************************************************************************************
+  Filename:       Scheduler.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    deadline based cooperative scheduler for periodic and one-shot tasks
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+#define SCHED_MAX_TASKS     8           // tasks per scheduler, table is scanned linearly
+#define SCHED_MAX_IDLE_MS   10          // longest sleep in Idle(), bounds latency of unsignalled events
+
+typedef void (*SchedCallback_t)(uint32_t now);
+
+typedef struct {
+	uint32_t runs;							// number of executions
+	uint32_t last_late_ms;					// delay between deadline and execution
+	uint32_t max_late_ms;
+	uint32_t last_exec_us;					// execution time of the callback
+	uint32_t max_exec_us;
+} SchedTaskStats_t;
+
+class Scheduler
+{
+private:
+	typedef struct {
+		const char *name;
+		SchedCallback_t callback;
+		uint32_t period;					// 0 for one-shot tasks
+		uint32_t due;						// next deadline, millis()
+		bool active;
+		SchedTaskStats_t stats;
+	} SchedTask_t;
+
+	SchedTask_t _tasks[SCHED_MAX_TASKS];
+	uint8_t _num_tasks;
+	TaskHandle_t _idle_task;				// task blocked in Idle(), woken by Wake()
+	uint64_t _idle_us;						// time spent in Idle() since ResetLoad(), 64 bit: no wrap after 71 minutes
+	uint64_t _load_start_us;
+
+	int8_t _add(const char *name, SchedCallback_t callback, uint32_t period, uint32_t delay, bool active, uint32_t now);
+
+public:
+	Scheduler();
+
+	int8_t AddPeriodic(const char *name, SchedCallback_t callback, uint32_t period_ms, uint32_t now);
+	int8_t AddOneShot(const char *name, SchedCallback_t callback);		// inactive until Start()
+
+	void Start(int8_t id, uint32_t delay_ms, uint32_t now);	// (re)arm task, first run after delay_ms
+	void Stop(int8_t id);
+	bool IsActive(int8_t id) { return (id >= 0) && (id < _num_tasks) && _tasks[id].active; }
+	void SetPeriod(int8_t id, uint32_t period_ms, uint32_t now);		// next run at most period_ms from now
+
+	uint32_t Run(uint32_t now);				// run due tasks, returns ms to the next deadline
+	void Idle(uint32_t wait_ms);			// block the calling task up to wait_ms or until Wake()
+	void Wake();							// end Idle() early, e.g. on UART or network event
+
+	uint8_t GetNumTasks() { return _num_tasks; }
+	const char *GetName(int8_t id) { return _tasks[id].name; }
+	const SchedTaskStats_t &GetStats(int8_t id) { return _tasks[id].stats; }
+	uint32_t GetBusyPercent();				// CPU busy fraction of the calling loop since ResetLoad()
+	void ResetLoad();
+};
@@ -0,0 +1,396 @@
+/**************************************************************************************************
+  Filename:       SettingsJournal.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    append only, CRC checked journal of changed settings on LittleFS, replayed over
+                  the library settings file at boot
+**************************************************************************************************/
+#include "SettingsJournal.h"
+#include <LittleFS.h>
+#include <rom/crc.h>
+#include <SLog.h>
+#include "AlpacaActions.h"
+#include <AsyncJson.h>
+
+#define SETTINGS_MAGIC      0x4A53          // "SJ"
+
+SettingsJournal settings_journal;
+
+SettingsJournal::SettingsJournal() : _mutex(NULL), _num_pending(0), _last_set_ms(0), _armed(false), _compact(false), _torn(false), _good_size(0)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+static uint32_t record_crc(uint8_t path_len, uint8_t value_len, const char *path, const char *value)
+{
+	uint8_t lens[2] = {path_len, value_len};
+	uint32_t crc = crc32_le(0, lens, sizeof(lens));
+
+	crc = crc32_le(crc, (const uint8_t *)path, path_len);
+	return crc32_le(crc, (const uint8_t *)value, value_len);
+}
+
+// one record from f, false at end of journal or on a torn/corrupt record
+bool SettingsJournal::_readRecord(File &f, char *path, char *value)
+{
+	Record_t r;
+
+	if( f.read((uint8_t *)&r, sizeof(r)) != sizeof(r) )
+		return false;
+	if(( r.magic != SETTINGS_MAGIC ) || ( r.path_len == 0 ) || ( r.path_len >= SETTINGS_PATH_SIZE ) ||
+	   ( r.value_len == 0 ) || ( r.value_len >= SETTINGS_VALUE_SIZE ))
+		return false;
+	if(( f.read((uint8_t *)path, r.path_len) != r.path_len ) || ( f.read((uint8_t *)value, r.value_len) != r.value_len ))
+		return false;
+	if( record_crc(r.path_len, r.value_len, path, value) != r.crc )
+		return false;
+
+	path[r.path_len] = 0;
+	value[r.value_len] = 0;
+	return true;
+}
+
+size_t SettingsJournal::_writeRecord(File &f, const char *path, const char *value)
+{
+	Record_t r;
+	size_t n;
+
+	r.magic = SETTINGS_MAGIC;
+	r.path_len = strlen(path);
+	r.value_len = strlen(value);
+	r.crc = record_crc(r.path_len, r.value_len, path, value);
+
+	n = f.write((const uint8_t *)&r, sizeof(r));
+	n += f.write((const uint8_t *)path, r.path_len);
+	n += f.write((const uint8_t *)value, r.value_len);
+
+	return n;
+}
+
+// "<section>/<key>" and a JSON literal to the device
+bool SettingsJournal::_applyPath(const char *path, const char *value)
+{
+	char section[SETTINGS_PATH_SIZE];
+	const char *key = strchr(path, '/');
+	JsonDocument doc;
+
+	if(( key == NULL ) || ( deserializeJson(doc, value) != DeserializationError::Ok ))
+		return false;
+
+	memcpy(section, path, key - path);
+	section[key - path] = 0;
+
+	return _apply(section, key + 1, doc.as<JsonVariantConst>());
+}
+
+void SettingsJournal::Begin(AsyncWebServer *server, SettingsApply_t apply)
+{
+	char path[SETTINGS_PATH_SIZE];
+	char value[SETTINGS_VALUE_SIZE];
+
+	_apply = apply;
+	_mutex = xSemaphoreCreateMutex();
+
+	if( LittleFS.exists(SETTINGS_JOURNAL_TMP) )			// power lost during a compaction
+		LittleFS.remove(SETTINGS_JOURNAL_TMP);
+
+	File f = LittleFS.open(SETTINGS_JOURNAL_FILE, "r");
+	if( f ) {
+		while( f.available() ) {
+			if( !_readRecord(f, path, value) ) {		// torn write at the tail, records after it would never be replayed
+				_stats.rejected++;
+				_torn = true;
+				break;
+			}
+			_good_size = f.position();
+			if( _applyPath(path, value) )
+				_stats.replayed++;
+			else
+				_stats.rejected++;
+		}
+		if( f.size() > SETTINGS_JOURNAL_MAX )
+			_compact = true;
+		f.close();
+	}
+	if( _torn && !_truncateJournal() )
+		SLOG_ERROR_PRINTF("ERROR! Cannot cut the torn tail of %s\n", SETTINGS_JOURNAL_FILE);
+
+	SLOG_PRINTF(SLOG_INFO, "SETTINGS JOURNAL replayed=%u rejected=%u\n", _stats.replayed, _stats.rejected);
+	_armed = true;
+
+	server->on(SETTINGS_JOURNAL_URL, HTTP_PUT, [this](AsyncWebServerRequest *request) { _handlePut(request); });
+	server->on(SETTINGS_JOURNAL_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _handleGet(request); });
+
+	AsyncCallbackJsonWebHandler *patch = new AsyncCallbackJsonWebHandler(SETTINGS_JOURNAL_URL,
+		[this](AsyncWebServerRequest *request, JsonVariant &json) { _handlePatch(request, json); });
+	patch->setMethod(HTTP_PATCH);
+	server->addHandler(patch);
+	SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\"\n", SETTINGS_JOURNAL_URL);
+}
+
+// one changed setting from the setup page, Value is a JSON literal or a plain string
+void SettingsJournal::_handlePut(AsyncWebServerRequest *request)
+{
+	String section = AlpacaActions::GetParam(request, "Section");
+	String key = AlpacaActions::GetParam(request, "Key");
+	String text = AlpacaActions::GetParam(request, "Value");
+	JsonDocument doc;
+
+	if( deserializeJson(doc, text) != DeserializationError::Ok )
+		doc.set(text);
+
+	if( section.isEmpty() || key.isEmpty() || !Set(section.c_str(), key.c_str(), doc.as<JsonVariantConst>()) )
+		request->send(400, "text/plain", "Invalid setting " + section + "/" + key);
+	else
+		request->send(200, "text/plain", "OK");
+}
+
+// leaves of the setup form diff, each one routed to its device by the name of the enclosing section
+void SettingsJournal::_patchObject(JsonObjectConst obj, const char *section, String &path, JsonArray rejected, uint32_t &applied)
+{
+	for(JsonPairConst kv : obj) {
+		size_t len = path.length();
+
+		path += "/";
+		path += kv.key().c_str();
+
+		if( kv.value().is<JsonObjectConst>() )
+			_patchObject(kv.value().as<JsonObjectConst>(), kv.key().c_str(), path, rejected, applied);
+		else if(( section != NULL ) && Set(section, kv.key().c_str(), kv.value()))
+			applied++;
+		else
+			rejected.add(path);
+
+		path.remove(len);
+	}
+}
+
+void SettingsJournal::_handlePatch(AsyncWebServerRequest *request, JsonVariant &json)
+{
+	JsonDocument doc;
+	String body, path;
+	uint32_t applied = 0;
+
+	if( !json.is<JsonObject>() ) {
+		request->send(400, "text/plain", "JSON object expected");
+		return;
+	}
+
+	JsonArray rejected = doc["rejected"].to<JsonArray>();
+	_patchObject(json.as<JsonObjectConst>(), NULL, path, rejected, applied);
+	doc["applied"] = applied;
+
+	serializeJson(doc, body);
+	request->send(rejected.size() == 0 ? 200 : 400, "application/json", body);
+}
+
+void SettingsJournal::_handleGet(AsyncWebServerRequest *request)
+{
+	JsonDocument doc;
+	String body;
+	File f = LittleFS.open(SETTINGS_JOURNAL_FILE, "r");
+
+	doc["replayed"] = _stats.replayed;
+	doc["rejected"] = _stats.rejected;
+	doc["changes"] = _stats.changes;
+	doc["flushes"] = _stats.flushes;
+	doc["records_written"] = _stats.records_written;
+	doc["bytes_written"] = _stats.bytes_written;
+	doc["bytes_per_change"] = ( _stats.changes > 0 ) ? (float)_stats.bytes_written / _stats.changes : 0.0f;
+	doc["compactions"] = _stats.compactions;
+	doc["pending"] = _num_pending;
+	doc["journal_size"] = f ? f.size() : 0;
+	if( f )
+		f.close();
+
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+}
+
+bool SettingsJournal::Set(const char *section, const char *key, JsonVariantConst value)
+{
+	char path[SETTINGS_PATH_SIZE];
+	char text[SETTINGS_VALUE_SIZE];
+	bool result = false;
+
+	if(( snprintf(path, sizeof(path), "%s/%s", section, key) >= (int)sizeof(path) ) ||
+	   ( serializeJson(value, text, sizeof(text)) >= sizeof(text) - 1 ))
+		return false;
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+
+	if( _apply(section, key, value) ) {
+		uint8_t i;
+
+		for(i = 0; i < _num_pending; i++)				// coalesce repeated changes of a key
+			if( strcmp(_pending[i].path, path) == 0 )
+				break;
+
+		if( i == SETTINGS_MAX_PENDING ) {				// table full, write what we have first
+			_flush();
+			i = 0;
+		}
+		if( i == _num_pending )
+			_num_pending++;
+
+		strcpy(_pending[i].path, path);
+		strcpy(_pending[i].value, text);
+		_last_set_ms = millis();
+		_stats.changes++;
+		result = true;
+	}
+
+	xSemaphoreGive(_mutex);
+
+	return result;
+}
+
+// keep the records before the torn tail: copied to a new file that replaces the journal, power loss
+// while copying leaves the torn journal for the next boot
+bool SettingsJournal::_truncateJournal()
+{
+	uint8_t buf[64];
+	size_t left = _good_size;
+	File in = LittleFS.open(SETTINGS_JOURNAL_FILE, "r");
+	File out = LittleFS.open(SETTINGS_JOURNAL_TMP, "w");
+	bool opened = in && out;
+
+	while( opened && ( left > 0 )) {
+		size_t n = in.read(buf, min(left, sizeof(buf)));
+		if(( n == 0 ) || ( out.write(buf, n) != n ))
+			break;
+		_stats.bytes_written += n;
+		left -= n;
+	}
+	if( in )
+		in.close();
+	if( out )
+		out.close();
+
+	if( !opened || ( left > 0 ) || !LittleFS.rename(SETTINGS_JOURNAL_TMP, SETTINGS_JOURNAL_FILE)) {
+		LittleFS.remove(SETTINGS_JOURNAL_TMP);
+		return false;
+	}
+	_torn = false;
+	return true;
+}
+
+// append all pending changes with one open/write, caller holds _mutex
+void SettingsJournal::_flush()
+{
+	if( _num_pending == 0 )
+		return;
+
+	if( _torn && !_truncateJournal() ) {				// keep the changes pending, appended records would be lost
+		SLOG_ERROR_PRINTF("ERROR! Cannot cut the torn tail of %s\n", SETTINGS_JOURNAL_FILE);
+		_last_set_ms = millis();						// try again after the quiet time
+		return;
+	}
+
+	File f = LittleFS.open(SETTINGS_JOURNAL_FILE, "a");
+	if( !f ) {
+		SLOG_ERROR_PRINTF("ERROR! Cannot open %s\n", SETTINGS_JOURNAL_FILE);
+		return;
+	}
+
+	for(uint8_t i = 0; i < _num_pending; i++) {
+		_stats.bytes_written += _writeRecord(f, _pending[i].path, _pending[i].value);
+		_stats.records_written++;
+	}
+	if( f.size() > SETTINGS_JOURNAL_MAX )
+		_compact = true;
+	f.close();
+
+	_num_pending = 0;
+	_stats.flushes++;
+}
+
+// keep only the last record of every key: one pass into a RAM table, written to a new file that
+// replaces the journal
+void SettingsJournal::_compactJournal()
+{
+	char path[SETTINGS_PATH_SIZE], value[SETTINGS_VALUE_SIZE];
+	Pending_t *keys;
+	uint16_t num_keys = 0;
+	bool overflow = false;
+
+	_compact = false;
+	File in = LittleFS.open(SETTINGS_JOURNAL_FILE, "r");
+	if( !in )
+		return;
+
+	keys = (Pending_t *)malloc(SETTINGS_MAX_KEYS * sizeof(Pending_t));
+	if( keys == NULL ) {
+		in.close();
+		return;
+	}
+
+	while( _readRecord(in, path, value) ) {
+		uint16_t i;
+
+		for(i = 0; i < num_keys; i++)
+			if( strcmp(keys[i].path, path) == 0 )
+				break;
+		if( i == SETTINGS_MAX_KEYS ) {
+			overflow = true;
+			break;
+		}
+		if( i == num_keys ) {
+			strcpy(keys[i].path, path);
+			num_keys++;
+		}
+		strcpy(keys[i].value, value);
+	}
+	in.close();
+
+	if( overflow ) {
+		SLOG_WARNING_PRINTF("WARNING! More than %u keys in %s, not compacted\n", SETTINGS_MAX_KEYS, SETTINGS_JOURNAL_FILE);
+	} else {
+		File out = LittleFS.open(SETTINGS_JOURNAL_TMP, "w");
+		if( out ) {
+			for(uint16_t i = 0; i < num_keys; i++)
+				_stats.bytes_written += _writeRecord(out, keys[i].path, keys[i].value);
+			out.close();
+			LittleFS.rename(SETTINGS_JOURNAL_TMP, SETTINGS_JOURNAL_FILE);
+			_stats.compactions++;
+		}
+	}
+
+	free(keys);
+}
+
+void SettingsJournal::Loop(uint32_t now)
+{
+	if( !_armed || (( _num_pending == 0 ) && !_compact ))
+		return;
+
+	if( xSemaphoreTake(_mutex, 0) != pdTRUE )			// web server is changing a setting, next pass
+		return;
+
+	if(( _num_pending > 0 ) && (( now - _last_set_ms ) >= SETTINGS_COALESCE_MS ))
+		_flush();
+
+	if( _compact && ( _num_pending == 0 ))
+		_compactJournal();
+
+	xSemaphoreGive(_mutex);
+}
+
+// no Set() while the file is written: every change applied so far is in it, pending or journaled
+bool SettingsJournal::Save(std::function<bool()> write)
+{
+	bool result;
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+	result = write();
+	if( result ) {
+		_num_pending = 0;
+		_compact = false;
+		_torn = false;
+		LittleFS.remove(SETTINGS_JOURNAL_FILE);
+	}
+	xSemaphoreGive(_mutex);
+
+	return result;
+}
@@ -0,0 +1,122 @@
+/**************************************************************************************************
+  Filename:       SettingsJournal.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    append only, CRC checked journal of changed settings on LittleFS, replayed over
+                  the library settings file at boot
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <FS.h>
+
+#define SETTINGS_JOURNAL_URL    "/setup/v1/settings"    // PUT Section, Key, Value (JSON literal), PATCH changed
+                                                        // keys as {device: {section: {key: value}}}, GET statistics
+#define SETTINGS_JOURNAL_FILE   "/settings.jnl"
+#define SETTINGS_JOURNAL_TMP    "/settings.tmp"     // compaction in progress
+#define SETTINGS_JOURNAL_MAX    4096        // compact when the journal grows above
+#define SETTINGS_COALESCE_MS    2000        // quiet time before pending changes are written
+#define SETTINGS_MAX_PENDING    16          // distinct keys waiting for the flash write
+#define SETTINGS_MAX_KEYS       128         // distinct keys of a compaction, 16 kB of heap while it runs
+#define SETTINGS_PATH_SIZE      64          // "<section>/<key>"
+#define SETTINGS_VALUE_SIZE     64          // JSON literal
+
+// applies one setting to its device, returns false if unknown or invalid
+typedef std::function<bool(const char *section, const char *key, JsonVariantConst value)> SettingsApply_t;
+
+typedef struct {
+	uint32_t replayed;						// records applied at boot
+	uint32_t rejected;						// records with bad CRC or refused by the device
+	uint32_t changes;						// Set() calls
+	uint32_t flushes;						// flash writes of coalesced changes
+	uint32_t records_written;
+	uint32_t bytes_written;
+	uint32_t compactions;
+} SettingsJournalStats_t;
+
+class SettingsJournal
+{
+private:
+	typedef struct __attribute__((packed)) {
+		uint16_t magic;
+		uint8_t path_len;
+		uint8_t value_len;
+		uint32_t crc;						// CRC32 of lengths, path and value
+	} Record_t;
+
+	typedef struct {
+		char path[SETTINGS_PATH_SIZE];
+		char value[SETTINGS_VALUE_SIZE];
+	} Pending_t;
+
+	SettingsApply_t _apply;
+	SemaphoreHandle_t _mutex;				// Set() runs in the web server task
+	Pending_t _pending[SETTINGS_MAX_PENDING];
+	uint8_t _num_pending;
+	uint32_t _last_set_ms;
+	bool _armed;							// boot replay done
+	bool _compact;							// size limit, rewrite the journal
+	bool _torn;								// journal ends in a bad record, nothing appended until cut
+	size_t _good_size;						// bytes of the records before it
+	SettingsJournalStats_t _stats;
+
+	bool _applyPath(const char *path, const char *value);
+	bool _readRecord(File &f, char *path, char *value);
+	size_t _writeRecord(File &f, const char *path, const char *value);
+	bool _truncateJournal();
+	void _flush();
+	void _compactJournal();
+	void _handlePut(AsyncWebServerRequest *request);
+	void _handleGet(AsyncWebServerRequest *request);
+	void _handlePatch(AsyncWebServerRequest *request, JsonVariant &json);
+	void _patchObject(JsonObjectConst obj, const char *section, String &path, JsonArray rejected, uint32_t &applied);
+
+public:
+	SettingsJournal();
+	void Begin(AsyncWebServer *server, SettingsApply_t apply);	// call after AlpacaServer::LoadSettings(), replays the journal
+	bool Set(const char *section, const char *key, JsonVariantConst value);	// apply now, write coalesced
+	void Loop(uint32_t now);				// from loop(): flush and compaction
+	bool Save(std::function<bool()> write);	// full settings file by write(), the journal is obsolete once it succeeded
+	const SettingsJournalStats_t &GetStats() { return _stats; }
+};
+
+// JSON booleans or "true"/"false" strings from the setup form
+static inline bool settings_bool(JsonVariantConst value, bool &out)
+{
+	if( value.is<bool>() ) {
+		out = value.as<bool>();
+		return true;
+	}
+	if( value.is<const char *>() ) {
+		if( strcasecmp(value.as<const char *>(), "true") == 0 )
+			out = true;
+		else if( strcasecmp(value.as<const char *>(), "false") == 0 )
+			out = false;
+		else
+			return false;
+		return true;
+	}
+	return false;
+}
+
+// JSON integers or numeric strings within [min, max]
+static inline bool settings_int(JsonVariantConst value, int32_t min, int32_t max, int32_t &out)
+{
+	char *end;
+
+	if( value.is<int32_t>() )
+		out = value.as<int32_t>();
+	else if( value.is<const char *>() ) {
+		out = strtol(value.as<const char *>(), &end, 10);
+		if(( end == value.as<const char *>() ) || ( *end != 0 ))
+			return false;
+	} else
+		return false;
+
+	return ( out >= min ) && ( out <= max );
+}
+
+extern SettingsJournal settings_journal;
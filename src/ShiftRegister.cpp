@@ -0,0 +1,185 @@
+/**************************************************************************************************
+  Filename:       ShiftRegister.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    transport for the 74HC165 input and 74HC595 output shift register chains
+**************************************************************************************************/
+#include "ShiftRegister.h"
+#include "soc/gpio_reg.h"
+
+#define SR_MASK(pin)        (1UL << (pin))
+
+// ~70ns at 240MHz, covers 74HC pulse width and setup times at 3.3V
+static inline void sr_settle(void) { __asm__ __volatile__("nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop;"); }
+
+uint16_t ShiftRegisterBus::Read()
+{
+	uint32_t t = micros();
+	uint16_t v = _read();
+
+	t = micros() - t;
+	_stats.reads++;
+	_stats.last_read_us = t;
+	if( t > _stats.max_read_us )
+		_stats.max_read_us = t;
+
+	return v;
+}
+
+void ShiftRegisterBus::Write(uint16_t value)
+{
+	uint32_t t = micros();
+	_write(value);
+
+	t = micros() - t;
+	_stats.writes++;
+	_stats.last_write_us = t;
+	if( t > _stats.max_write_us )
+		_stats.max_write_us = t;
+}
+
+// ---------------------------------------------------------------------------------------- bit bang
+uint16_t ShiftRegisterBitBang::_read()
+{
+	uint16_t v = 0;
+
+	digitalWrite(SR_IN_PIN_CP, LOW);    	// be sure CP is low
+	digitalWrite(SR_IN_PIN_PL, LOW);    	// latch parallel inputs
+	delayMicroseconds(1);
+	digitalWrite(SR_IN_PIN_PL, HIGH);
+	delayMicroseconds(1);
+	digitalWrite(SR_IN_PIN_CE, LOW);    	// on CE -> low, D7 is available on serial out Q7
+	delayMicroseconds(1);
+
+	for(uint16_t i=0; i<16; i++) {
+		v = (v << 1);
+		v += digitalRead(SR_IN_PIN_SDIN);
+
+		digitalWrite(SR_IN_PIN_CP, HIGH);   // shift to the left
+		delayMicroseconds(1);
+		digitalWrite(SR_IN_PIN_CP, LOW);
+		delayMicroseconds(1);
+	}
+
+	digitalWrite(SR_IN_PIN_CE, HIGH);
+
+	return v;
+}
+
+void ShiftRegisterBitBang::_write(uint16_t value)
+{
+	uint16_t v = value;
+
+	digitalWrite(SR_OUT_PIN_SDOUT, LOW);        // 14 serial data low
+	digitalWrite(SR_OUT_PIN_MR, LOW);           // 10 clear previous data
+	delayMicroseconds(1);
+	digitalWrite(SR_OUT_PIN_SHCP, HIGH);        // 11 shift register clock
+	delayMicroseconds(1);
+	digitalWrite(SR_OUT_PIN_SHCP, LOW);
+	delayMicroseconds(1);
+	digitalWrite(SR_OUT_PIN_MR, HIGH);
+	delayMicroseconds(1);
+
+	for(uint8_t i = 0; i < 16; i++) {
+		if((v & 0x8000) == 0 )
+			digitalWrite(SR_OUT_PIN_SDOUT, LOW);
+		else
+			digitalWrite(SR_OUT_PIN_SDOUT, HIGH);
+
+		delayMicroseconds(1);
+		digitalWrite(SR_OUT_PIN_SHCP, HIGH);
+		delayMicroseconds(1);
+		digitalWrite(SR_OUT_PIN_SHCP, LOW);
+
+		v = (v << 1);
+	}
+
+	delayMicroseconds(1);
+	digitalWrite(SR_OUT_PIN_STCP, HIGH);        // transfer serial data to parallel output
+	delayMicroseconds(1);
+	digitalWrite(SR_OUT_PIN_STCP, LOW);         // 12
+	digitalWrite(SR_OUT_PIN_OE, LOW);           // 13 enable output
+}
+
+// -------------------------------------------------------------------------------- GPIO registers
+uint16_t ShiftRegisterGpio::_read()
+{
+	uint16_t v = 0;
+
+	REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_IN_PIN_CP) | SR_MASK(SR_IN_PIN_PL));	// CP low, latch parallel inputs
+	sr_settle();
+	REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_IN_PIN_PL));
+	REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_IN_PIN_CE));							// D7 available on Q7
+	sr_settle();
+
+	for(uint8_t i = 0; i < 16; i++) {
+		v = (v << 1) | ((REG_READ(GPIO_IN_REG) >> SR_IN_PIN_SDIN) & 1);
+
+		REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_IN_PIN_CP));						// shift to the left
+		sr_settle();
+		REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_IN_PIN_CP));
+		sr_settle();
+	}
+
+	REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_IN_PIN_CE));
+
+	return v;
+}
+
+void ShiftRegisterGpio::_write(uint16_t value)
+{
+	for(uint8_t i = 0; i < 16; i++) {
+		if( value & 0x8000 )
+			REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_OUT_PIN_SDOUT));
+		else
+			REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_OUT_PIN_SDOUT));
+
+		sr_settle();
+		REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_OUT_PIN_SHCP));
+		sr_settle();
+		REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_OUT_PIN_SHCP));
+
+		value = (value << 1);
+	}
+
+	REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_OUT_PIN_STCP));		// transfer serial data to parallel output
+	sr_settle();
+	REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_OUT_PIN_STCP) | SR_MASK(SR_OUT_PIN_OE));	// enable output
+}
+
+// ------------------------------------------------------------------------------------ SPI (VSPI/HSPI)
+void ShiftRegisterSpi::Begin()
+{
+	_spi_in.begin(SR_IN_PIN_CP, SR_IN_PIN_SDIN, -1, -1);		// CP and Q7 only, PL and CE stay on GPIO
+	_spi_out.begin(SR_OUT_PIN_SHCP, -1, SR_OUT_PIN_SDOUT, -1);	// SHCP and DS only, STCP, MR and OE stay on GPIO
+}
+
+uint16_t ShiftRegisterSpi::_read()
+{
+	uint16_t v;
+
+	REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_IN_PIN_PL));		// latch parallel inputs
+	sr_settle();
+	REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_IN_PIN_PL));
+	REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_IN_PIN_CE));		// D7 available on Q7
+
+	_spi_in.beginTransaction(_settings);						// mode 0, Q7 is sampled before the rising edge shifts it
+	v = _spi_in.transfer16(0);
+	_spi_in.endTransaction();
+
+	REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_IN_PIN_CE));
+
+	return v;
+}
+
+void ShiftRegisterSpi::_write(uint16_t value)
+{
+	_spi_out.beginTransaction(_settings);
+	_spi_out.transfer16(value);
+	_spi_out.endTransaction();
+
+	REG_WRITE(GPIO_OUT_W1TS_REG, SR_MASK(SR_OUT_PIN_STCP));		// transfer serial data to parallel output
+	sr_settle();
+	REG_WRITE(GPIO_OUT_W1TC_REG, SR_MASK(SR_OUT_PIN_STCP) | SR_MASK(SR_OUT_PIN_OE));	// enable output
+}
@@ -0,0 +1,76 @@
+/**************************************************************************************************
+  Filename:       ShiftRegister.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    transport for the 74HC165 input and 74HC595 output shift register chains
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+#include "defines.h"
+
+typedef struct {
+	uint32_t reads;							// number of 165 transfers
+	uint32_t writes;						// number of 595 transfers
+	uint32_t last_read_us;					// duration of last transfers
+	uint32_t last_write_us;
+	uint32_t max_read_us;					// worst case durations
+	uint32_t max_write_us;
+} ShiftRegisterStats_t;
+
+// common interface of the shift register transports
+class ShiftRegisterBus
+{
+protected:
+	ShiftRegisterStats_t _stats;
+
+	virtual uint16_t _read() = 0;
+	virtual void _write(uint16_t value) = 0;
+
+public:
+	ShiftRegisterBus() : _stats() {}
+	virtual void Begin() = 0;				// call after pins are configured by init_IO()
+
+	uint16_t Read();						// raw 16 bits from 165 chain, first bit shifted in is MSB
+	void Write(uint16_t value);				// shift 16 bits MSB first into 595 chain and latch them
+	const ShiftRegisterStats_t &GetStats() { return _stats; }
+};
+
+// original implementation, digitalWrite()/digitalRead() with 1us delays between edges
+class ShiftRegisterBitBang : public ShiftRegisterBus
+{
+private:
+	uint16_t _read();
+	void _write(uint16_t value);
+
+public:
+	void Begin() {}
+};
+
+// same waveforms as bit bang, driven through GPIO W1TS/W1TC registers (all pins are < 32)
+class ShiftRegisterGpio : public ShiftRegisterBus
+{
+private:
+	uint16_t _read();
+	void _write(uint16_t value);
+
+public:
+	void Begin() {}
+};
+
+// 165 chain clocked by VSPI (CP on SCK, Q7 on MISO), 595 chain by HSPI (SHCP on SCK, DS on MOSI)
+class ShiftRegisterSpi : public ShiftRegisterBus
+{
+private:
+	SPIClass _spi_in;
+	SPIClass _spi_out;
+	SPISettings _settings;
+
+	uint16_t _read();
+	void _write(uint16_t value);
+
+public:
+	ShiftRegisterSpi() : _spi_in(VSPI), _spi_out(HSPI), _settings(SR_SPI_CLOCK, MSBFIRST, SPI_MODE0) {}
+	void Begin();
+};
@@ -0,0 +1,74 @@
+/**************************************************************************************************
+  Filename:       Snapshot.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    single writer, lock free snapshot (seqlock) to exchange state between tasks
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// T must be trivially copyable. Only one task may call Write(), any task may read.
+template <typename T>
+class Snapshot
+{
+private:
+	std::atomic<uint32_t> _seq;				// odd while a write is in progress
+	T _data;
+
+	bool _try(T &value, uint32_t &seq) const
+	{
+		uint32_t s1 = _seq.load(std::memory_order_acquire);
+		if( s1 & 1 )
+			return false;
+
+		memcpy(&value, (const void *)&_data, sizeof(T));
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		seq = s1;
+		return s1 == _seq.load(std::memory_order_relaxed);
+	}
+
+public:
+	Snapshot() : _seq(0), _data() {}
+
+	void Write(const T &value)
+	{
+		uint32_t s = _seq.load(std::memory_order_relaxed);
+
+		_seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy((void *)&_data, &value, sizeof(T));
+		_seq.store(s + 2, std::memory_order_release);
+	}
+
+	// copy of a consistent snapshot, returns its version. A reader with higher priority than the
+	// writer on the same core sleeps a tick to let the write complete.
+	uint32_t Read(T &value) const
+	{
+		uint32_t seq;
+
+		for(uint32_t tries = 0; !_try(value, seq); tries++) {
+			if( tries >= 8 )
+				vTaskDelay(1);
+		}
+
+		return seq >> 1;
+	}
+
+	// non blocking variant, false if a write is in progress. value is undefined on false.
+	bool TryRead(T &value, uint32_t *version = NULL) const
+	{
+		uint32_t seq;
+
+		if( !_try(value, seq) )
+			return false;
+
+		if( version )
+			*version = seq >> 1;
+		return true;
+	}
+
+	uint32_t GetVersion() const { return _seq.load(std::memory_order_acquire) >> 1; }
+};
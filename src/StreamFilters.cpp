@@ -0,0 +1,30 @@
+/**************************************************************************************************
+  Filename:       StreamFilters.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    fixed point streaming filters for the weather channels: EMA, sliding max (gusts),
+                  running median and rate of change. No allocation, bounded cost per sample
+**************************************************************************************************/
+#include "StreamFilters.h"
+
+// a channel without sensor (-1) is -1 in every output
+void WeatherFilters::Update(const WeatherFrame &f, uint32_t now_ms, WeatherFrame *out)
+{
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		int16_t v = ws_channel(f, c);
+		int16_t ema;
+
+		if( !ws_channel_valid(c, v) ) {
+			for(uint8_t i = 0; i < WS_FILTERS; i++)
+				((int16_t *)&out[i])[c] = v;
+			continue;
+		}
+
+		ema = _ema[c].Update(v, WS_EMA_SHIFT);
+		((int16_t *)&out[WS_FILTER_EMA])[c] = ema;
+		((int16_t *)&out[WS_FILTER_MAX])[c] = _max[c].Update(v);
+		((int16_t *)&out[WS_FILTER_MEDIAN])[c] = _median[c].Update(v);
+		((int16_t *)&out[WS_FILTER_ROC])[c] = _roc[c].Update(ema, now_ms);
+	}
+}
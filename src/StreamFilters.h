@@ -0,0 +1,139 @@
+/**************************************************************************************************
+  Filename:       StreamFilters.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    fixed point streaming filters for the weather channels: EMA, sliding max (gusts),
+                  running median and rate of change. No allocation, bounded cost per sample
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "WeatherFrame.h"
+
+#define WS_EMA_SHIFT        2           // EMA alpha = 1 / 2^shift
+#define WS_GUST_SAMPLES     10          // frames in the sliding max window
+#define WS_MEDIAN_SAMPLES   5           // frames in the running median
+
+enum {									// index of WeatherSnapshot::filtered
+	WS_FILTER_EMA = 0,
+	WS_FILTER_MAX,						// gusts
+	WS_FILTER_MEDIAN,
+	WS_FILTER_ROC,						// change of the EMA per minute
+	WS_FILTERS
+};
+
+// exponential moving average, accumulator in Q8
+class EmaFilter
+{
+private:
+	int32_t _acc;
+	bool _init;
+public:
+	EmaFilter() : _acc(0), _init(false) {}
+	int16_t Update(int16_t v, uint8_t shift)
+	{
+		if( !_init ) {
+			_acc = (int32_t)v << 8;
+			_init = true;
+		} else
+			_acc += (((int32_t)v << 8) - _acc) >> shift;
+		return (int16_t)((_acc + 128) >> 8);
+	}
+};
+
+// maximum of the last N samples, monotonic deque, O(1) amortised
+template <uint8_t N>
+class SlidingMax
+{
+private:
+	int16_t _val[N];
+	uint32_t _pos[N];					// sample number of _val
+	uint8_t _head, _size;				// deque in a ring, _head is the oldest
+	uint32_t _n;						// samples seen
+public:
+	SlidingMax() : _head(0), _size(0), _n(0) {}
+	int16_t Update(int16_t v)
+	{
+		if(( _size > 0 ) && ( _n - _pos[_head] >= N )) {			// front leaves the window, before the push
+			_head = (_head + 1) % N;								// so that at most N entries are held
+			_size--;
+		}
+		while(( _size > 0 ) && ( _val[(_head + _size - 1) % N] <= v ))	// drop smaller values from the back
+			_size--;
+		_val[(_head + _size) % N] = v;
+		_pos[(_head + _size) % N] = _n;
+		_size++;
+		_n++;
+		return _val[_head];
+	}
+};
+
+// median of the last N samples, N odd and small: O(N) insert into a sorted copy
+template <uint8_t N>
+class RunningMedian
+{
+private:
+	int16_t _ring[N];
+	int16_t _sorted[N];
+	uint8_t _next, _count;
+public:
+	RunningMedian() : _next(0), _count(0) {}
+	int16_t Update(int16_t v)
+	{
+		uint8_t i;
+
+		if( _count == N ) {											// remove the oldest from the sorted copy
+			int16_t old = _ring[_next];
+			for(i = 0; _sorted[i] != old; i++);
+			for(; i < N - 1; i++)
+				_sorted[i] = _sorted[i + 1];
+			_count--;
+		}
+		_ring[_next] = v;
+		_next = (_next + 1) % N;
+
+		for(i = _count; ( i > 0 ) && ( _sorted[i - 1] > v ); i--)		// insert
+			_sorted[i] = _sorted[i - 1];
+		_sorted[i] = v;
+		_count++;
+
+		return _sorted[_count / 2];
+	}
+};
+
+// change per minute between two samples
+class RateOfChange
+{
+private:
+	int16_t _prev;
+	uint32_t _prev_ms;
+	bool _init;
+public:
+	RateOfChange() : _prev(0), _prev_ms(0), _init(false) {}
+	int16_t Update(int16_t v, uint32_t now_ms)
+	{
+		int64_t roc = 0;
+		uint32_t dt = now_ms - _prev_ms;
+
+		if( _init && ( dt > 0 ))
+			roc = (int64_t)(v - _prev) * 60000 / dt;				// int32 overflows above a 35791 step
+		_prev = v;
+		_prev_ms = now_ms;
+		_init = true;
+
+		return (int16_t)constrain(roc, (int64_t)INT16_MIN, (int64_t)INT16_MAX);
+	}
+};
+
+// filters of every weather channel, fed with each valid frame
+class WeatherFilters
+{
+private:
+	EmaFilter _ema[WS_FRAME_FIELDS];
+	SlidingMax<WS_GUST_SAMPLES> _max[WS_FRAME_FIELDS];
+	RunningMedian<WS_MEDIAN_SAMPLES> _median[WS_FRAME_FIELDS];
+	RateOfChange _roc[WS_FRAME_FIELDS];
+
+public:
+	void Update(const WeatherFrame &f, uint32_t now_ms, WeatherFrame *out);	// out[WS_FILTERS]
+};
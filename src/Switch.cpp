@@ -6,6 +6,8 @@
   Description:    ASCOM Alpaca ESP32 TSBoard implementation
 **************************************************************************************************/
 #include "Switch.h"
+#include "SettingsJournal.h"
+#include "EventLog.h"
 
 const uint32_t k_num_of_switch_devices = 20;
 
@@ -33,7 +35,7 @@ SwitchDevice_t init_switch_device[k_num_of_switch_devices] = {
     {false, true, "Switch_19", "PWM 4 (RW)", 0.0, 0.0, 100.0, 1.0}
     };
 
-Switch::Switch() : AlpacaSwitch(k_num_of_switch_devices)
+Switch::Switch() : AlpacaSwitch(k_num_of_switch_devices), _dirty(0), _unstored(0), _version(1), _states_version(0), _states_mutex(NULL)
 {
   // constructor
   //_p_swtc = AlpacaSwitch::_p_switch_devices;
@@ -55,6 +57,18 @@ void Switch::Begin()
 
   AlpacaSwitch::Begin();
 
+  for(uint32_t i=0; i<8; i++)                 // initial OUTs and PWMs, later changes come from _writeSwitchValue()
+    _sw_out[i] = AlpacaSwitch::GetValue(i + 8);
+  for(uint32_t i=0; i<4; i++)
+    _sw_pwm[i] = (uint8_t)AlpacaSwitch::GetSwitchValue(i + 16);
+  __atomic_fetch_or(&_dirty, SWITCH_OUT_MASK | SWITCH_PWM_MASK, __ATOMIC_RELEASE);
+
+  _states_mutex = xSemaphoreCreateMutex();
+  alpaca_actions.Add("switch", "switchstates", [this](const String &parameters, String &value)
+                     { return _actionSwitchStates(parameters, value); });
+  alpaca_actions.Add("switch", "setswitches", [this](const String &parameters, String &value)
+                     { return _actionSetSwitches(parameters, value); });
+
   // SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\"\n", "/setup/v1/switch/0/setup");
   // _p_alpaca_server->getServerTCP()->on("/setup/v1/switch/0/setup", HTTP_GET, [this](AsyncWebServerRequest *request)
   //                                      { DBG_REQ; _alpacaGetPage(request, FOCUSER_SETUP_URL); DBG_END; });
@@ -69,24 +83,29 @@ void Switch::Begin()
 
 void Switch::Loop()
 {
-  // copy inputs to AlpacaSwitch::_p_switch_devices
-  for(int i=0; i<8; i++)
+  uint16_t changed = (io_edges.rise | io_edges.fall) & 0x00ff;
+  uint32_t unstored = __atomic_load_n(&_unstored, __ATOMIC_ACQUIRE);
+  uint32_t stored = 0;
+
+  // copy input edges to AlpacaSwitch::_p_switch_devices, OUTs and PWMs are published by TakeDirty()
+  for(uint16_t c = changed; c; c &= c - 1)
   {
-    if(_sw_in[i])                             // set input value to AlpacaSwitch::_p_switch_devices[] array. Value is read from shift register
-      AlpacaSwitch::SetSwitch(i, true);
-    else
-      AlpacaSwitch::SetSwitch(i, false);
-  
-    if( AlpacaSwitch::GetValue(i + 8) )       // set OUTs and PWMs to HW
-      _sw_out[i] = true;
-    else
-      _sw_out[i] = false;
+    int i = __builtin_ctz(c);                 // set input value to AlpacaSwitch::_p_switch_devices[] array. Value is read from shift register
+    AlpacaSwitch::SetSwitch(i, (io_edges.state & (1 << i)) != 0);
   }
 
-  for(int i=0; i<4; i++)
+  // written channels the library has stored since _writeSwitchValue()
+  for(uint32_t u = unstored; u; u &= u - 1)
   {
-    _sw_pwm[i + 16] = (uint8_t)AlpacaSwitch::GetSwitchValue(i + 16);
+    uint32_t id = __builtin_ctz(u);
+    if((id < 16) ? (GetValue(id) == _sw_out[id - 8]) : ((uint8_t)GetSwitchValue(id) == _sw_pwm[id - 16]))
+      stored |= 1UL << id;
   }
+  if(stored)
+    __atomic_fetch_and(&_unstored, ~stored, __ATOMIC_RELEASE);
+
+  if(changed || stored)                       // after the values are stored: a render under the new version sees them
+    _changed();
 }
 
 /**
@@ -112,6 +131,9 @@ const bool Switch::_writeSwitchValue(uint32_t id, double value)
     _sw_out[id - 8] = (value != 0 ? true : false);
   else
     _sw_pwm[id - 16] = (uint8_t)value;
+  event_log.Add(EVLOG_SRC_SWITCH, id, (id < 16) ? _sw_out[id - 8] : _sw_pwm[id - 16]);
+  __atomic_fetch_or(&_dirty, 1UL << id, __ATOMIC_RELEASE);    // published to the I/O task by loop()
+  __atomic_fetch_or(&_unstored, 1UL << id, __ATOMIC_RELEASE); // the library stores the value after this returns, Loop() bumps the version
 
 #ifdef DEBUG_SWITCH
   DebugSwitchDevice(id);
@@ -122,6 +144,129 @@ const bool Switch::_writeSwitchValue(uint32_t id, double value)
   return result;
 }
 
+/**
+ * Action "switchstates": value, state, name and writability of every channel in one response.
+ * The JSON is rendered again only when a channel changed since the previous request.
+ */
+int32_t Switch::_actionSwitchStates(const String &parameters, String &value)
+{
+  xSemaphoreTake(_states_mutex, portMAX_DELAY);
+
+  uint32_t version = _version;
+  if(version != _states_version)
+  {
+    JsonDocument doc;
+    JsonArray arr = doc["switches"].to<JsonArray>();
+
+    doc["version"] = version;
+    for(uint32_t u = 0; u < GetMaxSwitch(); u++)
+    {
+      JsonObject obj = arr.add<JsonObject>();
+      obj["id"] = u;
+      obj["name"] = GetSwitchName(u);
+      obj["value"] = GetSwitchValue(u);
+      obj["state"] = GetValue(u);
+      obj["canwrite"] = GetSwitchCanWrite(u);
+    }
+    _states_json = "";
+    serializeJson(doc, _states_json);
+    _states_version = version;
+  }
+  value = _states_json;
+
+  xSemaphoreGive(_states_mutex);
+
+  return 0;
+}
+
+void Switch::GetValues(JsonArray &values)
+{
+  for(uint32_t u = 0; u < GetMaxSwitch(); u++)
+    values.add(GetSwitchValue(u));
+}
+
+/**
+ * Action "setswitches": Parameters "id=value,id=value,..." for OUT and PWM channels.
+ * All pairs are validated first, then published together so they reach the hardware
+ * in the same I/O cycle: one 595 latch and one PWM update.
+ */
+int32_t Switch::_actionSetSwitches(const String &parameters, String &value)
+{
+  uint32_t ids[k_num_of_switch_devices];
+  double values[k_num_of_switch_devices];
+  uint32_t n = 0;
+  uint32_t mask = 0;
+  const char *p = parameters.c_str();
+
+  if(GetNumberOfConnectedClients() == 0)      // drives relays and PWMs, as setswitchvalue
+  {
+    value = "Not connected";
+    return ALPACA_ERR_NOT_CONNECTED;
+  }
+
+  while(*p)
+  {
+    char *end;
+    uint32_t id = strtoul(p, &end, 10);
+
+    if((end == p) || (*end != '='))
+    {
+      value = "Parameters must be id=value,id=value,...";
+      return ALPACA_ERR_INVALID_VALUE;
+    }
+    p = end + 1;
+
+    double v = strtod(p, &end);
+    if((end == p) || ((*end != ',') && (*end != 0)) || ((*end == ',') && (end[1] == 0)))
+    {
+      value = "Invalid value for switch " + String(id);
+      return ALPACA_ERR_INVALID_VALUE;
+    }
+    p = (*end == ',') ? end + 1 : end;
+
+    if((id >= k_num_of_switch_devices) || !GetSwitchCanWrite(id) || (mask & (1UL << id)))
+    {
+      value = "Invalid, read-only or repeated switch " + String(id);
+      return ALPACA_ERR_INVALID_VALUE;
+    }
+
+    double k = (GetSwitchStep(id) > 0) ? (v - GetSwitchMinValue(id)) / GetSwitchStep(id) : 0.0;
+    if((v < GetSwitchMinValue(id)) || (v > GetSwitchMaxValue(id)) || (fabs(k - round(k)) > 1e-6))
+    {
+      value = "Value out of range for switch " + String(id);
+      return ALPACA_ERR_INVALID_VALUE;
+    }
+
+    ids[n] = id;
+    values[n] = v;
+    mask |= 1UL << id;
+    n++;
+  }
+
+  if(n == 0)
+  {
+    value = "No switches";
+    return ALPACA_ERR_INVALID_VALUE;
+  }
+
+  for(uint32_t i = 0; i < n; i++)           // commit
+  {
+    InitSwitchValue(ids[i], values[i]);
+    if(ids[i] < 16)
+      _sw_out[ids[i] - 8] = (values[i] != 0);
+    else
+      _sw_pwm[ids[i] - 16] = (uint8_t)values[i];
+    event_log.Add(EVLOG_SRC_SWITCH, ids[i], (ids[i] < 16) ? _sw_out[ids[i] - 8] : _sw_pwm[ids[i] - 16]);
+  }
+  __atomic_fetch_or(&_dirty, mask, __ATOMIC_RELEASE);          // one publish by loop(), one I/O cycle
+  _changed();
+
+  SLOG_DEBUG_PRINTF("setswitches mask=0x%05x\n", mask);
+  value = String(n);
+
+  return 0;
+}
+
 // read settings from flash
 void Switch::AlpacaReadJson(JsonObject &root)
 {
@@ -138,6 +283,7 @@ void Switch::AlpacaReadJson(JsonObject &root)
       InitSwitchName(u, obj_config[sw_name] | GetSwitchName(u));
       DBG_JSON_PRINTFJ(SLOG_NOTICE, obj_config, "... title=%s obj_config=<%s> \n", sw_name, _ser_json_);
     }
+    _changed();
   }
 	SLOG_PRINTF(SLOG_NOTICE, "...SWITCH READ END\n");
 }
@@ -160,6 +306,24 @@ void Switch::AlpacaWriteJson(JsonObject &root)
   DBG_JSON_PRINTFJ(SLOG_NOTICE, root, "...SWITCH WRITE END \"%s\"\n", _ser_json_);
 }
 
+// one Ch_n name from the settings journal
+bool Switch::ApplySetting(const char *section, const char *key, JsonVariantConst value)
+{
+  char *end;
+  uint32_t u;
+
+  if(( strcmp(section, "Switch_Configuration") != 0 ) || ( strncmp(key, "Ch_", 3) != 0 ) || !value.is<const char *>())
+    return false;
+
+  u = strtoul(key + 3, &end, 10);
+  if(( end == key + 3 ) || ( *end != 0 ) || ( u >= GetMaxSwitch() ) || ( strlen(value.as<const char *>()) >= kSwitchNameSize ))
+    return false;
+
+  InitSwitchName(u, value.as<const char *>());
+  _changed();
+  return true;
+}
+
 /* ORIGINAL VERSION FROM PETER
 void Switch::AlpacaReadJson(JsonObject &root)
 {
@@ -7,16 +7,32 @@
 **************************************************************************************************/
 #pragma once
 #include "AlpacaSwitch.h"
+#include "IoTask.h"
+#include "AlpacaActions.h"
 
 // comment/uncomment to enable/disable debugging
 // #define DEBUG_SWITCH
 
-extern bool _sw_in[8], _sw_out[8];
+extern bool _sw_out[8];
 extern u_int8_t _sw_pwm[4];
 
+#define SWITCH_OUT_MASK     0x0000ff00      // channel bits of OUT 1..8
+#define SWITCH_PWM_MASK     0x000f0000      // channel bits of PWM 1..4
+
 class Switch : public AlpacaSwitch
 {
 private:
+    volatile uint32_t _dirty;               // bit id: channel written by a client, not yet published
+    volatile uint32_t _unstored;            // bit id: written by a client, version bumped once the library holds the value
+    volatile uint32_t _version;             // incremented on any change of a channel
+    uint32_t _states_version;               // version rendered in _states_json
+    String _states_json;                    // response of Action "switchstates"
+    SemaphoreHandle_t _states_mutex;
+
+    int32_t _actionSwitchStates(const String &parameters, String &value);
+    int32_t _actionSetSwitches(const String &parameters, String &value);
+    void _changed() { __atomic_fetch_add(&_version, 1, __ATOMIC_RELEASE); }
+
     const bool _writeSwitchValue(uint32_t id, double value);
 
     void AlpacaReadJson(JsonObject &root);
@@ -30,4 +46,10 @@ public:
     Switch();
     void Begin();
     void Loop();
+    uint32_t GetVersion() { return _version; }
+    bool ApplySetting(const char *section, const char *key, JsonVariantConst value);	// from the settings journal
+    void GetValues(JsonArray &values);      // value of every channel
+    uint32_t GetNumChannels() { return GetMaxSwitch(); }
+    double GetChannelValue(uint32_t id) { return GetSwitchValue(id); }
+    uint32_t TakeDirty() { return __atomic_exchange_n(&_dirty, 0, __ATOMIC_ACQ_REL); }  // written channels, clears them
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+/**************************************************************************************************
+  Filename:       WeatherFrame.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    parser for weather station frames
+                  %WS, skytemp, airtemp, wind, humidity, rain, light, clouds, stars #
+**************************************************************************************************/
+#include "WeatherFrame.h"
+
+static const char *const k_ws_parse_error_str[] = {"Ok", "BadHeader", "TooLong", "TooShort", "TooManyFields", "BadNumber", "NoTerminator"};
+
+WsParseError_t ws_parse_frame(const char *msg, size_t len, WeatherFrame &frame)
+{
+	int16_t params[WS_FRAME_FIELDS];
+	size_t s = 4;
+	uint8_t v = 0;
+	bool terminated = false;
+
+	if( len > UART1_BUFFER )
+		return WsParseError_t::kTooLong;
+
+	if(( len < 5 ) || (msg[0] != '%') || (msg[1] != 'W') || (msg[2] != 'S') || (msg[3] != ','))
+		return WsParseError_t::kBadHeader;
+
+	while( s < len ) {
+		bool neg = false;
+		size_t digits = 0;
+		int32_t val = 0;
+
+		if(( msg[s] == '-' ) || ( msg[s] == '+' ))
+			neg = (msg[s++] == '-');
+
+		while(( s < len ) && ( msg[s] >= '0' ) && ( msg[s] <= '9' )) {
+			val = val * 10 + (msg[s++] - '0');
+			if( val > 32768 )								// stop before it can overflow
+				return WsParseError_t::kBadNumber;
+			digits++;
+		}
+
+		if( neg ) val = -val;
+		if(( digits == 0 ) || ( val > 32767 ))
+			return WsParseError_t::kBadNumber;
+
+		if( s >= len )
+			return WsParseError_t::kNoTerminator;
+
+		if( v >= WS_FRAME_FIELDS )
+			return WsParseError_t::kTooManyFields;
+
+		params[v++] = (int16_t)val;
+
+		if( msg[s] == '#' ) {
+			if( s != len - 1 )
+				return WsParseError_t::kNoTerminator;
+			if( v < WS_FRAME_FIELDS )
+				return WsParseError_t::kTooShort;
+			terminated = true;
+			break;
+		}
+
+		if( msg[s] != ',' )
+			return WsParseError_t::kBadNumber;
+
+		s++;
+	}
+
+	if( !terminated )										// frame ends with ','
+		return WsParseError_t::kNoTerminator;
+
+	frame.tsky = params[0];
+	frame.tair = params[1];
+	frame.wind = params[2];
+	frame.hum = params[3];
+	frame.rain = params[4];
+	frame.light = params[5];
+	frame.clouds = params[6];
+	frame.stars = params[7];
+
+	return WsParseError_t::kOk;
+}
+
+const char *ws_parse_error_str(WsParseError_t err)
+{
+	return k_ws_parse_error_str[(int)err];
+}
@@ -0,0 +1,55 @@
+/**************************************************************************************************
+  Filename:       WeatherFrame.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    parser for weather station frames
+                  %WS, skytemp, airtemp, wind, humidity, rain, light, clouds, stars #
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "defines.h"
+
+#define WS_FRAME_FIELDS     8           // number of values in a %WS frame
+
+enum struct WsParseError_t
+{
+	kOk = 0,
+	kBadHeader,							// frame does not start with "%WS,"
+	kTooLong,							// frame longer than UART1_BUFFER
+	kTooShort,							// less than WS_FRAME_FIELDS values
+	kTooManyFields,						// more than WS_FRAME_FIELDS values
+	kBadNumber,							// empty field, invalid char or value out of int16_t range
+	kNoTerminator						// '#' missing or not the last char
+};
+
+typedef struct {						// values as sent by the weather station, see parse_ws_message() for units
+	int16_t tsky;
+	int16_t tair;
+	int16_t wind;
+	int16_t hum;
+	int16_t rain;
+	int16_t light;
+	int16_t clouds;
+	int16_t stars;
+} WeatherFrame;
+
+enum {									// channels in frame order, index of ws_channel()
+	WS_CH_TSKY = 0,
+	WS_CH_TAIR,
+	WS_CH_WIND,
+	WS_CH_HUM,
+	WS_CH_RAIN,
+	WS_CH_LIGHT,
+	WS_CH_CLOUDS,
+	WS_CH_STARS
+};
+
+static inline int16_t ws_channel(const WeatherFrame &f, uint8_t ch) { return ((const int16_t *)&f)[ch]; }
+
+// clouds and stars are -1 when the station has no such sensor
+static inline bool ws_channel_valid(uint8_t ch, int16_t v) { return !((( ch == WS_CH_CLOUDS ) || ( ch == WS_CH_STARS )) && ( v == -1 )); }
+
+// single pass, no copy, no allocation. frame is written only if result is kOk
+WsParseError_t ws_parse_frame(const char *msg, size_t len, WeatherFrame &frame);
+const char *ws_parse_error_str(WsParseError_t err);
@@ -0,0 +1,232 @@
+/**************************************************************************************************
+  Filename:       WeatherHistory.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    fixed RAM, multi resolution history of the weather station readings
+                  tier 0: frames at 1 s resolution, tier 1: 1 minute min/mean/max, tier 2: 10 minutes
+**************************************************************************************************/
+#include "WeatherHistory.h"
+#include <memory>
+#include <SLog.h>
+
+#define WSH_ROW_SIZE        (12 + 3 * WS_FRAME_FIELDS * 7 + 2)     // longest JSON row
+#define WSH_CHUNK_ROWS      8               // rows copied per lock
+
+WeatherHistory weather_history;
+
+typedef struct {						// state of a chunked response
+	uint8_t tier;
+	uint8_t phase;						// 0: header, 1: rows, 2: closing, 3: done
+	uint32_t from, to;					// next row from, moves up as rows are sent
+	uint32_t rows;
+} WshQuery_t;
+
+static const char *const k_channels = "[\"tsky\",\"tair\",\"wind\",\"hum\",\"rain\",\"light\",\"clouds\",\"stars\"]";
+
+WeatherHistory::WeatherHistory() : _mutex(NULL)
+{
+	memset(&_t0, 0, sizeof(_t0));
+	memset(&_t1, 0, sizeof(_t1));
+	memset(&_t2, 0, sizeof(_t2));
+	memset(&_acc1, 0, sizeof(_acc1));
+	memset(&_acc2, 0, sizeof(_acc2));
+}
+
+void WeatherHistory::Begin(AsyncWebServer *server)
+{
+	_mutex = xSemaphoreCreateMutex();
+	server->on(WSH_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _handleGet(request); });
+	SLOG_PRINTF(SLOG_INFO, "REGISTER handler for \"%s\", %u bytes of history\n", WSH_URL, sizeof(_t0) + sizeof(_t1) + sizeof(_t2));
+}
+
+void WeatherHistory::_accStart(Acc_t &acc, uint32_t t)
+{
+	acc.t = t;
+	acc.count = 0;
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		acc.n[c] = 0;
+		acc.sum[c] = 0;
+		acc.min[c] = INT16_MAX;
+		acc.max[c] = INT16_MIN;
+	}
+}
+
+void WeatherHistory::_accAdd(Acc_t &acc, const int16_t *min, const int16_t *max, const int32_t *sum, const uint16_t *n, uint32_t count)
+{
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		if( n[c] == 0 )
+			continue;
+		acc.n[c] += n[c];
+		acc.sum[c] += sum[c];
+		if( min[c] < acc.min[c] ) acc.min[c] = min[c];
+		if( max[c] > acc.max[c] ) acc.max[c] = max[c];
+	}
+	acc.count += count;
+}
+
+void WeatherHistory::_accClose(const Acc_t &acc, WshAggregate_t &a)
+{
+	a.t = acc.t;
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		if( acc.n[c] == 0 ) {			// no sensor for the whole period
+			a.min[c] = a.mean[c] = a.max[c] = -1;
+			continue;
+		}
+		a.min[c] = acc.min[c];
+		a.max[c] = acc.max[c];
+		a.mean[c] = (int16_t)(acc.sum[c] / (int32_t)acc.n[c]);
+	}
+}
+
+void WeatherHistory::Add(const WeatherFrame &f, uint32_t now_ms)
+{
+	uint32_t t = now_ms / 1000;
+	WshSample_t s;
+	int32_t sum[WS_FRAME_FIELDS];
+	uint16_t n[WS_FRAME_FIELDS];
+
+	s.t = t;
+	memcpy(s.v, &f, sizeof(s.v));
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		n[c] = ws_channel_valid(c, s.v[c]) ? 1 : 0;
+		sum[c] = s.v[c];
+	}
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+
+	if(( _t0.count > 0 ) && ( _t0.Last().t == t ))		// same second, keep the latest frame
+		_t0.Last() = s;
+	else
+		_t0.Push(s);
+
+	if(( _acc1.count > 0 ) && ( t / WSH_T1_PERIOD != _acc1.t / WSH_T1_PERIOD )) {	// minute over
+		WshAggregate_t a;
+
+		if(( _acc2.count > 0 ) && ( _acc1.t / WSH_T2_PERIOD != _acc2.t / WSH_T2_PERIOD )) {
+			_accClose(_acc2, a);
+			_t2.Push(a);
+			_acc2.count = 0;
+		}
+		if( _acc2.count == 0 )
+			_accStart(_acc2, _acc1.t - _acc1.t % WSH_T2_PERIOD);
+		_accAdd(_acc2, _acc1.min, _acc1.max, _acc1.sum, _acc1.n, _acc1.count);
+
+		_accClose(_acc1, a);
+		_t1.Push(a);
+		_acc1.count = 0;
+	}
+	if( _acc1.count == 0 )
+		_accStart(_acc1, t - t % WSH_T1_PERIOD);
+	_accAdd(_acc1, s.v, s.v, sum, n, 1);
+
+	xSemaphoreGive(_mutex);
+}
+
+// up to max rows of one tier within [from, to], oldest first, tier 0 samples in rows[].mean
+uint16_t WeatherHistory::_copyRows(uint8_t tier, uint32_t from, uint32_t to, WshAggregate_t *rows, uint16_t max)
+{
+	uint16_t n = 0;
+
+	xSemaphoreTake(_mutex, portMAX_DELAY);
+
+	if( tier == 0 ) {
+		for(uint16_t i = 0; ( i < _t0.count ) && ( n < max ); i++) {
+			const WshSample_t &s = _t0.At(i);
+			if(( s.t < from ) || ( s.t > to ))
+				continue;
+			rows[n].t = s.t;
+			memcpy(rows[n++].mean, s.v, sizeof(s.v));
+		}
+	} else {
+		const uint16_t count = (tier == 1) ? _t1.count : _t2.count;
+
+		for(uint16_t i = 0; ( i < count ) && ( n < max ); i++) {
+			const WshAggregate_t &a = (tier == 1) ? _t1.At(i) : _t2.At(i);
+			if(( a.t < from ) || ( a.t > to ))
+				continue;
+			rows[n++] = a;
+		}
+	}
+
+	xSemaphoreGive(_mutex);
+	return n;
+}
+
+static size_t print_values(char *buffer, size_t size, const int16_t *v)
+{
+	size_t len = 0;
+
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++)
+		len += snprintf(buffer + len, size - len, ",%d", v[c]);
+	return len;
+}
+
+// rows of one tier within [from, to]: [t,v0..v7] for tier 0, [t,min0..7,mean0..7,max0..7] above
+// streamed in chunks, the rows are copied out WSH_CHUNK_ROWS at a time and printed without the lock
+void WeatherHistory::_handleGet(AsyncWebServerRequest *request)
+{
+	std::shared_ptr<WshQuery_t> q = std::make_shared<WshQuery_t>();
+	uint32_t now = millis() / 1000;
+
+	memset(q.get(), 0, sizeof(WshQuery_t));
+	q->tier = request->hasParam("tier") ? request->getParam("tier")->value().toInt() : 0;
+	q->from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+	q->to = request->hasParam("to") ? request->getParam("to")->value().toInt() : now;
+
+	if( q->tier > 2 ) {
+		request->send(400, "text/plain", "tier 0, 1 or 2");
+		return;
+	}
+
+	AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+		[this, q, now](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+			char *out = (char *)buffer;
+			size_t len = 0;
+
+			if( q->phase == 0 ) {
+				int head = snprintf(out, max_len, "{\"tier\":%u,\"period_s\":%u,\"now_s\":%u,\"channels\":%s,\"rows\":[", q->tier,
+									q->tier == 0 ? 1 : (q->tier == 1 ? WSH_T1_PERIOD : WSH_T2_PERIOD), now, k_channels);
+				if( (size_t)head >= max_len )
+					return RESPONSE_TRY_AGAIN;
+				len = head;
+				q->phase = 1;
+			}
+
+			while( q->phase == 1 ) {
+				WshAggregate_t rows[WSH_CHUNK_ROWS];
+				size_t room = (max_len - len) / WSH_ROW_SIZE;
+				uint16_t n;
+
+				if( room == 0 )
+					return len ? len : RESPONSE_TRY_AGAIN;
+
+				n = _copyRows(q->tier, q->from, q->to, rows, room < WSH_CHUNK_ROWS ? room : WSH_CHUNK_ROWS);
+				if( n == 0 ) {
+					q->phase = 2;
+					break;
+				}
+				for(uint16_t i = 0; i < n; i++) {
+					len += snprintf(out + len, max_len - len, "%s[%u", q->rows++ ? "," : "", rows[i].t);
+					if( q->tier > 0 )
+						len += print_values(out + len, max_len - len, rows[i].min);
+					len += print_values(out + len, max_len - len, rows[i].mean);
+					if( q->tier > 0 )
+						len += print_values(out + len, max_len - len, rows[i].max);
+					out[len++] = ']';
+				}
+				q->from = rows[n - 1].t + 1;					// rows are in time order
+			}
+
+			if( q->phase == 2 ) {
+				if( max_len - len < 2 )
+					return len ? len : RESPONSE_TRY_AGAIN;
+				memcpy(out + len, "]}", 2);
+				len += 2;
+				q->phase = 3;
+			}
+
+			return len;											// 0 once everything is sent
+		});
+	request->send(response);
+}
@@ -0,0 +1,81 @@
+/**************************************************************************************************
+  Filename:       WeatherHistory.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    fixed RAM, multi resolution history of the weather station readings
+                  tier 0: frames at 1 s resolution, tier 1: 1 minute min/mean/max, tier 2: 10 minutes
+
+                  memory, static, no allocation after boot:
+                    tier 0  WSH_T0_SIZE * 20 B =  6000 B  (5 minutes)
+                    tier 1  WSH_T1_SIZE * 52 B =  9360 B  (3 hours)
+                    tier 2  WSH_T2_SIZE * 52 B =  3744 B  (12 hours)
+                    accumulators 2 * 88 B, about 19.3 kB in total
+                  clouds and stars of -1 (no sensor) are left out of the aggregates, -1 when no sample
+                  of the period was valid
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "WeatherFrame.h"
+
+#define WSH_URL             "/weather/history"  // GET tier=0|1|2, from, to in seconds since boot
+#define WSH_T0_SIZE         300         // 1 s samples
+#define WSH_T1_SIZE         180         // 1 minute aggregates
+#define WSH_T2_SIZE         72          // 10 minute aggregates
+#define WSH_T1_PERIOD       60          // s
+#define WSH_T2_PERIOD       600
+
+typedef struct {
+	uint32_t t;							// s since boot
+	int16_t v[WS_FRAME_FIELDS];
+} WshSample_t;
+
+typedef struct {
+	uint32_t t;							// start of the period, s since boot
+	int16_t min[WS_FRAME_FIELDS];
+	int16_t mean[WS_FRAME_FIELDS];
+	int16_t max[WS_FRAME_FIELDS];
+} WshAggregate_t;
+
+class WeatherHistory
+{
+private:
+	typedef struct {					// period being filled
+		uint32_t t;
+		uint32_t count;					// frames
+		uint16_t n[WS_FRAME_FIELDS];	// valid samples
+		int32_t sum[WS_FRAME_FIELDS];
+		int16_t min[WS_FRAME_FIELDS];
+		int16_t max[WS_FRAME_FIELDS];
+	} Acc_t;
+
+	template <typename T, uint16_t N>
+	struct Ring {
+		T item[N];
+		uint16_t head;					// next write
+		uint16_t count;
+		void Push(const T &x) { item[head] = x; head = (head + 1) % N; if( count < N ) count++; }
+		const T &At(uint16_t i) const { return item[(head + N - count + i) % N]; }	// 0: oldest
+		T &Last() { return item[(head + N - 1) % N]; }
+	};
+
+	Ring<WshSample_t, WSH_T0_SIZE> _t0;
+	Ring<WshAggregate_t, WSH_T1_SIZE> _t1;
+	Ring<WshAggregate_t, WSH_T2_SIZE> _t2;
+	Acc_t _acc1, _acc2;
+	SemaphoreHandle_t _mutex;			// Add() in loop(), queries in the web server task
+
+	static void _accStart(Acc_t &acc, uint32_t t);
+	static void _accAdd(Acc_t &acc, const int16_t *min, const int16_t *max, const int32_t *sum, const uint16_t *n, uint32_t count);
+	static void _accClose(const Acc_t &acc, WshAggregate_t &a);
+	uint16_t _copyRows(uint8_t tier, uint32_t from, uint32_t to, WshAggregate_t *rows, uint16_t max);
+	void _handleGet(AsyncWebServerRequest *request);
+
+public:
+	WeatherHistory();
+	void Begin(AsyncWebServer *server);
+	void Add(const WeatherFrame &f, uint32_t now_ms);	// O(1), from loop() for every valid frame
+};
+
+extern WeatherHistory weather_history;
@@ -0,0 +1,27 @@
+/**************************************************************************************************
+  Filename:       WeatherSnapshot.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    latest readings from weather station, published to all tasks
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "WeatherFrame.h"
+#include "StreamFilters.h"
+#include "Snapshot.h"
+
+typedef struct {
+	WeatherFrame values;				// last valid value of every channel
+	WeatherFrame filtered[WS_FILTERS];	// WS_FILTER_x of every channel
+	uint32_t timestamp_ms;				// millis() when the last frame was received, 0 if none yet
+	uint32_t frames;					// number of frames received
+} WeatherSnapshot;
+
+extern Snapshot<WeatherSnapshot> weather_snapshot;		// written by loop() only
+
+// age of the readings in ms, UINT32_MAX if nothing was received yet
+static inline uint32_t weather_age_ms(const WeatherSnapshot &w)
+{
+	return (w.frames == 0) ? UINT32_MAX : millis() - w.timestamp_ms;
+}
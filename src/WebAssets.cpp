@@ -0,0 +1,107 @@
+/**************************************************************************************************
+  Filename:       WebAssets.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    setup page assets served with content hash ETags, 304 on If-None-Match and
+                  immutable caching of fingerprinted urls. Hashes from tools/fingerprint_assets.py
+**************************************************************************************************/
+#include "WebAssets.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <SLog.h>
+
+WebAssets web_assets;
+
+WebAssets::WebAssets() : _num_assets(0)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+bool WebAssets::_loadManifest()
+{
+	JsonDocument doc;
+	File f = LittleFS.open(WEB_ASSETS_MANIFEST, "r");
+
+	if( !f )
+		return false;
+
+	DeserializationError err = deserializeJson(doc, f);
+	f.close();
+	if( err != DeserializationError::Ok ) {
+		SLOG_ERROR_PRINTF("ERROR! %s: %s\n", WEB_ASSETS_MANIFEST, err.c_str());
+		return false;
+	}
+
+	for(JsonObject a : doc["assets"].as<JsonArray>()) {
+		const char *url = a["url"] | "";
+		const char *hash = a["hash"] | "";
+
+		if(( _num_assets >= WEB_ASSETS_MAX ) || ( strlen(url) >= WEB_ASSETS_URL_SIZE ) || ( strlen(hash) >= WEB_ASSETS_HASH_SIZE ))
+			continue;
+
+		strcpy(_assets[_num_assets].url, url);
+		strcpy(_assets[_num_assets].hash, hash);
+		_assets[_num_assets].size = a["size"] | 0;
+		_num_assets++;
+	}
+
+	return true;
+}
+
+void WebAssets::Begin(AsyncWebServer *server)
+{
+	if( !_loadManifest() )								// no manifest: assets served by the library, uncached
+		SLOG_PRINTF(SLOG_WARNING, "No %s, setup assets without ETag\n", WEB_ASSETS_MANIFEST);
+
+	// registered before the server's own static handler, so these take precedence
+	for(uint8_t i = 0; i < _num_assets; i++) {
+		const Asset_t *asset = &_assets[i];
+		server->on(asset->url, HTTP_GET, [this, asset](AsyncWebServerRequest *request) { _serve(request, *asset); });
+	}
+
+	server->on(WEB_ASSETS_URL, HTTP_GET, [this](AsyncWebServerRequest *request) { _report(request); });
+	SLOG_PRINTF(SLOG_INFO, "REGISTER %u setup assets and \"%s\"\n", _num_assets, WEB_ASSETS_URL);
+}
+
+void WebAssets::_serve(AsyncWebServerRequest *request, const Asset_t &asset)
+{
+	AsyncWebServerResponse *response;
+	const AsyncWebHeader *match = request->getHeader("If-None-Match");
+	String etag = String("\"") + asset.hash + "\"";
+	bool immutable = request->hasParam("v") && ( request->getParam("v")->value() == asset.hash );
+
+	_stats.requests++;
+
+	if(( match != NULL ) && ( match->value().indexOf(etag) >= 0 )) {
+		response = request->beginResponse(304);
+		_stats.not_modified++;
+		_stats.bytes_saved += asset.size;
+	} else {
+		response = request->beginResponse(LittleFS, asset.url, String());	// picks up <url>.gz with Content-Encoding
+		_stats.bytes_sent += asset.size;
+	}
+
+	response->addHeader("ETag", etag);
+	// url carries the content hash: never changes. Plain url: revalidate with the ETag every time
+	response->addHeader("Cache-Control", immutable ? "public, max-age=31536000, immutable" : "no-cache");
+	request->send(response);
+}
+
+void WebAssets::_report(AsyncWebServerRequest *request)
+{
+	JsonDocument doc;
+	String body;
+
+	doc["assets"] = _num_assets;
+	doc["requests"] = _stats.requests;
+	doc["not_modified"] = _stats.not_modified;
+	doc["bytes_sent"] = _stats.bytes_sent;
+	doc["bytes_saved"] = _stats.bytes_saved;
+
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+
+	if( request->hasParam("reset") )
+		memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,48 @@
+/**************************************************************************************************
+  Filename:       WebAssets.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    setup page assets served with content hash ETags, 304 on If-None-Match and
+                  immutable caching of fingerprinted urls. Hashes from tools/fingerprint_assets.py
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#define WEB_ASSETS_MANIFEST     "/www/assets.json"
+#define WEB_ASSETS_URL          "/stats/assets"     // GET, ?reset=1 clears after reporting
+#define WEB_ASSETS_MAX          16
+#define WEB_ASSETS_URL_SIZE     48
+#define WEB_ASSETS_HASH_SIZE    20
+
+typedef struct {
+	uint32_t requests;
+	uint32_t not_modified;					// answered 304
+	uint32_t bytes_sent;					// bodies of 200 responses
+	uint32_t bytes_saved;					// bodies not sent thanks to 304
+} WebAssetsStats_t;
+
+class WebAssets
+{
+private:
+	typedef struct {
+		char url[WEB_ASSETS_URL_SIZE];
+		char hash[WEB_ASSETS_HASH_SIZE];
+		uint32_t size;						// of the file on LittleFS, gzip if compressed
+	} Asset_t;
+
+	Asset_t _assets[WEB_ASSETS_MAX];
+	uint8_t _num_assets;
+	WebAssetsStats_t _stats;
+
+	bool _loadManifest();
+	void _serve(AsyncWebServerRequest *request, const Asset_t &asset);
+	void _report(AsyncWebServerRequest *request);
+
+public:
+	WebAssets();
+	void Begin(AsyncWebServer *server);		// call before AlpacaServer::RegisterCallbacks()
+};
+
+extern WebAssets web_assets;
@@ -0,0 +1,94 @@
+/**************************************************************************************************
+  Filename:       WindowAverage.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    sliding window averages of the weather channels, O(1) per sample and per read
+                  from running sums over a ring of fixed time buckets
+**************************************************************************************************/
+#include "WindowAverage.h"
+
+WindowAverage::WindowAverage() : _head(0), _window(1)
+{
+	memset(_buckets, 0, sizeof(_buckets));
+	memset(_sum, 0, sizeof(_sum));
+	memset(_count, 0, sizeof(_count));
+}
+
+void WindowAverage::SetWindow(uint32_t window_ms)
+{
+	uint32_t n = (window_ms + WAVG_BUCKET_MS - 1) / WAVG_BUCKET_MS;
+
+	_window = (n < 1) ? 1 : ((n > WAVG_BUCKETS) ? WAVG_BUCKETS : n);
+	_recompute();
+}
+
+// running sums from the ring, only when the window length changes
+void WindowAverage::_recompute()
+{
+	memset(_sum, 0, sizeof(_sum));
+	memset(_count, 0, sizeof(_count));
+
+	for(uint16_t i = 0; i < _window; i++) {
+		const Bucket_t &b = _buckets[(_head + WAVG_BUCKETS - i) % WAVG_BUCKETS];
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+			_sum[c] += b.sum[c];
+			_count[c] += b.count[c];
+		}
+	}
+}
+
+// each step drops the bucket leaving the window and clears the one being reused, at most
+// WAVG_BUCKETS steps after a long gap, one step in normal operation
+void WindowAverage::_advance(uint32_t now_ms)
+{
+	uint32_t index = now_ms / WAVG_BUCKET_MS;
+	uint32_t steps = index - _head;
+
+	if( steps > WAVG_BUCKETS ) {						// everything expired
+		memset(_buckets, 0, sizeof(_buckets));
+		memset(_sum, 0, sizeof(_sum));
+		memset(_count, 0, sizeof(_count));
+		_head = index;
+		return;
+	}
+
+	for(; steps > 0; steps--) {
+		Bucket_t &out = _buckets[(_head + WAVG_BUCKETS + 1 - _window) % WAVG_BUCKETS];
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+			_sum[c] -= out.sum[c];
+			_count[c] -= out.count[c];
+		}
+
+		_head++;
+		Bucket_t &in = _buckets[_head % WAVG_BUCKETS];
+		memset(&in, 0, sizeof(in));
+	}
+}
+
+void WindowAverage::Add(const WeatherFrame &f, uint32_t now_ms)
+{
+	_advance(now_ms);
+
+	Bucket_t &b = _buckets[_head % WAVG_BUCKETS];
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		int16_t v = ws_channel(f, c);
+		if( !ws_channel_valid(c, v) )
+			continue;
+		b.sum[c] += v;
+		b.count[c]++;
+		_sum[c] += v;
+		_count[c]++;
+	}
+}
+
+bool WindowAverage::Average(uint8_t channel, uint32_t now_ms, float &avg)
+{
+	_advance(now_ms);
+
+	if( _count[channel] == 0 )
+		return false;
+
+	avg = (float)_sum[channel] / _count[channel];
+	return true;
+}
@@ -0,0 +1,39 @@
+/**************************************************************************************************
+  Filename:       WindowAverage.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    sliding window averages of the weather channels, O(1) per sample and per read
+                  from running sums over a ring of fixed time buckets
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "WeatherFrame.h"
+
+#define WAVG_BUCKET_MS      15000       // time resolution of the window
+#define WAVG_BUCKETS        240         // longest window: 240 * 15 s = 1 hour
+
+class WindowAverage
+{
+private:
+	typedef struct {
+		int32_t sum[WS_FRAME_FIELDS];
+		uint16_t count[WS_FRAME_FIELDS];	// valid samples, clouds/stars -1 are skipped
+	} Bucket_t;
+
+	Bucket_t _buckets[WAVG_BUCKETS];
+	uint32_t _head;						// absolute index of the current bucket, now / WAVG_BUCKET_MS
+	uint16_t _window;					// buckets in the window, 1 ~ WAVG_BUCKETS
+	int32_t _sum[WS_FRAME_FIELDS];		// of the last _window buckets
+	uint32_t _count[WS_FRAME_FIELDS];
+
+	void _advance(uint32_t now_ms);		// expire buckets that left the window
+	void _recompute();
+
+public:
+	WindowAverage();
+	void SetWindow(uint32_t window_ms);	// rounded up to buckets, clamped to the ring
+	uint32_t GetWindow() { return _window * WAVG_BUCKET_MS; }
+	void Add(const WeatherFrame &f, uint32_t now_ms);
+	bool Average(uint8_t channel, uint32_t now_ms, float &avg);	// false if no valid sample in the window
+};
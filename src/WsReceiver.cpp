@@ -0,0 +1,104 @@
+/**************************************************************************************************
+  Filename:       WsReceiver.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    ring buffered receiver for weather station frames (%WS,...#)
+**************************************************************************************************/
+#include "WsReceiver.h"
+
+#define WS_RX_RING_MASK     (WS_RX_RING_SIZE - 1)
+
+static_assert((WS_RX_RING_SIZE & WS_RX_RING_MASK) == 0, "WS_RX_RING_SIZE must be a power of 2");
+static_assert(WS_RX_RING_SIZE >= 2 * UART1_BUFFER, "WS_RX_RING_SIZE too small");
+
+WsReceiver::WsReceiver() : _head(0), _tail(0), _scan(0), _in_frame(false), _stats()
+{
+	// constructor
+}
+
+// discard bytes up to index 'to'
+void WsReceiver::_drop(uint32_t to)
+{
+	_stats.dropped_bytes += to - _tail;
+	_tail = to;
+}
+
+uint32_t WsReceiver::Poll(Stream &serial)
+{
+	uint32_t t = micros();
+	uint32_t total = 0;
+	int avail = serial.available();
+
+	while( avail > 0 ) {
+		uint32_t free = WS_RX_RING_SIZE - (_head - _tail);
+
+		if( free == 0 ) {									// leave the rest in the UART driver buffer
+			_stats.overruns++;
+			break;
+		}
+
+		uint32_t idx = _head & WS_RX_RING_MASK;
+		uint32_t n = WS_RX_RING_SIZE - idx;					// contiguous space up to the end of the ring
+		if( n > free ) n = free;
+		if( n > (uint32_t)avail ) n = avail;
+
+		n = serial.readBytes(&_ring[idx], n);
+		if( n == 0 )
+			break;
+
+		_head += n;
+		total += n;
+		avail -= n;
+	}
+
+	t = micros() - t;
+	if( total > _stats.max_poll_bytes ) _stats.max_poll_bytes = total;
+	if( t > _stats.max_poll_us ) _stats.max_poll_us = t;
+
+	return total;
+}
+
+bool WsReceiver::NextFrame(const char *&frame, size_t &len)
+{
+	while( _scan != _head ) {
+		char c = _ring[_scan & WS_RX_RING_MASK];
+
+		if( c == '%' ) {									// frame start, anything pending is garbage
+			_drop(_scan);
+			_in_frame = true;
+		} else if( !_in_frame ) {
+			_scan++;
+			_drop(_scan);
+			continue;
+		} else if( c == '#' ) {								// frame end
+			uint32_t start = _tail & WS_RX_RING_MASK;
+			len = _scan - _tail + 1;
+
+			if( start + len <= WS_RX_RING_SIZE ) {			// contiguous, hand out the ring itself
+				frame = &_ring[start];
+			} else {
+				uint32_t first = WS_RX_RING_SIZE - start;
+				memcpy(_linear, &_ring[start], first);
+				memcpy(&_linear[first], _ring, len - first);
+				frame = _linear;
+			}
+
+			_scan++;
+			_tail = _scan;
+			_in_frame = false;
+			_stats.frames++;
+			return true;
+		}
+
+		_scan++;
+
+		if(( _scan - _tail ) >= UART1_BUFFER ) {			// too long, drop it and wait for the next '%'
+			_drop(_scan);
+			_in_frame = false;
+			_stats.overruns++;
+		}
+	}
+
+	return false;
+}
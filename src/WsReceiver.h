@@ -0,0 +1,39 @@
+/**************************************************************************************************
+  Filename:       WsReceiver.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    ring buffered receiver for weather station frames (%WS,...#)
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "defines.h"
+
+typedef struct {
+	uint32_t frames;						// complete frames extracted
+	uint32_t overruns;						// frames longer than UART1_BUFFER and ring full events
+	uint32_t dropped_bytes;					// bytes discarded outside of a frame or in overlong frames
+	uint32_t max_poll_bytes;				// largest burst drained by one Poll()
+	uint32_t max_poll_us;					// worst case time spent in Poll()
+} WsReceiverStats_t;
+
+class WsReceiver
+{
+private:
+	char _ring[WS_RX_RING_SIZE];
+	char _linear[UART1_BUFFER];				// used only when a frame wraps around the end of the ring
+	uint32_t _head;							// free running write index
+	uint32_t _tail;							// free running read index, start of current frame if _in_frame
+	uint32_t _scan;							// next byte to examine
+	bool _in_frame;
+	WsReceiverStats_t _stats;
+
+	void _drop(uint32_t to);
+
+public:
+	WsReceiver();
+	uint32_t Poll(Stream &serial);			// drain all available bytes, returns the number of bytes read
+	bool NextFrame(const char *&frame, size_t &len);	// next complete frame '%'...'#', not NUL terminated,
+														// valid until the next call to Poll()
+	const WsReceiverStats_t &GetStats() { return _stats; }
+};
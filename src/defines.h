@@ -5,9 +5,13 @@
   Description:    board definitions
   
 ************************************************************************************************* */
+#pragma once
 
 #define SYSLOG_HOST         "0.0.0.0"   // your SysLog-Host
 
+#define RESPONSE_CACHE      1           // serve hot GET endpoints pre-rendered, 0 to use the library handlers
+#define REQUEST_STATS       1           // per endpoint latency and heap statistics on /stats/requests
+
 #define SR_OUT_PIN_OE       15          // 595 shift register output enable
 #define SR_OUT_PIN_STCP     2           // output latch storage clock
 #define SR_OUT_PIN_MR       12          // shift register master reset
@@ -19,11 +23,45 @@
 #define OUT_PIN_PWM2        25
 #define OUT_PIN_PWM3        26
 
+#define PWM0_FREQ           1000        // frequency Hz, resolution bits and curve of each PWM channel
+#define PWM0_BITS           10          // e.g. 1000Hz linear for dew heaters, 20000Hz PWM_CURVE_CIE for flat panels
+#define PWM0_CURVE          PWM_CURVE_LINEAR
+#define PWM1_FREQ           1000
+#define PWM1_BITS           10
+#define PWM1_CURVE          PWM_CURVE_LINEAR
+#define PWM2_FREQ           1000
+#define PWM2_BITS           10
+#define PWM2_CURVE          PWM_CURVE_LINEAR
+#define PWM3_FREQ           1000
+#define PWM3_BITS           10
+#define PWM3_CURVE          PWM_CURVE_LINEAR
+#define PWM_FADE_MS         500         // hardware ramp of duty changes, 0 to step
+
 #define SR_IN_PIN_CE        5           // 165 shift register chip enable
 #define SR_IN_PIN_CP        18          // clock
 #define SR_IN_PIN_PL        19          // parallel load
 #define SR_IN_PIN_SDIN      4           // serial data in
 
+#define SR_BUS_BITBANG      0           // shift register transport: digitalWrite/digitalRead (fallback)
+#define SR_BUS_GPIO         1           // direct access to GPIO set/clear/in registers
+#define SR_BUS_SPI          2           // hardware SPI, VSPI for 165 chain, HSPI for 595 chain
+#define SR_BUS_TYPE         SR_BUS_SPI  // selected transport
+#define SR_SPI_CLOCK        1000000     // SPI clock for the shift registers, 1MHz
+
+#define IO_TASK_CORE        1           // core, priority, stack and period of the hardware I/O task
+#define IO_TASK_PRIORITY    5
+#define IO_TASK_STACK       4096
+#define IO_TASK_PERIOD_MS   10
+#define IO_FAST_PERIOD_MS   2           // cycle, limit switch sampling and relay latch while the roof moves
+
+#define RAIN_AUTO_CLOSE     1           // close the roof on confirmed rain while no Dome client is connected
+
+#define DEBOUNCE_PERIOD_MS  10          // input sampling period, stability time = samples * period
+#define DEBOUNCE_IN         2           // consecutive samples to accept an input change: IN 1..8
+#define DEBOUNCE_FC         2           // limit switches, samples of IO_FAST_PERIOD_MS while the roof moves
+#define DEBOUNCE_BUTTON     3           // manual open/close buttons
+#define DEBOUNCE_SAFE       3           // rain and power inputs
+
 #define IN_PIN_AP_SET       34          // net config button pin
 #define OUT_PIN_AP_LED      13          // net config LED
 
@@ -31,6 +69,7 @@
 #define IN_PIN_RX1          16          // usart RX from weather station
 #define OUT_PIN_TX1         17          // usart TX to weather station
 #define UART1_BUFFER        64          // size of uart buffers
+#define WS_RX_RING_SIZE     256         // receive ring for weather station frames, power of 2
 
 // bit mask for output shif register 595
 #define BIT_OUT_CLEAR       0xff00      // 0b1111 1111 0000 0000
@@ -21,78 +21,100 @@
 #include <Dome.h>
 #include <Switch.h>
 #include <SafetyMonitor.h>
+#include <ObservingConditions.h>
+#include <WsReceiver.h>
+#include <WeatherFrame.h>
+#include <WeatherSnapshot.h>
+#include <Scheduler.h>
+#include <IoTask.h>
+#include <AlpacaActions.h>
+#include <EventPush.h>
+#include <ResponseCache.h>
+#include <RequestStats.h>
+#include <SettingsJournal.h>
+#include <BootProfile.h>
+#include <WebAssets.h>
+#include <WeatherHistory.h>
+#include <EventLog.h>
 
 Dome domeDevice;
 Switch switchDevice;
 SafetyMonitor safemonDevice;
+ObservingConditions obscondDevice;
 
 #define VERSION "1.0.0"
+#define LOOP_STATS_URL "/stats/loop"         // GET busy fraction and timers of loop(), ?reset=1 restarts the busy fraction
 
 // ASCOM Alpaca server with discovery
 AlpacaServer alpaca_server(ALPACA_MNG_SERVER_NAME, ALPACA_MNG_MANUFACTURE, ALPACA_MNG_MANUFACTURE_VERSION, ALPACA_MNG_LOCATION);
 
-uint16_t _shift_reg_in, _shift_reg_out, _prev_shift_reg_out;
-bool d_open_button, d_close_button, d_switch_opened, d_switch_closed;
+// state exchanged with the I/O task through io_inputs/io_outputs, owned by loop()
+IoEdges_t io_edges;								// debounced inputs and their edges
 bool d_relay_open, d_relay_close;
 
-uint8_t _safemon_inputs;						// status of safety monitor 0->safe
-uint32_t tmr_rain_ini, tmr_rain_len;			// timers for rain delay and alarm duration
-uint32_t tmr_power_ini, tmr_power_len;			// power
-//uint32_t tmr_wstat_ini, tmr_wstat_len;		// weather station
+uint16_t _safemon_inputs;						// status of safety monitor 0->safe
 
-uint32_t tmr_ws_connected;						// timout for weather station connection. If elapses, ws is considered offline
 bool is_ws_connected;							// true when weather station is connected
-int rx_1_idx;									// index of pointed char in ws_message[]
-bool rx_1_complete;								// true when a complete message is received
-char rx_1_buffer[UART1_BUFFER];
+WsReceiver ws_receiver;							// frames from weather station
+uint32_t ws_parse_errors;						// frames rejected by the parser
 char tx_1_buffer[UART1_BUFFER];
-int16_t	weather_tsky;							// readings from weather station
-int16_t	weather_tair;
-int16_t	weather_wind;
-int16_t	weather_hum;
-int16_t	weather_light;
-int16_t	weather_press;							// 2024-08-26 2.03 not used anymore
-int16_t	weather_rain;							// 2024-08-26 2.03 added
-int16_t	weather_clouds;							// 2024-08-26 2.03 added
-int16_t	weather_stars;							// 2024-08-26 2.03 added
-
-bool _sw_in[8], _sw_out[8];						// status of switch in and out
-uint8_t _sw_pwm[4], _prev_sw_pwm[4];			// switch PWMs
-uint8_t _sw_pwm_pins[4] = {OUT_PIN_PWM0, OUT_PIN_PWM1, OUT_PIN_PWM2, OUT_PIN_PWM3};		// definition of PWM pins
-
-uint32_t tmr_LED, tmr_shreg_in, tmr_shreg_out;	// timers for LEDs and shift registers
+Snapshot<WeatherSnapshot> weather_snapshot;		// readings from weather station
+WeatherSnapshot weather;						// loop() copy of the published readings
+WeatherFilters weather_filters;					// filtered channels of weather
+
+bool _sw_out[8];								// status of switch out
+uint8_t _sw_pwm[4];								// switch PWMs
+
+Scheduler loop_sched;							// timers of loop()
+int8_t t_ws_timeout;							// one-shot: weather station timeout
+int8_t t_settings;								// periodic: coalesced settings journal writes
+int8_t t_events;								// periodic: batched event log writes
+int8_t t_wifi;									// periodic: Wi-Fi connection and syslog
+uint32_t wifi_start_ms;							// last WiFi.begin()
+bool is_wifi_connected;
+uint32_t const WIFI_RETRY_MS = 60000;			// connection attempt timeout
 uint32_t restart_start_time_ms;					// timer for restart
 uint32_t const RESTART_DELAY_MS = 5000;			// restart delay
 
-bool parse_ws_message(void);
+bool parse_ws_message(const char *msg, size_t len);
 void flush_tx(void);
-void flush_rx(void);
 void provisioning(void);
 void normal_boot(void);
-uint16_t read_shift_register( void );
-void write_shift_register( uint16_t value );
 void init_IO(void);
 void checkForRestart(void);
+void publish_io_outputs(void);
+void task_ws_timeout(uint32_t now);
+void task_settings(uint32_t now);
+void task_events(uint32_t now);
+void task_wifi(uint32_t now);
+void register_cached_responses(void);
+void handle_loop_stats(AsyncWebServerRequest *request);
 
 void setup()
 {
+	init_IO();											// safety I/O first, serviced while Wi-Fi connects
+	io_task_begin();
+	boot_profile.Mark("io");
+
 	pinMode(IN_PIN_AP_SET, INPUT_PULLUP);             	// net configuration button (WARNING no pullup on chip)
 	pinMode(OUT_PIN_AP_LED, OUTPUT);           			// net configuration LED
 	digitalWrite(OUT_PIN_AP_LED, HIGH);        			// turn LED OFF
-	delay(100);
+	delay(10);
 
 	if( LOW == digitalRead(IN_PIN_AP_SET)) {	// Entering WiFi provisioning mode.
 		provisioning();
 	}
 
 	Serial.begin(115200);
-	delay(1000);
 	Serial.println("Serial OK");
+	boot_profile.Mark("serial");
 
-	init_IO();
-	normal_boot();
+	normal_boot();										// returns at once, connection finished by task_wifi()
+	boot_profile.Mark("wifi_begin");
 
 	alpaca_server.Begin();
+	alpaca_actions.SetTransactionCounter([]() { return alpaca_server.GetServerTransactionID(); });	// one ServerTransactionID sequence
+	event_log.Begin(alpaca_server.getServerTCP());		// shutter, safety and switch transitions, before the devices
 
 	domeDevice.Begin();
 	alpaca_server.AddDevice(&domeDevice);
@@ -103,336 +125,232 @@ void setup()
 	safemonDevice.Begin();
 	alpaca_server.AddDevice(&safemonDevice);
 
+	obscondDevice.Begin();
+	alpaca_server.AddDevice(&obscondDevice);
+
+	alpaca_actions.Begin(alpaca_server.getServerTCP());	// device actions, before the default handlers
+	event_push.Begin(alpaca_server.getServerTCP(), &domeDevice, &switchDevice, &safemonDevice);
+	web_assets.Begin(alpaca_server.getServerTCP());		// setup page assets, before the library static handler
+	weather_history.Begin(alpaca_server.getServerTCP());
+#if REQUEST_STATS
+	request_stats.Begin(alpaca_server.getServerTCP());
+#endif
+#if RESPONSE_CACHE
+	register_cached_responses();
+	response_cache.Begin(alpaca_server.getServerTCP());
+#endif
+	alpaca_server.getServerTCP()->on(LOOP_STATS_URL, HTTP_GET, handle_loop_stats);
+	alpaca_server.getServerTCP()->on("/save_settings", HTTP_GET, [](AsyncWebServerRequest *request)	// before the library handler
+		{ bool saved = settings_journal.Save([]() { return alpaca_server.SaveSettings(); });			// journal obsolete once the file is written
+		  request->send(200, "application/json", saved ? "{\"saved\":true}" : "{\"saved\":false}"); });
 	alpaca_server.RegisterCallbacks();
 	alpaca_server.LoadSettings();
-
-	_shift_reg_in = 0;
-	_shift_reg_out = 0;
-	_prev_shift_reg_out = 0;
-
-	tmr_LED = millis();
-	tmr_shreg_in = millis();
-	tmr_shreg_out = millis();
+	settings_journal.Begin(alpaca_server.getServerTCP(), [](const char *section, const char *key, JsonVariantConst value)
+		{ return domeDevice.ApplySetting(section, key, value) || switchDevice.ApplySetting(section, key, value) ||
+				 safemonDevice.ApplySetting(section, key, value) || obscondDevice.ApplySetting(section, key, value); });		// changes saved after the settings file
+	boot_profile.Begin(alpaca_server.getServerTCP());
+	publish_io_outputs();								// connections and safety delays to the I/O task
+	boot_profile.Mark("alpaca");
 
 	_safemon_inputs = 0;
-	tmr_rain_ini = 0; tmr_rain_len =0 ;
-	tmr_power_ini = 0; tmr_power_len = 0; 
-	//tmr_wstat_ini = 0; tmr_wstat_len = 0;
 	is_ws_connected = false;
-	rx_1_complete = false;
-	rx_1_idx = 0;
 	restart_start_time_ms = 0;
+
+	t_ws_timeout = loop_sched.AddOneShot("ws_timeout", task_ws_timeout);
+	t_settings = loop_sched.AddPeriodic("settings", task_settings, 500, millis());
+	t_events = loop_sched.AddPeriodic("events", task_events, 250, millis());
+	t_wifi = loop_sched.AddPeriodic("wifi", task_wifi, 250, millis());
+
+	Serial1.onReceive([]() { loop_sched.Wake(); });		// wake up loop() as soon as WS data arrives
+	loop_sched.ResetLoad();
 }
 
 void loop()
 {
+	uint32_t now = millis();
+
 	checkForRestart();
 
 	alpaca_server.Loop();
 
-	domeDevice.Loop();
-
-	switchDevice.Loop();
+	IoInputs_t in;
+	io_inputs.Read(in);											// latest inputs from the I/O task
 
-	safemonDevice.Loop();
+	io_edges.rise = in.shift_reg_in & ~io_edges.state;			// edges for Dome and Switch
+	io_edges.fall = ~in.shift_reg_in & io_edges.state;
+	io_edges.state = in.shift_reg_in;
 
-	if((millis() - tmr_shreg_in) > 100) {                  	// read shift register every 100ms
-		tmr_shreg_in = millis();
-		_shift_reg_in = read_shift_register();
+	_safemon_inputs = (_safemon_inputs & ~(SAFEMON_RAIN_BIT | SAFEMON_POWER_BIT)) | in.safemon_inputs;	// rain and power for SafetyMonitor
+	if( safemonDevice.GetNumberOfConnectedClients() == 0 ) {
+		_safemon_inputs = 0;
+		is_ws_connected = false;
 	}
 
-	if( domeDevice.GetNumberOfConnectedClients() > 0 ) {
-		_shift_reg_out |= BIT_DOME;							// Dome connected LED ON
-
-		if( _shift_reg_in & BIT_FC_CLOSE )                	// handle close switch input
-			d_switch_closed = true;
-		else
-			d_switch_closed = false;
-
-		if( _shift_reg_in & BIT_FC_OPEN )                 	// handle open switch input
-			d_switch_opened = true;
-		else 
-			d_switch_opened = false;
-
-		if( d_relay_close && !d_switch_closed ){			// handle close relay bit in the out shift register
-			_shift_reg_out |= BIT_ROOF_CLOSE;
-			_shift_reg_out &= ~BIT_ROOF_OPEN;
-		} else {
-			_shift_reg_out &= ~BIT_ROOF_CLOSE;
-		}
-		
-		if( d_relay_open && !d_switch_opened) {				// handle open relay bit in the out shift register
-			_shift_reg_out |= BIT_ROOF_OPEN;
-			_shift_reg_out &= ~BIT_ROOF_CLOSE;
-		} else {
-			_shift_reg_out &= ~BIT_ROOF_OPEN;
-		}
-	} else {
-		_shift_reg_out &= ~BIT_DOME;		// Dome connected LED OFF
-
-		// set flags according to bits in shift registers
-		if( _shift_reg_in & BIT_BUTTON_CLOSE)   	// if no clients connected, handle manual close button
-			d_close_button = true;
-		else
-			d_close_button = false;
-		
-		if( _shift_reg_in & BIT_BUTTON_OPEN )   	// if no clients connected, handle manual open button
-			d_open_button = true;
-		else
-			d_open_button = false;
-		
-		if( _shift_reg_in & BIT_FC_CLOSE )      	// handle close switch
-			d_switch_closed = true;
-		else
-			d_switch_closed = false;
-
-		if( _shift_reg_in & BIT_FC_OPEN )       	// handle open switch
-			d_switch_opened = true;
-		else 
-			d_switch_opened = false;
-		
-		// set relays if conditions are met
-		if( d_close_button && !d_open_button && !d_switch_closed ) {
-			_shift_reg_out |= BIT_ROOF_CLOSE; 			// set close relay bit in the shift register
-			_shift_reg_out &= ~BIT_ROOF_OPEN;			// be sure to clear OPEN RELAY bit
-		}
-		else if( !d_close_button && d_open_button && !d_switch_opened ) {
-			_shift_reg_out |= BIT_ROOF_OPEN;   			// set open relay bit in the shift register
-			_shift_reg_out &= ~BIT_ROOF_CLOSE;			// be sure to clear CLOSE RELAY bit
-		} else {
-			_shift_reg_out &= ~BIT_ROOF_CLOSE;			// bclear CLOSE RELAY bit
-			_shift_reg_out &= ~BIT_ROOF_OPEN;			// clear OPEN RELAY bit
-		}
-	}
+	domeDevice.Loop();
 
-	if( safemonDevice.GetNumberOfConnectedClients() > 0 ) {
-		_shift_reg_out |= BIT_SAFEMON; 									// Sefemon connected LED ON
+	switchDevice.Loop();
 
-		if(( _shift_reg_in & BIT_SAFE_RAIN ) != 0) {					// rain signal
-			if( tmr_rain_ini == 0 ) {									// if it's the first event, start counting the rain delay
-				tmr_rain_ini = millis();
-				tmr_rain_len = 1000 * safemonDevice.getRainDelay();
-			}
+	safemonDevice.Loop();
 
-			if(( tmr_rain_ini != 0 ) && ((millis() - tmr_rain_ini) > tmr_rain_len))    // if alarm persists for rain_delay, set UNSAFE
-				_safemon_inputs |= SAFEMON_RAIN_BIT;		
-		
-		} else {
-			tmr_rain_ini = 0;											// clear timer and flag
-			_safemon_inputs &= ~SAFEMON_RAIN_BIT;
-		}
+	publish_io_outputs();
+	event_push.Loop();
 
-		if( safemonDevice.getPowerDelay() > 0 ) {                 		// enter only if power delay is > 0
-			if(( _shift_reg_in & BIT_SAFE_POWER ) != 0) {
-				if( tmr_power_ini == 0 ) {
-					tmr_power_ini = millis();
-					tmr_power_len = 1000 * safemonDevice.getPowerDelay();
-				}
+	// serial from WS, drain everything received since last pass
+	if( ws_receiver.Poll(Serial1) > 0 )
+	{
+		const char *frame;
+		size_t len;
 
-				if((tmr_power_ini != 0) && ((millis() - tmr_power_ini) > tmr_power_len))
-					_safemon_inputs |= SAFEMON_POWER_BIT;				
-			}
-			else
-			{
-				tmr_power_ini = 0;
-				_safemon_inputs &= ~SAFEMON_POWER_BIT;
+		while( ws_receiver.NextFrame(frame, len) ) {
+			if( parse_ws_message(frame, len) ) {
+				is_ws_connected = true;
+				loop_sched.Start(t_ws_timeout, WS_TIMEOUT * 1000, now);		// refresh connection timer
 			}
-		} else {
-			tmr_power_ini = 0;
-			_safemon_inputs &= ~SAFEMON_POWER_BIT;
 		}
 	}
-	else
-	{
-		_shift_reg_out &= ~BIT_SAFEMON;		// Sefemon connected LED OFF
-		_safemon_inputs = 0;
-		is_ws_connected = false;
-	}
 
-	if( switchDevice.GetNumberOfConnectedClients() > 0)
-	{
-		uint32_t i;
-		uint16_t p;
-
-		_shift_reg_out |= BIT_SWITCH;		// Switch connected LED ON
-
-		for(i=0; i<8; i++)
-		{
-			if((_shift_reg_in & (1 << i) != 0))         // set _sw_in[] according to shift register inputs
-				_sw_in[i] = true;
-			else
-				_sw_in[i] = false;
-		
-			if( _sw_out[i] )                            // set out bits according to _sw_out[] status
-				_shift_reg_out |= (BIT_OUT_0 >> i);
-			else
-				_shift_reg_out &= ~(BIT_OUT_0 >> i);
-		}
+	loop_sched.Idle(loop_sched.Run(millis()));			// run due timers, sleep until the next one or an event
+}
 
-		for(i=0; i<4; i++)
-		{
-			if( _prev_sw_pwm[i] != _sw_pwm[i] ) {				// update pwm only if different
-				_prev_sw_pwm[i] = _sw_pwm[i];
-
-				if( p == 0) {                                   // set PWM pin to 0
-					digitalWrite(_sw_pwm_pins[i], LOW);
-				} else if( p == 100) {                          // set PWM pin to 1
-					digitalWrite(_sw_pwm_pins[i], HIGH);
-				} else {         
-					p = ((uint16_t)_sw_pwm[i] * 255) / 100;		// set PWM value
-					analogWrite(_sw_pwm_pins[i], (int)p);
-				}
-			}
-		}
-	} else {
-		uint32_t i;
+// publish outputs to the I/O task, only when something changed
+void publish_io_outputs(void)
+{
+	static IoOutputs_t prev;
+	IoOutputs_t out = prev;
+	uint32_t dirty = switchDevice.TakeDirty();			// Switch channels written since last pass
+
+	out.relay_open = d_relay_open;
+	out.relay_close = d_relay_close;
+	for(uint32_t i=0; i<8; i++)
+		if( dirty & (1 << (i + 8)) )
+			out.sw_out = _sw_out[i] ? (out.sw_out | (1 << i)) : (out.sw_out & ~(1 << i));
+	for(uint32_t i=0; i<4; i++)
+		if( dirty & (1 << (i + 16)) )
+			out.sw_pwm[i] = _sw_pwm[i];
+	out.dome_connected = domeDevice.GetNumberOfConnectedClients() > 0;
+	out.switch_connected = switchDevice.GetNumberOfConnectedClients() > 0;
+	out.safemon_connected = safemonDevice.GetNumberOfConnectedClients() > 0;
+	out.rain_delay_ms = 1000 * safemonDevice.getRainDelay();
+	out.power_delay_ms = 1000 * safemonDevice.getPowerDelay();
+	out.settings = true;
+
+	if( memcmp(&out, &prev, sizeof(out)) == 0 )
+		return;
+
+	prev = out;
+	io_outputs.Write(out);
+	io_task_wake();										// apply without waiting for the next cycle
+}
 
-		_shift_reg_out &= ~BIT_SWITCH;						// Switch connected LED OFF
+// hot GET endpoints, rendered again only when the device version changes
+void register_cached_responses(void)
+{
+	response_cache.Add("/api/v1/dome/0/shutterstatus", 0, []() { return domeDevice.GetNumberOfConnectedClients() > 0; },
+		[]() { return domeDevice.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%d", (int)domeDevice.GetShutter()); });
 
-		_shift_reg_out &= BIT_OUT_CLEAR;                  	// clear all OUT bits
-		for(i=0; i<8; i++)
-		{
-			_sw_out[i] = false;                             // clear all out
-			_sw_in[i] = false;                              // set input to false
-		}
+	response_cache.Add("/api/v1/dome/0/slewing", 0, []() { return domeDevice.GetNumberOfConnectedClients() > 0; },
+		[]() { return domeDevice.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%s", domeDevice.GetSlewing() ? "true" : "false"); });
 
-		for(i=0; i<4; i++)
-		{
-			_sw_pwm[i] = 0;                                 // clear all PWMs
-			digitalWrite(_sw_pwm_pins[i], LOW);             // set PWM pin to 0
-		}
-	}
+	response_cache.Add("/api/v1/safetymonitor/0/issafe", 0, []() { return safemonDevice.GetNumberOfConnectedClients() > 0; },
+		[]() { return safemonDevice.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%s", safemonDevice.IsSafe() ? "true" : "false"); });
 
-	if(( millis() - tmr_LED ) < 1000 ) {                 	// blink CPU OK LED
-	
-		if(( millis() - tmr_LED ) < 500 )
-		{
-			_shift_reg_out |= BIT_CPU_OK;		// CPU LED ON
-			//if( domeDevice.GetNumberOfConnectedClients() > 0) _shift_reg_out |= BIT_DOME;			// Dome connected LED ON
-			//if( safemonDevice.GetNumberOfConnectedClients() > 0) _shift_reg_out |= BIT_SAFEMON; 	// Sefemon connected LED ON
-			//if( switchDevice.GetNumberOfConnectedClients() > 0) _shift_reg_out |= BIT_SWITCH;		// Switch connected LED ON
-		}
-		else
-		{
-			_shift_reg_out &= ~BIT_CPU_OK;		// CPU LED OFF
-			//_shift_reg_out &= ~BIT_DOME;		// Dome connected LED OFF
-			//_shift_reg_out &= ~BIT_SAFEMON;		// Sefemon connected LED OFF
-			//_shift_reg_out &= ~BIT_SWITCH;		// Switch connected LED OFF
-		}
-	} else {
-		tmr_LED = millis();
-	}
+	response_cache.Add("/api/v1/switch/0/getswitchvalue", switchDevice.GetNumChannels(), []() { return switchDevice.GetNumberOfConnectedClients() > 0; },
+		[]() { return switchDevice.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%g", switchDevice.GetChannelValue(id)); });
+}
 
-	if((millis() - tmr_shreg_out) > 100)                    // write shift register every 100ms
-	{
-		tmr_shreg_out = millis();
-	
-		if( _shift_reg_out != _prev_shift_reg_out )       	// write only if changed
-		{
-			_prev_shift_reg_out = _shift_reg_out;
-			write_shift_register( _shift_reg_out );
-		}
+// CPU busy fraction of loop() and lateness/execution time of its timers
+void handle_loop_stats(AsyncWebServerRequest *request)
+{
+	JsonDocument doc;
+	String body;
+
+	doc["busy_percent"] = loop_sched.GetBusyPercent();
+	JsonArray arr = doc["tasks"].to<JsonArray>();
+	for(uint8_t i = 0; i < loop_sched.GetNumTasks(); i++) {
+		const SchedTaskStats_t &st = loop_sched.GetStats(i);
+		JsonObject obj = arr.add<JsonObject>();
+
+		obj["name"] = loop_sched.GetName(i);
+		obj["runs"] = st.runs;
+		obj["max_late_ms"] = st.max_late_ms;
+		obj["max_exec_us"] = st.max_exec_us;
 	}
 
-	// serial from WS
-	if(Serial1.available())
-	{
-		char in_msg = (char)Serial1.read();
-		if( in_msg == '%' )                   		// frame start
-			rx_1_idx = 0;
-		
-		rx_1_buffer[rx_1_idx++] = in_msg;     		// store char in the rx_buffer
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+
+	if( request->hasParam("reset") )
+		loop_sched.ResetLoad();
+}
 
-		if(in_msg == '#') {                   		// frame end
-			rx_1_buffer[rx_1_idx++] = 0;        	// append termination char
+// scheduled tasks of loop()
+void task_ws_timeout(uint32_t now)
+{
+	is_ws_connected = false;							// no valid frame for WS_TIMEOUT seconds
+}
 
-			if( rx_1_buffer[0] == '%') {
-				rx_1_complete = true;
-				is_ws_connected = true;
-				tmr_ws_connected = millis();      	// refresh connection timer
-			} else {                            	// message is incomplete, ignore
-				rx_1_idx = 0;
-				rx_1_buffer[rx_1_idx] = 0;
-			}
-		}
-	}
+void task_settings(uint32_t now)
+{
+	settings_journal.Loop(now);							// flush coalesced changes, compact the journal
+}
 
-	if (rx_1_complete) {
-		parse_ws_message();
-		rx_1_complete = false;
-		flush_rx();
-	}
+void task_events(uint32_t now)
+{
+	event_log.Loop(now);								// queued events to the flash
 }
 
 // NEW -> decode messages from WStation and store to local variables (%WS, skytemp, airtemp, wind, humidity, rain, light, clouds, stars #)
 // NEW -> typical message			%WS,-175,-120,24,85,1,1270,-1,-1#
-bool parse_ws_message(void) {
-	Serial.println(rx_1_buffer);
-
-	uint8_t s, d, v;
-	int16_t params[8];
-	char s_val[8];
-
-	s = 0;
-	d = 0;
-	v = 0;
+bool parse_ws_message(const char *msg, size_t len) {
+	WeatherFrame f;
+	WsParseError_t err = ws_parse_frame(msg, len, f);
+
+	if( err != WsParseError_t::kOk ) {
+		ws_parse_errors++;
+		SLOG_DEBUG_PRINTF("WS frame rejected: %s\n", ws_parse_error_str(err));
+		return false;
+	}
 
-	if((rx_1_buffer[0] == '%') && (rx_1_buffer[1] == 'W') && (rx_1_buffer[2] == 'S') && (rx_1_buffer[3] == ','))
-	{
-		s = 4;
-
-		while(rx_1_buffer[s])
-		{
-			if(( rx_1_buffer[s] == ',' ) || ( rx_1_buffer[s] == '#' ))
-			{
-				params[v] = atoi( s_val );
-				v++;
-				s++;
-				d = 0;
-			}
-			else
-			{
-				s_val[d++] = rx_1_buffer[s++];
-				s_val[d] = 0;
-			}
-		}
+	if(!(( f.tsky < -500 ) || ( f.tsky > 500 )))			// sky temp -500 -> 500			1adu = 0,1°C
+		weather.values.tsky = f.tsky;
+	
+	if(!(( f.tair < -500 ) || ( f.tair > 500 )))			// air temp -500 -> 500			1adu = 0,1°C
+		weather.values.tair = f.tair;
+	
+	if(!(( f.wind < 0 ) || ( f.wind > 100 )))				// wind 0 -> 100				1adu = 1km/h
+		weather.values.wind = f.wind;
+	
+	if(!(( f.hum < 0 ) || ( f.hum > 110 )))					// humidity 0 -> 110			1adu = 1%
+		weather.values.hum = f.hum;
+	
+	if(!(( f.rain < 0 ) || ( f.rain > 9999 )))				// rain 0 -> 1					0 safe, 1 rain
+		weather.values.rain = f.rain;
+	
+	if(!(( f.light < 0 ) || ( f.light > 9999 )))			// light 0 -> 9999				1adu = 1lux
+		weather.values.light = f.light;
+	
+	if(!(( f.clouds < -1 ) || ( f.clouds > 100 )))			// cloud coverage -1 -> 100		-1 not used, 0~100 percentage
+		weather.values.clouds = f.clouds;
+	
+	if(!(( f.stars < -1 ) || ( f.stars > 9999 )))			// stars -1 -> 9999				-1 not used, 0~9999 number of stars in sight
+		weather.values.stars = f.stars;
 
-		if(!(( params[0] < -500 ) || ( params[0] > 500 )))		// sky temp -500 -> 500			1adu = 0,1°C
-			weather_tsky = params[0];
-		
-		if(!(( params[1] < -500 ) || ( params[1] > 500 )))		// air temp -500 -> 500			1adu = 0,1°C
-			weather_tair = params[1];
-		
-		if(!(( params[2] < 0 ) || ( params[2] > 100 )))			// wind 0 -> 100				1adu = 1km/h
-			weather_wind = params[2];
-		
-		if(!(( params[3] < 0 ) || ( params[3] > 110 )))			// humidity 0 -> 110			1adu = 1%
-			weather_hum = params[3];
-		
-		if(!(( params[4] < 0 ) || ( params[4] > 9999 )))		// rain 0 -> 1					0 safe, 1 rain
-			weather_rain = params[4];
-		
-		if(!(( params[5] < 0 ) || ( params[5] > 9999 )))		// light 0 -> 9999				1adu = 1lux
-			weather_light = params[5];
-		
-		if(!(( params[6] < -1 ) || ( params[6] > 100 )))		// cloud coverage -1 -> 100		-1 not used, 0~100 percentage
-			weather_clouds = params[6];
-		
-		if(!(( params[7] < -1 ) || ( params[7] > 9999 )))		// stars -1 -> 9999				-1 not used, 0~9999 number of stars in sight
-			weather_stars = params[7];
-		
-		/*
-		if(!(( params[5] < 0 ) || ( params[5] > 1100 )))		// pressure 0 -> 1100			1adu = 1mbar
-		weather_press = params[5];
-		*/
-	}
+	weather.timestamp_ms = millis();
+	weather_filters.Update(weather.values, weather.timestamp_ms, weather.filtered);
+	weather.frames++;
+	weather_snapshot.Write(weather);						// publish one coherent frame
+	weather_history.Add(weather.values, weather.timestamp_ms);
+	obscondDevice.Add(weather.values, weather.timestamp_ms);
 
 	return true;
 }
 
 // flush UART buffers
 void flush_tx(void) { for(int i=0; i< UART1_BUFFER; i++) tx_1_buffer[i] = 0; }
-void flush_rx(void) { for(int i=0; i< UART1_BUFFER; i++) rx_1_buffer[i] = 0; }
 
 // if wifi is not configured, setup WiFiManager to configure via web
 void provisioning() {
@@ -500,93 +418,47 @@ void normal_boot() {
 
 	SLOG_INFO_PRINTF("Connecting to WiFi ..\n");
 	Serial.println("Connecting to WiFi ..");
-	uint16_t _attempts = 0;
-	while ((WiFi.status() != WL_CONNECTED) && (_attempts < 60))
-	{
-		delay(1000);
-		_attempts++;
-		Serial.print(".");
+	is_wifi_connected = false;
+	wifi_start_ms = millis();
+}
 
-		if(!(_attempts < 60)) {
-			ESP.restart();
+// finish the connection started by normal_boot(), the devices keep running meanwhile
+void task_wifi(uint32_t now)
+{
+	if( WiFi.status() != WL_CONNECTED ) {
+		if( is_wifi_connected ) {
+			is_wifi_connected = false;
+			wifi_start_ms = now;
+			Serial.println("WiFi lost");
 		}
+		if(( now - wifi_start_ms ) > WIFI_RETRY_MS ) {	// retry instead of a restart, the roof may be moving
+			Serial.println("WiFi retry");
+			WiFi.disconnect();
+			WiFi.begin();
+			wifi_start_ms = now;
+		}
+		return;
 	}
-	
+
+	if( is_wifi_connected )
+		return;
+	is_wifi_connected = true;
+
 	IPAddress ip = WiFi.localIP();
 	char wifi_ipstr[32]; // = "xxx.yyy.zzz.www";
 	snprintf(wifi_ipstr, sizeof(wifi_ipstr), "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
 	SLOG_INFO_PRINTF("connected with %s\n", wifi_ipstr);
 	Serial.printf("connected with %s\n", wifi_ipstr);
+	if( boot_profile.Get("wifi") == 0 )
+		boot_profile.Mark("wifi");
 	
 	// finalize logging setup
 	g_Slog.Begin(alpaca_server.GetSyslogHost().c_str());
 	SLOG_INFO_PRINTF("SYSLOG enabled and running log_lvl=%s enable_serial=%s\n", g_Slog.GetLvlMskStr().c_str(), alpaca_server.GetSerialLog() ? "true" : "false"); 
 	g_Slog.SetLvlMsk(alpaca_server.GetLogLvl());
 	g_Slog.SetEnableSerial(alpaca_server.GetSerialLog());
-}
-
-// read inputs from shift register 165, returns uint16_t value
-uint16_t read_shift_register( void )
-{
-	uint16_t v = 0;
-
-	digitalWrite(SR_IN_PIN_CP, LOW);    	// be sure CP is low
-	digitalWrite(SR_IN_PIN_PL, LOW);    	// latch parallel inputs
-	delayMicroseconds(1);
-	digitalWrite(SR_IN_PIN_PL, HIGH);
-	delayMicroseconds(1);
-	digitalWrite(SR_IN_PIN_CE, LOW);    	// on CE -> low, D7 is available on serial out Q7
-	delayMicroseconds(1);
-
-	for(uint16_t i=0; i<16; i++) {
-		v = (v << 1);
-		v += digitalRead(SR_IN_PIN_SDIN);
-
-		digitalWrite(SR_IN_PIN_CP, HIGH);   // shift to the left
-		delayMicroseconds(1);
-		digitalWrite(SR_IN_PIN_CP, LOW);
-		delayMicroseconds(1);
-	}
-
-	digitalWrite(SR_IN_PIN_CE, HIGH);
-
-	return ((~v) & 0x3fff);
-}
-
-// put value on the shift registers 595
-void write_shift_register( uint16_t value )
-{
-	uint16_t v = value;
-
-	digitalWrite(SR_OUT_PIN_SDOUT, LOW);        // 14 serial data low
-	digitalWrite(SR_OUT_PIN_MR, LOW);           // 10 clear previous data
-	delayMicroseconds(1);
-	digitalWrite(SR_OUT_PIN_SHCP, HIGH);        // 11 shift register clock
-	delayMicroseconds(1);
-	digitalWrite(SR_OUT_PIN_SHCP, LOW);
-	delayMicroseconds(1);
-	digitalWrite(SR_OUT_PIN_MR, HIGH);
-	delayMicroseconds(1);
-
-	for(uint8_t i = 0; i < 16; i++) {
-		if((v & 0x8000) == 0 )
-			digitalWrite(SR_OUT_PIN_SDOUT, LOW);
-		else
-			digitalWrite(SR_OUT_PIN_SDOUT, HIGH);
-
-		delayMicroseconds(1);
-		digitalWrite(SR_OUT_PIN_SHCP, HIGH);
-		delayMicroseconds(1);
-		digitalWrite(SR_OUT_PIN_SHCP, LOW);
-
-		v = (v << 1);
-	}
-
-	delayMicroseconds(1);
-	digitalWrite(SR_OUT_PIN_STCP, HIGH);        // transfer serial data to parallel output
-	delayMicroseconds(1);
-	digitalWrite(SR_OUT_PIN_STCP, LOW);         // 12
-	digitalWrite(SR_OUT_PIN_OE, LOW);           // 13 enable output
+	if( boot_profile.Get("syslog") == 0 )
+		boot_profile.Mark("syslog");
 }
 
 // initialize IOs and pin status
@@ -638,9 +510,6 @@ void init_IO( void ) {
 	usleep(10);
 	digitalWrite(SR_OUT_PIN_MR, HIGH);
 
-	analogWriteFrequency(1000);         // set PWM 1KHz 8bits
-	analogWriteResolution(8);
-
 	Serial1.begin(9600, SERIAL_8N1, IN_PIN_RX1, OUT_PIN_TX1);
 }
 
@@ -0,0 +1,29 @@
+/**************************************************************************************************
+  Filename:       AlpacaDevice.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32_Alpaca_Server device base class and debug macros,
+                  shared by the device stand-ins
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <SLog.h>
+
+#define DBG_JSON_PRINTFJ(level, root, ...)  do {} while(0)
+
+class AlpacaDevice
+{
+protected:
+	uint32_t _clients = 0;
+
+	virtual void AlpacaReadJson(JsonObject &root) {}
+	virtual void AlpacaWriteJson(JsonObject &root) {}
+
+public:
+	virtual ~AlpacaDevice() {}
+	void Begin() {}
+	uint32_t GetNumberOfConnectedClients() { return _clients; }
+	void SetNumberOfConnectedClients(uint32_t n) { _clients = n; }		// test side
+};
@@ -0,0 +1,35 @@
+/**************************************************************************************************
+  Filename:       AlpacaDome.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32_Alpaca_Server Dome base class: the shutter status enum
+                  and the PUT openshutter/closeshutter/abortslew path into the device
+**************************************************************************************************/
+#pragma once
+#include "AlpacaDevice.h"
+
+enum struct AlpacaShutterStatus_t
+{
+	kOpen = 0,
+	kClosed,
+	kOpening,
+	kClosing,
+	kError
+};
+
+class AlpacaDome : public AlpacaDevice
+{
+protected:
+	virtual const bool _putAbort() = 0;
+	virtual const bool _putClose() = 0;
+	virtual const bool _putOpen() = 0;
+	virtual const AlpacaShutterStatus_t _getShutter() = 0;
+	virtual const bool _getSlewing() = 0;
+
+public:
+	// test side: the library handlers
+	bool PutOpen() { return _putOpen(); }
+	bool PutClose() { return _putClose(); }
+	bool PutAbort() { return _putAbort(); }
+};
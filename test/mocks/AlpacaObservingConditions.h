@@ -0,0 +1,40 @@
+/**************************************************************************************************
+  Filename:       AlpacaObservingConditions.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32_Alpaca_Server ObservingConditions base class: the
+                  properties the firmware device implements and the GET/PUT path into them
+**************************************************************************************************/
+#pragma once
+#include "AlpacaDevice.h"
+
+class AlpacaObservingConditions : public AlpacaDevice
+{
+protected:
+	virtual const bool _putAveragePeriod(double period) = 0;
+	virtual const double _getAveragePeriod() = 0;
+	virtual const double _getCloudCover() = 0;
+	virtual const double _getDewPoint() = 0;
+	virtual const double _getHumidity() = 0;
+	virtual const double _getRainRate() = 0;
+	virtual const double _getSkyBrightness() = 0;
+	virtual const double _getSkyTemperature() = 0;
+	virtual const double _getTemperature() = 0;
+	virtual const double _getWindSpeed() = 0;
+	virtual const double _getTimeSinceLastUpdate(const char *sensor) = 0;
+
+public:
+	// test side: the library handlers
+	bool PutAveragePeriod(double period) { return _putAveragePeriod(period); }
+	double AveragePeriod() { return _getAveragePeriod(); }
+	double CloudCover() { return _getCloudCover(); }
+	double DewPoint() { return _getDewPoint(); }
+	double Humidity() { return _getHumidity(); }
+	double RainRate() { return _getRainRate(); }
+	double SkyBrightness() { return _getSkyBrightness(); }
+	double SkyTemperature() { return _getSkyTemperature(); }
+	double Temperature() { return _getTemperature(); }
+	double WindSpeed() { return _getWindSpeed(); }
+	double TimeSinceLastUpdate(const char *sensor) { return _getTimeSinceLastUpdate(sensor); }
+};
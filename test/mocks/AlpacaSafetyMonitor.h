@@ -0,0 +1,16 @@
+/**************************************************************************************************
+  Filename:       AlpacaSafetyMonitor.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32_Alpaca_Server SafetyMonitor base class, enough to
+                  declare the firmware device in suites that only use its definitions
+**************************************************************************************************/
+#pragma once
+#include "AlpacaDevice.h"
+
+class AlpacaSafetyMonitor : public AlpacaDevice
+{
+protected:
+	virtual const bool _getIsSafe() = 0;
+};
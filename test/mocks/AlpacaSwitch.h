@@ -0,0 +1,76 @@
+/**************************************************************************************************
+  Filename:       AlpacaSwitch.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32_Alpaca_Server Switch base class: the channel table,
+                  its accessors and the setswitch/setswitchvalue path into _writeSwitchValue(),
+                  with a counter of accessor calls
+**************************************************************************************************/
+#pragma once
+#include "AlpacaDevice.h"
+#include <vector>
+
+const uint32_t kSwitchNameSize = 32;
+const uint32_t kSwitchDescriptionSize = 64;
+
+typedef struct {
+	bool init_by_setup;
+	bool can_write;
+	char name[kSwitchNameSize];
+	char description[kSwitchDescriptionSize];
+	double value;
+	double min_value;
+	double max_value;
+	double step;
+} SwitchDevice_t;
+
+namespace mock {
+	inline uint32_t switch_calls = 0;			// Get/Set accessor calls on the channel table
+}
+
+class AlpacaSwitch : public AlpacaDevice
+{
+private:
+	std::vector<SwitchDevice_t> _devices;
+
+protected:
+	virtual const bool _writeSwitchValue(uint32_t id, double value) = 0;
+
+	void InitSwitchInitBySetup(uint32_t id, bool v) { _devices[id].init_by_setup = v; }
+	void InitSwitchCanWrite(uint32_t id, bool v) { _devices[id].can_write = v; }
+	void InitSwitchName(uint32_t id, const char *s) { snprintf(_devices[id].name, kSwitchNameSize, "%s", s); }
+	void InitSwitchDescription(uint32_t id, const char *s) { snprintf(_devices[id].description, kSwitchDescriptionSize, "%s", s); }
+	void InitSwitchValue(uint32_t id, double v) { _devices[id].value = v; }
+	void InitSwitchMinValue(uint32_t id, double v) { _devices[id].min_value = v; }
+	void InitSwitchMaxValue(uint32_t id, double v) { _devices[id].max_value = v; }
+	void InitSwitchStep(uint32_t id, double v) { _devices[id].step = v; }
+
+public:
+	AlpacaSwitch(uint32_t max_switch) : _devices(max_switch) {}
+
+	uint32_t GetMaxSwitch() { return _devices.size(); }
+	const char *GetSwitchName(uint32_t id) { return _devices[id].name; }
+	const char *GetSwitchDescription(uint32_t id) { return _devices[id].description; }
+	bool GetSwitchInitBySetup(uint32_t id) { return _devices[id].init_by_setup; }
+	bool GetSwitchCanWrite(uint32_t id) { return _devices[id].can_write; }
+	double GetSwitchMinValue(uint32_t id) { return _devices[id].min_value; }
+	double GetSwitchMaxValue(uint32_t id) { return _devices[id].max_value; }
+	double GetSwitchStep(uint32_t id) { return _devices[id].step; }
+	double GetSwitchValue(uint32_t id) { mock::switch_calls++; return _devices[id].value; }
+	const bool GetValue(uint32_t id) { mock::switch_calls++; return _devices[id].value != _devices[id].min_value; }
+	void SetSwitch(uint32_t id, bool v) { mock::switch_calls++; _devices[id].value = v ? _devices[id].max_value : _devices[id].min_value; }
+	void SetSwitchValue(uint32_t id, double v) { mock::switch_calls++; _devices[id].value = v; }
+
+	// PUT setswitchvalue as the library handles it: checked, written to the device, then stored
+	bool PutSetSwitchValue(uint32_t id, double v)
+	{
+		if(( id >= _devices.size() ) || !_devices[id].can_write || ( v < _devices[id].min_value ) || ( v > _devices[id].max_value ))
+			return false;
+		if( !_writeSwitchValue(id, v) )
+			return false;
+		_devices[id].value = v;
+		return true;
+	}
+	bool PutSetSwitch(uint32_t id, bool v) { return ( id < _devices.size() ) && PutSetSwitchValue(id, v ? _devices[id].max_value : _devices[id].min_value); }
+};
@@ -0,0 +1,375 @@
+/**************************************************************************************************
+  Filename:       Arduino.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32 Arduino core for the native test environment
+                  String, a virtual or real time clock, GPIO levels with write/toggle counters,
+                  FreeRTOS mutexes, tasks and task notifications on std::thread, heap counters, log_x
+**************************************************************************************************/
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s)                (s)
+
+#define HIGH                1
+#define LOW                 0
+#define INPUT               0x01
+#define OUTPUT              0x03
+#define INPUT_PULLUP        0x05
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/**************************************************************************************************
+  String, the subset of WString used by the firmware and ArduinoJson
+**************************************************************************************************/
+class String
+{
+private:
+	std::string _s;
+
+public:
+	String() {}
+	String(const char *s) : _s(s ? s : "") {}
+	String(const String &s) = default;
+	String(const std::string &s) : _s(s) {}
+	explicit String(char c) : _s(1, c) {}
+	explicit String(int v) : _s(std::to_string(v)) {}
+	explicit String(unsigned int v) : _s(std::to_string(v)) {}
+	explicit String(long v) : _s(std::to_string(v)) {}
+	explicit String(unsigned long v) : _s(std::to_string(v)) {}
+	explicit String(double v, unsigned int decimals = 2) { char b[40]; snprintf(b, sizeof(b), "%.*f", decimals, v); _s = b; }
+	String &operator=(const String &s) = default;
+	String &operator=(const char *s) { _s = s ? s : ""; return *this; }
+
+	const char *c_str() const { return _s.c_str(); }
+	unsigned int length() const { return _s.length(); }
+	bool isEmpty() const { return _s.empty(); }
+	void reserve(unsigned int size) { _s.reserve(size); }
+	long toInt() const { return strtol(_s.c_str(), NULL, 10); }
+	float toFloat() const { return strtof(_s.c_str(), NULL); }
+	double toDouble() const { return strtod(_s.c_str(), NULL); }
+
+	bool concat(const char *s) { if( s ) _s += s; return s != NULL; }
+	bool concat(const char *s, size_t n) { _s.append(s, n); return true; }
+	bool concat(const String &s) { _s += s._s; return true; }
+	bool concat(char c) { _s += c; return true; }
+	String &operator+=(const String &s) { _s += s._s; return *this; }
+	String &operator+=(const char *s) { concat(s); return *this; }
+	String &operator+=(char c) { _s += c; return *this; }
+	String &operator+=(int v) { _s += std::to_string(v); return *this; }
+	String &operator+=(unsigned int v) { _s += std::to_string(v); return *this; }
+	String &operator+=(long v) { _s += std::to_string(v); return *this; }
+	String &operator+=(unsigned long v) { _s += std::to_string(v); return *this; }
+
+	bool equals(const String &s) const { return _s == s._s; }
+	bool equalsIgnoreCase(const String &s) const { return strcasecmp(_s.c_str(), s.c_str()) == 0; }
+	bool startsWith(const String &s) const { return _s.compare(0, s.length(), s._s) == 0; }
+	bool endsWith(const String &s) const { return ( _s.length() >= s.length() ) && ( _s.compare(_s.length() - s.length(), s.length(), s._s) == 0 ); }
+	int indexOf(char c, unsigned int from = 0) const { size_t i = _s.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+	int indexOf(const String &s, unsigned int from = 0) const { size_t i = _s.find(s._s, from); return i == std::string::npos ? -1 : (int)i; }
+	int lastIndexOf(char c) const { size_t i = _s.rfind(c); return i == std::string::npos ? -1 : (int)i; }
+	String substring(unsigned int from) const { return from < _s.length() ? String(_s.substr(from)) : String(); }
+	String substring(unsigned int from, unsigned int to) const { return from < to && from < _s.length() ? String(_s.substr(from, to - from)) : String(); }
+	void toLowerCase() { for(char &c : _s) c = tolower(c); }
+	void toUpperCase() { for(char &c : _s) c = toupper(c); }
+	void trim() { size_t a = _s.find_first_not_of(" \t\r\n"); size_t b = _s.find_last_not_of(" \t\r\n"); _s = ( a == std::string::npos ) ? "" : _s.substr(a, b - a + 1); }
+	void remove(unsigned int index) { if( index < _s.length() ) _s.erase(index); }
+	void remove(unsigned int index, unsigned int count) { if( index < _s.length() ) _s.erase(index, count); }
+	void replace(const String &from, const String &to) { for(size_t i = 0; ( i = _s.find(from._s, i) ) != std::string::npos; i += to.length()) _s.replace(i, from.length(), to._s); }
+
+	char operator[](unsigned int i) const { return i < _s.length() ? _s[i] : 0; }
+	char &operator[](unsigned int i) { return _s[i]; }
+	bool operator==(const String &s) const { return _s == s._s; }
+	bool operator==(const char *s) const { return _s == (s ? s : ""); }
+	bool operator!=(const String &s) const { return _s != s._s; }
+	bool operator!=(const char *s) const { return !(*this == s); }
+	bool operator<(const String &s) const { return _s < s._s; }
+	const std::string &str() const { return _s; }
+};
+
+class StringSumHelper : public String
+{
+public:
+	StringSumHelper(const String &s) : String(s) {}
+	StringSumHelper(const char *s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String &a, const String &b) { String s(a); s += b; return s; }
+inline StringSumHelper operator+(const String &a, const char *b) { String s(a); s += b; return s; }
+inline StringSumHelper operator+(const char *a, const String &b) { String s(a); s += b; return s; }
+inline StringSumHelper operator+(const String &a, char b) { String s(a); s += b; return s; }
+
+/**************************************************************************************************
+  clock: virtual by default, tests advance it, or the host steady clock with mock::real_clock
+**************************************************************************************************/
+namespace mock {
+	inline bool real_clock = false;
+	inline std::atomic<uint64_t> virtual_us{0};
+	inline std::atomic<uint64_t> idle_us{0};			// time given away in ulTaskNotifyTake()
+	inline const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	inline uint64_t now_us()
+	{
+		if( real_clock )
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+		return virtual_us.load();
+	}
+	inline void advance_us(uint64_t us) { virtual_us += us; }
+	inline void set_ms(uint64_t ms) { virtual_us = ms * 1000; }
+}
+
+inline uint32_t millis() { return (uint32_t)(mock::now_us() / 1000); }
+inline uint32_t micros() { return (uint32_t)mock::now_us(); }
+inline int64_t esp_timer_get_time() { return (int64_t)mock::now_us(); }
+
+inline void delayMicroseconds(uint32_t us)
+{
+	if( mock::real_clock )
+		std::this_thread::sleep_for(std::chrono::microseconds(us));
+	else
+		mock::advance_us(us);
+}
+inline void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+inline void yield() { std::this_thread::yield(); }
+
+/**************************************************************************************************
+  GPIO: pin levels, writes and level changes per pin, optional hooks for device models
+**************************************************************************************************/
+#define MOCK_PINS           64
+
+namespace mock {
+	inline uint8_t pin_mode[MOCK_PINS];
+	inline uint8_t pin_level[MOCK_PINS];
+	inline uint32_t pin_writes[MOCK_PINS];
+	inline uint32_t pin_toggles[MOCK_PINS];
+	inline uint32_t pin_reads[MOCK_PINS];
+	inline uint32_t gpio_calls = 0;					// digitalWrite() and digitalRead() calls
+	inline std::function<void(uint8_t pin, uint8_t level)> on_write;		// after the level is set
+
+	inline void pin_set(uint8_t pin, uint8_t level)
+	{
+		if( pin >= MOCK_PINS )
+			return;
+		pin_writes[pin]++;
+		if( pin_level[pin] != level ) {
+			pin_toggles[pin]++;
+			pin_level[pin] = level;
+		}
+		if( on_write )
+			on_write(pin, level);
+	}
+	inline void pin_hw(uint8_t pin, uint8_t level)	// driven by a peripheral or a device model, not the CPU
+	{
+		if( pin >= MOCK_PINS )
+			return;
+		pin_level[pin] = level;
+		if( on_write )
+			on_write(pin, level);
+	}
+	inline uint32_t total_toggles() { uint32_t n = 0; for(uint8_t i = 0; i < MOCK_PINS; i++) n += pin_toggles[i]; return n; }
+	inline uint32_t total_writes() { uint32_t n = 0; for(uint8_t i = 0; i < MOCK_PINS; i++) n += pin_writes[i]; return n; }
+	inline void gpio_reset()
+	{
+		memset(pin_mode, 0, sizeof(pin_mode)); memset(pin_level, 0, sizeof(pin_level));
+		memset(pin_writes, 0, sizeof(pin_writes)); memset(pin_toggles, 0, sizeof(pin_toggles)); memset(pin_reads, 0, sizeof(pin_reads));
+		gpio_calls = 0;
+		on_write = nullptr;
+	}
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) { if( pin < MOCK_PINS ) mock::pin_mode[pin] = mode; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { mock::gpio_calls++; mock::pin_set(pin, level ? HIGH : LOW); }
+inline int digitalRead(uint8_t pin) { mock::gpio_calls++; if( pin >= MOCK_PINS ) return LOW; mock::pin_reads[pin]++; return mock::pin_level[pin]; }
+
+/**************************************************************************************************
+  FreeRTOS: mutexes and direct to task notifications, one tick per ms
+**************************************************************************************************/
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define portMAX_DELAY       0xFFFFFFFF
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+typedef std::timed_mutex *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::timed_mutex(); }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks)
+{
+	if( ticks == portMAX_DELAY ) {
+		m->lock();
+		return pdTRUE;
+	}
+	return m->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m) { m->unlock(); return pdTRUE; }
+
+struct MockTask {
+	std::mutex m;
+	std::condition_variable cv;
+	uint32_t notify = 0;
+};
+typedef MockTask *TaskHandle_t;
+
+namespace mock {
+	inline thread_local MockTask *current_task = nullptr;	// set in threads started by xTaskCreatePinnedToCore()
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { static thread_local MockTask task; return mock::current_task ? mock::current_task : &task; }
+
+// runs the task function on a detached std::thread, priority and core are ignored
+typedef void (*TaskFunction_t)(void *param);
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *param, UBaseType_t priority,
+										  TaskHandle_t *handle, BaseType_t core)
+{
+	MockTask *task = new MockTask();
+
+	if( handle )
+		*handle = task;
+	std::thread([fn, param, task]() { mock::current_task = task; fn(param); }).detach();
+	return pdPASS;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task)
+{
+	std::lock_guard<std::mutex> lock(task->m);
+	task->notify++;
+	task->cv.notify_one();
+}
+
+// blocks up to ticks ms, on the virtual clock the wait is skipped and counted in mock::idle_us
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+	TaskHandle_t task = xTaskGetCurrentTaskHandle();
+	std::unique_lock<std::mutex> lock(task->m);
+	uint32_t n;
+
+	if(( task->notify == 0 ) && ( ticks > 0 )) {
+		if( mock::real_clock )
+			task->cv.wait_for(lock, std::chrono::milliseconds(ticks), [task]() { return task->notify > 0; });
+		else {
+			mock::advance_us((uint64_t)ticks * 1000);
+			mock::idle_us += (uint64_t)ticks * 1000;
+		}
+	}
+	n = task->notify;
+	if( n > 0 )
+		task->notify = clear ? 0 : n - 1;
+	return n;
+}
+
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+/**************************************************************************************************
+  heap: counters kept by a test that tracks its allocations, see test/test_replay
+**************************************************************************************************/
+namespace mock {
+	inline uint32_t heap_size = 320 * 1024;
+	inline std::atomic<int64_t> heap_in_use{0};
+	inline std::atomic<int64_t> heap_peak{0};
+}
+
+class EspClass
+{
+public:
+	uint32_t getFreeHeap() { return mock::heap_size - (uint32_t)mock::heap_in_use.load(); }
+	uint32_t getMinFreeHeap() { return mock::heap_size - (uint32_t)mock::heap_peak.load(); }
+	uint32_t getHeapSize() { return mock::heap_size; }
+	void restart() { exit(0); }
+};
+inline EspClass ESP;
+
+typedef enum { ESP_RST_UNKNOWN = 0, ESP_RST_POWERON, ESP_RST_EXT, ESP_RST_SW, ESP_RST_PANIC } esp_reset_reason_t;
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+
+/**************************************************************************************************
+  esp_err_t and the log_x macros of esp32-hal-log, printed when mock::serial_echo is set
+**************************************************************************************************/
+typedef int esp_err_t;
+#define ESP_OK              0
+#define ESP_FAIL            -1
+#define ESP_ERR_INVALID_ARG 0x102
+
+namespace mock {
+	inline bool serial_echo = false;
+	inline std::atomic<uint32_t> log_errors{0};
+}
+
+#define log_x(...)          do { if( mock::serial_echo ) { printf(__VA_ARGS__); printf("\n"); } } while(0)
+#define log_e(...)          do { mock::log_errors++; log_x(__VA_ARGS__); } while(0)
+#define log_w(...)          log_x(__VA_ARGS__)
+#define log_i(...)          log_x(__VA_ARGS__)
+#define log_d(...)          log_x(__VA_ARGS__)
+
+/**************************************************************************************************
+  Stream and Serial: no input, output discarded unless mock::serial_echo
+**************************************************************************************************/
+class Stream
+{
+public:
+	virtual ~Stream() {}
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual size_t readBytes(char *buffer, size_t length)		// no timeout, what is available
+	{
+		size_t n = 0;
+		int c;
+		while(( n < length ) && (( c = read() ) >= 0 ))
+			buffer[n++] = (char)c;
+		return n;
+	}
+	size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+};
+
+class HardwareSerial : public Stream
+{
+public:
+	void begin(unsigned long) {}
+	void onReceive(std::function<void(void)> fn) {}
+	size_t write(uint8_t c) { if( mock::serial_echo ) putchar(c); return 1; }
+	size_t print(const char *s) { if( mock::serial_echo ) fputs(s, stdout); return strlen(s); }
+	size_t print(const String &s) { return print(s.c_str()); }
+	size_t println(const char *s = "") { print(s); return print("\n"); }
+	size_t println(const String &s) { return println(s.c_str()); }
+	size_t print(long n) { char b[24]; snprintf(b, sizeof(b), "%ld", n); return print(b); }
+	size_t print(unsigned long n) { char b[24]; snprintf(b, sizeof(b), "%lu", n); return print(b); }
+	size_t print(int n) { return print((long)n); }
+	size_t print(unsigned int n) { return print((unsigned long)n); }
+	size_t print(double n) { char b[32]; snprintf(b, sizeof(b), "%.2f", n); return print(b); }
+	template <typename T> size_t println(T n) { size_t r = print(n); return r + print("\n"); }
+	size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+	{
+		va_list ap;
+		int n;
+		va_start(ap, fmt);
+		n = mock::serial_echo ? vprintf(fmt, ap) : vsnprintf(NULL, 0, fmt, ap);
+		va_end(ap);
+		return n;
+	}
+};
+inline HardwareSerial Serial;
+inline HardwareSerial Serial1;
@@ -0,0 +1,39 @@
+/**************************************************************************************************
+  Filename:       AsyncJson.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESPAsyncWebServer JSON body handler, the body set by the test
+                  is parsed and handed to the callback
+**************************************************************************************************/
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+
+typedef std::function<void(AsyncWebServerRequest *request, JsonVariant &json)> ArJsonRequestHandlerFunction;
+
+class AsyncCallbackJsonWebHandler : public AsyncWebHandler
+{
+private:
+	String _uri;
+	WebRequestMethodComposite _method;
+	ArJsonRequestHandlerFunction _onRequest;
+
+public:
+	AsyncCallbackJsonWebHandler(const String &uri, ArJsonRequestHandlerFunction fn)
+		: _uri(uri), _method(HTTP_POST | HTTP_PUT | HTTP_PATCH), _onRequest(fn) {}
+	void setMethod(WebRequestMethodComposite method) { _method = method; }
+
+	bool canHandle(AsyncWebServerRequest *request) const override { return ( request->method() & _method ) && ( request->url() == _uri ); }
+	void handleRequest(AsyncWebServerRequest *request) override
+	{
+		JsonDocument doc;
+
+		if( deserializeJson(doc, request->Body()) != DeserializationError::Ok ) {
+			request->send(400);
+			return;
+		}
+		JsonVariant json = doc.as<JsonVariant>();
+		_onRequest(request, json);
+	}
+};
@@ -0,0 +1,370 @@
+/**************************************************************************************************
+  Filename:       ESPAsyncWebServer.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in HTTP front end with the ESPAsyncWebServer API used by the firmware
+                  requests are built by the test and run through the middlewares and the first
+                  matching handler by AsyncWebServer::Dispatch(), chunked responses are drained in
+                  mock::chunk_size pieces as the TCP task would, event sources record what every
+                  connected client receives, file responses read the flash emulator of FS.h
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+#include <memory>
+
+#define RESPONSE_TRY_AGAIN  0xFFFFFFFF
+
+typedef enum {
+	HTTP_GET = 0b00000001,
+	HTTP_POST = 0b00000010,
+	HTTP_DELETE = 0b00000100,
+	HTTP_PUT = 0b00001000,
+	HTTP_PATCH = 0b00010000,
+	HTTP_HEAD = 0b00100000,
+	HTTP_OPTIONS = 0b01000000,
+	HTTP_ANY = 0b01111111
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+namespace mock {
+	inline size_t chunk_size = 1436;		// TCP send buffer space offered to a chunk filler
+}
+
+class AsyncWebServerRequest;
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<size_t(uint8_t *buffer, size_t max_len, size_t index)> AwsResponseFiller;
+typedef std::function<void(void)> ArDisconnectHandler;
+typedef std::function<void(void)> ArMiddlewareNext;
+
+class AsyncWebParameter
+{
+private:
+	String _name, _value;
+	bool _post;
+
+public:
+	AsyncWebParameter(const String &name, const String &value, bool post = false) : _name(name), _value(value), _post(post) {}
+	const String &name() const { return _name; }
+	const String &value() const { return _value; }
+	bool isPost() const { return _post; }
+	bool isFile() const { return false; }
+};
+
+class AsyncWebHeader
+{
+private:
+	String _name, _value;
+
+public:
+	AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+	const String &name() const { return _name; }
+	const String &value() const { return _value; }
+};
+
+class AsyncWebServerResponse
+{
+protected:
+	int _code;
+	String _contentType;
+	String _content;
+	std::vector<std::pair<String, String>> _headers;
+
+public:
+	AsyncWebServerResponse(int code = 200, const String &type = String(), const String &content = String())
+		: _code(code), _contentType(type), _content(content) {}
+	virtual ~AsyncWebServerResponse() {}
+	void setCode(int code) { _code = code; }
+	void setContentType(const String &type) { _contentType = type; }
+	void addHeader(const String &name, const String &value) { _headers.push_back({name, value}); }
+
+	int code() const { return _code; }
+	const String &contentType() const { return _contentType; }
+	String header(const String &name) const
+	{
+		for(const auto &h : _headers)
+			if( h.first.equalsIgnoreCase(name) )
+				return h.second;
+		return String();
+	}
+	virtual String body() { return _content; }			// test side: the bytes sent
+};
+
+class AsyncChunkedResponse : public AsyncWebServerResponse
+{
+private:
+	AwsResponseFiller _filler;
+
+public:
+	uint32_t chunks = 0;
+	uint32_t retries = 0;
+
+	AsyncChunkedResponse(const String &type, AwsResponseFiller filler) : AsyncWebServerResponse(200, type), _filler(filler) {}
+	String body() override
+	{
+		std::vector<uint8_t> buffer(mock::chunk_size);
+		String out;
+		size_t index = 0, n;
+
+		while(( n = _filler(buffer.data(), buffer.size(), index) ) != 0 ) {
+			if( n == RESPONSE_TRY_AGAIN ) {
+				if( ++retries > 1000 )
+					break;
+				continue;
+			}
+			out.concat((const char *)buffer.data(), n);
+			index += n;
+			chunks++;
+		}
+		return out;
+	}
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse
+{
+public:
+	AsyncResponseStream(const String &type) : AsyncWebServerResponse(200, type) {}
+	size_t write(uint8_t c) { _content += (char)c; return 1; }
+	size_t write(const uint8_t *data, size_t len) { _content.concat((const char *)data, len); return len; }
+	size_t print(const char *s) { _content += s; return strlen(s); }
+	size_t print(const String &s) { _content += s; return s.length(); }
+	size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+	{
+		char buf[512];
+		va_list ap;
+		int n;
+
+		va_start(ap, fmt);
+		n = vsnprintf(buf, sizeof(buf), fmt, ap);
+		va_end(ap);
+		_content.concat(buf, std::min((size_t)n, sizeof(buf) - 1));
+		return n;
+	}
+};
+
+class AsyncWebServerRequest
+{
+private:
+	WebRequestMethodComposite _method;
+	String _url;
+	String _body;
+	std::vector<AsyncWebParameter> _params;
+	std::vector<AsyncWebHeader> _headers;
+	size_t _contentLength;
+	std::unique_ptr<AsyncWebServerResponse> _response;
+	ArDisconnectHandler _onDisconnect;
+
+public:
+	AsyncWebServerRequest(WebRequestMethodComposite method, const String &url, size_t content_length = 0)
+		: _method(method), _url(url), _contentLength(content_length) {}
+
+	// test side
+	void AddParam(const String &name, const String &value, bool post = false) { _params.emplace_back(name, value, post); }
+	void AddHeader(const String &name, const String &value) { _headers.emplace_back(name, value); }
+	void SetBody(const String &body) { _body = body; _contentLength = body.length(); }
+	const String &Body() const { return _body; }
+	AsyncWebServerResponse *Response() { return _response.get(); }
+	void Disconnect() { if( _onDisconnect ) _onDisconnect(); }
+
+	// firmware side
+	WebRequestMethodComposite method() const { return _method; }
+	const String &url() const { return _url; }
+	size_t contentLength() const { return _contentLength; }
+	size_t params() const { return _params.size(); }
+	const AsyncWebParameter *getParam(size_t i) const { return i < _params.size() ? &_params[i] : nullptr; }
+	const AsyncWebParameter *getParam(const char *name, bool post = false, bool file = false) const
+	{
+		for(const auto &p : _params)
+			if(( p.name() == name ) && ( p.isPost() == post ))
+				return &p;
+		return nullptr;
+	}
+	bool hasParam(const char *name, bool post = false, bool file = false) const { return getParam(name, post, file) != nullptr; }
+	bool hasHeader(const char *name) const { return getHeader(name) != nullptr; }
+	const AsyncWebHeader *getHeader(const char *name) const
+	{
+		for(const auto &h : _headers)
+			if( h.name().equalsIgnoreCase(name) )
+				return &h;
+		return nullptr;
+	}
+	String header(const char *name) const { const AsyncWebHeader *h = getHeader(name); return h ? h->value() : String(); }
+	void onDisconnect(ArDisconnectHandler fn) { _onDisconnect = fn; }
+
+	AsyncWebServerResponse *beginResponse(int code, const char *type = "", const String &content = String()) { return new AsyncWebServerResponse(code, type, content); }
+	// the file, or <path>.gz sent with Content-Encoding: gzip as the library does, 404 if neither
+	AsyncWebServerResponse *beginResponse(FS &fs, const String &path, const String &type = String(), bool download = false)
+	{
+		bool gz = !fs.exists(path) && fs.exists(path + ".gz");
+		File f = fs.open(gz ? path + ".gz" : path, "r");
+		String content;
+		uint8_t buf[512];
+		size_t n;
+
+		if( !f )
+			return new AsyncWebServerResponse(404);
+		while(( n = f.read(buf, sizeof(buf)) ) > 0 )
+			content.concat((const char *)buf, n);
+		f.close();
+		AsyncWebServerResponse *response = new AsyncWebServerResponse(200, type, content);
+		if( gz )
+			response->addHeader("Content-Encoding", "gzip");
+		return response;
+	}
+	AsyncWebServerResponse *beginChunkedResponse(const char *type, AwsResponseFiller filler) { return new AsyncChunkedResponse(type, filler); }
+	AsyncResponseStream *beginResponseStream(const char *type) { return new AsyncResponseStream(type); }
+
+	void send(AsyncWebServerResponse *response) { _response.reset(response); }
+	void send(int code, const char *type = "", const char *content = "") { send(beginResponse(code, type, content)); }
+	void send(int code, const char *type, const String &content) { send(beginResponse(code, type, content)); }
+	void send(int code, const String &type, const String &content) { send(beginResponse(code, type.c_str(), content)); }
+};
+
+class AsyncMiddleware
+{
+public:
+	virtual ~AsyncMiddleware() {}
+	virtual void run(AsyncWebServerRequest *request, ArMiddlewareNext next) = 0;
+};
+
+class AsyncWebHandler
+{
+public:
+	virtual ~AsyncWebHandler() {}
+	virtual bool canHandle(AsyncWebServerRequest *request) const = 0;
+	virtual void handleRequest(AsyncWebServerRequest *request) = 0;
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+private:
+	String _uri;
+	WebRequestMethodComposite _method;
+	ArRequestHandlerFunction _onRequest;
+
+public:
+	AsyncCallbackWebHandler(const String &uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn)
+		: _uri(uri), _method(method), _onRequest(fn) {}
+	bool canHandle(AsyncWebServerRequest *request) const override
+	{
+		if( !( request->method() & _method ))
+			return false;
+		if( _uri.endsWith("*") )
+			return request->url().startsWith(_uri.substring(0, _uri.length() - 1));
+		return request->url() == _uri;
+	}
+	void handleRequest(AsyncWebServerRequest *request) override { _onRequest(request); }
+};
+
+class AsyncEventSourceClient
+{
+public:
+	typedef struct {
+		String event;
+		uint32_t id;
+		String data;
+		uint64_t t_us;							// mock::now_us() when sent
+	} Event_t;
+
+	std::vector<Event_t> events;				// test side: every event received
+	bool connected = true;
+
+	void close() { connected = false; }
+};
+typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFunction;
+
+// test side: the response of GET on the source url, holds the client it connected
+class AsyncEventSourceResponse : public AsyncWebServerResponse
+{
+public:
+	AsyncEventSourceClient *client;
+	AsyncEventSourceResponse(AsyncEventSourceClient *c) : AsyncWebServerResponse(200, "text/event-stream"), client(c) {}
+};
+
+class AsyncEventSource : public AsyncWebHandler
+{
+private:
+	String _url;
+	std::vector<std::unique_ptr<AsyncEventSourceClient>> _clients;
+	ArEventHandlerFunction _connect;
+
+public:
+	AsyncEventSource(const String &url) : _url(url) {}
+	void onConnect(ArEventHandlerFunction fn) { _connect = fn; }
+	size_t count() const
+	{
+		size_t n = 0;
+		for(const auto &c : _clients)
+			n += c->connected;
+		return n;
+	}
+	void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0)
+	{
+		for(const auto &c : _clients)
+			if( c->connected )
+				c->events.push_back({ event ? event : "", id, message, mock::now_us() });
+	}
+
+	bool canHandle(AsyncWebServerRequest *request) const override { return ( request->method() == HTTP_GET ) && ( request->url() == _url ); }
+	void handleRequest(AsyncWebServerRequest *request) override
+	{
+		AsyncEventSourceClient *c = new AsyncEventSourceClient();
+
+		_clients.emplace_back(c);
+		if( _connect )
+			_connect(c);
+		request->send(new AsyncEventSourceResponse(c));
+	}
+};
+
+class AsyncWebServer
+{
+private:
+	std::vector<AsyncWebHandler *> _handlers;
+	std::vector<std::unique_ptr<AsyncWebHandler>> _owned;
+	std::vector<AsyncMiddleware *> _middlewares;
+	ArRequestHandlerFunction _notFound;
+
+	void _chain(AsyncWebServerRequest *request, AsyncWebHandler *handler, size_t i)
+	{
+		if( i < _middlewares.size() )
+			_middlewares[i]->run(request, [this, request, handler, i]() { _chain(request, handler, i + 1); });
+		else if( handler )
+			handler->handleRequest(request);
+		else if( _notFound )
+			_notFound(request);
+		else
+			request->send(404);
+	}
+
+public:
+	AsyncWebServer(uint16_t port = 80) {}
+	void begin() {}
+
+	AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn)
+	{
+		AsyncCallbackWebHandler *h = new AsyncCallbackWebHandler(uri, method, fn);
+		_owned.emplace_back(h);
+		_handlers.push_back(h);
+		return *h;
+	}
+	AsyncWebHandler &addHandler(AsyncWebHandler *handler) { _handlers.push_back(handler); return *handler; }
+	void addMiddleware(AsyncMiddleware *middleware) { _middlewares.push_back(middleware); }
+	void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+
+	// test side: handlers in registration order as the library does, the first match serves
+	AsyncWebServerResponse *Dispatch(AsyncWebServerRequest *request)
+	{
+		AsyncWebHandler *handler = nullptr;
+
+		for(AsyncWebHandler *h : _handlers)
+			if( h->canHandle(request) ) {
+				handler = h;
+				break;
+			}
+		_chain(request, handler, 0);
+		return request->Response();
+	}
+};
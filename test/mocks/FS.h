@@ -0,0 +1,152 @@
+/**************************************************************************************************
+  Filename:       FS.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the Arduino FS layer as a flash emulator backed by files in a host
+                  directory: every byte written reaches the "flash" at once, a power loss point cuts
+                  a write after mock::fs_power_budget bytes and fails every later change until
+                  mock::fs_power_on(), as a reset in the middle of a program would. Counts the bytes
+                  and write calls that reach the flash.
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+
+namespace mock {
+	inline std::string fs_root;						// host directory of the partition, made by FS::begin()
+	inline int64_t fs_power_budget = -1;			// bytes written until power is lost, -1: never
+	inline bool fs_power_lost = false;
+	inline uint64_t fs_bytes_written = 0;
+	inline uint32_t fs_write_calls = 0;
+	inline uint32_t fs_opens = 0;
+
+	inline void fs_power_on() { fs_power_lost = false; fs_power_budget = -1; }
+	inline void fs_reset_counters() { fs_bytes_written = 0; fs_write_calls = 0; fs_opens = 0; }
+
+	// bytes of a write of len that reach the flash, the rest is lost with the power
+	inline size_t fs_program(size_t len)
+	{
+		if( fs_power_lost )
+			return 0;
+		if(( fs_power_budget >= 0 ) && ( (int64_t)len >= fs_power_budget )) {
+			len = fs_power_budget;
+			fs_power_budget = -1;
+			fs_power_lost = true;
+		}
+		else if( fs_power_budget >= 0 )
+			fs_power_budget -= len;
+		fs_bytes_written += len;
+		fs_write_calls++;
+		return len;
+	}
+
+	// removes every file of the partition
+	inline void fs_format()
+	{
+		DIR *d = fs_root.empty() ? NULL : opendir(fs_root.c_str());
+		struct dirent *e;
+
+		if( d == NULL )
+			return;
+		while(( e = readdir(d) ) != NULL )
+			if( e->d_name[0] != '.' )
+				unlink(( fs_root + "/" + e->d_name ).c_str());
+		closedir(d);
+	}
+}
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File
+{
+private:
+	struct Impl {
+		FILE *f;
+		bool writable;
+		~Impl() { if( f ) fclose(f); }
+	};
+	std::shared_ptr<Impl> _p;
+
+public:
+	File() {}
+	File(FILE *f, bool writable) : _p(new Impl{f, writable}) {}
+
+	explicit operator bool() const { return _p && _p->f; }
+	void close() { _p.reset(); }
+
+	size_t write(const uint8_t *buf, size_t len)
+	{
+		if( !*this || !_p->writable )
+			return 0;
+		len = fwrite(buf, 1, mock::fs_program(len), _p->f);
+		fflush(_p->f);
+		return len;
+	}
+	size_t write(uint8_t c) { return write(&c, 1); }
+	size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+
+	size_t read(uint8_t *buf, size_t len) { return *this ? fread(buf, 1, len, _p->f) : 0; }
+	int read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+	int available() { return *this ? (int)( size() - position() ) : 0; }
+	bool seek(uint32_t pos, SeekMode mode = SeekSet) { return *this && ( fseek(_p->f, pos, mode) == 0 ); }
+	size_t position() const { return *this ? ftell(_p->f) : 0; }
+	size_t size() const
+	{
+		struct stat st;
+		return ( *this && ( fstat(fileno(_p->f), &st) == 0 )) ? st.st_size : 0;
+	}
+	void flush() {}
+};
+
+class FS
+{
+protected:
+	std::string _path(const char *path) { return mock::fs_root + path; }
+
+public:
+	bool begin(bool format_on_fail = false, const char *base_path = "/littlefs", uint8_t max_open = 10, const char *label = NULL)
+	{
+		if( mock::fs_root.empty() ) {
+			char dir[] = "/tmp/flashXXXXXX";
+			if( mkdtemp(dir) == NULL )
+				return false;
+			mock::fs_root = dir;
+		}
+		return true;
+	}
+	void end() {}
+	bool format() { mock::fs_format(); return true; }
+
+	File open(const char *path, const char *mode = "r", bool create = false)
+	{
+		const char *m = ( mode[0] == 'w' ) ? "wb" : ( mode[0] == 'a' ) ? "ab" : "rb";
+
+		if(( mode[0] != 'r' ) && mock::fs_power_lost )
+			return File();
+		mock::fs_opens++;
+		FILE *f = fopen(_path(path).c_str(), m);
+		return f ? File(f, mode[0] != 'r') : File();
+	}
+	File open(const String &path, const char *mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+	bool exists(const char *path) { struct stat st; return stat(_path(path).c_str(), &st) == 0; }
+	bool exists(const String &path) { return exists(path.c_str()); }
+	bool remove(const char *path) { return !mock::fs_power_lost && ( unlink(_path(path).c_str()) == 0 ); }
+	bool remove(const String &path) { return remove(path.c_str()); }
+	bool rename(const char *from, const char *to) { return !mock::fs_power_lost && ( ::rename(_path(from).c_str(), _path(to).c_str()) == 0 ); }
+	bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+};
+
+}	// namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,18 @@
+/**************************************************************************************************
+  Filename:       LittleFS.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the LittleFS partition on the flash emulator of FS.h, renames are
+                  atomic as on LittleFS
+**************************************************************************************************/
+#pragma once
+#include <FS.h>
+
+class LittleFSFS : public fs::FS
+{
+public:
+	size_t totalBytes() { return 1536 * 1024; }
+};
+
+inline LittleFSFS LittleFS;
@@ -0,0 +1,57 @@
+/**************************************************************************************************
+  Filename:       Preferences.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32 NVS Preferences, blobs kept in memory per namespace
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mock {
+	inline std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+}
+
+class Preferences
+{
+private:
+	std::string _ns;
+	bool _read_only = true;
+	bool _open = false;
+
+public:
+	bool begin(const char *name, bool read_only = false, const char *label = NULL)
+	{
+		_ns = name;
+		_read_only = read_only;
+		_open = true;
+		return true;
+	}
+	void end() { _open = false; }
+
+	size_t getBytesLength(const char *key)
+	{
+		auto ns = mock::nvs.find(_ns);
+		if( !_open || ( ns == mock::nvs.end() ) || ( ns->second.count(key) == 0 ))
+			return 0;
+		return ns->second[key].size();
+	}
+	size_t getBytes(const char *key, void *buf, size_t len)
+	{
+		size_t n = getBytesLength(key);
+		if(( n == 0 ) || ( n > len ))
+			return 0;
+		memcpy(buf, mock::nvs[_ns][key].data(), n);
+		return n;
+	}
+	size_t putBytes(const char *key, const void *value, size_t len)
+	{
+		if( !_open || _read_only )
+			return 0;
+		mock::nvs[_ns][key].assign((const uint8_t *)value, (const uint8_t *)value + len);
+		return len;
+	}
+};
@@ -0,0 +1,26 @@
+/**************************************************************************************************
+  Filename:       SLog.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the SLog syslog macros, printed when mock::slog_echo is set. Blocks
+                  as in the library, the firmware uses them with and without a trailing ';'
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+enum { SLOG_EMERGENCY = 0, SLOG_ALERT, SLOG_CRITICAL, SLOG_ERROR, SLOG_WARNING, SLOG_NOTICE, SLOG_INFO, SLOG_DEBUG };
+
+namespace mock {
+	inline bool slog_echo = false;
+	inline uint32_t slog_lines = 0;
+	inline uint32_t slog_errors = 0;
+}
+
+#define SLOG_PRINTF(level, ...)     { mock::slog_lines++; if( (level) <= SLOG_ERROR ) mock::slog_errors++; \
+                                      if( mock::slog_echo ) printf(__VA_ARGS__); }
+#define SLOG_ERROR_PRINTF(...)      SLOG_PRINTF(SLOG_ERROR, __VA_ARGS__)
+#define SLOG_WARNING_PRINTF(...)    SLOG_PRINTF(SLOG_WARNING, __VA_ARGS__)
+#define SLOG_NOTICE_PRINTF(...)     SLOG_PRINTF(SLOG_NOTICE, __VA_ARGS__)
+#define SLOG_INFO_PRINTF(...)       SLOG_PRINTF(SLOG_INFO, __VA_ARGS__)
+#define SLOG_DEBUG_PRINTF(...)      SLOG_PRINTF(SLOG_DEBUG, __VA_ARGS__)
@@ -0,0 +1,66 @@
+/**************************************************************************************************
+  Filename:       SPI.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32 SPI master, mode 0 MSB first. The peripheral drives
+                  SCK and MOSI of the mock pins (not counted as CPU writes) and samples MISO, the
+                  virtual clock advances by the transfer time
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+#define VSPI                3
+#define HSPI                2
+#define MSBFIRST            1
+#define LSBFIRST            0
+#define SPI_MODE0           0
+
+namespace mock {
+	inline uint32_t spi_bits = 0;
+	inline uint32_t spi_transactions = 0;
+}
+
+class SPISettings
+{
+public:
+	uint32_t clock;
+	uint8_t bit_order, mode;
+	SPISettings(uint32_t c = 1000000, uint8_t order = MSBFIRST, uint8_t m = SPI_MODE0) : clock(c), bit_order(order), mode(m) {}
+};
+
+class SPIClass
+{
+private:
+	uint8_t _bus;
+	int8_t _sck = -1, _miso = -1, _mosi = -1;
+	uint32_t _clock = 1000000;
+
+public:
+	SPIClass(uint8_t bus = HSPI) : _bus(bus) {}
+	void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) { _sck = sck; _miso = miso; _mosi = mosi; }
+	void end() {}
+	void beginTransaction(SPISettings settings) { _clock = settings.clock; mock::spi_transactions++; }
+	void endTransaction() {}
+
+	uint16_t transfer16(uint16_t data)
+	{
+		uint16_t in = 0;
+
+		for(uint8_t i = 0; i < 16; i++) {
+			if( _mosi >= 0 )
+				mock::pin_hw(_mosi, ( data & 0x8000 ) ? HIGH : LOW);
+			in = (in << 1) | (( _miso >= 0 ) ? mock::pin_level[_miso] : 0);	// sampled on the rising edge
+			if( _sck >= 0 ) {
+				mock::pin_hw(_sck, HIGH);
+				mock::pin_hw(_sck, LOW);
+			}
+			data <<= 1;
+		}
+		mock::spi_bits += 16;
+		if( !mock::real_clock )
+			mock::advance_us((16ULL * 1000000 + _clock - 1) / _clock);
+		return in;
+	}
+	uint8_t transfer(uint8_t data) { return (uint8_t)(transfer16((uint16_t)data << 8) >> 8); }
+};
@@ -0,0 +1,168 @@
+/**************************************************************************************************
+  Filename:       ledc.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP-IDF LEDC driver: timer resolution check, duty and
+                  hardware fades interpolated on the mock clock, API call and fade counters
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+#define LEDC_APB_CLK_HZ     80000000
+#define LEDC_MOCK_CHANNELS  8
+#define LEDC_MOCK_TIMERS    4
+
+typedef enum { LEDC_HIGH_SPEED_MODE = 0, LEDC_LOW_SPEED_MODE, LEDC_SPEED_MODE_MAX } ledc_mode_t;
+typedef enum { LEDC_TIMER_0 = 0, LEDC_TIMER_1, LEDC_TIMER_2, LEDC_TIMER_3, LEDC_TIMER_MAX } ledc_timer_t;
+typedef enum { LEDC_CHANNEL_0 = 0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_3, LEDC_CHANNEL_4, LEDC_CHANNEL_5,
+			   LEDC_CHANNEL_6, LEDC_CHANNEL_7, LEDC_CHANNEL_MAX } ledc_channel_t;
+typedef enum { LEDC_TIMER_1_BIT = 1, LEDC_TIMER_8_BIT = 8, LEDC_TIMER_10_BIT = 10, LEDC_TIMER_12_BIT = 12,
+			   LEDC_TIMER_16_BIT = 16, LEDC_TIMER_20_BIT = 20, LEDC_TIMER_BIT_MAX } ledc_timer_bit_t;
+typedef enum { LEDC_AUTO_CLK = 0, LEDC_USE_APB_CLK } ledc_clk_cfg_t;
+typedef enum { LEDC_INTR_DISABLE = 0, LEDC_INTR_FADE_END } ledc_intr_type_t;
+typedef enum { LEDC_FADE_NO_WAIT = 0, LEDC_FADE_WAIT_DONE } ledc_fade_mode_t;
+
+typedef struct {
+	ledc_mode_t speed_mode;
+	ledc_timer_bit_t duty_resolution;
+	ledc_timer_t timer_num;
+	uint32_t freq_hz;
+	ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct {
+	int gpio_num;
+	ledc_mode_t speed_mode;
+	ledc_channel_t channel;
+	ledc_intr_type_t intr_type;
+	ledc_timer_t timer_sel;
+	uint32_t duty;
+	int hpoint;
+} ledc_channel_config_t;
+
+namespace mock {
+	struct LedcChannel {
+		bool configured;
+		int gpio;
+		uint8_t timer;
+		uint32_t duty;					// duty at the start of the fade, or the current duty
+		uint32_t set_duty;				// set by ledc_set_duty(), applied by ledc_update_duty()
+		uint32_t target;				// fade target
+		uint64_t fade_start_us;
+		uint64_t fade_us;				// 0: no fade programmed
+	};
+	inline LedcChannel ledc_channel[LEDC_MOCK_CHANNELS];
+	inline uint8_t ledc_timer_bits[LEDC_MOCK_TIMERS];
+	inline uint32_t ledc_timer_freq[LEDC_MOCK_TIMERS];
+	inline bool ledc_fade_installed = false;
+	inline uint32_t ledc_calls = 0;				// driver API calls
+	inline uint32_t ledc_fades = 0;				// fades started
+	inline uint32_t ledc_fade_overlaps = 0;		// fades started while the previous one runs, the IDF blocks there
+	inline uint64_t ledc_wait_us = 0;			// time spent blocked in LEDC_FADE_WAIT_DONE
+
+	inline uint32_t ledc_now_duty(uint8_t ch)
+	{
+		LedcChannel &c = ledc_channel[ch];
+		uint64_t t = now_us() - c.fade_start_us;
+
+		if(( c.fade_us == 0 ) || ( t >= c.fade_us ))
+			return c.fade_us ? c.target : c.duty;
+		return (uint32_t)((int64_t)c.duty + ((int64_t)c.target - (int64_t)c.duty) * (int64_t)t / (int64_t)c.fade_us);
+	}
+	inline bool ledc_fading(uint8_t ch) { return ledc_channel[ch].fade_us && ( now_us() - ledc_channel[ch].fade_start_us < ledc_channel[ch].fade_us ); }
+
+	inline void ledc_reset()
+	{
+		memset(ledc_channel, 0, sizeof(ledc_channel));
+		memset(ledc_timer_bits, 0, sizeof(ledc_timer_bits));
+		memset(ledc_timer_freq, 0, sizeof(ledc_timer_freq));
+		ledc_fade_installed = false;
+		ledc_calls = ledc_fades = ledc_fade_overlaps = 0;
+		ledc_wait_us = 0;
+	}
+}
+
+inline esp_err_t ledc_timer_config(const ledc_timer_config_t *cfg)
+{
+	mock::ledc_calls++;
+	if(( cfg->timer_num >= LEDC_MOCK_TIMERS ) || ( cfg->duty_resolution < 1 ) || ( cfg->duty_resolution > 20 ) ||
+	   ( cfg->freq_hz == 0 ) || (( (uint64_t)cfg->freq_hz << cfg->duty_resolution ) > LEDC_APB_CLK_HZ ))
+		return ESP_FAIL;
+	mock::ledc_timer_bits[cfg->timer_num] = cfg->duty_resolution;
+	mock::ledc_timer_freq[cfg->timer_num] = cfg->freq_hz;
+	return ESP_OK;
+}
+
+inline esp_err_t ledc_channel_config(const ledc_channel_config_t *cfg)
+{
+	mock::ledc_calls++;
+	if(( cfg->channel >= LEDC_MOCK_CHANNELS ) || ( cfg->timer_sel >= LEDC_MOCK_TIMERS ))
+		return ESP_ERR_INVALID_ARG;
+	mock::LedcChannel &c = mock::ledc_channel[cfg->channel];
+	c = {};
+	c.configured = true;
+	c.gpio = cfg->gpio_num;
+	c.timer = cfg->timer_sel;
+	c.duty = c.set_duty = cfg->duty;
+	return ESP_OK;
+}
+
+inline esp_err_t ledc_fade_func_install(int intr_alloc_flags) { mock::ledc_calls++; mock::ledc_fade_installed = true; return ESP_OK; }
+
+inline esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t ch, uint32_t duty)
+{
+	mock::ledc_calls++;
+	if(( ch >= LEDC_MOCK_CHANNELS ) || !mock::ledc_channel[ch].configured )
+		return ESP_ERR_INVALID_ARG;
+	mock::ledc_channel[ch].set_duty = duty;
+	return ESP_OK;
+}
+
+inline esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t ch)
+{
+	mock::ledc_calls++;
+	if(( ch >= LEDC_MOCK_CHANNELS ) || !mock::ledc_channel[ch].configured )
+		return ESP_ERR_INVALID_ARG;
+	mock::LedcChannel &c = mock::ledc_channel[ch];
+	c.duty = c.set_duty;
+	c.fade_us = 0;
+	return ESP_OK;
+}
+
+inline esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t ch, uint32_t target, int max_fade_time_ms)
+{
+	mock::ledc_calls++;
+	if(( ch >= LEDC_MOCK_CHANNELS ) || !mock::ledc_channel[ch].configured || !mock::ledc_fade_installed ||
+	   ( target > (1UL << mock::ledc_timer_bits[mock::ledc_channel[ch].timer]) ))
+		return ESP_ERR_INVALID_ARG;
+	mock::LedcChannel &c = mock::ledc_channel[ch];
+	if( mock::ledc_fading(ch) )
+		mock::ledc_fade_overlaps++;
+	c.duty = mock::ledc_now_duty(ch);
+	c.target = target;
+	c.fade_us = (uint64_t)max_fade_time_ms * 1000;
+	c.fade_start_us = mock::now_us();				// restarted by ledc_fade_start()
+	return ESP_OK;
+}
+
+inline esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t ch, ledc_fade_mode_t wait)
+{
+	mock::ledc_calls++;
+	if(( ch >= LEDC_MOCK_CHANNELS ) || !mock::ledc_channel[ch].configured || ( mock::ledc_channel[ch].fade_us == 0 ))
+		return ESP_ERR_INVALID_ARG;
+	mock::LedcChannel &c = mock::ledc_channel[ch];
+	c.fade_start_us = mock::now_us();
+	mock::ledc_fades++;
+	if( wait == LEDC_FADE_WAIT_DONE ) {
+		mock::ledc_wait_us += c.fade_us;
+		delayMicroseconds(c.fade_us);
+	}
+	return ESP_OK;
+}
+
+inline uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t ch)
+{
+	mock::ledc_calls++;
+	return ( ch < LEDC_MOCK_CHANNELS ) ? mock::ledc_now_duty(ch) : 0;
+}
@@ -0,0 +1,21 @@
+/**************************************************************************************************
+  Filename:       crc.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32 ROM CRC32, little endian (reflected) 0xEDB88320 with
+                  the initial and final inversion, crc32_le(0, ...) equals the zlib crc32()
+**************************************************************************************************/
+#pragma once
+#include <stdint.h>
+
+inline uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	crc = ~crc;
+	while( len-- ) {
+		crc ^= *buf++;
+		for(uint8_t k = 0; k < 8; k++)
+			crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ));
+	}
+	return ~crc;
+}
@@ -0,0 +1,45 @@
+/**************************************************************************************************
+  Filename:       gpio_reg.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    host stand-in of the ESP32 GPIO set/clear/input registers on the mock pins 0~31
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+#define GPIO_OUT_REG        0x3FF44004
+#define GPIO_OUT_W1TS_REG   0x3FF44008
+#define GPIO_OUT_W1TC_REG   0x3FF4400C
+#define GPIO_IN_REG         0x3FF4403C
+
+namespace mock {
+	inline uint32_t reg_writes = 0;
+	inline uint32_t reg_reads = 0;
+
+	inline void reg_write(uint32_t reg, uint32_t value)
+	{
+		reg_writes++;
+		for(uint8_t pin = 0; pin < 32; pin++) {
+			if( !( value & (1UL << pin) ))
+				continue;
+			if( reg == GPIO_OUT_W1TS_REG )
+				pin_set(pin, HIGH);
+			else if( reg == GPIO_OUT_W1TC_REG )
+				pin_set(pin, LOW);
+		}
+	}
+
+	inline uint32_t reg_read(uint32_t reg)
+	{
+		uint32_t v = 0;
+
+		reg_reads++;
+		for(uint8_t pin = 0; pin < 32; pin++)
+			v |= (uint32_t)pin_level[pin] << pin;
+		return v;
+	}
+}
+
+#define REG_WRITE(reg, value)   mock::reg_write((reg), (value))
+#define REG_READ(reg)           mock::reg_read(reg)
@@ -0,0 +1,191 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    BootProfile marks and the /stats/boot report. Then a boot after a power blip in the
+                  rain with no Wi-Fi: the setup() order of main.cpp on the virtual clock, I/O task
+                  first, Wi-Fi finished by a loop() timer that never sees a connection, against the
+                  165/595 chain model. Time from reset to the first input sample and to the roof
+                  close relay on confirmed rain, with the time the original setup() sampled its
+                  first input after the Serial delays and the 60 s Wi-Fi wait, as JSON on stdout.
+
+                  BOOT_RAIN_MS        rain input active from this time after reset, default 0
+                  BOOT_RAIN_DELAY_S   Rain_delay of the SafetyMonitor settings, default 2
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <algorithm>
+
+#include "BootProfile.cpp"
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+#define WIFI_WAIT_MS        60000       // original normal_boot(): 1 s delay loop, 60 tries
+#define SERIAL_DELAY_MS     1100        // original setup(): delay(100) and delay(1000)
+#define SETUP_MS            100         // setup() from io_task_begin() to publish_io_outputs()
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static AsyncWebServer server;
+
+/**************************************************************************************************
+  165/595 chain: input levels from the test, time of the first latch of each output bit
+**************************************************************************************************/
+static uint16_t in_levels = 0xffff;			// active low, all inactive
+static uint16_t in_shift, out_shift;
+static uint64_t first_sample_us, first_set_us[16];
+static bool sampled;
+
+static void chain_edge(uint8_t pin, uint8_t level)
+{
+	switch( pin ) {
+	case SR_IN_PIN_PL:
+		if( level == LOW ) {
+			if( !sampled )										// reset is at 0 us
+				first_sample_us = mock::now_us();
+			sampled = true;
+			in_shift = in_levels;
+			mock::pin_hw(SR_IN_PIN_SDIN, ( in_shift & 0x8000 ) ? HIGH : LOW);
+		}
+		break;
+	case SR_IN_PIN_CP:
+		if(( level == HIGH ) && ( mock::pin_level[SR_IN_PIN_CE] == LOW ) && ( mock::pin_level[SR_IN_PIN_PL] == HIGH )) {
+			in_shift <<= 1;
+			mock::pin_hw(SR_IN_PIN_SDIN, ( in_shift & 0x8000 ) ? HIGH : LOW);
+		}
+		break;
+	case SR_OUT_PIN_SHCP:
+		if( level == HIGH )
+			out_shift = (out_shift << 1) | mock::pin_level[SR_OUT_PIN_SDOUT];
+		break;
+	case SR_OUT_PIN_STCP:
+		if( level == HIGH )
+			for(uint32_t i = 0; i < 16; i++)
+				if(( out_shift & (1 << i) ) && ( first_set_us[i] == 0 ))
+					first_set_us[i] = mock::now_us();
+		break;
+	}
+}
+
+static uint64_t first_set(uint16_t bit) { return first_set_us[__builtin_ctz(bit)]; }
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/**************************************************************************************************
+  report
+**************************************************************************************************/
+void test_marks(void)
+{
+	AsyncWebServer server;
+	BootProfile p;
+
+	mock::set_ms(0);
+	TEST_ASSERT_EQUAL_UINT32(0, p.Get("io"));
+	mock::advance_us(1500);
+	p.Mark("io");
+	mock::advance_us(20000);
+	p.Mark("serial");
+	TEST_ASSERT_EQUAL_UINT32(1500, p.Get("io"));
+	TEST_ASSERT_EQUAL_UINT32(21500, p.Get("serial"));
+	TEST_ASSERT_EQUAL_UINT32(0, p.Get("wifi"));
+
+	for(uint32_t i = 2; i < BOOT_PROFILE_PHASES + 4; i++)		// full table: later marks dropped
+		p.Mark("extra");
+	p.Mark("late");
+	TEST_ASSERT_EQUAL_UINT32(0, p.Get("late"));
+
+	p.Begin(&server);
+	AsyncWebServerRequest req(HTTP_GET, BOOT_PROFILE_URL);
+	JsonDocument doc;
+	TEST_ASSERT_TRUE(deserializeJson(doc, server.Dispatch(&req)->body()) == DeserializationError::Ok);
+	TEST_ASSERT_EQUAL(BOOT_PROFILE_PHASES, (int)doc["phases"].size());
+	TEST_ASSERT_EQUAL_STRING("io", doc["phases"][0]["name"].as<const char *>());
+	TEST_ASSERT_EQUAL_UINT32(1500, doc["phases"][0]["took_us"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(20000, doc["phases"][1]["took_us"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(21500, doc["phases"][1]["at_us"].as<uint32_t>());
+	TEST_ASSERT_TRUE(doc["reset_reason"].is<int>());
+}
+
+/**************************************************************************************************
+  boot in the rain without Wi-Fi
+**************************************************************************************************/
+// I/O task cycles while setup() and loop() run, rain from rain_ms
+static void run_until(uint64_t end_us, uint32_t rain_ms)
+{
+	static uint64_t next_us;
+
+	while( next_us + IO_TASK_PERIOD_MS * 1000 <= end_us ) {
+		next_us += IO_TASK_PERIOD_MS * 1000;
+		mock::virtual_us = next_us;
+		if( millis() >= rain_ms )
+			in_levels &= ~BIT_SAFE_RAIN;
+		io_cycle(millis());
+	}
+	mock::virtual_us = end_us;
+}
+
+void test_rain_without_wifi(void)
+{
+	uint32_t rain_ms = atoi(env("BOOT_RAIN_MS", "0"));
+	uint32_t rain_delay_ms = 1000 * atoi(env("BOOT_RAIN_DELAY_S", "2"));
+	IoOutputs_t outputs = {};
+
+	mock::gpio_reset();
+	mock::pin_level[SR_IN_PIN_CE] = HIGH;						// init_IO()
+	mock::pin_level[SR_IN_PIN_PL] = HIGH;
+	mock::pin_level[SR_OUT_PIN_MR] = HIGH;
+	mock::pin_level[SR_OUT_PIN_OE] = HIGH;
+	mock::on_write = chain_edge;
+	mock::set_ms(0);												// reset
+	if( rain_ms == 0 )												// raining at power up
+		in_levels &= ~BIT_SAFE_RAIN;
+
+	io_init(millis());												// setup(): io_task_begin(), the task runs at once
+	io_cycle(millis());
+	boot_profile.Mark("io");
+	run_until(10000, rain_ms);
+	boot_profile.Mark("serial");
+	boot_profile.Mark("wifi_begin");								// normal_boot() returns at once
+	run_until(SETUP_MS * 1000, rain_ms);							// devices, LoadSettings(), rain debounced meanwhile
+	boot_profile.Mark("alpaca");
+	boot_profile.Begin(&server);
+	outputs.rain_delay_ms = rain_delay_ms;							// publish_io_outputs(): no client, Rain_delay loaded
+	outputs.settings = true;
+	io_outputs.Write(outputs);
+
+	run_until(WIFI_WAIT_MS * 1000ULL, rain_ms);						// loop(): task_wifi() never connects
+
+	AsyncWebServerRequest req(HTTP_GET, BOOT_PROFILE_URL);
+	JsonDocument doc;
+	TEST_ASSERT_TRUE(deserializeJson(doc, server.Dispatch(&req)->body()) == DeserializationError::Ok);
+	uint32_t io_first = doc["io_first_cycle_us"].as<uint32_t>();
+	uint64_t close_us = first_set(BIT_ROOF_CLOSE);
+	uint64_t armed_us = std::max<uint64_t>(rain_ms * 1000ULL, boot_profile.Get("alpaca"));	// rain seen with its delay from here
+
+	printf("{\"bench\":\"boot_profile\",\"rain_at_ms\":%u,\"rain_delay_ms\":%u,\"wifi\":\"none\",\"first_sample_us\":%llu,\"io_first_cycle_us\":%u,"
+		"\"roof_close_us\":%llu,\"alpaca_us\":%u,\"original\":{\"first_sample_us\":%u}}\n",
+		rain_ms, rain_delay_ms, (unsigned long long)first_sample_us, io_first, (unsigned long long)close_us, boot_profile.Get("alpaca"),
+		( SERIAL_DELAY_MS + WIFI_WAIT_MS ) * 1000);
+
+	TEST_ASSERT_TRUE(first_sample_us < 1000);						// inputs sampled within a millisecond of reset
+	TEST_ASSERT_TRUE(io_first <= boot_profile.Get("io"));
+	TEST_ASSERT_EQUAL_UINT32(0, boot_profile.Get("wifi"));
+#if RAIN_AUTO_CLOSE
+	TEST_ASSERT_TRUE(close_us >= armed_us + rain_delay_ms * 1000ULL);				// Rain_delay kept, also for rain at boot
+	TEST_ASSERT_TRUE(( close_us - armed_us ) / 1000 <= rain_delay_ms + ( DEBOUNCE_SAFE + 2 ) * DEBOUNCE_PERIOD_MS);	// next sample, confirmed rain
+#endif
+	TEST_ASSERT_EQUAL(0, (int)first_set(BIT_ROOF_OPEN));
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_marks);
+	RUN_TEST(test_rain_without_wifi);
+	return UNITY_END();
+}
@@ -0,0 +1,174 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    vertical counter Debouncer checked exhaustively against a per bit reference: every
+                  16 sample input sequence, on every bit, for every stability count 1~15 and both
+                  initial states. Then the cost of one Update() of the 16 bit word against the per
+                  bit counter loop, in ns and TSC cycles per sample as JSON on stdout.
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC            1
+#endif
+
+#include "Debouncer.cpp"
+
+#define SEQ_SAMPLES         16
+#define BENCH_SAMPLES       20000000
+
+// one counter per bit, what each bool would need without the bit planes
+class RefDebouncer
+{
+public:
+	uint8_t samples[16];
+	uint8_t count[16];
+	uint16_t state, rise, fall;
+
+	void Reset(uint16_t s) { state = s; rise = fall = 0; memset(count, 0, sizeof(count)); }
+
+	uint16_t Update(uint16_t raw)
+	{
+		uint16_t changed = 0;
+
+		for(uint8_t b = 0; b < 16; b++) {
+			uint16_t m = 1 << b;
+			if(( raw ^ state ) & m ) {
+				if( ++count[b] >= samples[b] ) {
+					changed |= m;
+					count[b] = 0;
+				}
+			}
+			else
+				count[b] = 0;
+		}
+		state ^= changed;
+		rise = changed & state;
+		fall = changed & ~state;
+		return changed;
+	}
+};
+
+static uint16_t rotl(uint16_t v, uint8_t n) { return n ? (uint16_t)(( v << n ) | ( v >> ( 16 - n ))) : v; }
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_defaults_and_clamp(void)
+{
+	Debouncer d;
+
+	TEST_ASSERT_EQUAL_HEX16(0x0005, d.Update(0x0005));				// 1 sample by default
+	TEST_ASSERT_EQUAL_HEX16(0x0005, d.GetRise());
+	TEST_ASSERT_EQUAL_HEX16(0x0000, d.Update(0x0005));
+	TEST_ASSERT_EQUAL_HEX16(0x0000, d.GetRise());					// edges last one Update()
+
+	d.SetSamples(0xffff, 0);										// clamped to 1
+	TEST_ASSERT_EQUAL_HEX16(0x0004, d.Update(0x0001));
+	TEST_ASSERT_EQUAL_HEX16(0x0004, d.GetFall());
+
+	d.SetSamples(0xffff, 200);										// clamped to 15
+	for(uint8_t i = 0; i < 14; i++)
+		TEST_ASSERT_EQUAL_HEX16(0x0000, d.Update(0x0000));
+	TEST_ASSERT_EQUAL_HEX16(0x0001, d.Update(0x0000));
+
+	d.Reset(0x8000);
+	TEST_ASSERT_EQUAL_HEX16(0x8000, d.GetState());
+	TEST_ASSERT_EQUAL_HEX16(0x0000, d.GetFall());
+}
+
+// bit b gets sequence rotl(seq, b), so over all seq every bit sees all 2^16 sequences, each with
+// count 1 + (b + shift) % 15 and counters of the 16 bits running side by side
+void test_exhaustive(void)
+{
+	uint32_t updates = 0;
+
+	for(uint16_t init = 0; init < 2; init++)
+		for(uint8_t shift = 0; shift < DEBOUNCE_MAX_SAMPLES; shift++) {
+			Debouncer d;
+			RefDebouncer ref;
+
+			for(uint8_t b = 0; b < 16; b++) {
+				ref.samples[b] = 1 + ( b + shift ) % DEBOUNCE_MAX_SAMPLES;
+				d.SetSamples(1 << b, ref.samples[b]);
+			}
+			for(uint32_t seq = 0; seq < ( 1UL << SEQ_SAMPLES ); seq++) {
+				d.Reset(init ? 0xffff : 0);
+				ref.Reset(init ? 0xffff : 0);
+				for(uint8_t s = 0; s < SEQ_SAMPLES; s++) {
+					uint16_t raw = 0;
+					for(uint8_t b = 0; b < 16; b++)
+						raw |= (( rotl(seq, b) >> s ) & 1 ) << b;
+
+					uint16_t changed = d.Update(raw);
+					if(( changed != ref.Update(raw) ) || ( d.GetState() != ref.state ) || ( d.GetRise() != ref.rise ) ||
+					   ( d.GetFall() != ref.fall )) {
+						printf("seq 0x%04x sample %u shift %u init %u: state 0x%04x expected 0x%04x\n",
+							seq, s, shift, init, d.GetState(), ref.state);
+						TEST_FAIL_MESSAGE("debouncer and reference disagree");
+					}
+					updates++;
+				}
+			}
+		}
+	TEST_ASSERT_EQUAL_UINT32(2 * DEBOUNCE_MAX_SAMPLES * ( 1UL << SEQ_SAMPLES ) * SEQ_SAMPLES, updates);
+}
+
+template <typename T>
+static void bench(T &d, const uint16_t *samples, double &ns, double &cycles)
+{
+	volatile uint16_t sink = 0;
+	uint64_t c0 = 0, c1 = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+	c0 = __rdtsc();
+#endif
+	for(uint32_t i = 0; i < BENCH_SAMPLES; i++)
+		sink = sink ^ d.Update(samples[i & 1023]);
+#ifdef HAVE_TSC
+	c1 = __rdtsc();
+#endif
+	auto t1 = std::chrono::steady_clock::now();
+	ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_SAMPLES;
+	cycles = (double)(c1 - c0) / BENCH_SAMPLES;
+}
+
+void test_cycles_per_sample(void)
+{
+	static uint16_t samples[1024];
+	uint32_t seed = 1;
+	Debouncer d;
+	RefDebouncer ref;
+	double d_ns, d_cycles, ref_ns, ref_cycles;
+
+	for(uint16_t i = 0; i < 1024; i++) {						// quiet word with a noisy bit now and then
+		seed = seed * 1664525 + 1013904223;
+		samples[i] = ( i & 64 ) ? 0x0a5a : 0x0a52;
+		if(( seed >> 24 ) < 16 )
+			samples[i] ^= 1 << (( seed >> 8 ) & 15 );
+	}
+	d.SetSamples(0xffff, 3);
+	memset(ref.samples, 3, sizeof(ref.samples));
+	ref.Reset(0);
+	bench(d, samples, d_ns, d_cycles);
+	bench(ref, samples, ref_ns, ref_cycles);
+
+	printf("{\"bench\":\"debouncer\",\"samples\":%u,\"bits\":16,\"vertical\":{\"ns\":%.2f,\"cycles\":%.1f},"
+		"\"per_bit\":{\"ns\":%.2f,\"cycles\":%.1f},\"speedup\":%.1f}\n",
+		BENCH_SAMPLES, d_ns, d_cycles, ref_ns, ref_cycles, ref_ns / d_ns);
+	TEST_ASSERT_TRUE(d_ns < ref_ns);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_defaults_and_clamp);
+	RUN_TEST(test_exhaustive);
+	RUN_TEST(test_cycles_per_sample);
+	return UNITY_END();
+}
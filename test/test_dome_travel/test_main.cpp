@@ -0,0 +1,314 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Dome travel model on a roof driven by the relays, loop() passes on the virtual
+                  clock: travel times learned per direction from full travels only, partial travels
+                  not learned, a start limit switch that never releases, a roof that stops halfway
+                  and one that arrives early, the travelstats Action and its reset, the model kept
+                  in NVS for the next boot. Then moves with a travel time that drifts by a few
+                  percent, false faults and the time to fault of a stall and of a jam against the
+                  Shutter_timeout, as JSON on stdout.
+
+                  DOME_MOVES  moves of the drift run, default 400
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+
+#include "Dome.cpp"
+#include "AlpacaActions.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+#define TRAVEL_MS           20000       // roof travel time, both directions
+#define TIMEOUT_S           60          // Shutter_timeout
+#define LOOP_MS             10          // loop() pass
+
+bool d_relay_open, d_relay_close;
+IoEdges_t io_edges;
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static AsyncWebServer server;
+static Dome dome;
+
+/**************************************************************************************************
+  roof: position in % of the travel, moves while a relay is on, limit switches at both ends
+**************************************************************************************************/
+typedef struct {
+	double pos;						// 0 closed, 100 open
+	double travel_ms;				// time of a full travel
+	double stop_at;					// the roof jams at this position, -1: never
+	bool stuck;						// the motor does not turn
+} Roof_t;
+
+static Roof_t roof = { 0, TRAVEL_MS, -1, false };
+
+static void roof_step(uint32_t ms)
+{
+	double step = 100.0 * ms / roof.travel_ms;
+	double to = roof.pos;
+
+	if( !roof.stuck && d_relay_open )
+		to += step;
+	if( !roof.stuck && d_relay_close )
+		to -= step;
+	if(( roof.stop_at >= 0 ) && (( roof.pos - roof.stop_at ) * ( to - roof.stop_at ) <= 0 ))	// reached or crossed
+		to = roof.stop_at;
+	roof.pos = ( to < 0 ) ? 0 : ( to > 100 ) ? 100 : to;
+	io_edges.state = (( roof.pos >= 100 ) ? BIT_FC_OPEN : 0 ) | (( roof.pos <= 0 ) ? BIT_FC_CLOSE : 0 );
+}
+
+static void pass(Dome &d)
+{
+	delay(LOOP_MS);
+	roof_step(LOOP_MS);
+	d.Loop();
+}
+
+// one PUT openshutter/closeshutter, loop() passes until the movement ends, returns its duration
+static uint32_t move(Dome &d, bool open)
+{
+	uint32_t start = millis();
+
+	TEST_ASSERT_TRUE(open ? d.PutOpen() : d.PutClose());
+	while( d.GetSlewing() && ( millis() - start < 2 * TIMEOUT_S * 1000 ))
+		pass(d);
+	return millis() - start;
+}
+
+static JsonDocument travel_stats(const char *parameters = "")
+{
+	AsyncWebServerRequest req(HTTP_PUT, "/api/v1/dome/0/action");
+	JsonDocument reply, stats;
+
+	req.AddParam("Action", "travelstats", true);
+	req.AddParam("Parameters", parameters, true);
+	req.AddParam("ClientTransactionID", "1", true);
+	TEST_ASSERT_TRUE(deserializeJson(reply, server.Dispatch(&req)->body()) == DeserializationError::Ok);
+	TEST_ASSERT_EQUAL(0, reply["ErrorNumber"].as<int>());
+	TEST_ASSERT_TRUE(deserializeJson(stats, reply["Value"].as<const char *>()) == DeserializationError::Ok);
+	return stats;
+}
+
+static void configure(Dome &d)
+{
+	JsonDocument doc;
+
+	doc["use"] = true;
+	doc["timeout"] = TIMEOUT_S;
+	TEST_ASSERT_TRUE(d.ApplySetting("Dome_Configuration", "Use_limit_switches", doc["use"]));
+	TEST_ASSERT_TRUE(d.ApplySetting("Dome_Configuration", "Shutter_timeout", doc["timeout"]));
+}
+
+// back to closed on a healthy roof, as the operator would after a fault
+static void recover(Dome &d)
+{
+	roof.stuck = false;
+	roof.stop_at = -1;
+	roof.travel_ms = TRAVEL_MS;
+	if( d.GetShutter() != AlpacaShutterStatus_t::kClosed )
+		move(d, false);
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kClosed, (int)d.GetShutter());
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		mock::set_ms(1000);
+		roof_step(0);
+		configure(dome);
+		dome.Begin();
+		alpaca_actions.Begin(&server);
+		begun = true;
+	}
+	dome.SetNumberOfConnectedClients(1);
+}
+void tearDown(void) {}
+
+/**************************************************************************************************
+  model
+**************************************************************************************************/
+void test_learn(void)
+{
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kClosed, (int)dome.GetShutter());
+	TEST_ASSERT_EQUAL_UINT32(0, travel_stats()["open"]["runs"].as<uint32_t>());
+
+	for(uint32_t i = 0; i < DOME_TRAVEL_MIN_RUNS; i++) {
+		roof.travel_ms = TRAVEL_MS + 200.0 * i;
+		move(dome, true);
+		TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kOpen, (int)dome.GetShutter());
+		move(dome, false);
+		TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kClosed, (int)dome.GetShutter());
+	}
+
+	JsonDocument s = travel_stats();
+	for(const char *dir : { "open", "close" }) {
+		TEST_ASSERT_EQUAL_UINT32(DOME_TRAVEL_MIN_RUNS, s[dir]["runs"].as<uint32_t>());
+		TEST_ASSERT_UINT32_WITHIN(LOOP_MS, TRAVEL_MS, s[dir]["min_ms"].as<uint32_t>());
+		TEST_ASSERT_UINT32_WITHIN(LOOP_MS, TRAVEL_MS + 400, s[dir]["max_ms"].as<uint32_t>());
+		TEST_ASSERT_UINT32_WITHIN(400, TRAVEL_MS + 200, s[dir]["avg_ms"].as<uint32_t>());
+		TEST_ASSERT_EQUAL_UINT32(0, s[dir]["stalls"].as<uint32_t>() + s[dir]["early"].as<uint32_t>() + s[dir]["late"].as<uint32_t>());
+	}
+
+	// abort halfway, then open from there: checked, not learned
+	roof.travel_ms = TRAVEL_MS;
+	TEST_ASSERT_TRUE(dome.PutOpen());
+	while( roof.pos < 50 )
+		pass(dome);
+	TEST_ASSERT_TRUE(dome.PutAbort());
+	pass(dome);
+	uint32_t ms = move(dome, true);
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kOpen, (int)dome.GetShutter());
+	TEST_ASSERT_UINT32_WITHIN(2 * LOOP_MS, TRAVEL_MS / 2, ms);
+	TEST_ASSERT_EQUAL_UINT32(ms, travel_stats()["open"]["last_ms"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(DOME_TRAVEL_MIN_RUNS, travel_stats()["open"]["runs"].as<uint32_t>());
+	recover(dome);
+}
+
+void test_stall(void)
+{
+	roof.stuck = true;
+	uint32_t ms = move(dome, true);
+
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kError, (int)dome.GetShutter());
+	TEST_ASSERT_FALSE(d_relay_open || d_relay_close);
+	TEST_ASSERT_UINT32_WITHIN(LOOP_MS, DOME_RELEASE_MS, ms);			// not Shutter_timeout
+	TEST_ASSERT_EQUAL_UINT32(1, travel_stats()["open"]["stalls"].as<uint32_t>());
+	recover(dome);
+}
+
+void test_jam(void)
+{
+	JsonDocument before = travel_stats();
+	uint32_t avg = before["close"]["avg_ms"].as<uint32_t>();
+	uint32_t band = std::max<uint32_t>(avg * DOME_TRAVEL_TOLERANCE / 100, DOME_TRAVEL_MARGIN_MS);
+
+	move(dome, true);
+	roof.stop_at = 40;														// released, then stops
+	uint32_t ms = move(dome, false);
+
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kError, (int)dome.GetShutter());
+	TEST_ASSERT_UINT32_WITHIN(LOOP_MS, avg + band, ms);
+	TEST_ASSERT_TRUE(ms < TIMEOUT_S * 1000);
+	TEST_ASSERT_EQUAL_UINT32(1, travel_stats()["close"]["late"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(before["close"]["runs"].as<uint32_t>(), travel_stats()["close"]["runs"].as<uint32_t>());
+	recover(dome);
+}
+
+void test_early(void)
+{
+	JsonDocument before = travel_stats();
+
+	roof.travel_ms = TRAVEL_MS / 2;											// limit switch hit halfway
+	move(dome, true);
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kOpen, (int)dome.GetShutter());
+
+	JsonDocument after = travel_stats();
+	TEST_ASSERT_EQUAL_UINT32(1, after["open"]["early"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(before["open"]["runs"].as<uint32_t>(), after["open"]["runs"].as<uint32_t>());	// not learned
+	TEST_ASSERT_EQUAL_UINT32(before["open"]["avg_ms"].as<uint32_t>(), after["open"]["avg_ms"].as<uint32_t>());
+	recover(dome);
+}
+
+// the model of the previous boot is in NVS: a jam is caught without learning again
+void test_reboot(void)
+{
+	JsonDocument s = travel_stats();
+	static Dome rebooted;
+
+	TEST_ASSERT_EQUAL_UINT32(2 * sizeof(DomeTravel_t), mock::nvs["dome"]["travel"].size());
+	configure(rebooted);
+	rebooted.Begin();
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kClosed, (int)rebooted.GetShutter());
+
+	roof.stop_at = 60;
+	uint32_t ms = move(rebooted, true);
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kError, (int)rebooted.GetShutter());
+	TEST_ASSERT_TRUE(ms < TIMEOUT_S * 1000);
+
+	DomeTravel_t t[2];
+	memcpy(t, mock::nvs["dome"]["travel"].data(), sizeof(t));
+	TEST_ASSERT_EQUAL_UINT32(s["open"]["runs"].as<uint32_t>(), t[DOME_TRAVEL_OPEN].runs);
+	TEST_ASSERT_EQUAL_UINT32(s["open"]["avg_ms"].as<uint32_t>(), t[DOME_TRAVEL_OPEN].avg_ms);
+	TEST_ASSERT_EQUAL_UINT32(s["open"]["late"].as<uint32_t>() + 1, t[DOME_TRAVEL_OPEN].late);
+	recover(rebooted);
+}
+
+void test_reset(void)
+{
+	TEST_ASSERT_TRUE(travel_stats("reset")["open"]["runs"].as<uint32_t>() > 0);	// answered before the reset
+	pass(dome);
+	JsonDocument s = travel_stats();
+	TEST_ASSERT_EQUAL_UINT32(0, s["open"]["runs"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(0, s["close"]["late"].as<uint32_t>());
+
+	DomeTravel_t t[2];
+	memcpy(t, mock::nvs["dome"]["travel"].data(), sizeof(t));
+	TEST_ASSERT_EQUAL_UINT32(0, t[DOME_TRAVEL_OPEN].runs + t[DOME_TRAVEL_CLOSE].runs);
+}
+
+/**************************************************************************************************
+  drift run and time to fault
+**************************************************************************************************/
+void test_benchmark(void)
+{
+	uint32_t moves = atoi(env("DOME_MOVES", "400"));
+	uint32_t seed = 5, faults = 0, stall_ms, jam_ms;
+	double drift = 1.0, worst = 1.0;
+
+	for(uint32_t i = 0; i < moves; i++) {						// slow drift of +-10% and +-3% noise
+		seed = seed * 1664525 + 1013904223;
+		drift += ((int32_t)(( seed >> 8 ) % 1001) - 500) / 1e5;
+		drift = std::min(1.1, std::max(0.9, drift));
+		roof.travel_ms = TRAVEL_MS * drift * ( 1.0 + ((int32_t)(( seed >> 20 ) % 601) - 300) / 1e4 );
+		worst = std::max(worst, fabs(roof.travel_ms / TRAVEL_MS - 1.0) + 1.0);
+
+		move(dome, ( i % 2 ) == 0);
+		if( dome.GetShutter() == AlpacaShutterStatus_t::kError ) {
+			faults++;
+			recover(dome);
+			i |= 1;
+		}
+	}
+	recover(dome);
+	JsonDocument s = travel_stats();
+
+	roof.stuck = true;
+	stall_ms = move(dome, true);
+	recover(dome);
+	move(dome, true);
+	roof.stop_at = 50;
+	jam_ms = move(dome, false);
+	recover(dome);
+
+	printf("{\"bench\":\"dome_travel\",\"travel_ms\":%u,\"timeout_ms\":%u,\"drift\":{\"moves\":%u,\"max_deviation\":%.3f,\"false_faults\":%u,"
+		"\"avg_open_ms\":%u,\"avg_close_ms\":%u},\"time_to_fault_ms\":{\"stall\":%u,\"jam\":%u,\"timeout\":%u}}\n",
+		TRAVEL_MS, TIMEOUT_S * 1000, moves, worst - 1.0, faults, s["open"]["avg_ms"].as<uint32_t>(), s["close"]["avg_ms"].as<uint32_t>(),
+		stall_ms, jam_ms, TIMEOUT_S * 1000);
+
+	TEST_ASSERT_EQUAL_UINT32(0, faults);
+	TEST_ASSERT_TRUE(stall_ms < TIMEOUT_S * 1000 / 5);
+	TEST_ASSERT_TRUE(jam_ms < TIMEOUT_S * 1000 / 2);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_learn);
+	RUN_TEST(test_stall);
+	RUN_TEST(test_jam);
+	RUN_TEST(test_early);
+	RUN_TEST(test_reboot);
+	RUN_TEST(test_reset);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
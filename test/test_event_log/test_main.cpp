@@ -0,0 +1,406 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    EventLog on the flash emulator of FS.h: events of several boots queried by boot and
+                  time range as JSON and raw records, queued events in the answer, the segment index
+                  skipping segments out of range, rotation over every segment with a bounded size,
+                  queue overflow, and power lost at every byte of a batch and of a segment header,
+                  each followed by a boot that keeps a prefix of the batch and appends again. Then
+                  append throughput, flash bytes and writes per event, a full log query and the boot
+                  scan, as JSON on stdout.
+
+                  EVLOG_EVENTS events of the throughput run, default 200000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <vector>
+
+#include "EventLog.cpp"
+
+#define BATCH               ( EVLOG_QUEUE / 2 )     // events written by one Loop()
+#define SEGMENT_RECORDS     ((EVLOG_SEGMENT_SIZE - 16) / sizeof(EventRecord_t))
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+typedef struct {
+	uint32_t boot, t_ms, source, code, payload;
+} Row_t;
+
+// a boot of the board: new log over the partition as it is
+struct Board
+{
+	AsyncWebServer server;
+	EventLog log;
+
+	Board() { log.Begin(&server); }
+	void Add(uint8_t source, uint8_t code, uint32_t payload)
+	{
+		mock::advance_us(1000);
+		log.Add(source, code, payload);
+	}
+	void Flush()												// queue written whatever its size
+	{
+		mock::advance_us(EVLOG_FLUSH_MS * 1000);
+		log.Loop(millis());
+	}
+	std::vector<Row_t> Query(const char *boot, const char *from = NULL, const char *to = NULL)
+	{
+		AsyncWebServerRequest req(HTTP_GET, EVLOG_URL);
+		std::vector<Row_t> rows;
+		JsonDocument doc;
+
+		if( boot ) req.AddParam("boot", boot);
+		if( from ) req.AddParam("from", from);
+		if( to ) req.AddParam("to", to);
+		String body = server.Dispatch(&req)->body();
+		TEST_ASSERT_TRUE(deserializeJson(doc, body) == DeserializationError::Ok);
+		JsonVariantConst r = doc["rows"];
+		for(size_t i = 0; i < r.size(); i++)
+			rows.push_back({ r[i][0].as<uint32_t>(), r[i][1].as<uint32_t>(), r[i][2].as<uint32_t>(), r[i][3].as<uint32_t>(), r[i][4].as<uint32_t>() });
+		return rows;
+	}
+};
+
+static size_t file_size(uint8_t slot)
+{
+	char name[16];
+
+	snprintf(name, sizeof(name), EVLOG_FILE, slot);
+	File f = LittleFS.open(name, "r");
+	size_t n = f ? f.size() : 0;
+	if( f ) f.close();
+	return n;
+}
+
+void setUp(void)
+{
+	LittleFS.begin();
+	mock::fs_format();
+	mock::fs_power_on();
+	mock::fs_reset_counters();
+	mock::real_clock = false;
+	mock::set_ms(1000);
+	mock::chunk_size = 1436;
+}
+void tearDown(void) {}
+
+/**************************************************************************************************
+  append and query
+**************************************************************************************************/
+void test_append_query(void)
+{
+	Board b;
+
+	TEST_ASSERT_EQUAL_UINT16(1, b.log.GetBoot());
+	mock::fs_reset_counters();										// header of the first segment
+	b.Add(EVLOG_SRC_DOME, 2, 1 | ( 1 << 8 ));
+	b.Add(EVLOG_SRC_SAFEMON, 1, 0x40 | ( 0x00 << 16 ));
+	b.Add(EVLOG_SRC_SWITCH, 9, 1);
+	TEST_ASSERT_EQUAL_UINT32(0, mock::fs_write_calls);				// Add() never touches the flash
+	b.log.Loop(millis());
+	TEST_ASSERT_EQUAL_UINT32(0, mock::fs_write_calls);				// not old enough
+
+	std::vector<Row_t> rows = b.Query(NULL);						// queued events in the answer
+	TEST_ASSERT_EQUAL_UINT32(4, rows.size());
+	TEST_ASSERT_EQUAL_UINT32(EVLOG_SRC_SYSTEM, rows[0].source);
+	TEST_ASSERT_EQUAL_UINT32(EVLOG_BOOT, rows[0].code);
+	TEST_ASSERT_EQUAL_UINT32(ESP_RST_POWERON, rows[0].payload);
+	TEST_ASSERT_EQUAL_UINT32(EVLOG_SRC_DOME, rows[1].source);
+	TEST_ASSERT_EQUAL_UINT32(0x101, rows[1].payload);
+	TEST_ASSERT_EQUAL_UINT32(9, rows[3].code);
+
+	b.Flush();
+	TEST_ASSERT_EQUAL_UINT32(1, b.log.GetStats().flushes);
+	TEST_ASSERT_EQUAL_UINT32(4, b.log.GetStats().written);
+	TEST_ASSERT_EQUAL_UINT32(16 + 4 * sizeof(EventRecord_t), file_size(0));
+	std::vector<Row_t> flushed = b.Query(NULL);
+	TEST_ASSERT_EQUAL_UINT32(4, flushed.size());
+	for(size_t i = 0; i < rows.size(); i++) {
+		TEST_ASSERT_EQUAL_UINT32(rows[i].t_ms, flushed[i].t_ms);
+		TEST_ASSERT_EQUAL_UINT32(rows[i].payload, flushed[i].payload);
+	}
+
+	AsyncWebServerRequest req(HTTP_GET, EVLOG_URL);					// raw records
+	req.AddParam("format", "bin");
+	String bin = b.server.Dispatch(&req)->body();
+	TEST_ASSERT_EQUAL_UINT32(4 * sizeof(EventRecord_t), bin.length());
+	for(size_t i = 0; i < 4; i++) {
+		EventRecord_t r;
+		memcpy(&r, bin.c_str() + i * sizeof(r), sizeof(r));
+		TEST_ASSERT_EQUAL_UINT32(record_crc(r), r.crc);
+		TEST_ASSERT_EQUAL_UINT32(rows[i].t_ms, r.t_ms);
+	}
+
+	AsyncWebServerRequest stats(HTTP_GET, EVLOG_STATS_URL);
+	JsonDocument doc;
+	deserializeJson(doc, b.server.Dispatch(&stats)->body());
+	TEST_ASSERT_EQUAL_UINT32(4, doc["written"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(SEGMENT_RECORDS, doc["records_per_segment"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(4, doc["segments"][0]["count"].as<uint32_t>());
+}
+
+// boots one after the other, queries by boot and by time range, small chunks
+void test_boots_and_ranges(void)
+{
+	for(uint32_t boot = 1; boot <= 3; boot++) {
+		Board b;
+
+		TEST_ASSERT_EQUAL_UINT16(boot, b.log.GetBoot());
+		for(uint32_t i = 0; i < 10; i++)
+			b.Add(EVLOG_SRC_SWITCH, 8 + i % 8, boot * 100 + i);
+		b.Flush();
+		mock::set_ms(1000);										// millis() starts over
+	}
+
+	Board b;
+	TEST_ASSERT_EQUAL_UINT32(4 + 3 * 10, b.Query("all").size());
+	std::vector<Row_t> two = b.Query("2");
+	TEST_ASSERT_EQUAL_UINT32(11, two.size());
+	for(const Row_t &r : two)
+		TEST_ASSERT_EQUAL_UINT32(2, r.boot);
+	TEST_ASSERT_EQUAL_UINT32(205, two[6].payload);
+
+	std::vector<Row_t> range = b.Query("2", "1003", "1006");			// events of boot 2 at 1001 + i ms
+	TEST_ASSERT_EQUAL_UINT32(4, range.size());
+	TEST_ASSERT_EQUAL_UINT32(202, range[0].payload);
+	TEST_ASSERT_EQUAL_UINT32(205, range[3].payload);
+	TEST_ASSERT_EQUAL_UINT32(1, b.Query(NULL).size());				// this boot: its boot event
+
+	mock::chunk_size = 100;											// a row or two per TCP chunk
+	TEST_ASSERT_EQUAL_UINT32(4 + 3 * 10, b.Query("all").size());
+}
+
+// a full log: a range query opens only the segments of its range
+void test_index_skips_segments(void)
+{
+	Board b;
+	uint32_t opens;
+
+	for(uint32_t i = 1; i < ( EVLOG_SEGMENTS - 1 ) * SEGMENT_RECORDS; i++) {	// with the boot event
+		b.Add(EVLOG_SRC_SWITCH, 8, i);
+		if( i % BATCH == BATCH - 1 )
+			b.log.Loop(millis());
+	}
+	b.Flush();
+
+	uint32_t t = 1000 + 3 * SEGMENT_RECORDS + 10;					// in the 4th segment, record n at 1000 + n ms
+	char from[12], to[12];
+	snprintf(from, sizeof(from), "%u", t);
+	snprintf(to, sizeof(to), "%u", t + 20);
+
+	mock::fs_reset_counters();
+	std::vector<Row_t> rows = b.Query(NULL, from, to);
+	opens = mock::fs_opens;
+	TEST_ASSERT_EQUAL_UINT32(21, rows.size());
+	TEST_ASSERT_EQUAL_UINT32(t, rows[0].t_ms);
+	TEST_ASSERT_TRUE(opens <= 2);
+
+	mock::fs_reset_counters();										// every segment, opened again for each chunk
+	TEST_ASSERT_EQUAL_UINT32(( EVLOG_SEGMENTS - 1 ) * SEGMENT_RECORDS, b.Query(NULL).size());
+	TEST_ASSERT_TRUE(mock::fs_opens >= EVLOG_SEGMENTS - 1);
+}
+
+/**************************************************************************************************
+  rotation and bounds
+**************************************************************************************************/
+void test_rotation(void)
+{
+	uint32_t events = 3 * EVLOG_SEGMENTS * SEGMENT_RECORDS + 100;
+	size_t total = 0;
+
+	{
+		Board b;
+		for(uint32_t i = 0; i < events; i++) {
+			b.Add(EVLOG_SRC_SWITCH, 8, i);
+			if( i % BATCH == BATCH - 1 )
+				b.log.Loop(millis());
+		}
+		b.Flush();
+		TEST_ASSERT_EQUAL_UINT32(events + 1, b.log.GetStats().written);
+		TEST_ASSERT_TRUE(b.log.GetStats().segments_recycled >= 2 * EVLOG_SEGMENTS);
+	}
+
+	for(uint8_t slot = 0; slot < EVLOG_SEGMENTS; slot++) {			// bounded, every slot in use
+		TEST_ASSERT_TRUE(file_size(slot) <= EVLOG_SEGMENT_SIZE);
+		TEST_ASSERT_TRUE(file_size(slot) > 16);
+		total += file_size(slot);
+	}
+	TEST_ASSERT_TRUE(total <= EVLOG_SEGMENTS * EVLOG_SEGMENT_SIZE);
+
+	Board b;															// the newest events, in order, none lost between
+	std::vector<Row_t> rows = b.Query("1");
+	TEST_ASSERT_TRUE(rows.size() > ( EVLOG_SEGMENTS - 1 ) * SEGMENT_RECORDS);
+	TEST_ASSERT_EQUAL_UINT32(events - 1, rows.back().payload);
+	for(size_t i = 1; i < rows.size(); i++)
+		TEST_ASSERT_EQUAL_UINT32(rows[i - 1].payload + 1, rows[i].payload);
+}
+
+void test_queue_full(void)
+{
+	Board b;
+
+	mock::fs_reset_counters();
+	for(uint32_t i = 0; i < EVLOG_QUEUE + 10; i++)
+		b.log.Add(EVLOG_SRC_DOME, 1, i);								// no Loop() for a while
+	TEST_ASSERT_EQUAL_UINT32(11, b.log.GetStats().dropped);			// the boot event took a place
+	TEST_ASSERT_EQUAL_UINT32(0, mock::fs_write_calls);
+	b.log.Loop(millis());												// a full queue goes at once
+	TEST_ASSERT_EQUAL_UINT32(EVLOG_QUEUE, b.log.GetStats().written);
+}
+
+/**************************************************************************************************
+  power loss
+**************************************************************************************************/
+// power lost at every byte of a batch: the next boot keeps a prefix of it, appends after it
+void test_power_loss_batch(void)
+{
+	const size_t bytes = BATCH * sizeof(EventRecord_t);
+
+	for(size_t budget = 0; budget <= bytes; budget++) {
+		mock::fs_format();
+		mock::fs_power_on();
+		mock::set_ms(1000);
+		{
+			Board b;
+			for(uint32_t i = 0; i < 5; i++)
+				b.Add(EVLOG_SRC_DOME, 1, i);
+			b.Flush();
+			for(uint32_t i = 0; i < BATCH; i++)
+				b.Add(EVLOG_SRC_SAFEMON, 1, 100 + i);
+			mock::fs_power_budget = budget;
+			b.log.Loop(millis());
+		}
+		mock::fs_power_on();
+		mock::set_ms(1000);
+
+		uint32_t complete = budget / sizeof(EventRecord_t);
+		bool torn = ( budget % sizeof(EventRecord_t) ) != 0;
+		{
+			Board b;
+			std::vector<Row_t> rows = b.Query("1");
+
+			TEST_ASSERT_EQUAL_UINT32(torn ? 1 : 0, b.log.GetStats().torn);
+			TEST_ASSERT_EQUAL_UINT32(1 + 5 + complete, rows.size());
+			for(uint32_t i = 0; i < complete; i++)
+				TEST_ASSERT_EQUAL_UINT32(100 + i, rows[6 + i].payload);
+			b.Add(EVLOG_SRC_SWITCH, 8, 7);
+			b.Flush();
+			TEST_ASSERT_EQUAL_UINT32(torn ? 16 + 2 * sizeof(EventRecord_t) : 0, file_size(1));	// never after a bad record
+		}
+		Board b;
+		std::vector<Row_t> rows = b.Query("2");
+		TEST_ASSERT_EQUAL_UINT32(2, rows.size());
+		TEST_ASSERT_EQUAL_UINT32(7, rows[1].payload);
+		TEST_ASSERT_EQUAL_UINT32(1 + 5 + complete, b.Query("1").size());
+	}
+}
+
+// power lost at every byte of the header of a new segment: the slot is reused, no event of the
+// full segment is lost
+void test_power_loss_segment(void)
+{
+	for(size_t budget = 0; budget <= 16; budget++) {
+		mock::fs_format();
+		mock::fs_power_on();
+		mock::set_ms(1000);
+		{
+			Board b;
+			for(uint32_t i = 1; i < SEGMENT_RECORDS; i++) {			// segment 0 full with the boot event
+				b.Add(EVLOG_SRC_SWITCH, 8, i);
+				if( i % BATCH == 0 )
+					b.log.Loop(millis());
+			}
+			b.Flush();
+			TEST_ASSERT_EQUAL_UINT32(0, file_size(1));
+			b.Add(EVLOG_SRC_SWITCH, 9, 0);
+			mock::fs_power_budget = budget;
+			b.Flush();
+		}
+		mock::fs_power_on();
+		mock::set_ms(1000);
+		{
+			Board b;
+			TEST_ASSERT_EQUAL_UINT32(SEGMENT_RECORDS, b.Query("1").size());
+			b.Add(EVLOG_SRC_SWITCH, 10, 0);
+			b.Flush();
+		}
+		Board b;
+		std::vector<Row_t> rows = b.Query("all");
+		TEST_ASSERT_EQUAL_UINT32(SEGMENT_RECORDS + 2 + 1, rows.size());	// boots 2 and 3, the switch event
+		TEST_ASSERT_EQUAL_UINT32(10, rows[SEGMENT_RECORDS + 1].code);
+	}
+}
+
+/**************************************************************************************************
+  benchmark
+**************************************************************************************************/
+void test_benchmark(void)
+{
+	uint32_t events = atoi(env("EVLOG_EVENTS", "200000"));
+	double add_ns, append_ns, query_us, boot_us;
+	uint64_t bytes;
+	uint32_t writes, rows;
+	size_t body;
+
+	{
+		Board b;
+		mock::fs_reset_counters();
+
+		auto a = std::chrono::steady_clock::now();
+		for(uint32_t i = 0; i < events; i++)
+			b.log.Add(EVLOG_SRC_SWITCH, 8 + i % 8, i);
+		auto c = std::chrono::steady_clock::now();
+		add_ns = std::chrono::duration<double, std::nano>(c - a).count() / events;	// queue full after EVLOG_QUEUE
+
+		a = std::chrono::steady_clock::now();
+		for(uint32_t i = 0; i < events; i++) {						// a burst, written a batch at a time
+			b.log.Add(EVLOG_SRC_SWITCH, 8 + i % 8, i);
+			if( i % BATCH == BATCH - 1 )
+				b.log.Loop(millis());
+		}
+		b.Flush();
+		c = std::chrono::steady_clock::now();
+		append_ns = std::chrono::duration<double, std::nano>(c - a).count() / events;
+		bytes = mock::fs_bytes_written;
+		writes = mock::fs_write_calls;
+
+		AsyncWebServerRequest req(HTTP_GET, EVLOG_URL);
+		a = std::chrono::steady_clock::now();
+		body = b.server.Dispatch(&req)->body().length();
+		c = std::chrono::steady_clock::now();
+		query_us = std::chrono::duration<double, std::micro>(c - a).count();
+		rows = b.Query(NULL).size();
+	}
+
+	auto a = std::chrono::steady_clock::now();
+	Board boot;
+	auto c = std::chrono::steady_clock::now();
+	boot_us = std::chrono::duration<double, std::micro>(c - a).count();
+
+	printf("{\"bench\":\"event_log\",\"events\":%u,\"add_ns\":%.1f,\"append\":{\"ns_per_event\":%.1f,\"events_per_s\":%.0f,"
+		"\"flash_bytes_per_event\":%.1f,\"writes_per_event\":%.3f},\"query\":{\"rows\":%u,\"bytes\":%u,\"us\":%.0f},"
+		"\"boot_scan_us\":%.0f,\"ram_bytes\":%u}\n",
+		events, add_ns, append_ns, 1e9 / append_ns, (double)bytes / events, (double)writes / events,
+		rows, (unsigned)body, query_us, boot_us, (unsigned)sizeof(EventLog));
+
+	TEST_ASSERT_TRUE((double)bytes / events < sizeof(EventRecord_t) + 2);	// headers of the segments only
+	TEST_ASSERT_TRUE((double)writes / events <= 2.0 / BATCH);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_append_query);
+	RUN_TEST(test_boots_and_ranges);
+	RUN_TEST(test_index_skips_segments);
+	RUN_TEST(test_rotation);
+	RUN_TEST(test_queue_full);
+	RUN_TEST(test_power_loss_batch);
+	RUN_TEST(test_power_loss_segment);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
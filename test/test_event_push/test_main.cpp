@@ -0,0 +1,379 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    EventPush on /events: nothing sent without a client, the full state on connect,
+                  one event per changed source with increasing ids and the source version. Then
+                  random changes of the Dome, SafetyMonitor, Switch and weather on the virtual clock
+                  with loop() passes SCHED_MAX_IDLE_MS apart, time from change to client for the
+                  events against a client polling the four states, and messages/s, as JSON on stdout.
+
+                  PUSH_SECONDS    simulated seconds, default 3600
+                  PUSH_POLL_MS    polling period of each state, default 1000
+                  PUSH_NET_US     one way Wi-Fi delay, default 4000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+
+#include "EventPush.cpp"
+#include "Dome.cpp"
+#include "SafetyMonitor.cpp"
+#include "SafetyRules.cpp"
+#include "Switch.cpp"
+#include "AlpacaActions.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+#define CHANGE_MEAN_MS      2000        // mean time between two changes
+#define IDLE_PASSES         1000000
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+bool d_relay_open, d_relay_close;
+uint16_t _safemon_inputs;
+bool is_ws_connected;
+Snapshot<WeatherSnapshot> weather_snapshot;
+bool _sw_out[8];
+uint8_t _sw_pwm[4];
+IoEdges_t io_edges;
+
+static AsyncWebServer server;
+static Dome dome;
+static Switch *sw;
+static SafetyMonitor safemon;
+static WeatherSnapshot weather;
+
+enum { SRC_DOME = 0, SRC_SAFEMON, SRC_SWITCH, SRC_WEATHER, SRC_COUNT };
+static const char *const k_src[SRC_COUNT] = { "dome", "safemon", "switch", "weather" };
+
+// one pass of loop() as main.cpp runs it
+static void loop_pass()
+{
+	dome.Loop();
+	sw->Loop();
+	safemon.Loop();
+	event_push.Loop();
+}
+
+static AsyncEventSourceClient *connect()
+{
+	AsyncWebServerRequest req(HTTP_GET, EVENTS_URL);
+
+	server.Dispatch(&req);
+	TEST_ASSERT_EQUAL(200, req.Response()->code());
+	TEST_ASSERT_EQUAL_STRING("text/event-stream", req.Response()->contentType().c_str());
+	return static_cast<AsyncEventSourceResponse *>(req.Response())->client;
+}
+
+static void weather_write(int16_t tsky)
+{
+	weather.values.tsky = tsky;
+	weather.timestamp_ms = millis();
+	weather.frames++;
+	weather_snapshot.Write(weather);
+}
+
+static uint32_t version(uint8_t src)
+{
+	switch( src ) {
+		case SRC_DOME: return dome.GetVersion();
+		case SRC_SAFEMON: return safemon.GetVersion();
+		case SRC_SWITCH: return sw->GetVersion();
+		default: return weather_snapshot.GetVersion();
+	}
+}
+
+// ids increase by one from first, "seq" of the data is the id, versions of a source never go back
+static void check_order(const std::vector<AsyncEventSourceClient::Event_t> &events, uint32_t first)
+{
+	uint32_t last_v[SRC_COUNT] = {0};
+
+	for(size_t i = 0; i < events.size(); i++) {
+		JsonDocument doc;
+
+		TEST_ASSERT_TRUE(deserializeJson(doc, events[i].data.c_str()) == DeserializationError::Ok);
+		TEST_ASSERT_EQUAL_UINT32(first + i, events[i].id);
+		TEST_ASSERT_EQUAL_UINT32(events[i].id, doc["seq"].as<uint32_t>());
+		for(uint8_t s = 0; s < SRC_COUNT; s++)
+			if( events[i].event == k_src[s] ) {
+				TEST_ASSERT_TRUE(doc["v"].as<uint32_t>() >= last_v[s]);
+				last_v[s] = doc["v"].as<uint32_t>();
+			}
+	}
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		JsonDocument to;
+
+		mock::real_clock = false;
+		mock::set_ms(1000);
+		to.set(1);
+		dome.ApplySetting("Dome_Configuration", "Shutter_timeout", to.as<JsonVariantConst>());
+		dome.Begin();
+		sw = new Switch();
+		sw->Begin();
+		safemon.Begin();
+		alpaca_actions.Begin(&server);
+		event_push.Begin(&server, &dome, sw, &safemon);
+		begun = true;
+	}
+}
+void tearDown(void) {}
+
+void test_no_client(void)
+{
+	dome.PutOpen();
+	sw->PutSetSwitchValue(16, 20);
+	weather_write(-150);
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(0, event_push.GetSeq());
+	mock::advance_us(2000000);										// shutter timeout, open
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(0, event_push.GetSeq());
+}
+
+// the current state of every source at once, then nothing until a change
+void test_connect_resync(void)
+{
+	AsyncEventSourceClient *c = connect();
+
+	TEST_ASSERT_EQUAL_UINT32(0, c->events.size());
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(SRC_COUNT, c->events.size());
+	for(uint8_t s = 0; s < SRC_COUNT; s++) {
+		JsonDocument doc;
+
+		deserializeJson(doc, c->events[s].data.c_str());
+		TEST_ASSERT_EQUAL_STRING(k_src[s], c->events[s].event.c_str());
+		TEST_ASSERT_EQUAL_UINT32(version(s), doc["v"].as<uint32_t>());
+	}
+	check_order(c->events, 1);
+
+	JsonDocument d, w;
+	deserializeJson(d, c->events[SRC_DOME].data.c_str());
+	deserializeJson(w, c->events[SRC_WEATHER].data.c_str());
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kOpen, d["shutter"].as<int>());		// state reached without a client
+	TEST_ASSERT_EQUAL(-150, w["tsky"].as<int>());
+
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(SRC_COUNT, c->events.size());
+	c->close();
+}
+
+// one event per source changed since the last pass, several writes in a pass coalesce
+void test_one_event_per_change(void)
+{
+	AsyncEventSourceClient *c = connect();
+
+	loop_pass();
+	c->events.clear();
+
+	uint32_t seq = event_push.GetSeq();
+	sw->PutSetSwitchValue(17, 10);
+	sw->PutSetSwitchValue(17, 30);
+	sw->PutSetSwitch(9, true);
+	_safemon_inputs ^= SAFEMON_POWER_BIT;
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(2, c->events.size());
+	TEST_ASSERT_EQUAL_STRING("safemon", c->events[0].event.c_str());
+	TEST_ASSERT_EQUAL_STRING("switch", c->events[1].event.c_str());
+
+	JsonDocument s, v;
+	deserializeJson(s, c->events[0].data.c_str());
+	deserializeJson(v, c->events[1].data.c_str());
+	TEST_ASSERT_EQUAL_UINT32(safemon.GetVersion(), s["v"].as<uint32_t>());
+	TEST_ASSERT_FALSE(s["issafe"].as<bool>());
+	TEST_ASSERT_EQUAL_UINT32(SAFEMON_POWER_BIT, s["inputs"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(sw->GetVersion(), v["v"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(sw->GetMaxSwitch(), v["values"].size());
+	TEST_ASSERT_EQUAL_DOUBLE(30.0, v["values"][17].as<double>());
+	TEST_ASSERT_EQUAL_DOUBLE(1.0, v["values"][9].as<double>());
+	check_order(c->events, seq + 1);
+
+	_safemon_inputs ^= SAFEMON_POWER_BIT;
+	dome.PutClose();
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(4, c->events.size());
+	TEST_ASSERT_EQUAL_STRING("dome", c->events[2].event.c_str());
+	TEST_ASSERT_EQUAL_STRING("safemon", c->events[3].event.c_str());
+	check_order(c->events, seq + 1);
+	c->close();
+}
+
+// a new client gets the full state, the others see it too, ids stay in order for everyone
+void test_second_client(void)
+{
+	AsyncEventSourceClient *a = connect();
+
+	loop_pass();
+	uint32_t first = a->events[0].id;
+	weather_write(-120);
+	loop_pass();
+
+	AsyncEventSourceClient *b = connect();
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(SRC_COUNT, b->events.size());
+	TEST_ASSERT_EQUAL_UINT32(2 * SRC_COUNT + 1, a->events.size());
+	check_order(a->events, first);
+	check_order(b->events, b->events[0].id);
+	TEST_ASSERT_EQUAL_UINT32(a->events.back().id, b->events.back().id);
+	a->close();
+	b->close();
+
+	uint32_t seq = event_push.GetSeq();
+	weather_write(-100);
+	loop_pass();
+	TEST_ASSERT_EQUAL_UINT32(seq, event_push.GetSeq());				// all gone: nothing rendered
+}
+
+typedef struct {
+	uint64_t sum_us;
+	uint64_t max_us;
+	uint32_t n;
+} Latency_t;
+
+static void add(Latency_t &l, uint64_t us)
+{
+	l.sum_us += us;
+	l.max_us = std::max(l.max_us, us);
+	l.n++;
+}
+
+typedef struct {
+	uint64_t t_us;					// when the change was made
+	uint64_t visible_us;			// when a GET would report it
+	uint8_t src;
+} Change_t;
+
+// random changes, a pass every SCHED_MAX_IDLE_MS, latency of the first event of the source after each
+void test_latency(void)
+{
+	uint32_t seconds = strtoul(env("PUSH_SECONDS", "3600"), NULL, 10);
+	uint32_t poll_ms = strtoul(env("PUSH_POLL_MS", "1000"), NULL, 10);
+	uint32_t net_us = strtoul(env("PUSH_NET_US", "4000"), NULL, 10);
+	uint32_t seed = 7, phase_us[SRC_COUNT];
+	std::vector<Change_t> changes;
+	Latency_t push[SRC_COUNT] = {}, poll[SRC_COUNT] = {}, push_all = {}, poll_all = {};
+	AsyncEventSourceClient *c = connect();
+
+	for(uint8_t s = 0; s < SRC_COUNT; s++) {
+		seed = seed * 1664525 + 1013904223;
+		phase_us[s] = ( seed >> 8 ) % ( poll_ms * 1000 );
+	}
+
+	uint64_t start = mock::now_us(), end = start + (uint64_t)seconds * 1000000;
+	uint64_t next_change = start, next_pass = start;
+	loop_pass();
+	c->events.clear();
+	size_t pending = 0;												// first change not seen by a pass
+	bool toggled = false;											// SAFEMON_POWER_BIT toggled since the last pass
+
+	while( mock::now_us() < end ) {
+		if( next_change < next_pass ) {
+			mock::virtual_us = next_change;
+			seed = seed * 1664525 + 1013904223;
+			uint8_t src = ( seed >> 12 ) % SRC_COUNT;
+			uint32_t before = version(src);
+
+			if( src == SRC_DOME )
+				( dome.GetShutter() == AlpacaShutterStatus_t::kOpen ) ? dome.PutClose() : dome.PutOpen();
+			else if( src == SRC_SWITCH )
+				sw->PutSetSwitchValue(16 + ( seed >> 16 ) % 4, ( seed >> 20 ) % 101);
+			else if(( src == SRC_SAFEMON ) && toggled )
+				src = SRC_COUNT;									// a second toggle before the pass would undo the first
+			else if( src == SRC_SAFEMON ) {
+				_safemon_inputs ^= SAFEMON_POWER_BIT;				// counted by SafetyMonitor::Loop()
+				toggled = true;
+			}
+			else
+				weather_write(-200 + ( seed >> 20 ) % 100);
+
+			if(( src == SRC_SAFEMON ) || (( src < SRC_COUNT ) && ( version(src) != before )))
+				changes.push_back({ next_change, ( src == SRC_SAFEMON ) ? UINT64_MAX : next_change, src });
+			next_change += 1000 + (uint64_t)( seed >> 8 ) % ( 2 * CHANGE_MEAN_MS * 1000 );
+		}
+		else {
+			mock::virtual_us = next_pass;
+			loop_pass();
+			for(; pending < changes.size(); pending++)
+				if( changes[pending].visible_us == UINT64_MAX )
+					changes[pending].visible_us = next_pass;
+			toggled = false;
+			next_pass += SCHED_MAX_IDLE_MS * 1000;
+		}
+	}
+	loop_pass();
+
+	std::vector<size_t> cursor(SRC_COUNT, 0);						// per source, first event not before a change
+	std::vector<std::vector<uint64_t>> sent(SRC_COUNT);
+	for(const auto &e : c->events)
+		for(uint8_t s = 0; s < SRC_COUNT; s++)
+			if( e.event == k_src[s] )
+				sent[s].push_back(e.t_us);
+
+	for(const Change_t &ch : changes) {
+		size_t &i = cursor[ch.src];
+		while(( i < sent[ch.src].size() ) && ( sent[ch.src][i] < ch.t_us ))
+			i++;
+		TEST_ASSERT_TRUE(i < sent[ch.src].size());					// every change reaches the client
+		uint64_t us = sent[ch.src][i] - ch.t_us + net_us;
+		add(push[ch.src], us);
+		add(push_all, us);
+
+		// polls leave the client at phase + k * period and reach the server net_us later
+		uint64_t period = poll_ms * 1000, base = start + phase_us[ch.src] + net_us;
+		uint64_t k = ( ch.visible_us <= base ) ? 0 : ( ch.visible_us - base + period - 1 ) / period;
+		us = base + k * period + net_us - ch.t_us;
+		add(poll[ch.src], us);
+		add(poll_all, us);
+	}
+	check_order(c->events, c->events[0].id);
+	c->close();
+
+	// cost of event_push.Loop() in a pass without changes
+	AsyncEventSourceClient *idle = connect();
+	event_push.Loop();
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < IDLE_PASSES; i++)
+		event_push.Loop();
+	auto t1 = std::chrono::steady_clock::now();
+	idle->close();
+
+	printf("{\"bench\":\"event_push\",\"seconds\":%u,\"changes\":%u,\"poll_ms\":%u,\"net_us\":%u,\"pass_ms\":%u,"
+		"\"push\":{\"messages_per_s\":%.2f,\"mean_ms\":%.2f,\"max_ms\":%.2f",
+		seconds, (unsigned)changes.size(), poll_ms, net_us, SCHED_MAX_IDLE_MS,
+		(double)c->events.size() / seconds, push_all.sum_us / 1000.0 / push_all.n, push_all.max_us / 1000.0);
+	for(uint8_t s = 0; s < SRC_COUNT; s++)
+		printf(",\"%s_mean_ms\":%.2f", k_src[s], push[s].n ? push[s].sum_us / 1000.0 / push[s].n : 0.0);
+	printf("},\"poll\":{\"requests_per_s\":%.2f,\"mean_ms\":%.2f,\"max_ms\":%.2f",
+		SRC_COUNT * 1000.0 / poll_ms, poll_all.sum_us / 1000.0 / poll_all.n, poll_all.max_us / 1000.0);
+	for(uint8_t s = 0; s < SRC_COUNT; s++)
+		printf(",\"%s_mean_ms\":%.2f", k_src[s], poll[s].n ? poll[s].sum_us / 1000.0 / poll[s].n : 0.0);
+	printf("},\"idle_loop_ns\":%.1f}\n", std::chrono::duration<double, std::nano>(t1 - t0).count() / IDLE_PASSES);
+
+	TEST_ASSERT_TRUE(push_all.n > 0);
+	TEST_ASSERT_TRUE(push_all.max_us <= (uint64_t)SCHED_MAX_IDLE_MS * 1000 + net_us);	// bounded by one pass
+	TEST_ASSERT_TRUE(push_all.sum_us < poll_all.sum_us);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_no_client);
+	RUN_TEST(test_connect_resync);
+	RUN_TEST(test_one_event_per_change);
+	RUN_TEST(test_second_client);
+	RUN_TEST(test_latency);
+	return UNITY_END();
+}
@@ -0,0 +1,322 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    limit switch fast poll of the I/O task, cycles stepped on the virtual clock as
+                  io_task() runs them, against a roll-off roof model behind the 165/595 chain: the
+                  motor runs while its relay is latched, the limit switch closes at the end of travel
+                  and bounces. Time from the switch to the relay off and overtravel of every move,
+                  with the adaptive rate and with cycles every 10 ms and every 100 ms as the loop()
+                  timers did, the relaylatency histogram against the model, the sampling rate back
+                  to idle at rest, as JSON on stdout.
+
+                  FAST_MOVES  moves of the roof per run, default 100
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <algorithm>
+#include <vector>
+
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+#define ROOF_TRAVEL_MM      1500.0
+#define ROOF_MM_S           100.0       // roof speed, the motor stops with its relay
+#define BOUNCE_US           1200        // limit switch chatter after it closes
+#define BOUNCE_SLOT_US      250
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+/**************************************************************************************************
+  roof model: two 74HC165 and two 74HC595 in series, roof position from the latched relays
+**************************************************************************************************/
+struct Chain_t {
+	uint16_t in_shift;				// 165 shift register, Q7 is the MSB
+	uint16_t out_shift;				// 595 shift register
+	uint16_t outputs;				// 595 storage register
+	bool outputs_enabled;
+};
+static Chain_t chain;
+
+struct Roof_t {
+	double pos_mm;					// 0 closed, ROOF_TRAVEL_MM open, beyond is overtravel
+	int8_t dir;						// motor: 1 opening, -1 closing
+	uint64_t t_us;					// time of pos_mm
+	uint64_t trip_us;				// limit switch of the current move closed
+	bool tripped;
+	std::vector<uint32_t> latency_us;	// switch closed to relay off, one per move
+	double max_overtravel_mm;
+};
+static Roof_t roof;
+
+static void roof_update(uint64_t now)
+{
+	double from = roof.pos_mm;
+
+	roof.pos_mm += roof.dir * ROOF_MM_S * (now - roof.t_us) / 1e6;
+	roof.t_us = now;
+	if( roof.tripped )
+		return;
+	if(( roof.dir > 0 ) && ( roof.pos_mm >= ROOF_TRAVEL_MM )) {
+		roof.trip_us = now - (uint64_t)(( roof.pos_mm - ROOF_TRAVEL_MM ) / ROOF_MM_S * 1e6);
+		roof.tripped = true;
+	}
+	if(( roof.dir < 0 ) && ( roof.pos_mm <= 0 ) && ( from > 0 )) {
+		roof.trip_us = now - (uint64_t)( -roof.pos_mm / ROOF_MM_S * 1e6);
+		roof.tripped = true;
+	}
+}
+
+// levels on the 165 parallel inputs, active low, the closing contact bounces
+static uint16_t roof_inputs(uint64_t now)
+{
+	uint16_t active = 0;
+	bool settled = !roof.tripped || ( now - roof.trip_us >= BOUNCE_US ) || ((( now - roof.trip_us ) / BOUNCE_SLOT_US ) % 2 == 0 );
+
+	if(( roof.pos_mm >= ROOF_TRAVEL_MM ) && ( settled || roof.dir <= 0 ))
+		active |= BIT_FC_OPEN;
+	if(( roof.pos_mm <= 0 ) && ( settled || roof.dir >= 0 ))
+		active |= BIT_FC_CLOSE;
+	return ~active;
+}
+
+static void chain_edge(uint8_t pin, uint8_t level)
+{
+	uint64_t now = mock::now_us();
+	int8_t dir;
+
+	roof_update(now);
+	switch( pin ) {
+	case SR_IN_PIN_PL:
+		if( level == LOW ) {					// asynchronous parallel load
+			chain.in_shift = roof_inputs(now);
+			mock::pin_hw(SR_IN_PIN_SDIN, ( chain.in_shift & 0x8000 ) ? HIGH : LOW);
+		}
+		break;
+	case SR_IN_PIN_CP:
+		if(( level == HIGH ) && ( mock::pin_level[SR_IN_PIN_CE] == LOW ) && ( mock::pin_level[SR_IN_PIN_PL] == HIGH )) {
+			chain.in_shift <<= 1;
+			mock::pin_hw(SR_IN_PIN_SDIN, ( chain.in_shift & 0x8000 ) ? HIGH : LOW);
+		}
+		break;
+	case SR_OUT_PIN_SHCP:
+		if( level == HIGH )
+			chain.out_shift = (chain.out_shift << 1) | mock::pin_level[SR_OUT_PIN_SDOUT];
+		break;
+	case SR_OUT_PIN_STCP:
+		if( level == HIGH )
+			chain.outputs = chain.out_shift;
+		break;
+	case SR_OUT_PIN_OE:
+		chain.outputs_enabled = ( level == LOW );
+		break;
+	}
+
+	dir = 0;
+	if( chain.outputs_enabled && ( chain.outputs & BIT_ROOF_OPEN ))
+		dir = 1;
+	if( chain.outputs_enabled && ( chain.outputs & BIT_ROOF_CLOSE ))
+		dir = -1;
+	if(( dir == 0 ) && ( roof.dir != 0 ) && roof.tripped ) {		// motor stopped by its limit switch
+		double over = ( roof.dir > 0 ) ? roof.pos_mm - ROOF_TRAVEL_MM : -roof.pos_mm;
+
+		roof.latency_us.push_back((uint32_t)( now - roof.trip_us ));
+		roof.max_overtravel_mm = std::max(roof.max_overtravel_mm, over);
+	}
+	roof.dir = dir;
+}
+
+/**************************************************************************************************
+  I/O task cycles on the virtual clock, cadence_ms 0: the period io_task() picks
+**************************************************************************************************/
+static uint64_t next_us;
+static IoOutputs_t outputs;
+
+static void cycle(uint32_t cadence_ms)
+{
+	uint64_t start = mock::now_us();
+	uint32_t period_us = ( cadence_ms ? cadence_ms : ( _fast ? IO_FAST_PERIOD_MS : IO_TASK_PERIOD_MS )) * 1000;
+
+	next_us += period_us;
+	if( start >= next_us )
+		next_us = start + period_us;
+	io_cycle(millis());
+	if( !cadence_ms && _fast && ( next_us - start > IO_FAST_PERIOD_MS * 1000 ))
+		next_us = start + IO_FAST_PERIOD_MS * 1000;
+}
+
+static void run_until(uint64_t end_us, uint32_t cadence_ms)
+{
+	while( next_us <= end_us ) {
+		if( mock::now_us() < next_us )
+			mock::virtual_us = next_us;
+		cycle(cadence_ms);
+	}
+	if( mock::now_us() < end_us )
+		mock::virtual_us = end_us;
+}
+
+// Dome asks for a relay and wakes the task, as loop() does after publishing the outputs
+static void command(bool open, bool close)
+{
+	outputs.relay_open = open;
+	outputs.relay_close = close;
+	io_outputs.Write(outputs);
+	io_cycle(millis());
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		mock::gpio_reset();
+		mock::pin_level[SR_IN_PIN_CE] = HIGH;		// idle levels set by init_IO()
+		mock::pin_level[SR_IN_PIN_PL] = HIGH;
+		mock::pin_level[SR_OUT_PIN_MR] = HIGH;
+		mock::pin_level[SR_OUT_PIN_OE] = HIGH;
+		mock::on_write = chain_edge;
+		mock::set_ms(1000);
+		roof.t_us = mock::now_us();
+
+		outputs.dome_connected = true;
+		io_outputs.Write(outputs);
+		io_init(millis());
+		next_us = mock::now_us();
+		run_until(mock::now_us() + 1000000, 0);		// roof closed, switch debounced
+		begun = true;
+	}
+}
+void tearDown(void) {}
+
+/**************************************************************************************************
+  moves
+**************************************************************************************************/
+typedef struct {
+	const char *name;
+	uint32_t cadence_ms;
+	uint32_t p50_us, p99_us, max_us;
+	double max_overtravel_mm;
+	uint32_t reads_moving, reads_rest;			// 165 transfers per second
+} Run_t;
+
+static void run_moves(Run_t &r, uint32_t moves)
+{
+	uint32_t seed = 7 + r.cadence_ms;
+	uint64_t moving_us = 0, rest_us = 0;
+	uint32_t reads_moving = 0, reads_rest = 0;
+
+	roof.latency_us.clear();
+	roof.max_overtravel_mm = 0;
+	io_latency_reset();
+	run_until(mock::now_us() + 100000, r.cadence_ms);
+
+	for(uint32_t i = 0; i < moves; i++) {
+		bool open = ( i % 2 == 0 );
+		uint64_t t0;
+		uint32_t reads;
+
+		seed = seed * 1664525 + 1013904223;
+		mock::advance_us(( seed >> 8 ) % 10000);				// anywhere in the cycle
+		roof.tripped = false;
+
+		t0 = mock::now_us();
+		reads = sr_bus.GetStats().reads;
+		command(open, !open);
+		TEST_ASSERT_TRUE(_fast);
+		run_until(t0 + (uint64_t)( ROOF_TRAVEL_MM / ROOF_MM_S * 1e6 ) + 500000, r.cadence_ms);
+		TEST_ASSERT_TRUE(roof.tripped);
+		TEST_ASSERT_EQUAL(0, roof.dir);
+		TEST_ASSERT_EQUAL_UINT32(i + 1, roof.latency_us.size());
+
+		const IoLatencyHist_t &h = io_latency_hist();				// from the raw edge the task sampled
+		uint32_t model = roof.latency_us.back();
+		TEST_ASSERT_EQUAL_UINT32(i + 1, h.count);
+		TEST_ASSERT_TRUE(h.last_us <= model);
+		TEST_ASSERT_TRUE(model - h.last_us <= ( r.cadence_ms ? r.cadence_ms : IO_FAST_PERIOD_MS ) * 1000 + BOUNCE_US);
+		moving_us += mock::now_us() - t0;
+		reads_moving += sr_bus.GetStats().reads - reads;
+
+		command(false, false);										// Dome sees the switch, move done
+		TEST_ASSERT_FALSE(_fast);
+		t0 = mock::now_us();
+		reads = sr_bus.GetStats().reads;
+		run_until(t0 + 1000000, r.cadence_ms);
+		rest_us += mock::now_us() - t0;
+		reads_rest += sr_bus.GetStats().reads - reads;
+	}
+
+	std::vector<uint32_t> lat = roof.latency_us;
+	std::sort(lat.begin(), lat.end());
+	r.p50_us = lat[lat.size() / 2];
+	r.p99_us = lat[std::min(lat.size() - 1, lat.size() * 99 / 100)];
+	r.max_us = lat.back();
+	r.max_overtravel_mm = roof.max_overtravel_mm;
+	r.reads_moving = (uint32_t)( reads_moving * 1e6 / moving_us + 0.5 );
+	r.reads_rest = (uint32_t)( reads_rest * 1e6 / rest_us + 0.5 );
+	TEST_ASSERT_TRUE(io_latency_hist().max_us <= r.max_us);
+}
+
+static void print_run(const Run_t &r, bool last)
+{
+	printf("\"%s\":{\"cadence_ms\":%u,\"p50_us\":%u,\"p99_us\":%u,\"max_us\":%u,\"max_overtravel_mm\":%.1f,"
+		"\"samples_per_s\":{\"moving\":%u,\"rest\":%u}}%s", r.name, r.cadence_ms, r.p50_us, r.p99_us, r.max_us,
+		r.max_overtravel_mm, r.reads_moving, r.reads_rest, last ? "" : ",");
+}
+
+void test_fast_poll(void)
+{
+	uint32_t moves = atoi(env("FAST_MOVES", "100"));
+	Run_t runs[3] = { { "adaptive", 0 }, { "io_10ms", IO_TASK_PERIOD_MS }, { "loop_100ms", 100 } };
+	IoLatencyHist_t hist;
+	uint32_t fast_cycles = io_task_stats().fast_cycles;
+
+	TEST_ASSERT_TRUE(( IO_FAST_PERIOD_MS >= 1 ) && ( IO_FAST_PERIOD_MS <= 5 ));
+	TEST_ASSERT_FALSE(_fast);											// roof at rest
+	TEST_ASSERT_EQUAL_UINT32(0, fast_cycles);
+
+	run_moves(runs[0], moves);
+	hist = io_latency_hist();
+	TEST_ASSERT_TRUE(io_task_stats().fast_cycles > fast_cycles);
+	run_moves(runs[1], moves);
+	run_moves(runs[2], moves);
+
+	printf("{\"bench\":\"fast_poll\",\"moves\":%u,\"roof_mm_s\":%.0f,\"fast_period_ms\":%u,\"debounce_fc\":%u,",
+		moves, ROOF_MM_S, IO_FAST_PERIOD_MS, DEBOUNCE_FC);
+	for(uint32_t i = 0; i < 3; i++)
+		print_run(runs[i], false);
+	printf("\"relaylatency\":{\"count\":%u,\"max_us\":%u,\"buckets\":[", hist.count, hist.max_us);
+	for(uint32_t i = 0; i < IO_LAT_BUCKETS; i++)
+		printf("%u%s", hist.bucket[i], ( i + 1 < IO_LAT_BUCKETS ) ? "," : "");
+	printf("]}}\n");
+
+	// switch seen within DEBOUNCE_FC fast samples, relay latched in the same cycle
+	TEST_ASSERT_TRUE(runs[0].max_us <= ( DEBOUNCE_FC + 1 ) * IO_FAST_PERIOD_MS * 1000 + BOUNCE_US);
+	TEST_ASSERT_TRUE(runs[0].max_us < runs[1].max_us);
+	TEST_ASSERT_TRUE(runs[1].max_us < runs[2].max_us);
+	TEST_ASSERT_EQUAL_UINT32(1000 / IO_FAST_PERIOD_MS, runs[0].reads_moving);
+	TEST_ASSERT_UINT32_WITHIN(2, 1000 / DEBOUNCE_PERIOD_MS, runs[0].reads_rest);	// back to the idle rate
+	TEST_ASSERT_EQUAL_UINT32(0, mock::log_errors);
+}
+
+void test_latency_reset(void)
+{
+	TEST_ASSERT_TRUE(io_latency_hist().count > 0);
+	io_latency_reset();
+	TEST_ASSERT_TRUE(io_latency_hist().count > 0);						// cleared by the task
+	run_until(mock::now_us() + 100000, 0);
+	TEST_ASSERT_EQUAL_UINT32(0, io_latency_hist().count);
+	TEST_ASSERT_EQUAL_UINT32(0, io_latency_hist().max_us);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_fast_poll);
+	RUN_TEST(test_latency_reset);
+	return UNITY_END();
+}
@@ -0,0 +1,156 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    I/O task on std::thread with the host clock while the HTTP side is saturated:
+                  a loop() thread and an async_tcp thread serve requests of 1~30ms of JSON work
+                  and publish outputs through the snapshots. Compares the control cycle jitter of
+                  the task with the lateness of the same period polled inline in loop(), as before
+                  the task existed, and reports both as JSON on stdout. The jitter bound is checked
+                  when the host has a core for the task, as IO_TASK_CORE on the ESP32.
+
+                  IO_BENCH_MS     duration of each run, default 3000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static std::atomic<bool> http_run;
+static std::atomic<uint32_t> http_requests;
+static std::atomic<uint32_t> input_reads, input_regressions;
+
+// one request: a JSON document built and serialised until ms milliseconds have passed
+static void http_request(uint32_t ms, uint32_t id)
+{
+	uint32_t end = millis() + ms;
+	String body;
+
+	do {
+		JsonDocument doc;
+		JsonArray values = doc["Value"].to<JsonArray>();
+		for(uint32_t i = 0; i < 16; i++)
+			values.add(id * 16 + i);
+		doc["ClientTransactionID"] = id;
+		body = String();
+		serializeJson(doc, body);
+	} while( (int32_t)(millis() - end) < 0 );
+	http_requests++;
+}
+
+// loop(): requests, then outputs published and inputs read as main.cpp does once per pass
+static void loop_thread()
+{
+	uint32_t seed = 1, id = 0, last_cycles = 0;
+	IoOutputs_t out = {};
+	IoInputs_t in;
+
+	out.dome_connected = out.switch_connected = out.safemon_connected = true;
+	while( http_run ) {
+		seed = seed * 1664525 + 1013904223;
+		http_request(1 + (seed >> 8) % 30, id++);
+
+		out.sw_out = id;
+		out.sw_pwm[id & 3] = id % 101;
+		io_outputs.Write(out);
+		io_task_wake();
+
+		io_inputs.Read(in);
+		input_reads++;
+		if( in.cycles < last_cycles )
+			input_regressions++;
+		last_cycles = in.cycles;
+	}
+}
+
+static void async_tcp_thread()
+{
+	uint32_t seed = 2, id = 0;
+
+	while( http_run ) {
+		seed = seed * 1664525 + 1013904223;
+		http_request(1 + (seed >> 8) % 30, id++);
+	}
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_jitter_under_http_load(void)
+{
+	uint32_t duration_ms = strtoul(env("IO_BENCH_MS", "3000"), NULL, 10);
+	uint32_t expected = duration_ms / IO_TASK_PERIOD_MS;
+	uint32_t cores = std::thread::hardware_concurrency();
+	uint32_t inline_max_late_us = 0, inline_cycles = 0;
+	uint64_t inline_late_sum = 0;
+	IoOutputs_t out = {};
+
+	mock::real_clock = true;
+	mock::pin_level[SR_IN_PIN_SDIN] = HIGH;					// 165 inputs read back inactive
+	out.dome_connected = out.switch_connected = out.safemon_connected = true;
+	io_outputs.Write(out);
+
+	// after: I/O in its own task, loop() and async_tcp busy with requests
+	io_task_begin();
+	http_run = true;
+	std::thread loop(loop_thread);
+	std::thread tcp(async_tcp_thread);
+	delay(duration_ms);
+	IoTaskStats_t task = io_task_stats();
+	uint32_t task_requests = http_requests;
+	http_run = false;
+	loop.join();
+	tcp.join();
+
+	// before: the same period polled in loop() between requests
+	uint32_t seed = 1, id = 0;
+	uint32_t start = micros(), next_us = start;
+	while( micros() - start < duration_ms * 1000 ) {
+		int32_t late = (int32_t)(micros() - next_us);
+		if( late >= 0 ) {
+			inline_cycles++;
+			inline_late_sum += late;
+			if( (uint32_t)late > inline_max_late_us )
+				inline_max_late_us = late;
+			next_us += IO_TASK_PERIOD_MS * 1000;
+			if( (int32_t)(micros() - next_us) >= 0 )
+				next_us = micros() + IO_TASK_PERIOD_MS * 1000;
+		}
+		seed = seed * 1664525 + 1013904223;
+		http_request(1 + (seed >> 8) % 30, id++);
+	}
+
+	printf("{\"bench\":\"io_task\",\"host_cores\":%u,\"duration_ms\":%u,\"period_ms\":%u,\"task\":{\"cycles\":%u,\"max_jitter_us\":%u,\"max_exec_us\":%u,"
+		"\"requests\":%u},\"inline\":{\"cycles\":%u,\"mean_late_us\":%.0f,\"max_late_us\":%u},\"input_reads\":%u}\n",
+		cores, duration_ms, IO_TASK_PERIOD_MS, task.cycles, task.max_jitter_us, task.max_exec_us, task_requests, inline_cycles,
+		inline_cycles ? (double)inline_late_sum / inline_cycles : 0.0, inline_max_late_us, input_reads.load());
+
+	TEST_ASSERT_TRUE(task.cycles >= expected * 8 / 10);					// wake ups from loop() add cycles
+	TEST_ASSERT_TRUE(inline_max_late_us > task.max_jitter_us);
+	if( cores >= 3 ) {													// a core for the task as on the ESP32
+		TEST_ASSERT_TRUE(task.max_jitter_us < IO_TASK_PERIOD_MS * 1000);	// never a missed period
+	}
+	TEST_ASSERT_TRUE(inline_cycles < expected * 8 / 10);				// requests longer than the period skip cycles
+	TEST_ASSERT_EQUAL_UINT32(0, input_regressions);
+	TEST_ASSERT_EQUAL_UINT32(0, mock::log_errors);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_jitter_under_http_load);
+	int failures = UNITY_END();
+	fflush(stdout);
+	_exit(failures);											// the I/O task never returns
+}
@@ -0,0 +1,225 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    PwmOutput on the LEDC mock: configurations the timer cannot run, duty of every
+                  percent against the linear and CIE 1976 formulas in double for several resolutions,
+                  hardware ramps that never block loop() nor overlap. Then a run of set point changes
+                  on the virtual clock against a ramp stepped from loop() and a blocking hardware fade,
+                  as loop() time and LEDC calls in JSON on stdout.
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+
+#include "PwmOutput.cpp"
+
+#define BENCH_SECONDS       60
+#define BENCH_FADE_MS       400
+#define STEP_PERIOD_MS      10          // ramp stepped from loop()
+#define LEDC_CALL_US        2           // modelled cost of one driver call on the ESP32
+
+static const PwmChannelConfig_t k_cfg[PWM_MAX_CHANNELS] = {
+	{ 25, 1000, 8, PWM_CURVE_LINEAR, 0 },		// dew heater as before
+	{ 26, 25000, 10, PWM_CURVE_LINEAR, 0 },		// inaudible heater
+	{ 27, 5000, 12, PWM_CURVE_CIE, 0 },			// flat panel
+	{ 14, 1000, 16, PWM_CURVE_CIE, 0 },
+};
+
+static double ref_linear(uint32_t p) { return p / 100.0; }
+static double ref_cie(uint32_t p) { return ( p <= 8 ) ? p / 903.3 : pow(( p + 16 ) / 116.0, 3); }
+
+void setUp(void)
+{
+	mock::ledc_reset();
+	mock::real_clock = false;
+	mock::virtual_us = 0;
+	mock::log_errors = 0;
+}
+void tearDown(void) {}
+
+void test_begin(void)
+{
+	PwmOutput pwm;
+	PwmChannelConfig_t bad = { 25, 40000, 12, PWM_CURVE_LINEAR, 0 };		// 40kHz << 12 > 80MHz
+
+	TEST_ASSERT_FALSE(pwm.Begin(&bad, 1));
+	TEST_ASSERT_EQUAL_UINT32(1, mock::log_errors);
+	TEST_ASSERT_TRUE(pwm.Begin(k_cfg, PWM_MAX_CHANNELS));
+	TEST_ASSERT_TRUE(mock::ledc_fade_installed);
+	for(uint8_t ch = 0; ch < PWM_MAX_CHANNELS; ch++) {
+		TEST_ASSERT_EQUAL_UINT8(k_cfg[ch].bits, mock::ledc_timer_bits[ch]);
+		TEST_ASSERT_EQUAL_UINT32(k_cfg[ch].freq_hz, mock::ledc_timer_freq[ch]);
+		TEST_ASSERT_EQUAL(k_cfg[ch].pin, mock::ledc_channel[ch].gpio);
+		TEST_ASSERT_EQUAL_UINT32(0, pwm.GetDuty(ch));
+	}
+}
+
+// every percent within one LSB of the formula, monotonic, 100% always on
+void test_duty_accuracy(void)
+{
+	PwmOutput pwm;
+
+	TEST_ASSERT_TRUE(pwm.Begin(k_cfg, PWM_MAX_CHANNELS));
+	for(uint8_t ch = 0; ch < PWM_MAX_CHANNELS; ch++) {
+		uint32_t max = pwm.GetMaxDuty(ch), prev = 0;
+		double worst = 0;
+
+		for(uint32_t p = 0; p <= 100; p++) {
+			pwm.Set(ch, p);
+			pwm.Update(millis());
+			uint32_t duty = pwm.GetDuty(ch);
+			double ref = ( k_cfg[ch].curve == PWM_CURVE_CIE ? ref_cie(p) : ref_linear(p) ) * max;
+
+			worst = std::max(worst, fabs(duty - ref));
+			TEST_ASSERT_TRUE(fabs(duty - ref) <= 1.0);
+			TEST_ASSERT_TRUE(duty >= prev);
+			prev = duty;
+		}
+		TEST_ASSERT_EQUAL_UINT32(max, prev);
+		printf("{\"bench\":\"pwm_duty\",\"channel\":%u,\"bits\":%u,\"curve\":\"%s\",\"max_error_lsb\":%.3f}\n",
+			ch, k_cfg[ch].bits, k_cfg[ch].curve == PWM_CURVE_CIE ? "cie" : "linear", worst);
+	}
+	pwm.Set(0, 150);														// clamped
+	pwm.Update(millis());
+	TEST_ASSERT_EQUAL_UINT32(256, pwm.GetDuty(0));
+}
+
+void test_ramp_never_blocks(void)
+{
+	PwmChannelConfig_t cfg = { 27, 5000, 12, PWM_CURVE_LINEAR, 500 };
+	PwmOutput pwm;
+
+	TEST_ASSERT_TRUE(pwm.Begin(&cfg, 1));
+	mock::set_ms(1000);
+	pwm.Set(0, 100);
+	pwm.Update(millis());
+	TEST_ASSERT_EQUAL_UINT32(1000, millis());								// loop() goes on at once
+	TEST_ASSERT_EQUAL_UINT32(1, mock::ledc_fades);
+	mock::advance_us(250000);
+	TEST_ASSERT_UINT32_WITHIN(1, 2048, pwm.GetDuty(0));						// half way, by the hardware
+
+	pwm.Set(0, 20);															// while the ramp runs: waits for its end
+	uint32_t calls = mock::ledc_calls;
+	for(uint32_t t = 0; t < 250; t++) {
+		pwm.Update(millis());
+		mock::advance_us(1000);
+	}
+	TEST_ASSERT_EQUAL_UINT32(calls, mock::ledc_calls);
+	TEST_ASSERT_EQUAL_UINT32(4096, pwm.GetDuty(0));
+	mock::advance_us(1000);
+	pwm.Update(millis());
+	TEST_ASSERT_EQUAL_UINT32(2, mock::ledc_fades);
+	mock::advance_us(500000);
+	TEST_ASSERT_EQUAL_UINT32(819, pwm.GetDuty(0));
+
+	calls = mock::ledc_calls;
+	pwm.Update(millis());													// nothing pending: no driver call
+	TEST_ASSERT_EQUAL_UINT32(calls, mock::ledc_calls);
+	TEST_ASSERT_EQUAL_UINT32(0, mock::ledc_fade_overlaps);
+	TEST_ASSERT_TRUE(mock::ledc_wait_us == 0);
+}
+
+typedef struct {
+	uint64_t loop_us;							// loop() time spent on the PWM, modelled
+	uint32_t ledc_calls;
+	uint32_t overlaps;
+	uint32_t changes;
+} Bench_t;
+
+enum { BENCH_PWMOUTPUT = 0, BENCH_STEPPED, BENCH_BLOCKING };
+
+// set point changes of a dew heater and a flat panel every 0.2~1.2s, loop() every ms
+static Bench_t bench(uint8_t mode)
+{
+	PwmChannelConfig_t cfg[2] = { { 25, 1000, 10, PWM_CURVE_LINEAR, BENCH_FADE_MS }, { 26, 5000, 12, PWM_CURVE_CIE, BENCH_FADE_MS } };
+	PwmOutput pwm;
+	uint32_t seed = 1, next_change = 0, step_duty[2] = {0}, step_target[2] = {0}, step_ms = 0;
+	Bench_t b = {};
+
+	mock::ledc_reset();
+	mock::virtual_us = 0;
+	pwm.Begin(cfg, 2);
+	mock::ledc_calls = 0;
+	while( millis() < BENCH_SECONDS * 1000 ) {
+		uint64_t t0 = mock::now_us();
+		uint32_t calls = mock::ledc_calls;
+
+		if( (int32_t)(millis() - next_change) >= 0 ) {
+			seed = seed * 1664525 + 1013904223;
+			uint8_t ch = ( seed >> 8 ) & 1, p = ( seed >> 12 ) % 101;
+			next_change = millis() + 200 + ( seed >> 20 ) % 1000;
+			b.changes++;
+
+			if( mode == BENCH_PWMOUTPUT )
+				pwm.Set(ch, p);
+			else if( mode == BENCH_STEPPED )
+				step_target[ch] = (uint32_t)((uint64_t)p * ( 1 << cfg[ch].bits ) / 100);
+			else {
+				ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch, (uint32_t)((uint64_t)p * ( 1 << cfg[ch].bits ) / 100), BENCH_FADE_MS);
+				ledc_fade_start(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch, LEDC_FADE_WAIT_DONE);
+			}
+		}
+
+		if( mode == BENCH_PWMOUTPUT )
+			pwm.Update(millis());
+		else if(( mode == BENCH_STEPPED ) && ( millis() - step_ms >= STEP_PERIOD_MS )) {
+			step_ms = millis();
+			for(uint8_t ch = 0; ch < 2; ch++) {
+				if( step_duty[ch] == step_target[ch] )
+					continue;
+				uint32_t step = ( 1 << cfg[ch].bits ) * STEP_PERIOD_MS / BENCH_FADE_MS;
+				step_duty[ch] = ( step_duty[ch] < step_target[ch] ) ? std::min(step_target[ch], step_duty[ch] + step)
+																	: std::max(step_target[ch], step_duty[ch] - std::min(step, step_duty[ch]));
+				ledc_set_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch, step_duty[ch]);
+				ledc_update_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ch);
+			}
+		}
+
+		b.loop_us += ( mock::now_us() - t0 ) + ( mock::ledc_calls - calls ) * LEDC_CALL_US;
+		mock::advance_us(1000);
+	}
+	b.ledc_calls = mock::ledc_calls;
+	b.overlaps = mock::ledc_fade_overlaps;
+	return b;
+}
+
+void test_benchmark(void)
+{
+	Bench_t engine = bench(BENCH_PWMOUTPUT);
+	Bench_t stepped = bench(BENCH_STEPPED);
+	Bench_t blocking = bench(BENCH_BLOCKING);
+	PwmOutput pwm;
+	volatile uint32_t sink = 0;
+
+	pwm.Begin(k_cfg, PWM_MAX_CHANNELS);
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < 10000000; i++)
+		pwm.Update(i);
+	auto t1 = std::chrono::steady_clock::now();
+	sink = sink + pwm.GetDuty(0);
+
+	printf("{\"bench\":\"pwm_output\",\"seconds\":%u,\"fade_ms\":%u,\"changes\":%u,"
+		"\"pwmoutput\":{\"loop_us\":%llu,\"ledc_calls\":%u,\"overlaps\":%u},"
+		"\"stepped\":{\"loop_us\":%llu,\"ledc_calls\":%u},"
+		"\"blocking\":{\"loop_us\":%llu,\"ledc_calls\":%u,\"overlaps\":%u},\"idle_update_ns\":%.2f}\n",
+		BENCH_SECONDS, BENCH_FADE_MS, engine.changes, (unsigned long long)engine.loop_us, engine.ledc_calls, engine.overlaps,
+		(unsigned long long)stepped.loop_us, stepped.ledc_calls, (unsigned long long)blocking.loop_us, blocking.ledc_calls, blocking.overlaps,
+		std::chrono::duration<double, std::nano>(t1 - t0).count() / 10000000);
+
+	TEST_ASSERT_EQUAL_UINT32(0, engine.overlaps);
+	TEST_ASSERT_TRUE(engine.ledc_calls <= engine.changes * 2);			// one fade per change at most
+	TEST_ASSERT_TRUE(engine.loop_us < stepped.loop_us);
+	TEST_ASSERT_TRUE(blocking.loop_us >= (uint64_t)blocking.changes * BENCH_FADE_MS * 1000);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_begin);
+	RUN_TEST(test_duty_accuracy);
+	RUN_TEST(test_ramp_never_blocks);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,254 @@
+/**************************************************************************************************
+  Filename:       standin_alpaca.h
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    stand-ins of the Dome, Switch and SafetyMonitor devices and of the Alpaca library
+                  handlers for the replay harness. Device state follows the firmware (shutter travel,
+                  20 switch channels, version counters), library handlers build and serialise a
+                  JsonDocument per request as ESP32_Alpaca_Server does.
+**************************************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include "AlpacaActions.h"
+
+#define STANDIN_TRAVEL_MS       8000        // shutter travel time
+#define STANDIN_SWITCHES        20          // as init_switch_device[]
+#define STANDIN_UNSAFE_FROM_MS  15000       // issafe false in [from, to) of every replay pass
+#define STANDIN_UNSAFE_TO_MS    20000
+
+enum { STANDIN_OPEN = 0, STANDIN_CLOSED, STANDIN_OPENING, STANDIN_CLOSING, STANDIN_ERROR };
+
+struct StandinDevice
+{
+	const char *type;
+	uint32_t clients = 0;				// connected clients
+	uint32_t version = 1;				// incremented on every state change, as the devices do
+
+	StandinDevice(const char *t) : type(t) {}
+	void Changed() { version++; }
+	uint32_t GetNumberOfConnectedClients() { return clients; }
+	uint32_t GetVersion() { return version; }
+};
+
+struct StandinDome : StandinDevice
+{
+	int shutter = STANDIN_CLOSED;
+	bool slewing = false;
+	uint32_t travel_end = 0;
+
+	StandinDome() : StandinDevice("dome") {}
+	void Move(int to, uint32_t now)
+	{
+		shutter = to;
+		slewing = true;
+		travel_end = now + STANDIN_TRAVEL_MS;
+		Changed();
+	}
+	void Abort()
+	{
+		if( slewing ) {
+			shutter = STANDIN_ERROR;
+			slewing = false;
+			Changed();
+		}
+	}
+	void Loop(uint32_t now)
+	{
+		if( slewing && (int32_t)(now - travel_end) >= 0 ) {
+			shutter = ( shutter == STANDIN_OPENING ) ? STANDIN_OPEN : STANDIN_CLOSED;
+			slewing = false;
+			Changed();
+		}
+	}
+};
+
+struct StandinSwitch : StandinDevice
+{
+	double value[STANDIN_SWITCHES] = {0};
+
+	StandinSwitch() : StandinDevice("switch") {}
+	static bool CanWrite(uint32_t id) { return id >= 8; }
+	static double MaxValue(uint32_t id) { return id >= 16 ? 100.0 : 1.0; }
+	bool Set(uint32_t id, double v)
+	{
+		if(( id >= STANDIN_SWITCHES ) || !CanWrite(id) || ( v < 0.0 ) || ( v > MaxValue(id) ))
+			return false;
+		if( value[id] != v ) {
+			value[id] = v;
+			Changed();
+		}
+		return true;
+	}
+};
+
+struct StandinSafetyMonitor : StandinDevice
+{
+	bool safe = true;
+
+	StandinSafetyMonitor() : StandinDevice("safetymonitor") {}
+	void Loop(uint32_t t_pass)		// ms since the start of the replay pass
+	{
+		bool s = ( t_pass < STANDIN_UNSAFE_FROM_MS ) || ( t_pass >= STANDIN_UNSAFE_TO_MS );
+		if( s != safe ) {
+			safe = s;
+			Changed();
+		}
+	}
+	bool IsSafe() { return safe; }
+};
+
+// Alpaca library stand-in: one handler per endpoint, registered after the firmware's own handlers
+class StandinAlpacaServer
+{
+private:
+	uint32_t _transaction = 0;
+	StandinDome &_dome;
+	StandinSwitch &_switch;
+	StandinSafetyMonitor &_safemon;
+
+	template <typename T>
+	void _send(AsyncWebServerRequest *request, T value, int32_t error = 0, const char *message = "")
+	{
+		JsonDocument doc;
+		String body;
+
+		doc["Value"] = value;
+		doc["ClientTransactionID"] = (uint32_t)AlpacaActions::GetParam(request, "ClientTransactionID").toInt();
+		doc["ServerTransactionID"] = NextTransactionID();
+		doc["ErrorNumber"] = error;
+		doc["ErrorMessage"] = message;
+		serializeJson(doc, body);
+		request->send(200, "application/json", body);
+	}
+
+	void _sendVoid(AsyncWebServerRequest *request, int32_t error = 0, const char *message = "")
+	{
+		JsonDocument doc;
+		String body;
+
+		doc["ClientTransactionID"] = (uint32_t)AlpacaActions::GetParam(request, "ClientTransactionID").toInt();
+		doc["ServerTransactionID"] = NextTransactionID();
+		doc["ErrorNumber"] = error;
+		doc["ErrorMessage"] = message;
+		serializeJson(doc, body);
+		request->send(200, "application/json", body);
+	}
+
+	// Id parameter of a switch request, false and an error sent if missing or out of range
+	bool _switchId(AsyncWebServerRequest *request, uint32_t &id)
+	{
+		String s = AlpacaActions::GetParam(request, "Id");
+
+		if( s.isEmpty() ) {
+			request->send(400, "text/plain", "Missing parameter Id");
+			return false;
+		}
+		id = s.toInt();
+		if( id >= STANDIN_SWITCHES ) {
+			_sendVoid(request, ALPACA_ERR_INVALID_VALUE, "Invalid Id");
+			return false;
+		}
+		return true;
+	}
+
+	void _on(AsyncWebServer *server, StandinDevice &device, const char *method, WebRequestMethodComposite type,
+			 std::function<void(AsyncWebServerRequest *)> handler, bool needs_connection = true)
+	{
+		String url = String("/api/v1/") + device.type + "/0/" + method;
+		StandinDevice *d = &device;
+
+		server->on(url.c_str(), type, [this, d, handler, needs_connection](AsyncWebServerRequest *request) {
+			if( needs_connection && ( d->clients == 0 ))
+				_sendVoid(request, ALPACA_ERR_NOT_CONNECTED, "Not connected");
+			else
+				handler(request);
+		});
+	}
+
+	void _registerCommon(AsyncWebServer *server, StandinDevice &device)
+	{
+		StandinDevice *d = &device;
+
+		_on(server, device, "connected", HTTP_GET, [this, d](AsyncWebServerRequest *request) { _send(request, d->clients > 0); }, false);
+		_on(server, device, "connected", HTTP_PUT, [this, d](AsyncWebServerRequest *request) {
+			String v = AlpacaActions::GetParam(request, "Connected");
+			if( v.equalsIgnoreCase("true") )
+				d->clients++;
+			else if( v.equalsIgnoreCase("false") && ( d->clients > 0 ))
+				d->clients--;
+			else if( !v.equalsIgnoreCase("false") ) {
+				request->send(400, "text/plain", "Invalid Connected");
+				return;
+			}
+			_sendVoid(request);
+		}, false);
+		_on(server, device, "name", HTTP_GET, [this, d](AsyncWebServerRequest *request) { _send(request, d->type); }, false);
+		_on(server, device, "interfaceversion", HTTP_GET, [this](AsyncWebServerRequest *request) { _send(request, 1); }, false);
+		_on(server, device, "driverversion", HTTP_GET, [this](AsyncWebServerRequest *request) { _send(request, "1.0"); }, false);
+	}
+
+public:
+	uint32_t now = 0;					// ms, set by the replay before each request
+
+	StandinAlpacaServer(StandinDome &dome, StandinSwitch &sw, StandinSafetyMonitor &safemon)
+		: _dome(dome), _switch(sw), _safemon(safemon) {}
+
+	uint32_t NextTransactionID() { return ++_transaction; }
+
+	void RegisterCallbacks(AsyncWebServer *server)
+	{
+		_registerCommon(server, _dome);
+		_on(server, _dome, "shutterstatus", HTTP_GET, [this](AsyncWebServerRequest *request) { _send(request, _dome.shutter); });
+		_on(server, _dome, "slewing", HTTP_GET, [this](AsyncWebServerRequest *request) { _send(request, _dome.slewing); });
+		_on(server, _dome, "openshutter", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+			if( _dome.shutter != STANDIN_OPEN ) _dome.Move(STANDIN_OPENING, now);
+			_sendVoid(request);
+		});
+		_on(server, _dome, "closeshutter", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+			if( _dome.shutter != STANDIN_CLOSED ) _dome.Move(STANDIN_CLOSING, now);
+			_sendVoid(request);
+		});
+		_on(server, _dome, "abortslew", HTTP_PUT, [this](AsyncWebServerRequest *request) { _dome.Abort(); _sendVoid(request); });
+
+		_registerCommon(server, _switch);
+		_on(server, _switch, "maxswitch", HTTP_GET, [this](AsyncWebServerRequest *request) { _send(request, STANDIN_SWITCHES); });
+		_on(server, _switch, "getswitchvalue", HTTP_GET, [this](AsyncWebServerRequest *request) {
+			uint32_t id;
+			if( _switchId(request, id) ) _send(request, _switch.value[id]);
+		});
+		_on(server, _switch, "getswitch", HTTP_GET, [this](AsyncWebServerRequest *request) {
+			uint32_t id;
+			if( _switchId(request, id) ) _send(request, _switch.value[id] != 0.0);
+		});
+		_on(server, _switch, "getswitchname", HTTP_GET, [this](AsyncWebServerRequest *request) {
+			uint32_t id;
+			if( _switchId(request, id) ) _send<String>(request, String("Switch_") + String(id));
+		});
+		_on(server, _switch, "canwrite", HTTP_GET, [this](AsyncWebServerRequest *request) {
+			uint32_t id;
+			if( _switchId(request, id) ) _send(request, StandinSwitch::CanWrite(id));
+		});
+		_on(server, _switch, "setswitchvalue", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+			uint32_t id;
+			if( !_switchId(request, id) ) return;
+			if( _switch.Set(id, AlpacaActions::GetParam(request, "Value").toDouble()) )
+				_sendVoid(request);
+			else
+				_sendVoid(request, ALPACA_ERR_INVALID_VALUE, "Invalid Value");
+		});
+		_on(server, _switch, "setswitch", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+			uint32_t id;
+			if( !_switchId(request, id) ) return;
+			if( _switch.Set(id, AlpacaActions::GetParam(request, "State").equalsIgnoreCase("true") ? StandinSwitch::MaxValue(id) : 0.0) )
+				_sendVoid(request);
+			else
+				_sendVoid(request, ALPACA_ERR_INVALID_OP, "Read only switch");
+		});
+
+		_registerCommon(server, _safemon);
+		_on(server, _safemon, "issafe", HTTP_GET, [this](AsyncWebServerRequest *request) { _send(request, _safemon.IsSafe()); });
+	}
+};
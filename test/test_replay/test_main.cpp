@@ -0,0 +1,344 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Alpaca traffic replay harness: replays a recorded client polling trace against the
+                  stand-in devices behind the stand-in HTTP front end, with the firmware's
+                  ResponseCache, AlpacaActions and RequestStats in the request path.
+                  Reports throughput, p50/p99/p999 latency and heap high-water mark per endpoint
+                  as JSON on stdout, and in $REPLAY_OUT when set.
+
+                  REPLAY_TRACE    trace file, default test/test_replay/nina_trace.csv
+                  REPLAY_REPEAT   passes over the trace, default 5
+                  REPLAY_CACHE    0: without the response cache, default 1
+                  REPLAY_OUT      JSON result file
+
+                  trace lines: t_ms,client,method,url,params  params as k=v&k=v, # comments
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "AlpacaActions.cpp"
+#include "ResponseCache.cpp"
+#include "RequestStats.cpp"
+#include "standin_alpaca.h"
+
+/**************************************************************************************************
+  heap: malloc and free interposed on glibc, in use and high-water mark in bytes
+**************************************************************************************************/
+static std::atomic<int64_t> req_peak{0};
+
+static void heap_count(int64_t n)
+{
+	int64_t v = mock::heap_in_use += n;
+	int64_t p = mock::heap_peak.load();
+
+	while(( v > p ) && !mock::heap_peak.compare_exchange_weak(p, v)) {}
+	p = req_peak.load();
+	while(( v > p ) && !req_peak.compare_exchange_weak(p, v)) {}
+}
+
+#if defined(__GLIBC__)
+#define HEAP_TRACKING   true
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size)
+{
+	void *p = __libc_malloc(size);
+	if( p ) heap_count(malloc_usable_size(p));
+	return p;
+}
+
+void *calloc(size_t n, size_t size)
+{
+	void *p = __libc_calloc(n, size);
+	if( p ) heap_count(malloc_usable_size(p));
+	return p;
+}
+
+void *realloc(void *p, size_t size)
+{
+	int64_t before = p ? malloc_usable_size(p) : 0;
+	void *q = __libc_realloc(p, size);
+	if( q ) heap_count((int64_t)malloc_usable_size(q) - before);
+	else if( size == 0 ) heap_count(-before);
+	return q;
+}
+
+void free(void *p)
+{
+	if( p ) heap_count(-(int64_t)malloc_usable_size(p));
+	__libc_free(p);
+}
+}
+#else
+#define HEAP_TRACKING   false
+#endif
+
+/**************************************************************************************************
+  trace and results
+**************************************************************************************************/
+typedef struct {
+	uint32_t t_ms;
+	uint32_t client;
+	WebRequestMethodComposite method;
+	std::string url;
+	std::vector<std::pair<std::string, std::string>> params;
+} TraceLine_t;
+
+typedef struct {
+	std::vector<uint32_t> ns;			// service time of every request
+	uint64_t total_ns = 0;
+	int64_t heap_peak = 0;				// bytes above the heap in use at the start of a request
+	uint32_t errors = 0;				// HTTP status other than 200 or ErrorNumber != 0
+	uint32_t bytes_out = 0;
+} Endpoint_t;
+
+static std::vector<TraceLine_t> trace;
+static std::map<std::string, Endpoint_t> endpoints;
+static std::map<uint32_t, uint32_t> clients;
+static uint64_t replay_ns;
+static uint32_t trace_ms;
+static const char *trace_file;
+
+static const char *env(const char *name, const char *fallback)
+{
+	const char *v = getenv(name);
+	return ( v && *v ) ? v : fallback;
+}
+
+static bool load_trace(const char *file)
+{
+	std::ifstream in(file);
+	std::string line;
+
+	if( !in )
+		return false;
+
+	while( std::getline(in, line) ) {
+		std::stringstream ss(line);
+		std::string t, client, method, url, params, kv;
+		TraceLine_t l;
+
+		if( line.empty() || ( line[0] == '#' ))
+			continue;
+		std::getline(ss, t, ',');
+		std::getline(ss, client, ',');
+		std::getline(ss, method, ',');
+		std::getline(ss, url, ',');
+		std::getline(ss, params);
+
+		l.t_ms = strtoul(t.c_str(), NULL, 10);
+		l.client = strtoul(client.c_str(), NULL, 10);
+		l.method = ( method == "PUT" ) ? HTTP_PUT : HTTP_GET;
+		l.url = url;
+		std::stringstream ps(params);
+		while( std::getline(ps, kv, '&') ) {
+			size_t eq = kv.find('=');
+			if( eq != std::string::npos )
+				l.params.push_back({kv.substr(0, eq), kv.substr(eq + 1)});
+		}
+		trace.push_back(l);
+		if( l.t_ms > trace_ms )
+			trace_ms = l.t_ms;
+	}
+	return !trace.empty();
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, uint32_t per_mille)
+{
+	size_t rank = (v.size() * per_mille + 999) / 1000;
+	return v.empty() ? 0 : v[rank > 0 ? rank - 1 : 0];
+}
+
+static std::string report(bool cache)
+{
+	std::stringstream out;
+	uint32_t requests = 0;
+	bool first = true;
+
+	for(auto &e : endpoints)
+		requests += e.second.ns.size();
+
+	out << "{\"trace\":\"" << trace_file << "\",\"trace_lines\":" << trace.size() << ",\"clients\":" << clients.size()
+		<< ",\"cache\":" << (cache ? "true" : "false") << ",\"requests\":" << requests
+		<< ",\"elapsed_ms\":" << replay_ns / 1000000.0
+		<< ",\"throughput_rps\":" << (replay_ns ? requests * 1e9 / replay_ns : 0.0)
+		<< ",\"heap_tracking\":" << (HEAP_TRACKING ? "true" : "false")
+		<< ",\"heap_peak_bytes\":" << mock::heap_peak.load()
+		<< ",\"cache_hits\":" << response_cache.GetStats().hits << ",\"cache_renders\":" << response_cache.GetStats().renders
+		<< ",\"endpoints\":[";
+
+	for(auto &e : endpoints) {
+		Endpoint_t &ep = e.second;
+
+		std::sort(ep.ns.begin(), ep.ns.end());
+		out << (first ? "" : ",") << "{\"endpoint\":\"" << e.first << "\",\"count\":" << ep.ns.size()
+			<< ",\"errors\":" << ep.errors
+			<< ",\"mean_us\":" << ep.total_ns / 1000.0 / ep.ns.size()
+			<< ",\"p50_us\":" << percentile(ep.ns, 500) / 1000.0
+			<< ",\"p99_us\":" << percentile(ep.ns, 990) / 1000.0
+			<< ",\"p999_us\":" << percentile(ep.ns, 999) / 1000.0
+			<< ",\"max_us\":" << ep.ns.back() / 1000.0
+			<< ",\"heap_peak_bytes\":" << ep.heap_peak
+			<< ",\"bytes_out\":" << ep.bytes_out << "}";
+		first = false;
+	}
+	out << "]}";
+	return out.str();
+}
+
+/**************************************************************************************************
+  replay
+**************************************************************************************************/
+static StandinDome dome;
+static StandinSwitch sw;
+static StandinSafetyMonitor safemon;
+static StandinAlpacaServer alpaca_server(dome, sw, safemon);
+static AsyncWebServer server(80);
+
+// registration as in setup(): firmware handlers first, then the library's
+static void begin(bool cache)
+{
+	alpaca_actions.SetTransactionCounter([]() { return alpaca_server.NextTransactionID(); });
+	request_stats.Begin(&server);
+	alpaca_actions.Begin(&server);
+	if( cache ) {
+		response_cache.Add("/api/v1/dome/0/shutterstatus", 0, []() { return dome.GetNumberOfConnectedClients() > 0; },
+			[]() { return dome.GetVersion(); },
+			[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%d", dome.shutter); });
+		response_cache.Add("/api/v1/dome/0/slewing", 0, []() { return dome.GetNumberOfConnectedClients() > 0; },
+			[]() { return dome.GetVersion(); },
+			[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%s", dome.slewing ? "true" : "false"); });
+		response_cache.Add("/api/v1/safetymonitor/0/issafe", 0, []() { return safemon.GetNumberOfConnectedClients() > 0; },
+			[]() { return safemon.GetVersion(); },
+			[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%s", safemon.IsSafe() ? "true" : "false"); });
+		response_cache.Add("/api/v1/switch/0/getswitchvalue", STANDIN_SWITCHES, []() { return sw.GetNumberOfConnectedClients() > 0; },
+			[]() { return sw.GetVersion(); },
+			[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%g", sw.value[id]); });
+		response_cache.Begin(&server);
+	}
+	alpaca_server.RegisterCallbacks(&server);
+}
+
+static void replay(uint32_t repeat)
+{
+	for(uint32_t pass = 0; pass < repeat; pass++) {
+		uint32_t base = pass * (trace_ms + 1000);
+
+		for(const TraceLine_t &l : trace) {
+			uint32_t now = base + l.t_ms;
+			const char *method = ( l.method == HTTP_PUT ) ? "PUT " : "GET ";
+			size_t content_length = 0;
+
+			if( l.method == HTTP_PUT )						// form encoded body
+				for(const auto &p : l.params)
+					content_length += p.first.size() + p.second.size() + 2;
+
+			AsyncWebServerRequest request(l.method, l.url.c_str(), content_length);
+			for(const auto &p : l.params)
+				request.AddParam(p.first.c_str(), p.second.c_str(), l.method == HTTP_PUT);
+
+			mock::set_ms(now);
+			alpaca_server.now = now;
+			dome.Loop(now);
+			safemon.Loop(l.t_ms);
+			clients[l.client]++;
+
+			int64_t heap_start = mock::heap_in_use.load();
+			req_peak = heap_start;
+			auto t0 = std::chrono::steady_clock::now();
+
+			AsyncWebServerResponse *response = server.Dispatch(&request);
+			String body = response ? response->body() : String();
+			request.Disconnect();
+
+			auto t1 = std::chrono::steady_clock::now();
+			int64_t heap = req_peak.load() - heap_start;
+			uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+			Endpoint_t &ep = endpoints[method + l.url];
+
+			ep.ns.push_back(ns);
+			ep.total_ns += ns;
+			ep.bytes_out += body.length();
+			if( heap > ep.heap_peak )
+				ep.heap_peak = heap;
+			if( !response || ( response->code() != 200 ) || ( body.indexOf("\"ErrorNumber\":0") < 0 ))
+				ep.errors++;
+			replay_ns += ns;
+		}
+	}
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_replay_trace(void)
+{
+	bool cache = strcmp(env("REPLAY_CACHE", "1"), "0") != 0;
+	uint32_t repeat = strtoul(env("REPLAY_REPEAT", "5"), NULL, 10);
+	const char *out_file = getenv("REPLAY_OUT");
+	uint32_t errors = 0;
+	std::string json;
+
+	trace_file = env("REPLAY_TRACE", "test/test_replay/nina_trace.csv");
+	TEST_ASSERT_TRUE_MESSAGE(load_trace(trace_file), "trace not found, run from the project directory or set REPLAY_TRACE");
+
+	begin(cache);
+	replay(repeat > 0 ? repeat : 1);
+	json = report(cache);
+
+	printf("%s\n", json.c_str());
+	if( out_file ) {
+		std::ofstream out(out_file);
+		out << json << "\n";
+	}
+
+	for(auto &e : endpoints) {
+		errors += e.second.errors;
+		TEST_ASSERT_TRUE(percentile(e.second.ns, 500) <= percentile(e.second.ns, 990));
+		TEST_ASSERT_TRUE(percentile(e.second.ns, 990) <= percentile(e.second.ns, 999));
+	}
+	TEST_ASSERT_EQUAL_UINT32(0, errors);
+	TEST_ASSERT_TRUE(clients.size() > 1);
+	if( cache ) {
+		TEST_ASSERT_TRUE(response_cache.GetStats().hits > response_cache.GetStats().renders);
+	}
+}
+
+// the request statistics middleware saw every request and left onDisconnect to the handlers
+void test_request_stats(void)
+{
+	AsyncWebServerRequest request(HTTP_GET, REQSTATS_URL);
+	AsyncWebServerResponse *response = server.Dispatch(&request);
+	String body = response->body();
+	uint32_t count = 0;
+
+	for(auto &e : endpoints)
+		count += e.second.ns.size();
+
+	TEST_ASSERT_EQUAL(200, response->code());
+	TEST_ASSERT_TRUE(body.indexOf("/api/v1/dome/0/shutterstatus") >= 0);
+	TEST_ASSERT_TRUE(count > 0);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_replay_trace);
+	RUN_TEST(test_request_stats);
+	return UNITY_END();
+}
@@ -0,0 +1,310 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    ResponseCache on the firmware Dome, SafetyMonitor and Switch, registered as setup()
+                  does: same answers as the library handlers, rendered again only after a version
+                  change, library errors when not connected or with a bad Id. Then a mix of polled
+                  GETs with the cache on and off, service time and heap churn (malloc calls and
+                  bytes) per request, as JSON on stdout.
+
+                  CACHE_REQUESTS  requests of each run, default 200000
+                  CACHE_CHANGE    requests between two state changes, default 100
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+
+#include "ResponseCache.cpp"
+#include "Dome.cpp"
+#include "SafetyMonitor.cpp"
+#include "SafetyRules.cpp"
+#include "Switch.cpp"
+#include "AlpacaActions.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+/**************************************************************************************************
+  heap churn: malloc calls and bytes, interposed on glibc
+**************************************************************************************************/
+static uint64_t heap_calls, heap_bytes;
+
+#if defined(__GLIBC__)
+#define HEAP_TRACKING   true
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) { heap_calls++; heap_bytes += size; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { heap_calls++; heap_bytes += n * size; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) { heap_calls++; heap_bytes += size; return __libc_realloc(p, size); }
+}
+#else
+#define HEAP_TRACKING   false
+#endif
+
+bool d_relay_open, d_relay_close;
+uint16_t _safemon_inputs;
+bool is_ws_connected;
+Snapshot<WeatherSnapshot> weather_snapshot;
+bool _sw_out[8];
+uint8_t _sw_pwm[4];
+IoEdges_t io_edges;
+
+static AsyncWebServer server_lib;						// library handlers only
+static AsyncWebServer server_cache;						// cache first, then the library
+static Dome dome;
+static Switch *sw;
+static SafetyMonitor safemon;
+static uint32_t server_transaction_id;
+
+/**************************************************************************************************
+  library handlers as ESP32_Alpaca_Server serves them: one JsonDocument per request
+**************************************************************************************************/
+static void library_reply(AsyncWebServerRequest *request, AlpacaDevice &device, std::function<void(JsonDocument &)> value)
+{
+	JsonDocument doc;
+	String body;
+
+	if( device.GetNumberOfConnectedClients() == 0 ) {
+		doc["Value"] = 0;
+		doc["ErrorNumber"] = ALPACA_ERR_NOT_CONNECTED;
+		doc["ErrorMessage"] = "Not connected";
+	} else {
+		value(doc);
+		doc["ErrorNumber"] = 0;
+		doc["ErrorMessage"] = "";
+	}
+	doc["ClientTransactionID"] = (uint32_t)AlpacaActions::GetParam(request, "ClientTransactionID").toInt();
+	doc["ServerTransactionID"] = ++server_transaction_id;
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+}
+
+static void register_library(AsyncWebServer &server)
+{
+	server.on("/api/v1/dome/0/shutterstatus", HTTP_GET, [](AsyncWebServerRequest *request) {
+		library_reply(request, dome, [](JsonDocument &doc) { doc["Value"] = (int)dome.GetShutter(); });
+	});
+	server.on("/api/v1/dome/0/slewing", HTTP_GET, [](AsyncWebServerRequest *request) {
+		library_reply(request, dome, [](JsonDocument &doc) { doc["Value"] = dome.GetSlewing(); });
+	});
+	server.on("/api/v1/safetymonitor/0/issafe", HTTP_GET, [](AsyncWebServerRequest *request) {
+		library_reply(request, safemon, [](JsonDocument &doc) { doc["Value"] = safemon.IsSafe(); });
+	});
+	server.on("/api/v1/switch/0/getswitchvalue", HTTP_GET, [](AsyncWebServerRequest *request) {
+		uint32_t id = AlpacaActions::GetParam(request, "Id").toInt();
+		library_reply(request, *sw, [id](JsonDocument &doc) { doc["Value"] = sw->GetChannelValue(id); });
+	});
+}
+
+// registration of setup()
+static void register_cache()
+{
+	response_cache.Add("/api/v1/dome/0/shutterstatus", 0, []() { return dome.GetNumberOfConnectedClients() > 0; },
+		[]() { return dome.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%d", (int)dome.GetShutter()); });
+	response_cache.Add("/api/v1/dome/0/slewing", 0, []() { return dome.GetNumberOfConnectedClients() > 0; },
+		[]() { return dome.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%s", dome.GetSlewing() ? "true" : "false"); });
+	response_cache.Add("/api/v1/safetymonitor/0/issafe", 0, []() { return safemon.GetNumberOfConnectedClients() > 0; },
+		[]() { return safemon.GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%s", safemon.IsSafe() ? "true" : "false"); });
+	response_cache.Add("/api/v1/switch/0/getswitchvalue", sw->GetNumChannels(), []() { return sw->GetNumberOfConnectedClients() > 0; },
+		[]() { return sw->GetVersion(); },
+		[](uint32_t id, char *value, size_t size) { snprintf(value, size, "%g", sw->GetChannelValue(id)); });
+	response_cache.Begin(&server_cache);
+}
+
+static const char *const k_urls[] = {
+	"/api/v1/dome/0/shutterstatus", "/api/v1/dome/0/slewing", "/api/v1/safetymonitor/0/issafe", "/api/v1/switch/0/getswitchvalue"
+};
+
+static JsonDocument get(AsyncWebServer &server, const char *url, const char *id, uint32_t client_id)
+{
+	AsyncWebServerRequest req(HTTP_GET, url);
+	JsonDocument doc;
+
+	if( id )
+		req.AddParam("Id", id);
+	req.AddParam("ClientTransactionID", String(client_id));
+	server.Dispatch(&req);
+	if( req.Response()->code() != 200 )
+		doc["status"] = req.Response()->code();
+	else
+		TEST_ASSERT_TRUE(deserializeJson(doc, req.Response()->body()) == DeserializationError::Ok);
+	return doc;
+}
+
+// every endpoint and Id answered the same by both servers
+static void check_same()
+{
+	for(const char *url : k_urls) {
+		uint32_t ids = ( url == k_urls[3] ) ? sw->GetNumChannels() : 1;
+
+		for(uint32_t id = 0; id < ids; id++) {
+			String s(id);
+			JsonDocument lib = get(server_lib, url, ( url == k_urls[3] ) ? s.c_str() : NULL, 100 + id);
+			JsonDocument cached = get(server_cache, url, ( url == k_urls[3] ) ? s.c_str() : NULL, 100 + id);
+
+			TEST_ASSERT_EQUAL_DOUBLE(lib["Value"].as<double>(), cached["Value"].as<double>());
+			TEST_ASSERT_EQUAL(lib["ErrorNumber"].as<int>(), cached["ErrorNumber"].as<int>());
+			TEST_ASSERT_EQUAL_STRING(lib["ErrorMessage"].as<const char *>(), cached["ErrorMessage"].as<const char *>());
+			TEST_ASSERT_EQUAL_UINT32(100 + id, cached["ClientTransactionID"].as<uint32_t>());
+			TEST_ASSERT_EQUAL_UINT32(lib["ServerTransactionID"].as<uint32_t>() + 1, cached["ServerTransactionID"].as<uint32_t>());
+		}
+	}
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		mock::real_clock = false;
+		mock::set_ms(1000);
+		dome.Begin();
+		sw = new Switch();
+		sw->Begin();
+		safemon.Begin();
+		alpaca_actions.SetTransactionCounter([]() { return ++server_transaction_id; });
+		register_library(server_lib);
+		register_cache();
+		register_library(server_cache);
+		begun = true;
+	}
+	dome.SetNumberOfConnectedClients(1);
+	sw->SetNumberOfConnectedClients(1);
+	safemon.SetNumberOfConnectedClients(1);
+}
+void tearDown(void) {}
+
+void test_same_as_library(void)
+{
+	sw->PutSetSwitchValue(17, 42);
+	sw->PutSetSwitch(12, true);
+	sw->Loop();
+	check_same();
+	dome.PutOpen();
+	_safemon_inputs = SAFEMON_POWER_BIT;
+	safemon.Loop();
+	check_same();
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kOpening, get(server_cache, k_urls[0], NULL, 1)["Value"].as<int>());
+	TEST_ASSERT_FALSE(get(server_cache, k_urls[2], NULL, 1)["Value"].as<bool>());
+	TEST_ASSERT_EQUAL_DOUBLE(42.0, get(server_cache, k_urls[3], "17", 1)["Value"].as<double>());
+}
+
+// one render per endpoint and Id until its device version changes
+void test_rendered_on_change(void)
+{
+	get(server_cache, k_urls[0], NULL, 1);
+	get(server_cache, k_urls[3], "16", 1);
+	ResponseCacheStats_t before = response_cache.GetStats();
+
+	for(uint32_t i = 0; i < 10; i++) {
+		get(server_cache, k_urls[0], NULL, 1);
+		get(server_cache, k_urls[3], "16", 1);
+	}
+	TEST_ASSERT_EQUAL_UINT32(before.renders, response_cache.GetStats().renders);
+	TEST_ASSERT_EQUAL_UINT32(before.hits + 20, response_cache.GetStats().hits);
+
+	dome.PutAbort();														// version bumped by the PUT handler
+	TEST_ASSERT_EQUAL((int)AlpacaShutterStatus_t::kError, get(server_cache, k_urls[0], NULL, 1)["Value"].as<int>());
+	TEST_ASSERT_EQUAL_UINT32(before.renders + 1, response_cache.GetStats().renders);
+
+	sw->PutSetSwitchValue(16, 7);
+	sw->Loop();															// version bumped once the library stored the value
+	TEST_ASSERT_EQUAL_DOUBLE(7.0, get(server_cache, k_urls[3], "16", 1)["Value"].as<double>());
+	TEST_ASSERT_EQUAL_UINT32(before.renders + 2, response_cache.GetStats().renders);
+}
+
+void test_errors(void)
+{
+	dome.SetNumberOfConnectedClients(0);
+	JsonDocument doc = get(server_cache, k_urls[0], NULL, 5);
+	TEST_ASSERT_EQUAL(ALPACA_ERR_NOT_CONNECTED, doc["ErrorNumber"].as<int>());
+	TEST_ASSERT_EQUAL_UINT32(5, doc["ClientTransactionID"].as<uint32_t>());
+	check_same();
+
+	TEST_ASSERT_EQUAL(400, get(server_cache, k_urls[3], NULL, 1)["status"].as<int>());
+	TEST_ASSERT_EQUAL(ALPACA_ERR_INVALID_VALUE, get(server_cache, k_urls[3], "20", 1)["ErrorNumber"].as<int>());
+	TEST_ASSERT_EQUAL(ALPACA_ERR_INVALID_VALUE, get(server_cache, k_urls[3], "3x", 1)["ErrorNumber"].as<int>());
+}
+
+typedef struct {
+	double ns;						// service time per request
+	double mallocs;					// per request
+	double bytes;
+} Cost_t;
+
+// polled GETs in NINA order, a Switch or Dome change every `change` requests, requests built outside the timing
+static Cost_t run(AsyncWebServer &server, uint32_t requests, uint32_t change)
+{
+	const uint32_t n_sw = sw->GetNumChannels(), n = 3 + n_sw;
+	std::vector<std::unique_ptr<AsyncWebServerRequest>> reqs;
+	uint64_t ns = 0, calls = 0, bytes = 0;
+	volatile size_t sink = 0;
+
+	for(uint32_t i = 0; i < requests; i++) {
+		AsyncWebServerRequest *req = new AsyncWebServerRequest(HTTP_GET, k_urls[std::min(i % n, 3u)]);
+
+		if( i % n >= 3 )
+			req->AddParam("Id", String(i % n - 3));
+		req->AddParam("ClientTransactionID", String(i));
+		reqs.emplace_back(req);
+	}
+	for(uint32_t i = 0; i < requests; i++) {
+		if( i % change == 0 )
+			( i / change ) & 1 ? (void)sw->PutSetSwitchValue(16 + i % 4, i % 101) : (void)dome.PutAbort();
+
+		uint64_t c0 = heap_calls, b0 = heap_bytes;
+		auto t0 = std::chrono::steady_clock::now();
+		server.Dispatch(reqs[i].get());
+		auto t1 = std::chrono::steady_clock::now();
+		calls += heap_calls - c0;
+		bytes += heap_bytes - b0;
+		ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+		sink = sink + reqs[i]->Response()->body().length();
+	}
+	return { (double)ns / requests, (double)calls / requests, (double)bytes / requests };
+}
+
+void test_benchmark(void)
+{
+	uint32_t requests = strtoul(env("CACHE_REQUESTS", "200000"), NULL, 10);
+	uint32_t change = strtoul(env("CACHE_CHANGE", "100"), NULL, 10);
+	ResponseCacheStats_t before = response_cache.GetStats();
+
+	Cost_t off = run(server_lib, requests, change);
+	Cost_t on = run(server_cache, requests, change);
+	uint32_t hits = response_cache.GetStats().hits - before.hits, renders = response_cache.GetStats().renders - before.renders;
+
+	printf("{\"bench\":\"response_cache\",\"requests\":%u,\"change_every\":%u,\"heap_tracking\":%s,"
+		"\"off\":{\"ns\":%.0f,\"mallocs\":%.2f,\"bytes\":%.0f},\"on\":{\"ns\":%.0f,\"mallocs\":%.2f,\"bytes\":%.0f,\"hits\":%u,\"renders\":%u}}\n",
+		requests, change, HEAP_TRACKING ? "true" : "false", off.ns, off.mallocs, off.bytes, on.ns, on.mallocs, on.bytes, hits, renders);
+
+	TEST_ASSERT_EQUAL_UINT32(requests, hits + renders);
+	TEST_ASSERT_TRUE(renders <= ( requests / change + 1 ) * sw->GetNumChannels());	// a change renders each slot once at most
+	TEST_ASSERT_TRUE(on.ns < off.ns);
+	if( HEAP_TRACKING )
+		TEST_ASSERT_TRUE(on.mallocs < off.mallocs);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_same_as_library);
+	RUN_TEST(test_rendered_on_change);
+	RUN_TEST(test_errors);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
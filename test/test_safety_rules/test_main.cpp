@@ -0,0 +1,389 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    SafetyMonitor rule table configured from SafetyMonitor_Configuration: every
+                  weather channel trips its own bit, trip and clear delays restart when interrupted,
+                  hysteresis holds the bit, so does a sensor dropping out, a lost station clears it,
+                  a filtered -1 is a value. Then noisy synthetic weather traces, one frame per
+                  second, time to unsafe after the noise free value crosses the limit and safe/unsafe
+                  transitions against the original hand written sky temperature and wind blocks, and
+                  the cost of one pass, as JSON on stdout.
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+
+#include "SafetyMonitor.cpp"
+#include "SafetyRules.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+#include "AlpacaActions.cpp"
+
+#define TRACE_SECONDS       7200
+#define TRIP_DELAY_S        10          // Weather_delay
+#define CLEAR_DELAY_S       30          // Weather_clear_delay
+#define BENCH_PASSES        10000000
+
+uint16_t _safemon_inputs;
+bool is_ws_connected;
+Snapshot<WeatherSnapshot> weather_snapshot;
+
+static const WeatherFrame k_safe = { -250, 100, 5, 50, 0, 0, 10, 50 };
+static const WeatherFrame k_unsafe = { 50, -50, 60, 99, 5, 90, 90, 2 };
+
+static SafetyMonitor *sm;
+
+static void set(const char *key, const char *literal)
+{
+	JsonDocument doc;
+
+	deserializeJson(doc, literal);
+	TEST_ASSERT_TRUE(sm->ApplySetting("SafetyMonitor_Configuration", key, doc.as<JsonVariantConst>()));
+}
+
+// frame as loop() publishes it, filters left at the raw value unless given
+static void publish(const WeatherFrame &f, const WeatherFrame *filtered = NULL)
+{
+	WeatherSnapshot w = {};
+
+	w.values = f;
+	for(uint8_t i = 0; i < WS_FILTERS; i++)
+		w.filtered[i] = filtered ? *filtered : f;
+	w.timestamp_ms = millis();
+	w.frames = 1;
+	weather_snapshot.Write(w);
+}
+
+static void step(const WeatherFrame &f, uint32_t seconds)
+{
+	for(uint32_t s = 0; s < seconds; s++) {
+		publish(f);
+		sm->Loop();
+		mock::advance_us(1000000);
+	}
+}
+
+static void set_channel(WeatherFrame &f, uint8_t ch, int16_t v) { ((int16_t *)&f)[ch] = v; }
+
+void setUp(void)
+{
+	mock::real_clock = false;
+	mock::set_ms(1000);
+	_safemon_inputs = 0;
+	is_ws_connected = true;
+	sm = new SafetyMonitor();
+	sm->Begin();
+}
+void tearDown(void) { delete sm; }
+
+void test_every_channel(void)
+{
+	set("Weather_delay", "0");
+	for(uint32_t i = 0; i < NUM_RULES; i++)
+		set(k_rule_config[i].use, "true");
+
+	step(k_safe, 1);
+	TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+	TEST_ASSERT_TRUE(sm->IsSafe());
+	for(uint32_t i = 0; i < NUM_RULES; i++) {
+		WeatherFrame f = k_safe;
+
+		set_channel(f, k_rule_config[i].channel, ws_channel(k_unsafe, k_rule_config[i].channel));
+		step(f, 1);
+		TEST_ASSERT_EQUAL_HEX16(k_rule_config[i].bit, _safemon_inputs);
+		TEST_ASSERT_FALSE(sm->IsSafe());
+		step(k_safe, 1);
+		TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+	}
+}
+
+void test_delays_and_hysteresis(void)
+{
+	WeatherFrame f = k_safe;
+
+	set("Use_sky_temp", "true");
+	set("Sky_temp_limit", "-10");										// -100 in 0.1 °C
+	set("Sky_temp_hysteresis", "2");
+	set("Weather_delay", "10");
+	set("Weather_clear_delay", "30");
+
+	f.tsky = -99;
+	step(f, 9);
+	step(k_safe, 1);													// interrupted: delay restarts
+	step(f, 9);
+	TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+	step(f, 2);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_TSKY_BIT, _safemon_inputs);
+
+	f.tsky = -119;														// inside the band: held
+	step(f, 100);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_TSKY_BIT, _safemon_inputs);
+	f.tsky = -120;
+	step(f, 29);
+	f.tsky = -110;
+	step(f, 1);															// interrupted: clear delay restarts
+	f.tsky = -120;
+	step(f, 30);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_TSKY_BIT, _safemon_inputs);
+	step(f, 1);
+	TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+
+	set("Sky_temp_trip_delay", "0");									// per rule delay over Weather_delay
+	f.tsky = 0;
+	step(f, 1);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_TSKY_BIT, _safemon_inputs);
+}
+
+void test_invalid_and_lost(void)
+{
+	WeatherFrame f = k_unsafe;
+
+	set("Weather_delay", "0");
+	set("Use_clouds", "true");
+	set("Use_stars", "true");
+	set("Use_wind", "true");
+	f.clouds = -1;														// no such sensor
+	f.stars = -1;
+	step(f, 2);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_WIND_BIT, _safemon_inputs);
+
+	_safemon_inputs |= SAFEMON_POWER_BIT;
+	is_ws_connected = false;
+	step(f, 1);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_POWER_BIT, _safemon_inputs);		// weather bits only
+	is_ws_connected = true;
+	set("Weather_delay", "5");
+	step(f, 3);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_POWER_BIT, _safemon_inputs);		// delay restarted by the reset
+}
+
+// a sensor dropping out holds the rule, a filtered value of -1 is a value
+void test_dropout_holds(void)
+{
+	WeatherFrame f = k_safe, roc = k_safe;
+
+	set("Weather_delay", "0");
+	set("Use_clouds", "true");
+	set("Clouds_clear_delay", "10");
+	f.clouds = 90;
+	step(f, 1);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_CLOUDS_BIT, _safemon_inputs);
+	f.clouds = -1;														// sensor lost: still unsafe
+	step(f, 60);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_CLOUDS_BIT, _safemon_inputs);
+	f.clouds = 0;
+	step(f, 10);
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_CLOUDS_BIT, _safemon_inputs);		// clear delay from the first safe reading
+	step(f, 1);
+	TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+
+	set("Clouds_input", "\"roc\"");										// rate of change of the raw value
+	roc.clouds = 60;
+	publish(f, &roc);
+	sm->Loop();
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_CLOUDS_BIT, _safemon_inputs);
+	roc.clouds = -1;													// falling by 1/s: a value, not "no sensor"
+	for(uint32_t s = 0; s < 10; s++) {
+		mock::advance_us(1000000);
+		publish(f, &roc);
+		sm->Loop();
+		TEST_ASSERT_EQUAL_HEX16(SAFEMON_CLOUDS_BIT, _safemon_inputs);
+	}
+	mock::advance_us(1000000);
+	publish(f, &roc);
+	sm->Loop();
+	TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+}
+
+void test_config(void)
+{
+	JsonDocument doc;
+	WeatherFrame median = k_safe;
+
+	doc.set(51);
+	TEST_ASSERT_FALSE(sm->ApplySetting("SafetyMonitor_Configuration", "Sky_temp_limit", doc.as<JsonVariantConst>()));
+	TEST_ASSERT_FALSE(sm->ApplySetting("SafetyMonitor_Configuration", "No_such_key", doc.as<JsonVariantConst>()));
+	doc.set("mean");
+	TEST_ASSERT_FALSE(sm->ApplySetting("SafetyMonitor_Configuration", "Wind_input", doc.as<JsonVariantConst>()));
+
+	set("Use_wind", "\"true\"");										// strings of the setup form
+	set("Wind_limit", "\"40\"");
+	set("Wind_input", "\"median\"");
+	set("Wind_trip_delay", "0");
+	median.wind = 45;
+	publish(k_unsafe, &median);											// gust of 60 in the raw value only
+	sm->Loop();
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_WIND_BIT, _safemon_inputs);
+	median.wind = 38;
+	publish(k_unsafe, &median);
+	sm->Loop();
+	TEST_ASSERT_EQUAL_HEX16(SAFEMON_WIND_BIT, _safemon_inputs);			// 38 > 40 - 3, held
+	median.wind = 37;
+	publish(k_unsafe, &median);
+	sm->Loop();
+	TEST_ASSERT_EQUAL_HEX16(0, _safemon_inputs);
+}
+
+/**************************************************************************************************
+  synthetic traces
+**************************************************************************************************/
+typedef struct {
+	const char *name;
+	uint8_t rule;							// index in k_rule_config
+	const char *limit, *hysteresis;			// setup units
+	int16_t from, to;						// noise free value, linear over the trace
+	int16_t noise;							// +/- uniform
+	uint32_t step_s;						// 0: ramp, else jump from `from` to `to` at step_s
+} Trace_t;
+
+static const Trace_t k_traces[] = {
+	{ "cloud_front", 0, "-10", "2",  -250, -20,  15, 0 },
+	{ "frost",       1, "0",   "1",   50,  -30,  5,  0 },
+	{ "wind",        2, "30",  "3",   10,   45,  8,  0 },
+	{ "humidity",    3, "90",  "3",   70,   98,  2,  0 },
+	{ "rain",        4, "0",   "0",   0,    5,   0,  3000 },
+	{ "dawn",        5, "50",  "5",   0,    100, 3,  0 },
+	{ "clouds",      6, "50",  "10",  20,   80,  5,  0 },
+	{ "stars",       7, "10",  "5",   40,   0,   3,  0 },
+};
+
+static int16_t trace_value(const Trace_t &t, uint32_t s)
+{
+	if( t.step_s )
+		return ( s < t.step_s ) ? t.from : t.to;
+	return t.from + (int32_t)( t.to - t.from ) * (int32_t)s / TRACE_SECONDS;
+}
+
+// the original block of SafetyMonitor::Loop(): no hysteresis, cleared at once
+typedef struct {
+	uint32_t tmr_ini;
+	bool tripped;
+} Legacy_t;
+
+static bool legacy(Legacy_t &l, int16_t v, int16_t limit, uint32_t now)
+{
+	if( v > limit ) {
+		if( l.tmr_ini == 0 )
+			l.tmr_ini = now;
+		if(( now - l.tmr_ini ) > TRIP_DELAY_S * 1000 )
+			l.tripped = true;
+	} else {
+		l.tripped = false;
+		l.tmr_ini = 0;
+	}
+	return l.tripped;
+}
+
+typedef struct {
+	int32_t time_to_unsafe_s;				// -1: never
+	uint32_t transitions;
+} Result_t;
+
+void test_traces(void)
+{
+	uint32_t seed = 11;
+
+	printf("{\"bench\":\"safety_rules\",\"seconds\":%u,\"trip_delay_s\":%u,\"clear_delay_s\":%u,\"traces\":[",
+		TRACE_SECONDS, TRIP_DELAY_S, CLEAR_DELAY_S);
+	for(size_t n = 0; n < sizeof(k_traces) / sizeof(k_traces[0]); n++) {
+		const Trace_t &t = k_traces[n];
+		const int16_t scale = k_rule_config[t.rule].scale, limit = atoi(t.limit) * scale;
+		const bool above = ( k_rule_config[t.rule].cmp == SAFETY_ABOVE );
+		const bool has_legacy = ( t.rule == 0 ) || ( t.rule == 2 );			// sky temperature and wind only
+		Result_t rules = { -1, 0 }, orig = { -1, 0 };
+		int32_t crossed = -1, certain = -1;								// noise free value beyond the limit, and by the noise
+		bool prev = false, prev_orig = false;
+		Legacy_t l = { 0, false };
+		char key[8];
+
+		delete sm;
+		sm = new SafetyMonitor();
+		_safemon_inputs = 0;
+		snprintf(key, sizeof(key), "%u", TRIP_DELAY_S);
+		set("Weather_delay", key);
+		snprintf(key, sizeof(key), "%u", CLEAR_DELAY_S);
+		set("Weather_clear_delay", key);
+		set(k_rule_config[t.rule].use, "true");
+		set(k_rule_config[t.rule].limit, t.limit);
+		set(k_rule_config[t.rule].hysteresis, t.hysteresis);
+
+		for(uint32_t s = 0; s < TRACE_SECONDS; s++) {
+			WeatherFrame f = k_safe;
+			int16_t v = trace_value(t, s);
+
+			if(( crossed < 0 ) && ( above ? v > limit : v < limit ))
+				crossed = s;
+			if(( certain < 0 ) && ( above ? v - t.noise > limit : v + t.noise < limit ))
+				certain = s;
+			if( t.noise ) {
+				seed = seed * 1664525 + 1013904223;
+				v += (int32_t)(( seed >> 8 ) % ( 2 * t.noise + 1 )) - t.noise;
+				if(( t.rule > 1 ) && ( v < 0 ))						// only temperatures go below 0
+					v = 0;
+			}
+			set_channel(f, k_rule_config[t.rule].channel, v);
+			publish(f);
+			sm->Loop();
+
+			bool unsafe = ( _safemon_inputs & k_rule_config[t.rule].bit ) != 0;
+			rules.transitions += ( unsafe != prev );
+			if( unsafe && ( rules.time_to_unsafe_s < 0 ) && ( crossed >= 0 ))
+				rules.time_to_unsafe_s = s - crossed;
+			prev = unsafe;
+
+			if( has_legacy ) {
+				bool u = legacy(l, v, limit, millis());
+				orig.transitions += ( u != prev_orig );
+				if( u && ( orig.time_to_unsafe_s < 0 ) && ( crossed >= 0 ))
+					orig.time_to_unsafe_s = s - crossed;
+				prev_orig = u;
+			}
+			mock::advance_us(1000000);
+		}
+
+		printf("%s{\"trace\":\"%s\",\"crossed_s\":%d,\"rules\":{\"time_to_unsafe_s\":%d,\"transitions\":%u},"
+			"\"original\":{\"supported\":%s,\"time_to_unsafe_s\":%d,\"transitions\":%u}}",
+			n ? "," : "", t.name, crossed, rules.time_to_unsafe_s, rules.transitions,
+			has_legacy ? "true" : "false", orig.time_to_unsafe_s, orig.transitions);
+
+		TEST_ASSERT_TRUE(crossed >= 0);
+		TEST_ASSERT_TRUE(rules.time_to_unsafe_s >= 0);
+		TEST_ASSERT_TRUE(rules.time_to_unsafe_s <= certain - crossed + TRIP_DELAY_S + 1);
+		TEST_ASSERT_EQUAL_UINT32(1, rules.transitions);					// tripped once, never flapping
+		if( has_legacy && t.noise )
+			TEST_ASSERT_TRUE(orig.transitions > rules.transitions);
+	}
+
+	// one pass over a table of every rule, enabled
+	SafetyRules rules;
+	WeatherSnapshot w;
+	volatile uint16_t sink = 0;
+
+	for(uint32_t i = 0; i < NUM_RULES; i++) {
+		rules.Add(k_rule_config[i].channel, k_rule_config[i].cmp, k_rule_config[i].limit_default * k_rule_config[i].scale,
+				  k_rule_config[i].hysteresis_default * k_rule_config[i].scale, k_rule_config[i].bit);
+		rules.Get(i).enabled = true;
+		rules.SetDelays(i, TRIP_DELAY_S * 1000, CLEAR_DELAY_S * 1000);
+	}
+	publish(k_unsafe);
+	weather_snapshot.Read(w);
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_PASSES; i++)
+		sink = sink + rules.Evaluate(w, i);
+	auto t1 = std::chrono::steady_clock::now();
+	printf("],\"rules\":%u,\"pass_ns\":%.1f}\n", (unsigned)NUM_RULES, std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_PASSES);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_every_channel);
+	RUN_TEST(test_delays_and_hysteresis);
+	RUN_TEST(test_invalid_and_lost);
+	RUN_TEST(test_dropout_holds);
+	RUN_TEST(test_config);
+	RUN_TEST(test_traces);
+	return UNITY_END();
+}
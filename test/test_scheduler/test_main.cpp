@@ -0,0 +1,273 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    deadline scheduler: periodic and one-shot semantics, millis() wrap around, and a
+                  benchmark on the virtual clock of loop() with the original polled millis() timers
+                  against loop_sched.Run()/Idle(). Reports CPU busy fraction and per task interval
+                  jitter as JSON on stdout.
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <vector>
+#include <string>
+
+#include "Scheduler.cpp"
+
+#define BENCH_SECONDS       60
+#define LOOP_WORK_US        40          // alpaca_server.Loop() and device Loop() without requests
+
+typedef struct {
+	const char *name;
+	uint32_t period_ms;
+	uint32_t exec_us;					// callback cost
+} BenchTask_t;
+
+static const BenchTask_t k_tasks[] = {
+	{ "shreg_in", 50, 30 },
+	{ "shreg_out", 100, 40 },
+	{ "led", 500, 5 },
+	{ "events", 250, 120 },
+	{ "settings", 500, 200 },
+	{ "wifi", 250, 15 },
+};
+#define BENCH_TASKS         (sizeof(k_tasks) / sizeof(k_tasks[0]))
+
+static std::vector<uint64_t> runs[BENCH_TASKS];			// run times in us
+
+template <uint8_t I>
+static void bench_cb(uint32_t now)
+{
+	runs[I].push_back(mock::now_us());
+	mock::advance_us(k_tasks[I].exec_us);
+}
+static const SchedCallback_t k_callbacks[BENCH_TASKS] = { bench_cb<0>, bench_cb<1>, bench_cb<2>, bench_cb<3>, bench_cb<4>, bench_cb<5> };
+
+typedef struct {
+	double busy_percent;
+	uint32_t max_jitter_us[BENCH_TASKS];		// worst |interval - period|
+	double mean_jitter_us[BENCH_TASKS];
+	uint32_t runs[BENCH_TASKS];
+	uint32_t passes;
+} Bench_t;
+
+static void bench_reset()
+{
+	for(uint8_t i = 0; i < BENCH_TASKS; i++)
+		runs[i].clear();
+	mock::virtual_us = 0;
+	mock::idle_us = 0;
+}
+
+static void bench_jitter(Bench_t &b)
+{
+	for(uint8_t i = 0; i < BENCH_TASKS; i++) {
+		uint64_t sum = 0;
+		uint32_t worst = 0;
+
+		for(size_t r = 1; r < runs[i].size(); r++) {
+			int64_t d = (int64_t)(runs[i][r] - runs[i][r - 1]) - k_tasks[i].period_ms * 1000;
+			uint32_t j = d < 0 ? -d : d;
+			sum += j;
+			if( j > worst ) worst = j;
+		}
+		b.max_jitter_us[i] = worst;
+		b.mean_jitter_us[i] = runs[i].size() > 1 ? (double)sum / (runs[i].size() - 1) : 0;
+		b.runs[i] = runs[i].size();
+	}
+}
+
+// original loop(): every timer polled with millis() on every pass, the loop never blocks
+static Bench_t bench_polled()
+{
+	uint32_t tmr[BENCH_TASKS] = {0};
+	Bench_t b = {};
+
+	bench_reset();
+	while( mock::now_us() < BENCH_SECONDS * 1000000ULL ) {
+		mock::advance_us(LOOP_WORK_US);
+		for(uint8_t i = 0; i < BENCH_TASKS; i++)
+			if(( millis() - tmr[i] ) > k_tasks[i].period_ms ) {
+				tmr[i] = millis();
+				k_callbacks[i](millis());
+			}
+		b.passes++;
+	}
+	b.busy_percent = 100.0 * (mock::now_us() - mock::idle_us) / mock::now_us();
+	bench_jitter(b);
+	return b;
+}
+
+// loop() with the scheduler: run due tasks, sleep until the next deadline
+static Bench_t bench_scheduled(Scheduler &sched)
+{
+	Bench_t b = {};
+
+	bench_reset();
+	for(uint8_t i = 0; i < BENCH_TASKS; i++)
+		sched.AddPeriodic(k_tasks[i].name, k_callbacks[i], k_tasks[i].period_ms, millis());
+	sched.ResetLoad();
+	while( mock::now_us() < BENCH_SECONDS * 1000000ULL ) {
+		mock::advance_us(LOOP_WORK_US);
+		sched.Idle(sched.Run(millis()));
+		b.passes++;
+	}
+	b.busy_percent = 100.0 * (mock::now_us() - mock::idle_us) / mock::now_us();
+	bench_jitter(b);
+	return b;
+}
+
+static std::string bench_json(const Bench_t &b)
+{
+	std::string s;
+	char buf[160];
+
+	snprintf(buf, sizeof(buf), "{\"busy_percent\":%.1f,\"passes\":%u,\"tasks\":{", b.busy_percent, b.passes);
+	s = buf;
+	for(uint8_t i = 0; i < BENCH_TASKS; i++) {
+		snprintf(buf, sizeof(buf), "%s\"%s\":{\"runs\":%u,\"mean_jitter_us\":%.0f,\"max_jitter_us\":%u}", i ? "," : "",
+			k_tasks[i].name, b.runs[i], b.mean_jitter_us[i], b.max_jitter_us[i]);
+		s += buf;
+	}
+	return s + "}}";
+}
+
+/**************************************************************************************************
+  tests
+**************************************************************************************************/
+static uint32_t count_a, count_b;
+static Scheduler *rearm_sched;
+static int8_t rearm_id;
+
+static void cb_a(uint32_t now) { count_a++; }
+static void cb_b(uint32_t now) { count_b++; }
+static void cb_rearm(uint32_t now) { count_b++; rearm_sched->Start(rearm_id, 30, now); }
+
+void setUp(void) { count_a = count_b = 0; mock::virtual_us = 0; mock::idle_us = 0; }
+void tearDown(void) {}
+
+void test_periodic_and_one_shot(void)
+{
+	Scheduler sched;
+	int8_t a = sched.AddPeriodic("a", cb_a, 100, 0);
+	int8_t b = sched.AddOneShot("b", cb_b);
+
+	TEST_ASSERT_EQUAL(0, a);
+	TEST_ASSERT_EQUAL(1, b);
+	TEST_ASSERT_FALSE(sched.IsActive(b));
+	TEST_ASSERT_EQUAL_UINT32(SCHED_MAX_IDLE_MS, sched.Run(0));		// nothing due within the idle bound
+	TEST_ASSERT_EQUAL_UINT32(5, sched.Run(95));
+	TEST_ASSERT_EQUAL_UINT32(0, count_a);
+	sched.Run(103);
+	TEST_ASSERT_EQUAL_UINT32(1, count_a);
+	TEST_ASSERT_EQUAL_UINT32(3, sched.GetStats(a).last_late_ms);
+	TEST_ASSERT_EQUAL_UINT32(SCHED_MAX_IDLE_MS, sched.Run(104));	// next deadline 200, no drift from the late run
+
+	sched.Start(b, 20, 104);
+	TEST_ASSERT_EQUAL_UINT32(10, sched.Run(114));
+	sched.Run(124);
+	TEST_ASSERT_EQUAL_UINT32(1, count_b);
+	TEST_ASSERT_FALSE(sched.IsActive(b));
+	sched.Run(200);
+	TEST_ASSERT_EQUAL_UINT32(1, count_b);
+	TEST_ASSERT_EQUAL_UINT32(2, count_a);
+
+	sched.Run(1000);												// missed deadlines run once, then from now
+	TEST_ASSERT_EQUAL_UINT32(3, count_a);
+	sched.Run(1099);
+	TEST_ASSERT_EQUAL_UINT32(3, count_a);
+	sched.Run(1100);
+	TEST_ASSERT_EQUAL_UINT32(4, count_a);
+
+	sched.SetPeriod(a, 10, 1105);									// shorter period applies at once
+	TEST_ASSERT_EQUAL_UINT32(5, sched.Run(1110));
+	TEST_ASSERT_EQUAL_UINT32(4, count_a);
+	sched.Run(1115);
+	TEST_ASSERT_EQUAL_UINT32(5, count_a);
+	sched.Stop(a);
+	sched.Run(2000);
+	TEST_ASSERT_EQUAL_UINT32(5, count_a);
+	TEST_ASSERT_EQUAL_UINT32(5, sched.GetStats(a).runs);
+}
+
+void test_rearm_and_wrap(void)
+{
+	Scheduler sched;
+	uint32_t t0 = 0xFFFFFFFF - 50;
+
+	rearm_sched = &sched;
+	rearm_id = sched.AddOneShot("rearm", cb_rearm);
+	sched.AddPeriodic("a", cb_a, 40, t0);
+	sched.Start(rearm_id, 30, t0);
+	for(uint32_t t = t0; t != t0 + 200; t++)
+		sched.Run(t);
+	TEST_ASSERT_EQUAL_UINT32(6, count_b);							// re-armed from its own callback
+	TEST_ASSERT_EQUAL_UINT32(4, count_a);							// across the millis() wrap
+	TEST_ASSERT_EQUAL_UINT32(0, sched.GetStats(0).max_late_ms);
+
+	for(uint8_t i = sched.GetNumTasks(); i < SCHED_MAX_TASKS; i++)
+		TEST_ASSERT_TRUE(sched.AddOneShot("x", cb_b) >= 0);
+	TEST_ASSERT_EQUAL(-1, sched.AddOneShot("full", cb_b));
+}
+
+// Idle() sleeps to the deadline on the virtual clock, Wake() ends it early
+void test_idle_and_wake(void)
+{
+	Scheduler sched;
+
+	sched.ResetLoad();
+	sched.Idle(sched.Run(millis()));
+	TEST_ASSERT_EQUAL_UINT32(SCHED_MAX_IDLE_MS, millis());
+	sched.Wake();
+	sched.Idle(5);
+	TEST_ASSERT_EQUAL_UINT32(SCHED_MAX_IDLE_MS, millis());			// notification pending, no wait
+	mock::advance_us(10000);
+	TEST_ASSERT_EQUAL_UINT32(50, sched.GetBusyPercent());
+}
+
+// busy fraction over more than the 71 minutes of a 32 bit microsecond count
+void test_busy_long_run(void)
+{
+	Scheduler sched;
+
+	sched.ResetLoad();
+	while( mock::now_us() < 80 * 60 * 1000000ULL ) {
+		mock::advance_us(10000);
+		sched.Idle(SCHED_MAX_IDLE_MS);
+	}
+	TEST_ASSERT_EQUAL_UINT32(50, sched.GetBusyPercent());
+}
+
+void test_benchmark(void)
+{
+	Scheduler sched;
+	Bench_t polled = bench_polled();
+	Bench_t scheduled = bench_scheduled(sched);
+
+	printf("{\"bench\":\"scheduler\",\"seconds\":%u,\"loop_work_us\":%u,\"polled\":%s,\"scheduled\":%s}\n",
+		BENCH_SECONDS, LOOP_WORK_US, bench_json(polled).c_str(), bench_json(scheduled).c_str());
+
+	TEST_ASSERT_TRUE(polled.busy_percent > 99.0);
+	TEST_ASSERT_TRUE(scheduled.busy_percent < 10.0);
+	TEST_ASSERT_UINT32_WITHIN(1, scheduled.busy_percent, sched.GetBusyPercent());
+	for(uint8_t i = 0; i < BENCH_TASKS; i++) {
+		uint32_t expected = BENCH_SECONDS * 1000 / k_tasks[i].period_ms;
+
+		TEST_ASSERT_UINT32_WITHIN(1, expected, scheduled.runs[i]);					// no drift
+		TEST_ASSERT_TRUE(polled.runs[i] < expected);								// '>' and reload from millis() drift
+		TEST_ASSERT_TRUE(scheduled.max_jitter_us[i] <= 1000 + 500);				// ms deadlines and other tasks' cost
+		TEST_ASSERT_TRUE(sched.GetStats(i).max_late_ms <= 1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_periodic_and_one_shot);
+	RUN_TEST(test_rearm_and_wrap);
+	RUN_TEST(test_idle_and_wake);
+	RUN_TEST(test_busy_long_run);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,520 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    SettingsJournal on the flash emulator of FS.h: replay at boot, coalesced bursts,
+                  power lost at every byte of a flush and of a compaction, each followed by a boot
+                  that must see every key at its old or its new value and a journal cut at its last
+                  good record that takes new records again, a save of the settings file that drops
+                  the journal only once it is written. Then flash bytes and writes per change
+                  against a rewrite of the full settings file, and the boot replay time, as JSON on
+                  stdout. Then the request size and peak heap of a setup page save of one key, as a
+                  PATCH of the diff against a POST of the whole form parsed and written back as the
+                  library does.
+
+                  JOURNAL_CHANGES changes of the long run, default 2000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+#include "SettingsJournal.cpp"
+#include "AlpacaActions.cpp"
+
+#define BURST_KEYS          4           // keys changed by one save of the setup page
+#define FULL_SETTINGS_FILE  "/settings.json"
+
+/**************************************************************************************************
+  peak heap: live bytes, interposed on glibc
+**************************************************************************************************/
+static int64_t heap_live, heap_peak;
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define HEAP_TRACKING   true
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+
+static void *heap_add(void *p)
+{
+	if( p ) {
+		heap_live += malloc_usable_size(p);
+		if( heap_live > heap_peak )
+			heap_peak = heap_live;
+	}
+	return p;
+}
+void *malloc(size_t size) { return heap_add(__libc_malloc(size)); }
+void *calloc(size_t n, size_t size) { return heap_add(__libc_calloc(n, size)); }
+void *realloc(void *p, size_t size) { heap_live -= p ? malloc_usable_size(p) : 0; return heap_add(__libc_realloc(p, size)); }
+void free(void *p) { heap_live -= p ? malloc_usable_size(p) : 0; __libc_free(p); }
+}
+#else
+#define HEAP_TRACKING   false
+#endif
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+// the devices: "<section>/<key>" to its JSON literal, key "Bad" refused
+static std::map<std::string, std::string> store;
+
+static bool apply(const char *section, const char *key, JsonVariantConst value)
+{
+	String text;
+
+	if( strcmp(key, "Bad") == 0 )
+		return false;
+	serializeJson(value, text);
+	store[std::string(section) + "/" + key] = text.c_str();
+	return true;
+}
+
+// a device of the board boots: new journal over the partition as it is
+struct Board
+{
+	AsyncWebServer server;
+	SettingsJournal journal;
+
+	Board() { store.clear(); journal.Begin(&server, apply); }
+	bool Set(const char *section, const char *key, const char *literal)
+	{
+		JsonDocument doc;
+
+		deserializeJson(doc, literal);
+		return journal.Set(section, key, doc.as<JsonVariantConst>());
+	}
+	void Settle()												// quiet time, pending written, compaction done
+	{
+		mock::advance_us(SETTINGS_COALESCE_MS * 1000);
+		journal.Loop(millis());
+		journal.Loop(millis());
+	}
+};
+
+static std::string host_path(const char *path) { return mock::fs_root + path; }
+
+static std::string read_file(const char *path)
+{
+	std::ifstream f(host_path(path), std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const char *path, const std::string &data)
+{
+	std::ofstream f(host_path(path), std::ios::binary | std::ios::trunc);
+	f << data;
+}
+
+static size_t record_size(const char *path, const char *literal) { return 8 + strlen(path) + strlen(literal); }
+
+void setUp(void)
+{
+	LittleFS.begin();
+	mock::fs_format();
+	mock::fs_power_on();
+	mock::fs_reset_counters();
+	mock::real_clock = false;
+	mock::set_ms(1000);
+}
+void tearDown(void) {}
+
+void test_replay(void)
+{
+	{
+		Board b;
+		TEST_ASSERT_TRUE(b.Set("Dome_Configuration", "Shutter_timeout", "90"));
+		TEST_ASSERT_TRUE(b.Set("Switch_Configuration", "Ch_17_name", "\"Dew heater\""));
+		TEST_ASSERT_FALSE(b.Set("Switch_Configuration", "Bad", "1"));
+		TEST_ASSERT_EQUAL_UINT32(0, mock::fs_bytes_written);			// nothing before the quiet time
+		b.Settle();
+		TEST_ASSERT_EQUAL_UINT32(1, b.journal.GetStats().flushes);
+	}
+	Board b;
+	TEST_ASSERT_EQUAL_UINT32(2, b.journal.GetStats().replayed);
+	TEST_ASSERT_EQUAL_UINT32(0, b.journal.GetStats().rejected);
+	TEST_ASSERT_EQUAL_STRING("90", store["Dome_Configuration/Shutter_timeout"].c_str());
+	TEST_ASSERT_EQUAL_STRING("\"Dew heater\"", store["Switch_Configuration/Ch_17_name"].c_str());
+}
+
+// a burst of changes of a few keys: one open, one record per key
+void test_coalescing(void)
+{
+	Board b;
+	char literal[8];
+
+	mock::fs_reset_counters();
+	for(uint32_t i = 0; i < 60; i++) {
+		snprintf(literal, sizeof(literal), "%u", i);
+		TEST_ASSERT_TRUE(b.Set("SafetyMonitor_Configuration", ( i % 3 == 0 ) ? "Rain_delay" : ( i % 3 == 1 ) ? "Power_delay" : "Tsky_limit", literal));
+		mock::advance_us(20000);
+		b.journal.Loop(millis());
+	}
+	TEST_ASSERT_EQUAL_UINT32(0, mock::fs_opens);
+	b.Settle();
+	TEST_ASSERT_EQUAL_UINT32(1, b.journal.GetStats().flushes);
+	TEST_ASSERT_EQUAL_UINT32(3, b.journal.GetStats().records_written);
+	TEST_ASSERT_EQUAL_UINT32(1, mock::fs_opens);
+
+	Board boot;
+	TEST_ASSERT_EQUAL_STRING("57", store["SafetyMonitor_Configuration/Rain_delay"].c_str());
+	TEST_ASSERT_EQUAL_STRING("59", store["SafetyMonitor_Configuration/Tsky_limit"].c_str());
+}
+
+static const char *const k_keys[BURST_KEYS] = { "Rain_delay", "Power_delay", "Wind_limit", "Hum_limit" };
+
+// power lost at every byte of a flush of BURST_KEYS records over a clean journal
+void test_power_loss_flush(void)
+{
+	size_t end[BURST_KEYS], total = 0;
+
+	for(uint32_t k = 0; k < BURST_KEYS; k++) {
+		total += record_size(( String("S/") + k_keys[k] ).c_str(), "222");
+		end[k] = total;
+	}
+
+	for(size_t budget = 0; budget <= total; budget++) {
+		mock::fs_format();
+		mock::fs_power_on();
+		{
+			Board b;
+			for(uint32_t k = 0; k < BURST_KEYS; k++)
+				b.Set("S", k_keys[k], "111");
+			b.Settle();
+			for(uint32_t k = 0; k < BURST_KEYS; k++)
+				b.Set("S", k_keys[k], "222");
+			mock::fs_power_budget = budget;
+			b.Settle();
+		}
+		mock::fs_power_on();
+
+		uint32_t complete = 0;
+		while(( complete < BURST_KEYS ) && ( end[complete] <= budget ))
+			complete++;
+		bool torn = ( budget > ( complete ? end[complete - 1] : 0 ));
+		{
+			Board b;											// old or new, never garbage
+			for(uint32_t k = 0; k < BURST_KEYS; k++)
+				TEST_ASSERT_EQUAL_STRING(k < complete ? "222" : "111", store[std::string("S/") + k_keys[k]].c_str());
+			TEST_ASSERT_EQUAL_UINT32(torn ? 1 : 0, b.journal.GetStats().rejected);
+			TEST_ASSERT_EQUAL_UINT32(total + ( complete ? end[complete - 1] : 0 ), read_file(SETTINGS_JOURNAL_FILE).size());	// torn tail cut at boot
+			b.Settle();
+			TEST_ASSERT_EQUAL_UINT32(0, b.journal.GetStats().compactions);
+			b.Set("S", "Stars_limit", "7");
+			b.Settle();
+		}
+		Board b;
+		TEST_ASSERT_EQUAL_UINT32(0, b.journal.GetStats().rejected);
+		TEST_ASSERT_EQUAL_STRING("7", store["S/Stars_limit"].c_str());
+		TEST_ASSERT_EQUAL_UINT32(BURST_KEYS + 1, store.size());
+	}
+}
+
+// a torn tail in a journal with more keys than a compaction takes: cut at boot, later records kept
+void test_torn_tail_not_compacted(void)
+{
+	char key[16];
+	size_t size;
+
+	{
+		Board b;
+		for(uint32_t i = 0; i <= SETTINGS_MAX_KEYS; i++) {
+			snprintf(key, sizeof(key), "K%u", i);
+			b.Set("S", key, "1");
+			if( i % SETTINGS_MAX_PENDING == SETTINGS_MAX_PENDING - 1 )
+				b.Settle();
+		}
+		b.Settle();
+		size = read_file(SETTINGS_JOURNAL_FILE).size();
+		TEST_ASSERT_TRUE(size < SETTINGS_JOURNAL_MAX);
+		b.Set("S", "K0", "2");
+		mock::fs_power_budget = 5;								// torn record
+		b.Settle();
+	}
+	mock::fs_power_on();
+	{
+		Board b;
+		TEST_ASSERT_EQUAL_UINT32(SETTINGS_MAX_KEYS + 1, b.journal.GetStats().replayed);
+		TEST_ASSERT_EQUAL_UINT32(1, b.journal.GetStats().rejected);
+		TEST_ASSERT_EQUAL_UINT32(size, read_file(SETTINGS_JOURNAL_FILE).size());
+		b.Set("S", "K0", "3");
+		b.Settle();
+	}
+	Board b;
+	TEST_ASSERT_EQUAL_UINT32(0, b.journal.GetStats().rejected);
+	TEST_ASSERT_EQUAL_STRING("3", store["S/K0"].c_str());
+}
+
+// power lost at every byte of a compaction: the journal is replaced whole or not at all
+void test_power_loss_compaction(void)
+{
+	std::string journal;										// before the flush that starts the compaction
+	size_t compacted, last;
+	char literal[8];
+	uint32_t i;
+
+	{
+		Board b;
+		for(i = 0; ( i < 1000 ) && ( b.journal.GetStats().compactions == 0 ); i++) {
+			snprintf(literal, sizeof(literal), "%u", i);
+			journal = read_file(SETTINGS_JOURNAL_FILE);
+			b.Set("SafetyMonitor_Configuration", k_keys[i % BURST_KEYS], literal);
+			b.Settle();
+		}
+		compacted = read_file(SETTINGS_JOURNAL_FILE).size();
+		TEST_ASSERT_EQUAL_UINT32(1, b.journal.GetStats().compactions);
+		TEST_ASSERT_TRUE(compacted < SETTINGS_JOURNAL_MAX / 10);
+	}
+	std::string key = k_keys[( i - 1 ) % BURST_KEYS];
+	last = record_size(( "SafetyMonitor_Configuration/" + key ).c_str(), literal);
+	Board ref;
+	std::map<std::string, std::string> expected = store;
+	TEST_ASSERT_EQUAL_UINT32(BURST_KEYS, expected.size());
+
+	for(size_t budget = 0; budget <= compacted; budget++) {
+		mock::fs_format();
+		mock::fs_power_on();
+		write_file(SETTINGS_JOURNAL_FILE, journal);
+		{
+			Board b;
+			b.Set("SafetyMonitor_Configuration", key.c_str(), literal);
+			mock::fs_power_budget = last + budget;				// the flush completes, the compaction is cut
+			b.Settle();
+		}
+		mock::fs_power_on();
+		{
+			Board b;
+			TEST_ASSERT_TRUE(expected == store);
+			TEST_ASSERT_FALSE(LittleFS.exists(SETTINGS_JOURNAL_TMP));
+			TEST_ASSERT_EQUAL_UINT32(0, b.journal.GetStats().rejected);
+			b.Settle();											// compacted again
+			TEST_ASSERT_EQUAL_UINT32(1, b.journal.GetStats().compactions);
+		}
+		Board b;
+		TEST_ASSERT_TRUE(expected == store);
+		TEST_ASSERT_EQUAL_UINT32(compacted, read_file(SETTINGS_JOURNAL_FILE).size());
+	}
+}
+
+// Save of the setup page: the journal is dropped only once the settings file is written
+void test_save(void)
+{
+	{
+		Board b;
+		b.Set("Dome_Configuration", "Shutter_timeout", "90");
+		b.Settle();
+		b.Set("SafetyMonitor_Configuration", "Rain_delay", "30");		// still pending
+		TEST_ASSERT_FALSE(b.journal.Save([]() { return false; }));		// file write failed: keep everything
+		b.Settle();
+	}
+	{
+		Board b;
+		TEST_ASSERT_EQUAL_UINT32(2, b.journal.GetStats().replayed);
+		b.Set("Dome_Configuration", "Shutter_timeout", "120");
+		TEST_ASSERT_TRUE(b.journal.Save([]() { write_file(FULL_SETTINGS_FILE, "{}"); return true; }));
+		TEST_ASSERT_FALSE(LittleFS.exists(SETTINGS_JOURNAL_FILE));
+		b.Settle();													// the pending change is in the file, not written again
+		TEST_ASSERT_FALSE(LittleFS.exists(SETTINGS_JOURNAL_FILE));
+		b.Set("Dome_Configuration", "Shutter_timeout", "150");			// journaled again after the save
+		b.Settle();
+	}
+	Board b;
+	TEST_ASSERT_EQUAL_UINT32(1, b.journal.GetStats().replayed);
+	TEST_ASSERT_EQUAL_STRING("150", store["Dome_Configuration/Shutter_timeout"].c_str());
+}
+
+void test_http(void)
+{
+	Board b;
+	AsyncWebServerRequest put(HTTP_PUT, SETTINGS_JOURNAL_URL);
+	AsyncWebServerRequest patch(HTTP_PATCH, SETTINGS_JOURNAL_URL);
+	AsyncWebServerRequest get(HTTP_GET, SETTINGS_JOURNAL_URL);
+	JsonDocument reply;
+
+	put.AddParam("Section", "Dome_Configuration", true);
+	put.AddParam("Key", "Use_limit_switches", true);
+	put.AddParam("Value", "true", true);
+	TEST_ASSERT_EQUAL(200, b.server.Dispatch(&put)->code());
+	TEST_ASSERT_EQUAL_STRING("true", store["Dome_Configuration/Use_limit_switches"].c_str());
+
+	patch.SetBody("{\"switch\":{\"Switch_Configuration\":{\"Ch_16_name\":\"Flat\",\"Bad\":1}}}");
+	TEST_ASSERT_EQUAL(400, b.server.Dispatch(&patch)->code());
+	TEST_ASSERT_TRUE(deserializeJson(reply, patch.Response()->body()) == DeserializationError::Ok);
+	TEST_ASSERT_EQUAL(1, reply["applied"].as<int>());
+	TEST_ASSERT_EQUAL_STRING("/switch/Switch_Configuration/Bad", reply["rejected"][0].as<const char *>());
+	TEST_ASSERT_EQUAL_STRING("\"Flat\"", store["Switch_Configuration/Ch_16_name"].c_str());
+
+	b.Settle();
+	TEST_ASSERT_TRUE(deserializeJson(reply, b.server.Dispatch(&get)->body()) == DeserializationError::Ok);
+	TEST_ASSERT_EQUAL(2, reply["changes"].as<int>());
+	TEST_ASSERT_EQUAL(1, reply["flushes"].as<int>());
+	TEST_ASSERT_EQUAL_UINT32(mock::fs_bytes_written, reply["bytes_written"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(read_file(SETTINGS_JOURNAL_FILE).size(), reply["journal_size"].as<uint32_t>());
+}
+
+/**************************************************************************************************
+  benchmark
+**************************************************************************************************/
+
+// the settings file as the library writes it on every save: Dome, 20 Switch channels, SafetyMonitor
+static String full_settings()
+{
+	JsonDocument doc;
+	String out;
+	char name[16];
+
+	doc["Dome"]["Dome_Configuration"]["Use_limit_switches"] = "true";
+	doc["Dome"]["Dome_Configuration"]["Shutter_timeout"] = 60;
+	for(uint32_t ch = 0; ch < 20; ch++) {
+		snprintf(name, sizeof(name), "Ch_%u", ch);
+		JsonObject c = doc["Switch"]["Switch_Configuration"][name].to<JsonObject>();
+		c["Name"] = "Channel name";
+		c["Description"] = "Channel description for the client";
+		c["Min"] = 0;
+		c["Max"] = ch < 16 ? 1 : 100;
+	}
+	for(const char *rule : { "Rain", "Power", "Tsky", "Wind", "Hum", "Light", "Tair", "WsRain", "Clouds", "Stars" }) {
+		JsonObject r = doc["SafetyMonitor"]["SafetyMonitor_Configuration"][rule].to<JsonObject>();
+		r["Use"] = true;
+		r["Limit"] = -15;
+		r["Hysteresis"] = 2;
+		r["Trip_delay"] = -1;
+		r["Clear_delay"] = -1;
+	}
+	serializeJson(doc, out);
+	return out;
+}
+
+void test_benchmark(void)
+{
+	uint32_t changes = strtoul(env("JOURNAL_CHANGES", "2000"), NULL, 10);
+	uint32_t seed = 3, bursts = 0;
+	size_t full = full_settings().length();
+	char literal[8];
+
+	Board b;
+	for(uint32_t i = 0; i < changes; ) {						// setup page saves of 1..BURST_KEYS keys
+		seed = seed * 1664525 + 1013904223;
+		uint32_t n = 1 + ( seed >> 8 ) % BURST_KEYS;
+
+		for(uint32_t k = 0; ( k < n ) && ( i < changes ); k++, i++) {
+			snprintf(literal, sizeof(literal), "%u", ( seed >> 12 ) % 600);
+			b.Set("SafetyMonitor_Configuration", k_keys[( k + ( seed >> 4 )) % BURST_KEYS], literal);
+			mock::advance_us(100000);
+		}
+		bursts++;
+		b.Settle();
+	}
+	const SettingsJournalStats_t &s = b.journal.GetStats();
+	size_t journal_size = read_file(SETTINGS_JOURNAL_FILE).size();
+	uint64_t bytes = mock::fs_bytes_written;
+	uint32_t writes = mock::fs_write_calls, opens = mock::fs_opens;
+
+	std::string record, worst;									// journal just below the limit, replayed at boot
+	mock::fs_format();
+	{
+		Board one;
+		one.Set("SafetyMonitor_Configuration", "Rain_delay", "600");
+		one.Settle();
+		record = read_file(SETTINGS_JOURNAL_FILE);
+	}
+	while( worst.size() + record.size() <= SETTINGS_JOURNAL_MAX )
+		worst += record;
+	write_file(SETTINGS_JOURNAL_FILE, worst);
+	auto t0 = std::chrono::steady_clock::now();
+	Board boot;
+	auto t1 = std::chrono::steady_clock::now();
+
+	printf("{\"bench\":\"settings_journal\",\"changes\":%u,\"saves\":%u,\"full_file_bytes\":%u,"
+		"\"journal\":{\"bytes_per_change\":%.1f,\"flash_writes_per_save\":%.2f,\"opens_per_save\":%.2f,\"compactions\":%u,\"size\":%u},"
+		"\"full_rewrite\":{\"bytes_per_change\":%.1f,\"opens_per_save\":1},"
+		"\"boot_replay\":{\"records\":%u,\"bytes\":%u,\"us\":%.0f}}\n",
+		changes, bursts, (unsigned)full, (double)bytes / changes, (double)writes / bursts,
+		(double)opens / bursts, s.compactions, (unsigned)journal_size,
+		(double)full * bursts / changes, boot.journal.GetStats().replayed, (unsigned)worst.size(),
+		std::chrono::duration<double, std::micro>(t1 - t0).count());
+
+	TEST_ASSERT_EQUAL_UINT32(bursts, s.flushes);
+	TEST_ASSERT_TRUE(s.bytes_written == bytes);
+	TEST_ASSERT_TRUE(bytes * 10 < (uint64_t)full * bursts);
+	TEST_ASSERT_TRUE(journal_size <= SETTINGS_JOURNAL_MAX);
+	TEST_ASSERT_EQUAL_UINT32(0, boot.journal.GetStats().rejected);
+}
+
+// the whole form as the library takes it: parsed, every key to its device, the file written back
+static void post_full_form(const String &body)
+{
+	JsonDocument doc;
+
+	deserializeJson(doc, body);
+	for(JsonPair device : doc.as<JsonObject>())
+		for(JsonPair section : device.value().as<JsonObject>())
+			for(JsonPair kv : section.value().as<JsonObject>())
+				apply(section.key().c_str(), kv.key().c_str(), kv.value());
+
+	String text;
+	serializeJson(doc, text);
+	File f = LittleFS.open(FULL_SETTINGS_FILE, "w");
+	f.print(text);
+	f.close();
+}
+
+// one key changed on the setup page, heap above what was in use when the request arrived
+void test_patch_request(void)
+{
+	const String full = full_settings();
+	const String diff = "{\"SafetyMonitor\":{\"SafetyMonitor_Configuration\":{\"Wind_limit\":45}}}";
+	Board b;
+	int64_t full_peak, patch_peak;
+	uint64_t full_bytes, patch_bytes;
+
+	mock::fs_reset_counters();
+	heap_peak = heap_live;
+	int64_t base = heap_live;
+	post_full_form(full);
+	full_peak = heap_peak - base;
+	full_bytes = mock::fs_bytes_written;
+
+	AsyncWebServerRequest patch(HTTP_PATCH, SETTINGS_JOURNAL_URL);
+	patch.SetBody(diff);
+	mock::fs_reset_counters();
+	heap_peak = heap_live;
+	base = heap_live;
+	TEST_ASSERT_EQUAL(200, b.server.Dispatch(&patch)->code());
+	b.Settle();
+	patch_peak = heap_peak - base;
+	patch_bytes = mock::fs_bytes_written;
+	TEST_ASSERT_EQUAL_STRING("45", store["SafetyMonitor_Configuration/Wind_limit"].c_str());
+
+	printf("{\"bench\":\"settings_patch\",\"heap_tracking\":%s,\"post_full\":{\"request_bytes\":%u,\"peak_heap\":%lld,\"flash_bytes\":%llu},"
+		"\"patch\":{\"request_bytes\":%u,\"peak_heap\":%lld,\"flash_bytes\":%llu}}\n",
+		HEAP_TRACKING ? "true" : "false", (unsigned)full.length(), (long long)full_peak, (unsigned long long)full_bytes,
+		(unsigned)diff.length(), (long long)patch_peak, (unsigned long long)patch_bytes);
+
+	TEST_ASSERT_TRUE(diff.length() * 10 < full.length());
+	TEST_ASSERT_TRUE(patch_bytes * 10 < full_bytes);
+	if( HEAP_TRACKING )
+		TEST_ASSERT_TRUE(patch_peak < full_peak);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_replay);
+	RUN_TEST(test_coalescing);
+	RUN_TEST(test_power_loss_flush);
+	RUN_TEST(test_torn_tail_not_compacted);
+	RUN_TEST(test_power_loss_compaction);
+	RUN_TEST(test_save);
+	RUN_TEST(test_http);
+	RUN_TEST(test_benchmark);
+	RUN_TEST(test_patch_request);
+	return UNITY_END();
+}
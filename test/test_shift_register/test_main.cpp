@@ -0,0 +1,205 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    shift register transports against a 74HC165/74HC595 chain model on the mock pins.
+                  Checks that the bit bang, GPIO register and SPI transports read and write the
+                  same words, and reports per transfer CPU pin writes, pin toggles, GPIO API calls,
+                  register accesses, SPI bits and modelled bus time as JSON on stdout.
+
+                  modelled time = virtual clock (delays, SPI bits at SR_SPI_CLOCK)
+                                  + GPIO API calls x COST_GPIO_CALL_NS
+                                  + register accesses x COST_REG_NS (includes sr_settle())
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <string>
+
+#include "ShiftRegister.cpp"
+
+#define COST_GPIO_CALL_NS   250     // digitalWrite()/digitalRead() on the ESP32 Arduino core
+#define COST_REG_NS         100     // one W1TS/W1TC/IN access and the following settle nops
+#define TRANSFERS           1000
+
+/**************************************************************************************************
+  chain model: two 74HC165 and two 74HC595 in series, 16 bits each
+**************************************************************************************************/
+struct Chain_t {
+	uint16_t inputs;				// levels on the 165 parallel inputs
+	uint16_t in_shift;				// 165 shift register, Q7 is the MSB
+	uint16_t out_shift;				// 595 shift register
+	uint16_t outputs;				// 595 storage register
+	bool outputs_enabled;
+};
+static Chain_t chain;
+
+static void chain_q7() { mock::pin_hw(SR_IN_PIN_SDIN, ( chain.in_shift & 0x8000 ) ? HIGH : LOW); }
+
+static void chain_edge(uint8_t pin, uint8_t level)
+{
+	switch( pin ) {
+	case SR_IN_PIN_PL:
+		if( level == LOW ) {					// asynchronous parallel load
+			chain.in_shift = chain.inputs;
+			chain_q7();
+		}
+		break;
+	case SR_IN_PIN_CP:
+		if(( level == HIGH ) && ( mock::pin_level[SR_IN_PIN_CE] == LOW ) && ( mock::pin_level[SR_IN_PIN_PL] == HIGH )) {
+			chain.in_shift <<= 1;				// DS of the last 165 tied low
+			chain_q7();
+		}
+		break;
+	case SR_OUT_PIN_SHCP:
+		if( level == HIGH ) {
+			if( mock::pin_level[SR_OUT_PIN_MR] == LOW )
+				chain.out_shift = 0;
+			else
+				chain.out_shift = (chain.out_shift << 1) | mock::pin_level[SR_OUT_PIN_SDOUT];
+		}
+		break;
+	case SR_OUT_PIN_MR:
+		if( level == LOW )
+			chain.out_shift = 0;
+		break;
+	case SR_OUT_PIN_STCP:
+		if( level == HIGH )
+			chain.outputs = chain.out_shift;
+		break;
+	case SR_OUT_PIN_OE:
+		chain.outputs_enabled = ( level == LOW );
+		break;
+	}
+}
+
+static void chain_begin()
+{
+	mock::gpio_reset();
+	memset(&chain, 0, sizeof(chain));
+	// idle levels set by init_IO(): CE, PL, MR and OE high, clocks low
+	mock::pin_level[SR_IN_PIN_CE] = HIGH;
+	mock::pin_level[SR_IN_PIN_PL] = HIGH;
+	mock::pin_level[SR_OUT_PIN_MR] = HIGH;
+	mock::pin_level[SR_OUT_PIN_OE] = HIGH;
+	mock::on_write = chain_edge;
+	mock::virtual_us = 0;
+	mock::reg_writes = mock::reg_reads = 0;
+	mock::spi_bits = mock::spi_transactions = 0;
+}
+
+static uint16_t next_word(uint32_t &seed)
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 16;
+}
+
+/**************************************************************************************************
+  tests
+**************************************************************************************************/
+typedef struct {
+	const char *name;
+	double pin_writes;				// per read + write pair
+	double pin_toggles;
+	double gpio_calls;
+	double reg_ops;
+	double spi_bits;
+	double virtual_us;
+	double modelled_us;
+	uint32_t max_read_us;			// from the transport statistics
+	uint32_t max_write_us;
+} Result_t;
+
+static Result_t results[3];
+
+static void loopback(ShiftRegisterBus &bus, Result_t &r)
+{
+	uint32_t seed = 12345;
+	const uint16_t fixed[] = { 0x0000, 0xFFFF, 0x8001, 0x5555, 0xAAAA, 0x00FF, 0xFF00 };
+
+	chain_begin();
+	bus.Begin();
+	for(uint32_t i = 0; i < TRANSFERS; i++) {
+		uint16_t in = ( i < sizeof(fixed) / sizeof(fixed[0]) ) ? fixed[i] : next_word(seed);
+		uint16_t out = next_word(seed);
+
+		chain.inputs = in;
+		TEST_ASSERT_EQUAL_HEX16(in, bus.Read());
+		bus.Write(out);
+		TEST_ASSERT_EQUAL_HEX16(out, chain.outputs);
+		TEST_ASSERT_TRUE(chain.outputs_enabled);
+		TEST_ASSERT_EQUAL(HIGH, mock::pin_level[SR_IN_PIN_CE]);		// 165 released
+	}
+
+	r.pin_writes = (double)mock::total_writes() / TRANSFERS;
+	r.pin_toggles = (double)mock::total_toggles() / TRANSFERS;
+	r.gpio_calls = (double)mock::gpio_calls / TRANSFERS;
+	r.reg_ops = (double)(mock::reg_writes + mock::reg_reads) / TRANSFERS;
+	r.spi_bits = (double)mock::spi_bits / TRANSFERS;
+	r.virtual_us = (double)mock::virtual_us.load() / TRANSFERS;
+	r.modelled_us = r.virtual_us + (r.gpio_calls * COST_GPIO_CALL_NS + r.reg_ops * COST_REG_NS) / 1000.0;
+	r.max_read_us = bus.GetStats().max_read_us;
+	r.max_write_us = bus.GetStats().max_write_us;
+	TEST_ASSERT_EQUAL_UINT32(TRANSFERS, bus.GetStats().reads);
+	TEST_ASSERT_EQUAL_UINT32(TRANSFERS, bus.GetStats().writes);
+}
+
+void setUp(void) {}
+void tearDown(void) { mock::on_write = nullptr; }
+
+void test_bitbang(void)
+{
+	ShiftRegisterBitBang bus;
+	results[0].name = "bitbang";
+	loopback(bus, results[0]);
+}
+
+void test_gpio(void)
+{
+	ShiftRegisterGpio bus;
+	results[1].name = "gpio";
+	loopback(bus, results[1]);
+}
+
+void test_spi(void)
+{
+	ShiftRegisterSpi bus;
+	results[2].name = "spi";
+	loopback(bus, results[2]);
+	TEST_ASSERT_EQUAL_UINT32(2 * TRANSFERS, mock::spi_transactions);
+}
+
+// GPIO keeps the bit bang waveform without the API calls and delays, SPI moves the clock and data
+// edges off the CPU
+void test_benchmark(void)
+{
+	std::string json = "{\"bench\":\"shift_register\",\"transfers\":" + std::to_string(TRANSFERS) + ",\"per_transfer\":{";
+	char buf[320];
+
+	for(uint8_t i = 0; i < 3; i++) {
+		const Result_t &r = results[i];
+		snprintf(buf, sizeof(buf), "%s\"%s\":{\"pin_writes\":%.1f,\"pin_toggles\":%.1f,\"gpio_calls\":%.1f,\"reg_ops\":%.1f,"
+			"\"spi_bits\":%.1f,\"virtual_us\":%.2f,\"modelled_us\":%.2f,\"max_read_us\":%u,\"max_write_us\":%u}",
+			i ? "," : "", r.name, r.pin_writes, r.pin_toggles, r.gpio_calls, r.reg_ops, r.spi_bits, r.virtual_us, r.modelled_us,
+			r.max_read_us, r.max_write_us);
+		json += buf;
+	}
+	json += "}}";
+	printf("%s\n", json.c_str());
+
+	TEST_ASSERT_TRUE(results[1].modelled_us < results[0].modelled_us / 4);
+	TEST_ASSERT_TRUE(results[2].modelled_us < results[0].modelled_us / 2);
+	TEST_ASSERT_TRUE(results[2].pin_toggles < results[0].pin_toggles / 4);
+	TEST_ASSERT_TRUE(results[1].gpio_calls == 0.0);
+	TEST_ASSERT_TRUE(results[2].gpio_calls == 0.0);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_bitbang);
+	RUN_TEST(test_gpio);
+	RUN_TEST(test_spi);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,203 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    seqlock Snapshot<WeatherSnapshot>: stress with one writer and several readers on
+                  std::thread, every frame read must be one the writer published and versions never
+                  go back. Unprotected copies of the same data are counted as a reference. Then the
+                  uncontended read cost against a mutex guarded copy and the former loose globals,
+                  as JSON on stdout.
+
+                  SNAP_WRITES     frames published by the writer, default 2000000
+                  SNAP_READERS    reader threads, default 3
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <vector>
+#include <chrono>
+
+#include "WeatherSnapshot.h"
+
+#define BENCH_READS         10000000
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static Snapshot<WeatherSnapshot> snap;
+static WeatherSnapshot unprotected;
+static std::atomic<bool> writing;
+
+// frame k: every field a different function of k, so a mix of two frames is always detected
+static void make(WeatherSnapshot &w, uint32_t k)
+{
+	int16_t *v = (int16_t *)&w.values;
+
+	for(uint8_t i = 0; i < WS_FRAME_FIELDS * ( 1 + WS_FILTERS ); i++)
+		v[i] = (int16_t)(k * ( 2 * i + 1 ));
+	w.timestamp_ms = k * 3;
+	w.frames = k;
+}
+
+static bool coherent(const WeatherSnapshot &w)
+{
+	WeatherSnapshot ref;
+
+	make(ref, w.frames);
+	return memcmp(&ref, &w, sizeof(w)) == 0;
+}
+
+typedef struct {
+	uint32_t reads;
+	uint32_t torn;
+	uint32_t regressions;					// version lower than the previous read
+	uint32_t mismatched;					// version is not the one of the frame
+	uint32_t try_busy;						// TryRead() during a write
+	uint32_t unprotected_torn;
+} ReaderStats_t;
+
+static void reader(ReaderStats_t *r)
+{
+	uint32_t last = 0;
+	WeatherSnapshot w;
+
+	while( writing ) {
+		uint32_t version = snap.Read(w);
+		r->reads++;
+		if( !coherent(w) )
+			r->torn++;
+		if( version < last )
+			r->regressions++;
+		if( version != w.frames + 1 )				// Write() k + 1 published frame k
+			r->mismatched++;
+		last = version;
+
+		if( !snap.TryRead(w, &version) )
+			r->try_busy++;
+		else if( !coherent(w) || ( version != w.frames + 1 ))
+			r->torn++;
+
+		memcpy(&w, (const void *)&unprotected, sizeof(w));
+		if( !coherent(w) )
+			r->unprotected_torn++;
+	}
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_version_and_age(void)
+{
+	Snapshot<WeatherSnapshot> s;
+	WeatherSnapshot w = {};
+
+	mock::real_clock = false;
+	mock::set_ms(5000);
+	TEST_ASSERT_EQUAL_UINT32(0, s.GetVersion());
+	TEST_ASSERT_EQUAL_UINT32(0, s.Read(w));
+	TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, weather_age_ms(w));		// nothing received yet
+
+	make(w, 1);
+	w.timestamp_ms = 4200;
+	s.Write(w);
+	s.Write(w);
+	memset(&w, 0, sizeof(w));
+	TEST_ASSERT_EQUAL_UINT32(2, s.Read(w));
+	TEST_ASSERT_EQUAL_UINT32(2, s.GetVersion());
+	TEST_ASSERT_EQUAL_UINT32(800, weather_age_ms(w));
+	uint32_t version = 0;
+	TEST_ASSERT_TRUE(s.TryRead(w, &version));
+	TEST_ASSERT_EQUAL_UINT32(2, version);
+	TEST_ASSERT_EQUAL_INT16(17, w.filtered[0].tsky);
+}
+
+void test_stress(void)
+{
+	uint32_t writes = strtoul(env("SNAP_WRITES", "2000000"), NULL, 10);
+	uint32_t readers = strtoul(env("SNAP_READERS", "3"), NULL, 10);
+	std::vector<ReaderStats_t> stats(readers);
+	std::vector<std::thread> threads;
+	ReaderStats_t sum = {};
+	WeatherSnapshot w;
+
+	mock::real_clock = true;
+	make(w, 0);
+	snap.Write(w);
+	make(unprotected, 0);
+	writing = true;
+	for(uint32_t i = 0; i < readers; i++)
+		threads.emplace_back(reader, &stats[i]);
+
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t k = 1; k < writes; k++) {
+		make(w, k);
+		snap.Write(w);
+		memcpy((void *)&unprotected, &w, sizeof(w));
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	writing = false;
+	for(std::thread &t : threads)
+		t.join();
+
+	for(const ReaderStats_t &r : stats) {
+		sum.reads += r.reads;
+		sum.torn += r.torn;
+		sum.regressions += r.regressions;
+		sum.mismatched += r.mismatched;
+		sum.try_busy += r.try_busy;
+		sum.unprotected_torn += r.unprotected_torn;
+	}
+	printf("{\"bench\":\"snapshot_stress\",\"writes\":%u,\"readers\":%u,\"host_cores\":%u,\"write_ns\":%.1f,\"reads\":%u,"
+		"\"torn\":%u,\"regressions\":%u,\"mismatched\":%u,\"try_busy\":%u,\"unprotected_torn\":%u}\n",
+		writes, readers, std::thread::hardware_concurrency(), std::chrono::duration<double, std::nano>(t1 - t0).count() / writes,
+		sum.reads, sum.torn, sum.regressions, sum.mismatched, sum.try_busy, sum.unprotected_torn);
+
+	TEST_ASSERT_TRUE(sum.reads > 0);
+	TEST_ASSERT_EQUAL_UINT32(0, sum.torn);
+	TEST_ASSERT_EQUAL_UINT32(0, sum.regressions);
+	TEST_ASSERT_EQUAL_UINT32(0, sum.mismatched);
+	snap.Read(w);
+	TEST_ASSERT_EQUAL_UINT32(writes - 1, w.frames);
+}
+
+// single reader, no writer: cost of one coherent frame
+void test_read_cost(void)
+{
+	static volatile int16_t weather_tsky, weather_tair, weather_wind, weather_hum, weather_light, weather_rain, weather_clouds, weather_stars;
+	std::mutex m;
+	WeatherSnapshot guarded, w;
+	volatile uint32_t sink = 0;
+
+	make(guarded, 7);
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_READS; i++) {
+		snap.Read(w);
+		sink = sink + w.values.tsky;
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_READS; i++) {
+		m.lock();
+		memcpy(&w, &guarded, sizeof(w));
+		m.unlock();
+		sink = sink + w.values.tsky;
+	}
+	auto t2 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_READS; i++)			// the former globals, no filters and no frame consistency
+		sink = sink + weather_tsky + weather_tair + weather_wind + weather_hum + weather_light + weather_rain + weather_clouds + weather_stars;
+	auto t3 = std::chrono::steady_clock::now();
+
+	double seqlock_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_READS;
+	double mutex_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / BENCH_READS;
+	double globals_ns = std::chrono::duration<double, std::nano>(t3 - t2).count() / BENCH_READS;
+	printf("{\"bench\":\"snapshot_read\",\"bytes\":%u,\"reads\":%u,\"seqlock_ns\":%.1f,\"mutex_ns\":%.1f,\"globals_ns\":%.1f}\n",
+		(unsigned)sizeof(WeatherSnapshot), BENCH_READS, seqlock_ns, mutex_ns, globals_ns);
+	TEST_ASSERT_TRUE(seqlock_ns > 0);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_version_and_age);
+	RUN_TEST(test_stress);
+	RUN_TEST(test_read_cost);
+	return UNITY_END();
+}
@@ -0,0 +1,375 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    streaming filters against floating point and brute force references: EMA within
+                  one unit, sliding max on rising, falling, flat and random input, running median with
+                  duplicates, rate of change with stalls and clamped steps, WeatherFilters with
+                  channels without sensor. Then a weather trace through WeatherFilters: the largest
+                  error of every filter and channel, the threshold crossings of a noisy wind and sky
+                  temperature raw and filtered, and the cost per sample, as JSON on stdout.
+
+                  WS_TRACE    trace file of frames, lines t_ms,tsky,tair,wind,hum,rain,light,clouds,stars
+                              and # comments, default a synthetic night at 1 Hz
+                  WS_SAMPLES  samples of the cost measure, default 2000000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "StreamFilters.cpp"
+
+#define NIGHT_S             ( 10 * 3600 )
+#define WIND_LIMIT          40          // km/h, the default wind limit of the safety rules
+#define TSKY_LIMIT          -150        // 0.1°C
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static uint32_t rnd(uint32_t &seed)
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+/**************************************************************************************************
+  filters one by one
+**************************************************************************************************/
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_ema(void)
+{
+	uint32_t seed = 1;
+
+	for(uint8_t shift = 1; shift <= 5; shift++) {
+		EmaFilter ema;
+		double ref = 0;
+		int16_t v = 0;
+
+		for(uint32_t i = 0; i < 100000; i++) {
+			if( i % 5000 == 0 )										// steps over the full range
+				v = (int16_t)(rnd(seed) % 65536 - 32768);
+			else
+				v = (int16_t)constrain((int32_t)v + (int32_t)(rnd(seed) % 201) - 100, INT16_MIN, INT16_MAX);
+
+			ref = ( i == 0 ) ? v : ref + ( v - ref ) / ( 1 << shift );
+			TEST_ASSERT_TRUE(fabs(ema.Update(v, shift) - ref) <= 1.0);	// Q8 truncation, bounded
+		}
+	}
+}
+
+template <uint8_t N>
+static void check_max(const std::vector<int16_t> &in)
+{
+	SlidingMax<N> m;
+
+	for(size_t i = 0; i < in.size(); i++) {
+		int16_t ref = *std::max_element(in.begin() + ( i + 1 > N ? i + 1 - N : 0 ), in.begin() + i + 1);
+		TEST_ASSERT_EQUAL(ref, m.Update(in[i]));
+	}
+}
+
+void test_sliding_max(void)
+{
+	std::vector<int16_t> rising, falling, flat, random, saw;
+	uint32_t seed = 2;
+
+	for(int32_t i = 0; i < 1000; i++) {
+		rising.push_back((int16_t)i);
+		falling.push_back((int16_t)(1000 - i));						// every sample is a new back, the front expires
+		flat.push_back(7);
+		random.push_back((int16_t)(rnd(seed) % 65536 - 32768));
+		saw.push_back((int16_t)(( i % 23 ) * (( i / 23 ) % 2 ? -1 : 1)));
+	}
+	for(const auto *in : { &rising, &falling, &flat, &random, &saw }) {
+		check_max<1>(*in);
+		check_max<2>(*in);
+		check_max<WS_GUST_SAMPLES>(*in);
+		check_max<64>(*in);
+	}
+}
+
+template <uint8_t N>
+static void check_median(const std::vector<int16_t> &in)
+{
+	RunningMedian<N> m;
+
+	for(size_t i = 0; i < in.size(); i++) {
+		std::vector<int16_t> w(in.begin() + ( i + 1 > N ? i + 1 - N : 0 ), in.begin() + i + 1);
+		std::sort(w.begin(), w.end());
+		TEST_ASSERT_EQUAL(w[w.size() / 2], m.Update(in[i]));
+	}
+}
+
+void test_running_median(void)
+{
+	std::vector<int16_t> random, few, falling;
+	uint32_t seed = 3;
+
+	for(int32_t i = 0; i < 5000; i++) {
+		random.push_back((int16_t)(rnd(seed) % 65536 - 32768));
+		few.push_back((int16_t)(rnd(seed) % 3));						// duplicates
+		falling.push_back((int16_t)(-i));
+	}
+	for(const auto *in : { &random, &few, &falling }) {
+		check_median<1>(*in);
+		check_median<3>(*in);
+		check_median<WS_MEDIAN_SAMPLES>(*in);
+		check_median<9>(*in);
+	}
+}
+
+void test_rate_of_change(void)
+{
+	RateOfChange roc;
+	uint32_t seed = 4, t = 0;
+	int16_t prev = 0;
+
+	TEST_ASSERT_EQUAL(0, roc.Update(100, 0));							// first sample
+	prev = 100;
+	for(uint32_t i = 0; i < 100000; i++) {
+		uint32_t dt = ( i % 17 == 0 ) ? 0 : 200 + rnd(seed) % 5000;	// stalls: same ms, no rate
+		int16_t v = (int16_t)(rnd(seed) % 65536 - 32768);
+		double ref = dt ? ( v - prev ) * 60000.0 / dt : 0;
+
+		t += dt;
+		ref = std::max(-32768.0, std::min(32767.0, ref));
+		TEST_ASSERT_TRUE(fabs(roc.Update(v, t) - ref) < 1.0);		// integer division
+		prev = v;
+	}
+	TEST_ASSERT_EQUAL(INT16_MAX, roc.Update(32767, t + 1));			// 1 ms step, clamped
+}
+
+void test_weather_filters(void)
+{
+	WeatherFilters filters;
+	WeatherFrame out[WS_FILTERS];
+	WeatherFrame f = { -200, 100, 10, 50, 0, 300, -1, 25 };
+
+	filters.Update(f, 1000, out);
+	for(uint8_t i = 0; i < WS_FILTERS; i++) {
+		TEST_ASSERT_EQUAL(-1, out[i].clouds);							// no sensor stays -1
+		TEST_ASSERT_EQUAL(i == WS_FILTER_ROC ? 0 : 25, out[i].stars);
+	}
+	f.wind = 30;
+	f.stars = -1;
+	filters.Update(f, 61000, out);
+	TEST_ASSERT_EQUAL(15, out[WS_FILTER_EMA].wind);
+	TEST_ASSERT_EQUAL(30, out[WS_FILTER_MAX].wind);
+	TEST_ASSERT_EQUAL(30, out[WS_FILTER_MEDIAN].wind);					// upper of two
+	TEST_ASSERT_EQUAL(5, out[WS_FILTER_ROC].wind);						// of the EMA, per minute
+	TEST_ASSERT_EQUAL(-1, out[WS_FILTER_MAX].stars);
+	f.stars = 35;
+	filters.Update(f, 62000, out);
+	TEST_ASSERT_EQUAL(35, out[WS_FILTER_MAX].stars);					// the -1 was not a sample
+	TEST_ASSERT_EQUAL(35, out[WS_FILTER_MEDIAN].stars);					// upper of 25 and 35
+	TEST_ASSERT_EQUAL(28, out[WS_FILTER_EMA].stars);
+}
+
+/**************************************************************************************************
+  weather trace
+**************************************************************************************************/
+typedef struct {
+	uint32_t ms;
+	WeatherFrame f;
+} Sample_t;
+
+// a night at 1 Hz: wind around the limit with gusts, sky temperature around the limit with sensor
+// noise and spikes, clouds without sensor for an hour
+static std::vector<Sample_t> synthetic_trace()
+{
+	std::vector<Sample_t> trace;
+	uint32_t seed = 5;
+
+	for(uint32_t s = 0; s < NIGHT_S; s++) {
+		Sample_t x;
+		double phase = s / 3600.0;
+
+		x.ms = 1000 * s + rnd(seed) % 50;
+		x.f.tsky = (int16_t)( TSKY_LIMIT - 20 * cos(phase) ) + (int16_t)( rnd(seed) % 11 ) - 5;
+		if( rnd(seed) % 300 == 0 )
+			x.f.tsky += 80;												// spike, a bird or a plane
+		x.f.tair = (int16_t)( 120 - 10 * phase );
+		x.f.wind = (int16_t)( WIND_LIMIT - 12 + 8 * sin(phase * 2) + rnd(seed) % 7 );
+		if( rnd(seed) % 120 == 0 )
+			x.f.wind += 15 + rnd(seed) % 10;								// gust
+		x.f.hum = (int16_t)( 70 + 10 * sin(phase) );
+		x.f.rain = 0;
+		x.f.light = 0;
+		x.f.clouds = (( s > 3 * 3600 ) && ( s < 4 * 3600 )) ? -1 : (int16_t)( 30 + rnd(seed) % 40 );
+		x.f.stars = (int16_t)( rnd(seed) % 200 );
+		trace.push_back(x);
+	}
+	return trace;
+}
+
+static std::vector<Sample_t> load_trace(const char *path)
+{
+	std::vector<Sample_t> trace;
+	std::ifstream in(path);
+	std::string line;
+
+	while( std::getline(in, line) ) {
+		std::stringstream ss(line);
+		std::string field;
+		Sample_t x;
+		int32_t v[1 + WS_FRAME_FIELDS];
+		uint8_t n = 0;
+
+		if( line.empty() || ( line[0] == '#' ))
+			continue;
+		while(( n < 1 + WS_FRAME_FIELDS ) && std::getline(ss, field, ','))
+			v[n++] = atoi(field.c_str());
+		if( n != 1 + WS_FRAME_FIELDS )
+			continue;
+		x.ms = v[0];
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++)
+			((int16_t *)&x.f)[c] = (int16_t)v[1 + c];
+		trace.push_back(x);
+	}
+	return trace;
+}
+
+// the trace through WeatherFilters, each output against its floating point or brute force reference
+void test_trace(void)
+{
+	const char *path = getenv("WS_TRACE");
+	std::vector<Sample_t> trace = path ? load_trace(path) : synthetic_trace();
+	WeatherFilters filters;
+	WeatherFrame out[WS_FILTERS];
+	std::deque<int16_t> window[WS_FRAME_FIELDS];
+	double ema[WS_FRAME_FIELDS];
+	int16_t prev_ema[WS_FRAME_FIELDS];				// EMA output of the previous sample, input of the rate
+	uint32_t prev_ms[WS_FRAME_FIELDS], valid[WS_FRAME_FIELDS] = { 0 };
+	double err[WS_FILTERS] = { 0 };
+	uint32_t crossings[2][1 + WS_FILTERS] = { { 0 } };					// wind, tsky: raw then each filter
+	bool above[2][1 + WS_FILTERS] = { { false } };
+
+	TEST_ASSERT_TRUE(trace.size() > 100);
+	for(const Sample_t &x : trace) {
+		filters.Update(x.f, x.ms, out);
+
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+			int16_t v = ws_channel(x.f, c);
+
+			if( !ws_channel_valid(c, v) ) {
+				for(uint8_t i = 0; i < WS_FILTERS; i++)
+					TEST_ASSERT_EQUAL(-1, ws_channel(out[i], c));
+				continue;
+			}
+
+			ema[c] = valid[c] ? ema[c] + ( v - ema[c] ) / ( 1 << WS_EMA_SHIFT ) : v;
+			window[c].push_back(v);
+			if( window[c].size() > (size_t)std::max(WS_GUST_SAMPLES, WS_MEDIAN_SAMPLES) )
+				window[c].pop_front();
+
+			std::vector<int16_t> w(window[c].end() - std::min<size_t>(window[c].size(), WS_MEDIAN_SAMPLES), window[c].end());
+			std::sort(w.begin(), w.end());
+			int16_t max = *std::max_element(window[c].end() - std::min<size_t>(window[c].size(), WS_GUST_SAMPLES), window[c].end());
+			double roc = ( valid[c] && ( x.ms != prev_ms[c] )) ? ( ws_channel(out[WS_FILTER_EMA], c) - prev_ema[c] ) * 60000.0 / ( x.ms - prev_ms[c] ) : 0;
+
+			err[WS_FILTER_EMA] = std::max(err[WS_FILTER_EMA], fabs(ws_channel(out[WS_FILTER_EMA], c) - ema[c]));
+			err[WS_FILTER_MAX] = std::max(err[WS_FILTER_MAX], fabs(ws_channel(out[WS_FILTER_MAX], c) - max));
+			err[WS_FILTER_MEDIAN] = std::max(err[WS_FILTER_MEDIAN], fabs(ws_channel(out[WS_FILTER_MEDIAN], c) - w[w.size() / 2]));
+			if( valid[c] && ( fabs(roc) < INT16_MAX ))
+				err[WS_FILTER_ROC] = std::max(err[WS_FILTER_ROC], fabs(ws_channel(out[WS_FILTER_ROC], c) - roc));
+			prev_ema[c] = ws_channel(out[WS_FILTER_EMA], c);
+			prev_ms[c] = x.ms;
+			valid[c]++;
+		}
+
+		for(uint8_t k = 0; k < 2; k++) {								// crossings of the safety limits
+			uint8_t c = k ? WS_CH_TSKY : WS_CH_WIND;
+			int16_t limit = k ? TSKY_LIMIT : WIND_LIMIT;
+
+			for(uint8_t i = 0; i <= WS_FILTERS; i++) {
+				if( i == 1 + WS_FILTER_ROC )
+					continue;
+				bool a = ( i ? ws_channel(out[i - 1], c) : ws_channel(x.f, c) ) > limit;
+				if( a != above[k][i] )
+					crossings[k][i]++;
+				above[k][i] = a;
+			}
+		}
+	}
+
+	printf("{\"bench\":\"stream_filters_trace\",\"trace\":\"%s\",\"frames\":%u,\"max_error\":{\"ema\":%.2f,\"max\":%.0f,"
+		"\"median\":%.0f,\"roc\":%.2f},\"crossings\":{\"wind\":{\"raw\":%u,\"ema\":%u,\"max\":%u,\"median\":%u},"
+		"\"tsky\":{\"raw\":%u,\"ema\":%u,\"max\":%u,\"median\":%u}}}\n",
+		path ? path : "synthetic", (unsigned)trace.size(), err[WS_FILTER_EMA], err[WS_FILTER_MAX], err[WS_FILTER_MEDIAN],
+		err[WS_FILTER_ROC], crossings[0][0], crossings[0][1], crossings[0][2], crossings[0][3],
+		crossings[1][0], crossings[1][1], crossings[1][2], crossings[1][3]);
+
+	TEST_ASSERT_TRUE(err[WS_FILTER_EMA] <= 1.0);
+	TEST_ASSERT_TRUE(err[WS_FILTER_MAX] == 0);
+	TEST_ASSERT_TRUE(err[WS_FILTER_MEDIAN] == 0);
+	TEST_ASSERT_TRUE(err[WS_FILTER_ROC] < 1.0);						// integer division, of the same EMA
+	if( !path ) {														// less churn than the raw samples
+		TEST_ASSERT_TRUE(crossings[0][1 + WS_FILTER_MAX] < crossings[0][0]);
+		TEST_ASSERT_TRUE(crossings[1][1 + WS_FILTER_MEDIAN] < crossings[1][0]);
+		TEST_ASSERT_TRUE(crossings[1][1 + WS_FILTER_EMA] < crossings[1][0]);
+	}
+}
+
+/**************************************************************************************************
+  cost per sample
+**************************************************************************************************/
+template <typename F>
+static double sample_ns(uint32_t samples, F update)
+{
+	volatile int32_t sink = 0;
+	uint32_t seed = 6;
+
+	auto a = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < samples; i++)
+		sink = sink + update((int16_t)(( seed = seed * 1664525 + 1013904223 ) >> 20), i);
+	auto b = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(b - a).count() / samples;
+}
+
+void test_benchmark(void)
+{
+	uint32_t samples = atoi(env("WS_SAMPLES", "2000000"));
+	EmaFilter ema;
+	SlidingMax<WS_GUST_SAMPLES> max;
+	RunningMedian<WS_MEDIAN_SAMPLES> median;
+	RateOfChange roc;
+	WeatherFilters filters;
+	WeatherFrame out[WS_FILTERS];
+
+	double ns_ema = sample_ns(samples, [&](int16_t v, uint32_t i) { return ema.Update(v, WS_EMA_SHIFT); });
+	double ns_max = sample_ns(samples, [&](int16_t v, uint32_t i) { return max.Update(v); });
+	double ns_falling = sample_ns(samples, [&](int16_t v, uint32_t i) { return max.Update((int16_t)( 30000 - i % 60000 )); });
+	double ns_median = sample_ns(samples, [&](int16_t v, uint32_t i) { return median.Update(v); });
+	double ns_roc = sample_ns(samples, [&](int16_t v, uint32_t i) { return roc.Update(v, i * 1000); });
+	double ns_frame = sample_ns(samples / 8, [&](int16_t v, uint32_t i) {
+		WeatherFrame f = { v, v, v, v, v, v, v, v };
+		filters.Update(f, i * 1000, out);
+		return out[WS_FILTER_MEDIAN].wind;
+	});
+
+	printf("{\"bench\":\"stream_filters\",\"samples\":%u,\"ns_per_sample\":{\"ema\":%.1f,\"sliding_max\":%.1f,"
+		"\"sliding_max_falling\":%.1f,\"median\":%.1f,\"roc\":%.1f},\"ns_per_frame\":%.1f,\"ram_bytes\":%u}\n",
+		samples, ns_ema, ns_max, ns_falling, ns_median, ns_roc, ns_frame, (unsigned)sizeof(WeatherFilters));
+
+	TEST_ASSERT_TRUE(ns_frame < 2000);									// a frame per second, far below
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_ema);
+	RUN_TEST(test_sliding_max);
+	RUN_TEST(test_running_median);
+	RUN_TEST(test_rate_of_change);
+	RUN_TEST(test_weather_filters);
+	RUN_TEST(test_trace);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
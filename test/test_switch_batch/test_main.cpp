@@ -0,0 +1,352 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Switch Action "setswitches" down to the hardware: malformed, read-only, repeated
+                  and out of range pairs or no connected client reject the whole batch and touch
+                  nothing, a valid batch reaches the 595 chain model in one latch and the LEDC
+                  channels in one I/O cycle.
+                  Then OUT 1..8 and PWM 1..4 set together, one Action against one setswitchvalue
+                  PUT per channel with a Wi-Fi round trip each, loop() publishing every pass and the
+                  I/O task on its period: latches, skew between the first and the last output and
+                  client time, as JSON on stdout.
+
+                  BATCH_RTT_US    HTTP round trip over Wi-Fi, default 8000
+                  BATCH_ROUNDS    sets of the 12 channels of each kind, default 200
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <algorithm>
+#include <vector>
+
+#include "Switch.cpp"
+#include "AlpacaActions.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+#include "IoTask.cpp"
+#include "ShiftRegister.cpp"
+#include "Scheduler.cpp"
+#include "Debouncer.cpp"
+#include "PwmOutput.cpp"
+
+#define LOOP_US             1000        // loop() pass, publish_io_outputs() each time
+
+bool _sw_out[8];
+uint8_t _sw_pwm[4];
+IoEdges_t io_edges;
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static AsyncWebServer server;
+static Switch *sw;
+
+/**************************************************************************************************
+  595 chain: OUT bits of every latch, 165 inputs inactive
+**************************************************************************************************/
+typedef struct {
+	uint64_t t_us;
+	uint8_t out;					// OUT 1..8, bit i -> OUT i+1
+} Latch_t;
+
+static uint16_t out_shift, in_shift;
+static std::vector<Latch_t> latches;
+
+static uint8_t out_bits(uint16_t word)
+{
+	uint8_t v = 0;
+
+	for(uint32_t i = 0; i < 8; i++)
+		if( word & (BIT_OUT_0 >> i) )
+			v |= 1 << i;
+	return v;
+}
+
+static void chain_edge(uint8_t pin, uint8_t level)
+{
+	switch( pin ) {
+	case SR_IN_PIN_PL:
+		if( level == LOW ) {
+			in_shift = 0xffff;
+			mock::pin_hw(SR_IN_PIN_SDIN, HIGH);
+		}
+		break;
+	case SR_OUT_PIN_SHCP:
+		if( level == HIGH )
+			out_shift = (out_shift << 1) | mock::pin_level[SR_OUT_PIN_SDOUT];
+		break;
+	case SR_OUT_PIN_STCP:
+		if( level == HIGH && ( latches.empty() || latches.back().out != out_bits(out_shift) ))
+			latches.push_back({ mock::now_us(), out_bits(out_shift) });
+		break;
+	}
+}
+
+// LEDC target of a PWM channel, changes when the I/O task starts a ramp
+static uint32_t pwm_target(uint32_t i) { return mock::ledc_channel[i].fade_us ? mock::ledc_channel[i].target : mock::ledc_channel[i].duty; }
+
+/**************************************************************************************************
+  loop() and the I/O task on the virtual clock
+**************************************************************************************************/
+static uint64_t next_io_us, next_loop_us;
+static std::vector<uint64_t> pwm_changes;			// time of every LEDC target change
+static uint32_t pwm_prev[4];
+
+static void io_run(void)
+{
+	io_cycle(millis());
+	for(uint32_t i = 0; i < 4; i++)
+		if( pwm_target(i) != pwm_prev[i] ) {
+			pwm_prev[i] = pwm_target(i);
+			pwm_changes.push_back(mock::now_us());
+		}
+}
+
+// publish_io_outputs() of main.cpp: dirty channels only, wakes the I/O task on a change
+static void publish(void)
+{
+	static IoOutputs_t prev;
+	IoOutputs_t out = prev;
+	uint32_t dirty = sw->TakeDirty();
+
+	for(uint32_t i = 0; i < 8; i++)
+		if( dirty & (1 << (i + 8)) )
+			out.sw_out = _sw_out[i] ? (out.sw_out | (1 << i)) : (out.sw_out & ~(1 << i));
+	for(uint32_t i = 0; i < 4; i++)
+		if( dirty & (1 << (i + 16)) )
+			out.sw_pwm[i] = _sw_pwm[i];
+	out.switch_connected = true;
+	if( memcmp(&out, &prev, sizeof(out)) == 0 )
+		return;
+	prev = out;
+	io_outputs.Write(out);
+	io_run();
+}
+
+static void run_until(uint64_t end_us)
+{
+	for(;;) {
+		uint64_t t = std::min(next_io_us, next_loop_us);
+
+		if( t > end_us )
+			break;
+		if( mock::now_us() < t )
+			mock::virtual_us = t;
+		if( t == next_loop_us ) {
+			publish();
+			next_loop_us += LOOP_US;
+		} else {
+			io_run();
+			next_io_us += IO_TASK_PERIOD_MS * 1000;
+		}
+	}
+	if( mock::now_us() < end_us )
+		mock::virtual_us = end_us;
+}
+
+static JsonDocument set_switches(const char *parameters)
+{
+	AsyncWebServerRequest req(HTTP_PUT, "/api/v1/switch/0/action");
+	JsonDocument reply;
+
+	req.AddParam("Action", "setswitches", true);
+	req.AddParam("Parameters", parameters, true);
+	req.AddParam("ClientTransactionID", "1", true);
+	TEST_ASSERT_TRUE(deserializeJson(reply, server.Dispatch(&req)->body()) == DeserializationError::Ok);
+	return reply;
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		mock::gpio_reset();
+		mock::pin_level[SR_IN_PIN_CE] = HIGH;
+		mock::pin_level[SR_IN_PIN_PL] = HIGH;
+		mock::pin_level[SR_OUT_PIN_MR] = HIGH;
+		mock::pin_level[SR_OUT_PIN_OE] = HIGH;
+		mock::on_write = chain_edge;
+		mock::set_ms(1000);
+
+		sw = new Switch();
+		sw->Begin();
+		sw->SetNumberOfConnectedClients(1);
+		alpaca_actions.Begin(&server);
+		io_init(millis());
+		next_io_us = next_loop_us = mock::now_us();
+		run_until(mock::now_us() + 100000);
+		begun = true;
+	}
+}
+void tearDown(void) {}
+
+/**************************************************************************************************
+  validation and commit
+**************************************************************************************************/
+void test_rejected(void)
+{
+	static const char *const k_bad[] = {
+		"",						// nothing
+		"8=1,9",				// no value
+		"8=1,",					// empty pair
+		"8=1;9=1",				// separator
+		"8=1,x=1",				// id
+		"8=1,9=on",				// value
+		"8=1,3=1",				// IN 4 is read-only
+		"8=1,20=1",				// no such switch
+		"8=1,8=0",				// repeated
+		"8=1,9=2",				// OUT range 0~1
+		"16=50,17=101",			// PWM range 0~100
+		"16=50,17=-1",
+		"16=50,17=12.5",		// PWM step 1
+	};
+	uint32_t version = sw->GetVersion();
+	uint32_t events = event_log.GetStats().added;
+	size_t n = latches.size();
+
+	for(const char *p : k_bad) {
+		JsonDocument reply = set_switches(p);
+
+		TEST_ASSERT_EQUAL(ALPACA_ERR_INVALID_VALUE, reply["ErrorNumber"].as<int>());
+		TEST_ASSERT_TRUE(strlen(reply["ErrorMessage"].as<const char *>()) > 0);
+	}
+	TEST_ASSERT_EQUAL_HEX32(0, sw->TakeDirty());						// nothing committed, not even the first pair
+	TEST_ASSERT_EQUAL_UINT32(version, sw->GetVersion());
+	TEST_ASSERT_EQUAL_UINT32(events, event_log.GetStats().added);
+	TEST_ASSERT_EQUAL_DOUBLE(0.0, sw->GetSwitchValue(8));
+	TEST_ASSERT_EQUAL_DOUBLE(0.0, sw->GetSwitchValue(16));
+	run_until(mock::now_us() + 50000);
+	TEST_ASSERT_EQUAL_UINT32(n, latches.size());
+}
+
+void test_not_connected(void)
+{
+	uint32_t version = sw->GetVersion();
+
+	sw->SetNumberOfConnectedClients(0);
+	JsonDocument reply = set_switches("8=1");
+	sw->SetNumberOfConnectedClients(1);
+
+	TEST_ASSERT_EQUAL(ALPACA_ERR_NOT_CONNECTED, reply["ErrorNumber"].as<int>());
+	TEST_ASSERT_EQUAL_HEX32(0, sw->TakeDirty());
+	TEST_ASSERT_EQUAL_UINT32(version, sw->GetVersion());
+	TEST_ASSERT_EQUAL_DOUBLE(0.0, sw->GetSwitchValue(8));
+}
+
+void test_one_latch(void)
+{
+	JsonDocument reply = set_switches("8=1,10=1,15=1,16=40,19=100");
+	size_t n = latches.size();
+	uint32_t pwm = pwm_changes.size();
+
+	TEST_ASSERT_EQUAL(0, reply["ErrorNumber"].as<int>());
+	TEST_ASSERT_EQUAL_STRING("5", reply["Value"].as<const char *>());
+	TEST_ASSERT_EQUAL_DOUBLE(40.0, sw->GetSwitchValue(16));
+
+	run_until(mock::now_us() + 50000);
+	TEST_ASSERT_EQUAL_UINT32(n + 1, latches.size());						// the three OUTs in one latch
+	TEST_ASSERT_EQUAL_HEX8(0x85, latches.back().out);
+	TEST_ASSERT_EQUAL_UINT32(pwm + 2, pwm_changes.size());				// both PWMs in the same cycle
+	TEST_ASSERT_TRUE(pwm_changes.back() == pwm_changes[pwm]);
+	TEST_ASSERT_TRUE(pwm_changes.back() - latches.back().t_us < IO_TASK_PERIOD_MS * 1000);
+	TEST_ASSERT_TRUE(pwm_target(0) > 0);
+	TEST_ASSERT_EQUAL_UINT32(0, pwm_target(1));
+}
+
+/**************************************************************************************************
+  12 channels together: one Action against one PUT per channel
+**************************************************************************************************/
+typedef struct {
+	uint32_t latches;				// latches that changed OUT bits, per set
+	uint32_t pwm_cycles;			// distinct times the LEDC targets changed, per set
+	double skew_us;					// first to last output change at the hardware, mean per set
+	uint32_t max_skew_us;
+	double client_us;				// first request sent to last reply received
+} Set_t;
+
+static void run_sets(Set_t &r, bool batch, uint32_t rounds, uint32_t rtt_us)
+{
+	uint32_t latch_sum = 0, pwm_sum = 0;
+	uint64_t skew_sum = 0, client_sum = 0;
+
+	memset(&r, 0, sizeof(r));
+	run_until(mock::now_us() + ( PWM_FADE_MS + 2 * IO_TASK_PERIOD_MS ) * 1000);
+	for(uint32_t k = 0; k < rounds; k++) {
+		uint32_t v = k + 1;
+		size_t l0 = latches.size(), p0 = pwm_changes.size();
+		uint64_t t0 = mock::now_us();
+		char params[128];
+		int len = 0;
+
+		if( batch ) {														// one request, applied on arrival
+			for(uint32_t i = 0; i < 12; i++)
+				len += snprintf(params + len, sizeof(params) - len, "%s%u=%u", i ? "," : "", 8 + i, ( i < 8 ) ? ( v >> ( i % 2 )) & 1 : ( v * 7 + i ) % 101);
+			run_until(t0 + rtt_us / 2);
+			TEST_ASSERT_EQUAL(0, set_switches(params)["ErrorNumber"].as<int>());
+			run_until(t0 + rtt_us);
+		} else {
+			for(uint32_t i = 0; i < 12; i++) {								// the next PUT after the previous reply
+				uint64_t t = t0 + (uint64_t)i * rtt_us;
+
+				run_until(t + rtt_us / 2);
+				TEST_ASSERT_TRUE(sw->PutSetSwitchValue(8 + i, ( i < 8 ) ? ( v >> ( i % 2 )) & 1 : ( v * 7 + i ) % 101));
+				run_until(t + rtt_us);
+			}
+		}
+		client_sum += mock::now_us() - t0;
+		run_until(mock::now_us() + ( PWM_FADE_MS + 2 * IO_TASK_PERIOD_MS ) * 1000);	// ramps done, next targets start at once
+
+		std::vector<uint64_t> times;
+		for(size_t i = l0; i < latches.size(); i++)
+			times.push_back(latches[i].t_us);
+		latch_sum += latches.size() - l0;
+		times.insert(times.end(), pwm_changes.begin() + p0, pwm_changes.end());
+		std::vector<uint64_t> pwm(pwm_changes.begin() + p0, pwm_changes.end());
+		pwm_sum += std::unique(pwm.begin(), pwm.end()) - pwm.begin();
+		TEST_ASSERT_TRUE(times.size() > 0);
+
+		uint32_t skew = *std::max_element(times.begin(), times.end()) - *std::min_element(times.begin(), times.end());
+		skew_sum += skew;
+		r.max_skew_us = std::max(r.max_skew_us, skew);
+		for(uint32_t i = 0; i < 8; i++)										// hardware is what the client asked
+			TEST_ASSERT_EQUAL(( v >> ( i % 2 )) & 1, ( latches.back().out >> i ) & 1);
+	}
+	r.latches = latch_sum / rounds;
+	r.pwm_cycles = pwm_sum / rounds;
+	r.skew_us = (double)skew_sum / rounds;
+	r.client_us = (double)client_sum / rounds;
+}
+
+void test_benchmark(void)
+{
+	uint32_t rtt = atoi(env("BATCH_RTT_US", "8000"));
+	uint32_t rounds = atoi(env("BATCH_ROUNDS", "200"));
+	Set_t per_id, batch;
+
+	run_sets(per_id, false, rounds, rtt);
+	run_sets(batch, true, rounds, rtt);
+
+	printf("{\"bench\":\"switch_batch\",\"channels\":12,\"rounds\":%u,\"rtt_us\":%u,"
+		"\"per_id\":{\"requests\":12,\"latches\":%u,\"pwm_cycles\":%u,\"skew_us\":%.0f,\"max_skew_us\":%u,\"client_ms\":%.1f},"
+		"\"setswitches\":{\"requests\":1,\"latches\":%u,\"pwm_cycles\":%u,\"skew_us\":%.0f,\"max_skew_us\":%u,\"client_ms\":%.1f}}\n",
+		rounds, rtt, per_id.latches, per_id.pwm_cycles, per_id.skew_us, per_id.max_skew_us, per_id.client_us / 1000,
+		batch.latches, batch.pwm_cycles, batch.skew_us, batch.max_skew_us, batch.client_us / 1000);
+
+	TEST_ASSERT_EQUAL_UINT32(1, batch.latches);
+	TEST_ASSERT_EQUAL_UINT32(1, batch.pwm_cycles);
+	TEST_ASSERT_TRUE(batch.max_skew_us < IO_TASK_PERIOD_MS * 1000);		// latch and LEDC of the same cycle
+	TEST_ASSERT_TRUE(per_id.latches > 1);
+	TEST_ASSERT_TRUE(per_id.skew_us > 10 * rtt);
+	TEST_ASSERT_TRUE(batch.client_us * 10 < per_id.client_us);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_rejected);
+	RUN_TEST(test_not_connected);
+	RUN_TEST(test_one_latch);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
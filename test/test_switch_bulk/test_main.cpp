@@ -0,0 +1,215 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Switch Action "switchstates": listed in SupportedActions, same channels as the per
+                  id getters, rendered again only after a change. Then a load test of full refreshes
+                  of the 20 channels, one Action against getswitchvalue + getswitch per id as NINA
+                  polls, in requests/s and refresh time with a Wi-Fi round trip per request, as JSON
+                  on stdout.
+
+                  BULK_REFRESHES  refreshes of each kind, default 2000
+                  BULK_RTT_US     HTTP round trip over Wi-Fi, default 8000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+
+#include "Switch.cpp"
+#include "AlpacaActions.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+
+#define CHANGE_EVERY        10          // refreshes between two client writes
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+bool _sw_out[8];
+uint8_t _sw_pwm[4];
+IoEdges_t io_edges;
+
+static AsyncWebServer server;
+static Switch *sw;
+static uint32_t server_transaction_id;
+
+// per id getters as the library serves them: one JsonDocument per request
+static void library_reply(AsyncWebServerRequest *request, JsonVariantConst value)
+{
+	JsonDocument doc;
+	String body;
+
+	doc["Value"] = value;
+	doc["ClientTransactionID"] = (uint32_t)AlpacaActions::GetParam(request, "ClientTransactionID").toInt();
+	doc["ServerTransactionID"] = ++server_transaction_id;
+	doc["ErrorNumber"] = 0;
+	doc["ErrorMessage"] = "";
+	serializeJson(doc, body);
+	request->send(200, "application/json", body);
+}
+
+static void register_library_getters()
+{
+	server.on("/api/v1/switch/0/getswitchvalue", HTTP_GET, [](AsyncWebServerRequest *request) {
+		JsonDocument v;
+		v.set(sw->GetSwitchValue(AlpacaActions::GetParam(request, "Id").toInt()));
+		library_reply(request, v.as<JsonVariantConst>());
+	});
+	server.on("/api/v1/switch/0/getswitch", HTTP_GET, [](AsyncWebServerRequest *request) {
+		JsonDocument v;
+		v.set(sw->GetValue(AlpacaActions::GetParam(request, "Id").toInt()));
+		library_reply(request, v.as<JsonVariantConst>());
+	});
+}
+
+static String get(const char *method, uint32_t id, uint32_t client_id)
+{
+	AsyncWebServerRequest req(HTTP_GET, String("/api/v1/switch/0/") + method);
+
+	req.AddParam("Id", String(id));
+	req.AddParam("ClientTransactionID", String(client_id));
+	return server.Dispatch(&req)->body();
+}
+
+static String action(const char *name, uint32_t client_id)
+{
+	AsyncWebServerRequest req(HTTP_PUT, "/api/v1/switch/0/action");
+
+	req.AddParam("Action", name, true);
+	req.AddParam("Parameters", "", true);
+	req.AddParam("ClientTransactionID", String(client_id), true);
+	return server.Dispatch(&req)->body();
+}
+
+// Value of the switchstates response, parsed as the client does
+static JsonDocument switch_states()
+{
+	JsonDocument reply, states;
+
+	TEST_ASSERT_TRUE(deserializeJson(reply, action("switchstates", 1)) == DeserializationError::Ok);
+	TEST_ASSERT_EQUAL(0, reply["ErrorNumber"].as<int>());
+	TEST_ASSERT_TRUE(deserializeJson(states, reply["Value"].as<const char *>()) == DeserializationError::Ok);
+	return states;
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		sw = new Switch();
+		sw->Begin();
+		alpaca_actions.Begin(&server);
+		register_library_getters();
+		begun = true;
+	}
+}
+void tearDown(void) {}
+
+void test_supported_actions(void)
+{
+	AsyncWebServerRequest req(HTTP_GET, "/api/v1/switch/0/supportedactions");
+	JsonDocument reply;
+
+	TEST_ASSERT_TRUE(deserializeJson(reply, server.Dispatch(&req)->body()) == DeserializationError::Ok);
+	TEST_ASSERT_EQUAL_STRING("switchstates", reply["Value"][0].as<const char *>());
+	TEST_ASSERT_EQUAL_STRING("setswitches", reply["Value"][1].as<const char *>());
+}
+
+// every channel as the per id getters report it
+void test_same_as_getters(void)
+{
+	sw->PutSetSwitch(10, true);
+	sw->PutSetSwitchValue(17, 33);
+	JsonDocument states = switch_states();
+
+	TEST_ASSERT_EQUAL_UINT32(sw->GetVersion(), states["version"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(sw->GetMaxSwitch(), states["switches"].size());
+	for(uint32_t id = 0; id < sw->GetMaxSwitch(); id++) {
+		JsonDocument value, state;
+		JsonVariantConst ch = states["switches"][id];
+
+		deserializeJson(value, get("getswitchvalue", id, 2));
+		deserializeJson(state, get("getswitch", id, 3));
+		TEST_ASSERT_EQUAL_UINT32(id, ch["id"].as<uint32_t>());
+		TEST_ASSERT_EQUAL_DOUBLE(value["Value"].as<double>(), ch["value"].as<double>());
+		TEST_ASSERT_EQUAL(state["Value"].as<bool>(), ch["state"].as<bool>());
+		TEST_ASSERT_EQUAL_STRING(sw->GetSwitchName(id), ch["name"].as<const char *>());
+		TEST_ASSERT_EQUAL(id >= 8, ch["canwrite"].as<bool>());
+	}
+	TEST_ASSERT_EQUAL_DOUBLE(33.0, states["switches"][17]["value"].as<double>());
+	TEST_ASSERT_TRUE(states["switches"][10]["state"].as<bool>());
+}
+
+// the snapshot follows the version: unchanged between writes, new after one
+void test_rendered_on_change(void)
+{
+	uint32_t version = switch_states()["version"].as<uint32_t>();
+
+	TEST_ASSERT_EQUAL_UINT32(version, switch_states()["version"].as<uint32_t>());
+	sw->PutSetSwitchValue(19, 50);									// stored by the library, version bumped by loop()
+	TEST_ASSERT_EQUAL_UINT32(version, switch_states()["version"].as<uint32_t>());
+	sw->Loop();
+	JsonDocument states = switch_states();
+	TEST_ASSERT_EQUAL_UINT32(version + 1, states["version"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_DOUBLE(50.0, states["switches"][19]["value"].as<double>());
+	sw->Loop();
+	TEST_ASSERT_EQUAL_UINT32(version + 1, switch_states()["version"].as<uint32_t>());	// once per write
+
+	io_edges.state = io_edges.rise = 0x0008;					// input edge
+	sw->Loop();
+	TEST_ASSERT_EQUAL_UINT32(version + 2, switch_states()["version"].as<uint32_t>());
+	TEST_ASSERT_TRUE(switch_states()["switches"][3]["state"].as<bool>());
+	io_edges.rise = 0;
+}
+
+void test_load(void)
+{
+	uint32_t refreshes = strtoul(env("BULK_REFRESHES", "2000"), NULL, 10);
+	uint32_t rtt_us = strtoul(env("BULK_RTT_US", "8000"), NULL, 10);
+	uint32_t n = sw->GetMaxSwitch(), client_id = 0;
+	uint64_t bytes_poll = 0, bytes_bulk = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t r = 0; r < refreshes; r++) {
+		if( r % CHANGE_EVERY == 0 )
+			sw->PutSetSwitchValue(16 + r % 4, r % 101);
+		sw->Loop();
+		for(uint32_t id = 0; id < n; id++) {
+			bytes_poll += get("getswitchvalue", id, ++client_id).length();
+			bytes_poll += get("getswitch", id, ++client_id).length();
+		}
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	for(uint32_t r = 0; r < refreshes; r++) {
+		if( r % CHANGE_EVERY == 0 )
+			sw->PutSetSwitchValue(16 + r % 4, r % 101);
+		sw->Loop();
+		bytes_bulk += action("switchstates", ++client_id).length();
+	}
+	auto t2 = std::chrono::steady_clock::now();
+
+	double poll_s = std::chrono::duration<double>(t1 - t0).count();
+	double bulk_s = std::chrono::duration<double>(t2 - t1).count();
+	double poll_refresh_us = 1e6 * poll_s / refreshes + 2.0 * n * rtt_us;		// requests in sequence, as NINA
+	double bulk_refresh_us = 1e6 * bulk_s / refreshes + rtt_us;
+
+	printf("{\"bench\":\"switch_bulk\",\"refreshes\":%u,\"channels\":%u,\"rtt_us\":%u,\"change_every\":%u,"
+		"\"per_id\":{\"requests_per_refresh\":%u,\"requests_per_s\":%.0f,\"refreshes_per_s\":%.0f,\"bytes_per_refresh\":%.0f,\"refresh_ms\":%.2f},"
+		"\"action\":{\"requests_per_refresh\":1,\"requests_per_s\":%.0f,\"refreshes_per_s\":%.0f,\"bytes_per_refresh\":%.0f,\"refresh_ms\":%.2f}}\n",
+		refreshes, n, rtt_us, CHANGE_EVERY, 2 * n, 2.0 * n * refreshes / poll_s, refreshes / poll_s, (double)bytes_poll / refreshes,
+		poll_refresh_us / 1000, refreshes / bulk_s, refreshes / bulk_s, (double)bytes_bulk / refreshes, bulk_refresh_us / 1000);
+
+	TEST_ASSERT_TRUE(bulk_s < poll_s);										// less server time per refresh
+	TEST_ASSERT_TRUE(bulk_refresh_us * 10 < poll_refresh_us);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_supported_actions);
+	RUN_TEST(test_same_as_getters);
+	RUN_TEST(test_rendered_on_change);
+	RUN_TEST(test_load);
+	return UNITY_END();
+}
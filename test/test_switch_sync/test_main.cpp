@@ -0,0 +1,225 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    Switch dirty mask sync: input edges pushed into AlpacaSwitch, client writes of OUT
+                  and PWM channels published by TakeDirty(), setswitches as one publish. Then the
+                  per pass cost of Switch::Loop() and the publish of loop() against the original
+                  copy of every channel, at idle and under a storm of setswitchvalue requests, in
+                  ns and AlpacaSwitch accessor calls per pass as JSON on stdout.
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+
+#include "Switch.cpp"
+#include "AlpacaActions.cpp"
+#include "SettingsJournal.cpp"
+#include "EventLog.cpp"
+
+#define BENCH_PASSES        2000000
+
+bool _sw_out[8];
+uint8_t _sw_pwm[4];
+IoEdges_t io_edges;
+
+static AsyncWebServer server;
+static Switch *sw;
+
+// outputs as publish_io_outputs() of main.cpp builds them, only channels in the dirty mask
+static void publish(IoOutputs_t &out)
+{
+	uint32_t dirty = sw->TakeDirty();
+
+	for(uint32_t i = 0; i < 8; i++)
+		if( dirty & (1 << (i + 8)) )
+			out.sw_out = _sw_out[i] ? (out.sw_out | (1 << i)) : (out.sw_out & ~(1 << i));
+	for(uint32_t i = 0; i < 4; i++)
+		if( dirty & (1 << (i + 16)) )
+			out.sw_pwm[i] = _sw_pwm[i];
+}
+
+/**************************************************************************************************
+  original sync: inputs unpacked to bools, every channel copied on every pass
+**************************************************************************************************/
+static bool _sw_in[8];
+static uint8_t legacy_pwm[20];						// the original wrote _sw_pwm[i + 16]
+
+static void legacy_loop(Switch &s, uint16_t inputs, IoOutputs_t &out)
+{
+	for(int i = 0; i < 8; i++)
+		_sw_in[i] = ( inputs & (1 << i) ) != 0;
+
+	for(int i = 0; i < 8; i++) {
+		if( _sw_in[i] )
+			s.SetSwitch(i, true);
+		else
+			s.SetSwitch(i, false);
+
+		if( s.GetValue(i + 8) )
+			_sw_out[i] = true;
+		else
+			_sw_out[i] = false;
+	}
+	for(int i = 0; i < 4; i++)
+		legacy_pwm[i + 16] = (uint8_t)s.GetSwitchValue(i + 16);
+
+	out.sw_out = 0;
+	for(int i = 0; i < 8; i++)
+		out.sw_out |= _sw_out[i] << i;
+	for(int i = 0; i < 4; i++)
+		out.sw_pwm[i] = legacy_pwm[i + 16];
+}
+
+/**************************************************************************************************
+  tests
+**************************************************************************************************/
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		sw = new Switch();
+		sw->Begin();
+		sw->SetNumberOfConnectedClients(1);
+		alpaca_actions.Begin(&server);
+		begun = true;
+	}
+	sw->TakeDirty();
+	memset(&io_edges, 0, sizeof(io_edges));
+	mock::switch_calls = 0;
+}
+void tearDown(void) {}
+
+void test_begin_publishes_all(void)
+{
+	Switch s;
+
+	s.Begin();
+	TEST_ASSERT_EQUAL_HEX32(SWITCH_OUT_MASK | SWITCH_PWM_MASK, s.TakeDirty());
+	TEST_ASSERT_EQUAL_HEX32(0, s.TakeDirty());
+}
+
+void test_client_writes(void)
+{
+	IoOutputs_t out = {};
+	uint32_t version = sw->GetVersion();
+
+	TEST_ASSERT_TRUE(sw->PutSetSwitchValue(18, 40));
+	TEST_ASSERT_TRUE(sw->PutSetSwitch(9, true));
+	TEST_ASSERT_EQUAL_UINT8(40, _sw_pwm[2]);
+	TEST_ASSERT_TRUE(_sw_out[1]);
+	TEST_ASSERT_EQUAL_UINT32(version, sw->GetVersion());			// bumped once the library holds the values
+	sw->Loop();
+	TEST_ASSERT_EQUAL_UINT32(version + 1, sw->GetVersion());
+
+	publish(out);
+	TEST_ASSERT_EQUAL_UINT8(0x02, out.sw_out);
+	TEST_ASSERT_EQUAL_UINT8(40, out.sw_pwm[2]);
+	TEST_ASSERT_EQUAL_HEX32(0, sw->TakeDirty());
+
+	TEST_ASSERT_FALSE(sw->PutSetSwitch(3, true));					// inputs are read only
+	TEST_ASSERT_FALSE(sw->PutSetSwitchValue(16, 101));				// out of range
+	TEST_ASSERT_EQUAL_HEX32(0, sw->TakeDirty());
+	sw->Loop();
+	TEST_ASSERT_EQUAL_UINT32(version + 1, sw->GetVersion());
+	TEST_ASSERT_EQUAL_UINT32(2, mock::switch_calls);				// Loop(): read back of the two written channels
+}
+
+void test_setswitches_one_publish(void)
+{
+	AsyncWebServerRequest req(HTTP_PUT, "/api/v1/switch/0/action");
+
+	req.AddParam("Action", "setswitches", true);
+	req.AddParam("Parameters", "8=1,15=1,19=75", true);
+	TEST_ASSERT_EQUAL(200, server.Dispatch(&req)->code());
+	TEST_ASSERT_EQUAL_HEX32((1 << 8) | (1 << 15) | (1 << 19), sw->TakeDirty());
+	TEST_ASSERT_EQUAL_UINT8(75, _sw_pwm[3]);
+	TEST_ASSERT_TRUE(_sw_out[0] && _sw_out[7]);
+	TEST_ASSERT_EQUAL_DOUBLE(75.0, sw->GetSwitchValue(19));
+}
+
+void test_input_edges(void)
+{
+	uint32_t version = sw->GetVersion();
+
+	sw->Loop();														// no edges: nothing touched
+	TEST_ASSERT_EQUAL_UINT32(0, mock::switch_calls);
+	TEST_ASSERT_EQUAL_UINT32(version, sw->GetVersion());
+
+	io_edges.state = 0x0105;										// bit 8 is not a Switch input
+	io_edges.rise = 0x0105;
+	sw->Loop();
+	TEST_ASSERT_EQUAL_UINT32(2, mock::switch_calls);
+	TEST_ASSERT_EQUAL_UINT32(version + 1, sw->GetVersion());
+	TEST_ASSERT_TRUE(sw->GetValue(0));
+	TEST_ASSERT_FALSE(sw->GetValue(1));
+	TEST_ASSERT_TRUE(sw->GetValue(2));
+
+	io_edges.state = 0x0001;
+	io_edges.rise = 0;
+	io_edges.fall = 0x0004;
+	sw->Loop();
+	TEST_ASSERT_FALSE(sw->GetValue(2));
+	TEST_ASSERT_EQUAL_HEX32(0, sw->TakeDirty());					// inputs are never published to the I/O task
+}
+
+typedef struct {
+	double ns;
+	double calls;												// AlpacaSwitch accessor calls per pass
+} Cost_t;
+
+// storm: one setswitchvalue on a rotating OUT/PWM channel per pass, the request is timed too
+static Cost_t bench(bool legacy, bool storm)
+{
+	IoOutputs_t out = {};
+	volatile uint8_t sink = 0;
+
+	mock::switch_calls = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_PASSES; i++) {
+		if( storm ) {
+			uint32_t id = 8 + i % 12;
+			sw->PutSetSwitchValue(id, ( id < 16 ) ? ( i >> 4 ) & 1 : i % 101);
+		}
+		if( legacy )
+			legacy_loop(*sw, 0x00a5, out);
+		else {
+			sw->Loop();
+			publish(out);
+		}
+		sink = sink + out.sw_out;
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	return { std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_PASSES, (double)mock::switch_calls / BENCH_PASSES };
+}
+
+void test_benchmark(void)
+{
+	Cost_t legacy_idle = bench(true, false);
+	Cost_t dirty_idle = bench(false, false);
+	Cost_t legacy_storm = bench(true, true);
+	Cost_t dirty_storm = bench(false, true);
+
+	printf("{\"bench\":\"switch_sync\",\"passes\":%u,\"idle\":{\"legacy_ns\":%.1f,\"legacy_calls\":%.1f,\"dirty_ns\":%.1f,\"dirty_calls\":%.1f},"
+		"\"storm\":{\"legacy_ns\":%.1f,\"legacy_calls\":%.1f,\"dirty_ns\":%.1f,\"dirty_calls\":%.1f}}\n",
+		BENCH_PASSES, legacy_idle.ns, legacy_idle.calls, dirty_idle.ns, dirty_idle.calls,
+		legacy_storm.ns, legacy_storm.calls, dirty_storm.ns, dirty_storm.calls);
+
+	TEST_ASSERT_EQUAL_DOUBLE(20.0, legacy_idle.calls);				// 8 SetSwitch, 8 GetValue, 4 GetSwitchValue
+	TEST_ASSERT_EQUAL_DOUBLE(0.0, dirty_idle.calls);
+	TEST_ASSERT_EQUAL_DOUBLE(1.0, dirty_storm.calls);				// written values come from _writeSwitchValue(), one read back
+	TEST_ASSERT_TRUE(dirty_idle.ns < legacy_idle.ns);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_begin_publishes_all);
+	RUN_TEST(test_client_writes);
+	RUN_TEST(test_setswitches_one_publish);
+	RUN_TEST(test_input_edges);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
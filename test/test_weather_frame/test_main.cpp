@@ -0,0 +1,241 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    %WS frame parser: error codes, a fuzz target checked against a reference parser
+                  built on std::string and strtol, and a throughput benchmark in frames/s against
+                  the original parse_ws_message() loop, as JSON on stdout.
+
+                  WS_FUZZ_ITER    fuzz iterations, default 200000
+                  WS_FUZZ_SEED    fuzz seed, default 1
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "WeatherFrame.cpp"
+
+#define BENCH_FRAMES        2000000
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static uint32_t seed = 1;
+static uint32_t rnd(uint32_t n) { seed = seed * 1664525 + 1013904223; return (seed >> 8) % n; }
+
+static WsParseError_t parse(const std::string &s, WeatherFrame &f)
+{
+	std::vector<char> exact(s.begin(), s.end());				// no slack after the frame
+	return ws_parse_frame(exact.data(), exact.size(), f);
+}
+
+// reference: "%WS," 8 comma separated [+-]digits in int16_t range, '#' last, at most UART1_BUFFER bytes
+static bool reference(const std::string &s, int16_t out[WS_FRAME_FIELDS])
+{
+	size_t start = 4;
+	int n = 0;
+
+	if(( s.size() > UART1_BUFFER ) || ( s.size() < 5 ) || ( s.compare(0, 4, "%WS,") != 0 ) || ( s.back() != '#' ))
+		return false;
+	std::string body = s.substr(0, s.size() - 1) + ",";
+	for(size_t i = start; i < body.size(); i++) {
+		if( body[i] != ',' )
+			continue;
+		std::string field = body.substr(start, i - start);
+		size_t d = ( !field.empty() && (( field[0] == '-' ) || ( field[0] == '+' ))) ? 1 : 0;
+		if(( field.size() == d ) || ( field.find_first_not_of("0123456789", d) != std::string::npos ) || ( n >= WS_FRAME_FIELDS ))
+			return false;
+		size_t first = field.find_first_not_of('0', d);
+		if(( first != std::string::npos ) && ( field.size() - first > 5 ))
+			return false;										// more than 5 significant digits
+		long v = strtol(field.c_str(), NULL, 10);
+		if(( v < -32768 ) || ( v > 32767 ))
+			return false;
+		out[n++] = (int16_t)v;
+		start = i + 1;
+	}
+	return n == WS_FRAME_FIELDS;
+}
+
+static std::string valid_frame()
+{
+	char b[UART1_BUFFER];
+	snprintf(b, sizeof(b), "%%WS,%d,%d,%d,%d,%d,%d,%d,%d#", (int)rnd(1000) - 500, (int)rnd(1000) - 500, (int)rnd(101),
+		(int)rnd(111), (int)rnd(2), (int)rnd(10000), (int)rnd(102) - 1, (int)rnd(10001) - 1);
+	return b;
+}
+
+static std::string mutate(std::string s)
+{
+	const char alphabet[] = "%WS,#-+0123456789 \r\n\0x\xff";
+	uint32_t n = 1 + rnd(4);
+
+	for(uint32_t i = 0; i < n; i++) {
+		size_t at = s.empty() ? 0 : rnd(s.size());
+		switch( rnd(8) ) {
+		case 0: if( !s.empty() ) s[at] = alphabet[rnd(sizeof(alphabet) - 1)]; break;			// replace
+		case 1: s.insert(s.begin() + at, alphabet[rnd(sizeof(alphabet) - 1)]); break;			// insert
+		case 2: if( !s.empty() ) s.erase(at, 1); break;										// delete
+		case 3: s.resize(at); break;															// truncate
+		case 4: s.insert(at, std::string(1 + rnd(8), '0' + rnd(10))); break;					// long number
+		case 5: s.insert(at, ",1"); break;														// extra field
+		case 6: if( !s.empty() ) s[at] = (char)rnd(256); break;								// any byte
+		case 7: s.insert(at, std::string(10 + rnd(30), '0')); break;							// leading zeros, overlong
+		}
+	}
+	return s;
+}
+
+/**************************************************************************************************
+  original parser, parse_ws_message() without Serial.println() and the range checks
+**************************************************************************************************/
+static char rx_1_buffer[UART1_BUFFER];
+
+static bool legacy_parse(int16_t params[8])
+{
+	uint8_t s, d, v;
+	char s_val[8];
+
+	s = 0;
+	d = 0;
+	v = 0;
+
+	if((rx_1_buffer[0] == '%') && (rx_1_buffer[1] == 'W') && (rx_1_buffer[2] == 'S') && (rx_1_buffer[3] == ','))
+	{
+		s = 4;
+
+		while(rx_1_buffer[s])
+		{
+			if(( rx_1_buffer[s] == ',' ) || ( rx_1_buffer[s] == '#' ))
+			{
+				params[v] = atoi( s_val );
+				v++;
+				s++;
+				d = 0;
+			}
+			else
+			{
+				s_val[d++] = rx_1_buffer[s++];
+				s_val[d] = 0;
+			}
+		}
+	}
+	return true;
+}
+
+/**************************************************************************************************
+  tests
+**************************************************************************************************/
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_errors(void)
+{
+	WeatherFrame f = {};
+
+	TEST_ASSERT_EQUAL(WsParseError_t::kOk, parse("%WS,-175,-120,24,85,1,1270,-1,-1#", f));
+	TEST_ASSERT_EQUAL(-175, f.tsky);
+	TEST_ASSERT_EQUAL(-120, f.tair);
+	TEST_ASSERT_EQUAL(1270, f.light);
+	TEST_ASSERT_EQUAL(-1, f.stars);
+	TEST_ASSERT_EQUAL(WsParseError_t::kOk, parse("%WS,-32768,32767,+0,0,0,0,0,0#", f));
+	TEST_ASSERT_EQUAL(-32768, f.tsky);
+	TEST_ASSERT_EQUAL(32767, f.tair);
+
+	f.tsky = 123;
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadHeader, parse("%WX,1,2,3,4,5,6,7,8#", f));
+	TEST_ASSERT_EQUAL(123, f.tsky);										// untouched on error
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadHeader, parse("%WS", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kTooLong, parse("%WS," + std::string(UART1_BUFFER, '1') + "#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kTooShort, parse("%WS,1,2,3,4,5,6,7#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kTooManyFields, parse("%WS,1,2,3,4,5,6,7,8,9#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadNumber, parse("%WS,1,,3,4,5,6,7,8#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadNumber, parse("%WS,1,2a,3,4,5,6,7,8#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadNumber, parse("%WS,32768,2,3,4,5,6,7,8#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadNumber, parse("%WS,-32769,2,3,4,5,6,7,8#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kBadNumber, parse("%WS,-,2,3,4,5,6,7,8#", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kNoTerminator, parse("%WS,1,2,3,4,5,6,7,8", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kNoTerminator, parse("%WS,1,2,3,4,5,6,7,8#\r", f));
+	TEST_ASSERT_EQUAL(WsParseError_t::kNoTerminator, parse("%WS,1,2,3,4,5,6,7,", f));
+	TEST_ASSERT_EQUAL_STRING("TooShort", ws_parse_error_str(WsParseError_t::kTooShort));
+}
+
+// mutated frames: accepted exactly when the reference accepts them, with the same values
+void test_fuzz(void)
+{
+	uint32_t iterations = strtoul(env("WS_FUZZ_ITER", "200000"), NULL, 10);
+	uint32_t accepted = 0;
+	uint32_t errors[8] = {0};
+
+	seed = strtoul(env("WS_FUZZ_SEED", "1"), NULL, 10);
+	for(uint32_t i = 0; i < iterations; i++) {
+		std::string s = ( rnd(8) == 0 ) ? valid_frame() : mutate(valid_frame());
+		int16_t expected[WS_FRAME_FIELDS];
+		WeatherFrame f;
+		WsParseError_t err = parse(s, f);
+		bool ok = reference(s, expected);
+
+		errors[(int)err]++;
+		if( ok != ( err == WsParseError_t::kOk )) {
+			printf("mismatch on \"%s\": %s\n", s.c_str(), ws_parse_error_str(err));
+			TEST_FAIL_MESSAGE("parser and reference disagree");
+		}
+		if( ok ) {
+			for(uint8_t ch = 0; ch < WS_FRAME_FIELDS; ch++)
+				TEST_ASSERT_EQUAL_INT16(expected[ch], ws_channel(f, ch));
+			accepted++;
+		}
+	}
+
+	printf("{\"bench\":\"weather_frame_fuzz\",\"iterations\":%u,\"accepted\":%u,\"errors\":{", iterations, accepted);
+	for(int e = 1; e <= (int)WsParseError_t::kNoTerminator; e++)
+		printf("%s\"%s\":%u", e > 1 ? "," : "", ws_parse_error_str((WsParseError_t)e), errors[e]);
+	printf("}}\n");
+	TEST_ASSERT_TRUE(accepted > 0);
+	TEST_ASSERT_TRUE(accepted < iterations);
+}
+
+void test_throughput(void)
+{
+	std::vector<std::string> frames;
+	volatile int32_t sink = 0;
+	double new_fps, old_fps;
+
+	seed = 7;
+	for(uint32_t i = 0; i < 256; i++)
+		frames.push_back(valid_frame());
+
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_FRAMES; i++) {
+		const std::string &s = frames[i & 255];
+		WeatherFrame f;
+		if( ws_parse_frame(s.data(), s.size(), f) == WsParseError_t::kOk )
+			sink = sink + f.light;
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < BENCH_FRAMES; i++) {
+		const std::string &s = frames[i & 255];
+		int16_t params[8];
+		memcpy(rx_1_buffer, s.c_str(), s.size() + 1);				// the original parsed the NUL terminated rx buffer
+		if( legacy_parse(params) )
+			sink = sink + params[5];
+	}
+	auto t2 = std::chrono::steady_clock::now();
+
+	new_fps = BENCH_FRAMES / std::chrono::duration<double>(t1 - t0).count();
+	old_fps = BENCH_FRAMES / std::chrono::duration<double>(t2 - t1).count();
+	printf("{\"bench\":\"weather_frame_parse\",\"frames\":%u,\"ws_parse_frame_fps\":%.0f,\"legacy_fps\":%.0f,\"speedup\":%.2f}\n",
+		BENCH_FRAMES, new_fps, old_fps, new_fps / old_fps);
+	TEST_ASSERT_TRUE(new_fps > 0);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_errors);
+	RUN_TEST(test_fuzz);
+	RUN_TEST(test_throughput);
+	return UNITY_END();
+}
@@ -0,0 +1,320 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    WeatherHistory fed a night of frames at 1 Hz with gaps and missing clouds/stars:
+                  the three tiers against min/mean/max computed from every frame, time ranges and
+                  small TCP chunks on /weather/history, no allocation in Add(). Then the cost of
+                  Add() on an empty and a full history and of a query of each tier, in ns and bytes,
+                  as JSON on stdout.
+                  env: WSH_ADDS frames per Add() run (1000000), WSH_QUERIES queries per tier (2000)
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <map>
+
+#include "WeatherHistory.cpp"
+
+#define NIGHT_S             ( 13 * 3600 )
+#define GAP_FROM_S          20000       // station lost for a little more than 2 minutes
+#define GAP_TO_S            20130
+#define NO_CLOUDS_FROM_S    30000       // clouds sensor missing for 3 minutes
+#define NO_CLOUDS_TO_S      30180
+
+static const char *env(const char *name, const char *def)
+{
+	const char *v = getenv(name);
+	return v ? v : def;
+}
+
+/**************************************************************************************************
+  allocations, interposed on glibc
+**************************************************************************************************/
+static uint64_t heap_calls;
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) { heap_calls++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { heap_calls++; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) { heap_calls++; return __libc_realloc(p, size); }
+}
+#endif
+
+/**************************************************************************************************
+  reference: every frame kept, aggregates of each period computed from them
+**************************************************************************************************/
+typedef struct {
+	int32_t sum[WS_FRAME_FIELDS];
+	uint16_t n[WS_FRAME_FIELDS];
+	int16_t min[WS_FRAME_FIELDS];
+	int16_t max[WS_FRAME_FIELDS];
+} RefAgg_t;
+
+static std::map<uint32_t, WeatherFrame> frames;					// by second, the last frame of the second
+static std::vector<std::pair<uint32_t, WeatherFrame>> added;	// every frame, all count in the aggregates
+static std::map<uint32_t, RefAgg_t> ref1, ref2;					// by start of the period
+
+static void ref_add(std::map<uint32_t, RefAgg_t> &ref, uint32_t t, const WeatherFrame &f)
+{
+	auto it = ref.find(t);
+
+	if( it == ref.end() ) {
+		RefAgg_t a;
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+			a.sum[c] = 0;
+			a.n[c] = 0;
+			a.min[c] = INT16_MAX;
+			a.max[c] = INT16_MIN;
+		}
+		it = ref.emplace(t, a).first;
+	}
+	for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+		int16_t v = ws_channel(f, c);
+		if( !ws_channel_valid(c, v) )
+			continue;
+		it->second.sum[c] += v;
+		it->second.n[c]++;
+		it->second.min[c] = std::min(it->second.min[c], v);
+		it->second.max[c] = std::max(it->second.max[c], v);
+	}
+}
+
+static WeatherFrame make_frame(uint32_t t, uint32_t &seed)
+{
+	WeatherFrame f;
+
+	seed = seed * 1664525 + 1013904223;
+	f.tsky = -250 + (int16_t)( t / 600 ) + (int16_t)(( seed >> 8 ) % 31) - 15;
+	f.tair = 80 - (int16_t)( t / 1200 );
+	f.wind = (int16_t)(( seed >> 12 ) % 40);
+	f.hum = 60 + (int16_t)( t / 2000 );
+	f.rain = ( t % 5000 < 300 ) ? 1 : 0;
+	f.light = ( t > NIGHT_S - 1800 ) ? (int16_t)(( t - ( NIGHT_S - 1800 )) / 18) : 0;
+	f.clouds = (( t >= NO_CLOUDS_FROM_S ) && ( t < NO_CLOUDS_TO_S )) ? -1 : (int16_t)(( seed >> 16 ) % 100);
+	f.stars = ( t % 7 == 0 ) ? -1 : (int16_t)(( seed >> 20 ) % 200);		// now and then no star count
+	return f;
+}
+
+static AsyncWebServer server;
+
+// a night of frames into the history and the reference, clock at the last frame
+static void feed_night()
+{
+	uint32_t seed = 5;
+
+	for(uint32_t t = 1; t <= NIGHT_S; t++) {
+		if(( t >= GAP_FROM_S ) && ( t < GAP_TO_S ))
+			continue;
+		WeatherFrame f = make_frame(t, seed);
+
+		mock::set_ms(t * 1000 + 200);
+		weather_history.Add(f, millis());
+		added.push_back({t, f});
+		if( t % 97 == 0 ) {										// two frames in the same second, tier 0 keeps the last
+			f.wind = 99;
+			mock::set_ms(t * 1000 + 700);
+			weather_history.Add(f, millis());
+			added.push_back({t, f});
+		}
+		frames[t] = f;
+	}
+	for(const auto &kv : added) {
+		ref_add(ref1, kv.first - kv.first % WSH_T1_PERIOD, kv.second);
+		ref_add(ref2, kv.first - kv.first % WSH_T2_PERIOD, kv.second);
+	}
+}
+
+static JsonDocument query(const char *tier, const char *from, const char *to, size_t *bytes = NULL)
+{
+	AsyncWebServerRequest req(HTTP_GET, WSH_URL);
+	JsonDocument doc;
+
+	if( tier ) req.AddParam("tier", tier);
+	if( from ) req.AddParam("from", from);
+	if( to ) req.AddParam("to", to);
+	String body = server.Dispatch(&req)->body();
+	if( bytes )
+		*bytes = body.length();
+	TEST_ASSERT_TRUE(deserializeJson(doc, body) == DeserializationError::Ok);
+	return doc;
+}
+
+// rows of a tier against the reference periods started before `open`, the last `size` of them
+static void check_tier(const char *tier, std::map<uint32_t, RefAgg_t> &ref, uint32_t period, uint32_t size, uint32_t open)
+{
+	JsonDocument doc = query(tier, NULL, NULL);
+	JsonVariantConst rows = doc["rows"];
+	std::vector<std::pair<uint32_t, RefAgg_t>> closed;
+
+	for(const auto &kv : ref)
+		if( kv.first < open )
+			closed.push_back(kv);
+	TEST_ASSERT_EQUAL_UINT32(period, doc["period_s"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(std::min((size_t)size, closed.size()), rows.size());
+
+	for(size_t i = 0; i < rows.size(); i++) {
+		const auto &r = closed[closed.size() - rows.size() + i];
+
+		TEST_ASSERT_EQUAL_UINT32(r.first, rows[i][0].as<uint32_t>());
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+			bool none = ( r.second.n[c] == 0 );
+
+			TEST_ASSERT_EQUAL(none ? -1 : r.second.min[c], rows[i][1 + c].as<int>());
+			TEST_ASSERT_EQUAL(none ? -1 : r.second.sum[c] / (int32_t)r.second.n[c], rows[i][1 + WS_FRAME_FIELDS + c].as<int>());
+			TEST_ASSERT_EQUAL(none ? -1 : r.second.max[c], rows[i][1 + 2 * WS_FRAME_FIELDS + c].as<int>());
+		}
+	}
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {
+		mock::real_clock = false;
+		weather_history.Begin(&server);
+		feed_night();
+		begun = true;
+	}
+	mock::chunk_size = 1436;
+}
+void tearDown(void) {}
+
+void test_tier0(void)
+{
+	JsonDocument doc = query("0", NULL, NULL);
+	JsonVariantConst rows = doc["rows"];
+
+	TEST_ASSERT_EQUAL_UINT32(WSH_T0_SIZE, rows.size());
+	TEST_ASSERT_EQUAL_UINT32(NIGHT_S, doc["now_s"].as<uint32_t>());
+	TEST_ASSERT_EQUAL_STRING("tsky", doc["channels"][0].as<const char *>());
+	for(size_t i = 0; i < rows.size(); i++) {
+		uint32_t t = NIGHT_S - WSH_T0_SIZE + 1 + i;
+
+		TEST_ASSERT_EQUAL_UINT32(t, rows[i][0].as<uint32_t>());
+		for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++)
+			TEST_ASSERT_EQUAL(ws_channel(frames[t], c), rows[i][1 + c].as<int>());
+	}
+}
+
+// the minute of the last frame is still open
+void test_tier1(void) { check_tier("1", ref1, WSH_T1_PERIOD, WSH_T1_SIZE, NIGHT_S - NIGHT_S % WSH_T1_PERIOD); }
+
+// tier 2 is fed from closed minutes, its period closes with the first minute of the next one
+void test_tier2(void)
+{
+	uint32_t last_minute = NIGHT_S - NIGHT_S % WSH_T1_PERIOD - WSH_T1_PERIOD;
+
+	check_tier("2", ref2, WSH_T2_PERIOD, WSH_T2_SIZE, last_minute - last_minute % WSH_T2_PERIOD);
+}
+
+// a range of the night, small chunks give the same document
+void test_range_and_chunks(void)
+{
+	char from[12], to[12];
+	size_t big, small;
+
+	snprintf(from, sizeof(from), "%u", NIGHT_S - 2 * 3600);
+	snprintf(to, sizeof(to), "%u", NIGHT_S - 3600);
+	JsonDocument a = query("1", from, to, &big);
+	TEST_ASSERT_EQUAL_UINT32(61, a["rows"].size());
+	TEST_ASSERT_EQUAL_UINT32(NIGHT_S - 2 * 3600, a["rows"][0][0].as<uint32_t>());
+	TEST_ASSERT_EQUAL_UINT32(NIGHT_S - 3600, a["rows"][60][0].as<uint32_t>());
+
+	mock::chunk_size = WSH_ROW_SIZE + 2;
+	JsonDocument b = query("1", from, to, &small);
+	TEST_ASSERT_EQUAL_UINT32(big, small);
+	for(size_t i = 0; i < a["rows"].size(); i++)
+		for(size_t c = 0; c <= 3 * WS_FRAME_FIELDS; c++)
+			TEST_ASSERT_EQUAL(a["rows"][i][c].as<int>(), b["rows"][i][c].as<int>());
+
+	AsyncWebServerRequest bad(HTTP_GET, WSH_URL);
+	bad.AddParam("tier", "3");
+	TEST_ASSERT_EQUAL(400, server.Dispatch(&bad)->code());
+	TEST_ASSERT_EQUAL_UINT32(0, query("2", "0", "1000")["rows"].size());	// older than the ring
+}
+
+void test_no_allocation(void)
+{
+	uint32_t seed = 9;
+	uint64_t calls = heap_calls;
+
+	for(uint32_t t = NIGHT_S + 1; t <= NIGHT_S + 3600; t++)
+		weather_history.Add(make_frame(t, seed), t * 1000);
+	TEST_ASSERT_TRUE(heap_calls == calls);
+}
+
+static double add_ns(WeatherHistory &h, uint32_t t0, uint32_t adds)
+{
+	uint32_t seed = 1;
+	WeatherFrame f = make_frame(t0, seed);
+
+	auto a = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < adds; i++) {
+		f.tsky = (int16_t)i;
+		h.Add(f, ( t0 + i ) * 1000);
+	}
+	auto b = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(b - a).count() / adds;
+}
+
+void test_benchmark(void)
+{
+	uint32_t adds = atoi(env("WSH_ADDS", "1000000"));
+	uint32_t queries = atoi(env("WSH_QUERIES", "2000"));
+	WeatherHistory *empty = new WeatherHistory();
+	AsyncWebServer s;
+	double query_ns[3];
+	size_t bytes[3];
+	uint32_t rows[3];
+
+	empty->Begin(&s);
+	double add_empty = add_ns(*empty, 1, adds);						// rings fill up during the run
+	double add_full = add_ns(weather_history, NIGHT_S + 3601, adds);	// every ring full, oldest overwritten
+
+	mock::set_ms(( NIGHT_S + 3600ULL + adds ) * 1000);
+
+	for(uint8_t tier = 0; tier < 3; tier++) {
+		char t[2] = { (char)( '0' + tier ), 0 };
+
+		rows[tier] = query(t, NULL, NULL, &bytes[tier])["rows"].size();
+		auto a = std::chrono::steady_clock::now();
+		for(uint32_t i = 0; i < queries; i++) {
+			AsyncWebServerRequest req(HTTP_GET, WSH_URL);
+			req.AddParam("tier", t);
+			server.Dispatch(&req)->body();
+		}
+		auto b = std::chrono::steady_clock::now();
+		query_ns[tier] = std::chrono::duration<double, std::nano>(b - a).count() / queries;
+	}
+
+	printf("{\"bench\":\"weather_history\",\"ram_bytes\":%u,\"add_ns\":{\"empty\":%.1f,\"full\":%.1f},\"query\":["
+		"{\"tier\":0,\"rows\":%u,\"bytes\":%u,\"us\":%.1f},{\"tier\":1,\"rows\":%u,\"bytes\":%u,\"us\":%.1f},"
+		"{\"tier\":2,\"rows\":%u,\"bytes\":%u,\"us\":%.1f}]}\n",
+		(unsigned)sizeof(WeatherHistory), add_empty, add_full,
+		rows[0], (unsigned)bytes[0], query_ns[0] / 1000, rows[1], (unsigned)bytes[1], query_ns[1] / 1000,
+		rows[2], (unsigned)bytes[2], query_ns[2] / 1000);
+
+	TEST_ASSERT_TRUE(sizeof(WeatherHistory) < 20 * 1024);			// memory budget of WeatherHistory.h
+	TEST_ASSERT_TRUE(add_full < 4 * add_empty + 50);				// O(1): no cost growth with the fill
+	delete empty;
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_tier0);
+	RUN_TEST(test_tier1);
+	RUN_TEST(test_tier2);
+	RUN_TEST(test_range_and_chunks);
+	RUN_TEST(test_no_allocation);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,228 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    WebAssets over the data/www files on the flash emulator: the ?v= links of
+                  setup.html match the manifest, ETag on every asset, 304 on If-None-Match, immutable
+                  caching of fingerprinted urls only, gzip files, /stats/assets. Then a browser that
+                  keeps what it is allowed to cache visits the setup page again and again: bytes and
+                  requests per visit and a load time from a round trip and a throughput, against the
+                  library static handler answering every asset in full, as JSON on stdout.
+
+                  WEB_DATA    data directory of the project, default data
+                  WEB_RTT_MS  Wi-Fi round trip, default 30
+                  WEB_KBPS    throughput of the board serving LittleFS files in kB/s, default 250
+                  WEB_VISITS  visits of the page, default 10
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <regex>
+
+#include "WebAssets.cpp"
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+static AsyncWebServer server;
+static JsonDocument manifest;
+
+static std::string read_text(const std::string &path)
+{
+	std::ifstream f(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static AsyncWebServerResponse *get(AsyncWebServerRequest &req, const char *v = NULL, const char *match = NULL)
+{
+	if( v ) req.AddParam("v", v);
+	if( match ) req.AddHeader("If-None-Match", match);
+	return server.Dispatch(&req);
+}
+
+void setUp(void)
+{
+	static bool begun = false;
+
+	if( !begun ) {													// the data partition as uploaded
+		std::string data = env("WEB_DATA", "data");
+
+		LittleFS.begin();
+		std::filesystem::copy(data + "/www", mock::fs_root + "/www", std::filesystem::copy_options::recursive);
+		deserializeJson(manifest, read_text(data + WEB_ASSETS_MANIFEST));
+		web_assets.Begin(&server);
+		begun = true;
+	}
+}
+void tearDown(void) {}
+
+void test_manifest(void)
+{
+	std::string page = read_text(mock::fs_root + "/www/setup.html");
+	std::regex link("(?:href|src)=\"(/www/[^\"?]+)\\?v=([0-9a-f]+)\"");
+	std::map<std::string, std::string> hashes;
+	uint32_t links = 0;
+
+	TEST_ASSERT_TRUE(manifest["assets"].size() > 0);
+	TEST_ASSERT_TRUE(manifest["assets"].size() <= WEB_ASSETS_MAX);
+	for(size_t i = 0; i < manifest["assets"].size(); i++) {
+		JsonVariantConst a = manifest["assets"][i];
+		File f = LittleFS.open(a["file"].as<const char *>(), "r");
+
+		TEST_ASSERT_TRUE((bool)f);										// the file is on the partition, same size
+		TEST_ASSERT_EQUAL_UINT32(a["size"].as<uint32_t>(), f.size());
+		f.close();
+		hashes[a["url"].as<const char *>()] = a["hash"].as<const char *>();
+	}
+	for(std::sregex_iterator m(page.begin(), page.end(), link), end; m != end; ++m, links++)
+		TEST_ASSERT_EQUAL_STRING(hashes[(*m)[1]].c_str(), (*m)[2].str().c_str());
+	TEST_ASSERT_EQUAL_UINT32(hashes.size() - 1, links);				// every asset but the page itself
+}
+
+void test_etag(void)
+{
+	JsonVariantConst a = manifest["assets"][3];						// theme.css, not compressed
+	const char *url = a["url"].as<const char *>();
+	String etag = String("\"") + a["hash"].as<const char *>() + "\"";
+
+	TEST_ASSERT_EQUAL_STRING("/www/css/theme.css", url);
+	AsyncWebServerRequest plain(HTTP_GET, url);
+	AsyncWebServerResponse *r = get(plain);
+	TEST_ASSERT_EQUAL(200, r->code());
+	TEST_ASSERT_EQUAL_STRING(etag.c_str(), r->header("ETag").c_str());
+	TEST_ASSERT_EQUAL_STRING("no-cache", r->header("Cache-Control").c_str());	// revalidated each time
+	TEST_ASSERT_EQUAL_UINT32(a["size"].as<uint32_t>(), r->body().length());
+
+	AsyncWebServerRequest fingerprinted(HTTP_GET, url);
+	r = get(fingerprinted, a["hash"].as<const char *>());
+	TEST_ASSERT_EQUAL_STRING("public, max-age=31536000, immutable", r->header("Cache-Control").c_str());
+
+	AsyncWebServerRequest stale(HTTP_GET, url);						// link of an older build
+	r = get(stale, "0123456789abcdef");
+	TEST_ASSERT_EQUAL_STRING("no-cache", r->header("Cache-Control").c_str());
+
+	AsyncWebServerRequest match(HTTP_GET, url);
+	r = get(match, NULL, ( String("\"0000\", ") + etag ).c_str());
+	TEST_ASSERT_EQUAL(304, r->code());
+	TEST_ASSERT_EQUAL_UINT32(0, r->body().length());
+	TEST_ASSERT_EQUAL_STRING(etag.c_str(), r->header("ETag").c_str());
+
+	AsyncWebServerRequest other(HTTP_GET, url);
+	TEST_ASSERT_EQUAL(200, get(other, NULL, "\"0000\"")->code());
+
+	JsonVariantConst gz = manifest["assets"][5];						// jquery-ui.min.js.gz
+	AsyncWebServerRequest zipped(HTTP_GET, gz["url"].as<const char *>());
+	r = get(zipped);
+	TEST_ASSERT_EQUAL_STRING("gzip", r->header("Content-Encoding").c_str());
+	TEST_ASSERT_EQUAL_UINT32(gz["size"].as<uint32_t>(), r->body().length());
+
+	AsyncWebServerRequest stats(HTTP_GET, WEB_ASSETS_URL);
+	stats.AddParam("reset", "1");
+	JsonDocument doc;
+	deserializeJson(doc, server.Dispatch(&stats)->body());
+	TEST_ASSERT_EQUAL(6, doc["requests"].as<int>());
+	TEST_ASSERT_EQUAL(1, doc["not_modified"].as<int>());
+	TEST_ASSERT_EQUAL_UINT32(a["size"].as<uint32_t>(), doc["bytes_saved"].as<uint32_t>());
+}
+
+/**************************************************************************************************
+  repeat visits
+**************************************************************************************************/
+typedef struct {
+	uint32_t requests;
+	uint64_t bytes;
+	double ms;
+} Visit_t;
+
+// a browser cache: ETag of every url, fingerprinted urls never asked again
+typedef struct {
+	std::map<std::string, String> etag;
+	std::map<std::string, bool> immutable;
+} Cache_t;
+
+static Visit_t visit(Cache_t *cache, double rtt_ms, double kbps)
+{
+	Visit_t v = { 0, 0, 0 };
+	uint32_t rounds = 0;
+
+	for(int pass = 0; pass < 2; pass++) {							// the page, then its assets in parallel
+		bool round = false;
+
+		for(size_t i = 0; i < manifest["assets"].size(); i++) {
+			JsonVariantConst a = manifest["assets"][i];
+			std::string url = a["url"].as<const char *>();
+			bool page = ( url == "/www/setup.html" );
+
+			if( page != ( pass == 0 ))
+				continue;
+			if( cache && cache->immutable[url] )
+				continue;
+
+			AsyncWebServerRequest req(HTTP_GET, url.c_str());
+			AsyncWebServerResponse *r;
+			if( !cache ) {												// library static handler, no validator
+				r = req.beginResponse(LittleFS, url.c_str());
+				req.send(r);
+			} else
+				r = get(req, page ? NULL : a["hash"].as<const char *>(), cache->etag.count(url) ? cache->etag[url].c_str() : NULL);
+			v.bytes += r->body().length();
+			v.requests++;
+			round = true;
+			if( cache ) {
+				cache->etag[url] = r->header("ETag");
+				cache->immutable[url] = ( r->header("Cache-Control").indexOf("immutable") >= 0 );
+			}
+		}
+		rounds += round ? 1 : 0;
+	}
+	v.ms = rounds * rtt_ms + v.bytes / kbps;
+	return v;
+}
+
+void test_repeat_visits(void)
+{
+	double rtt = atof(env("WEB_RTT_MS", "30"));
+	double kbps = atof(env("WEB_KBPS", "250"));
+	uint32_t visits = atoi(env("WEB_VISITS", "10"));
+	Cache_t cache;
+	Visit_t before, first, repeat = { 0, 0, 0 };
+
+	before = visit(NULL, rtt, kbps);									// same on every visit
+	first = visit(&cache, rtt, kbps);
+	for(uint32_t i = 1; i < visits; i++) {
+		Visit_t v = visit(&cache, rtt, kbps);
+		repeat.requests += v.requests;
+		repeat.bytes += v.bytes;
+		repeat.ms += v.ms;
+	}
+	if( visits > 1 ) {
+		repeat.requests /= visits - 1;
+		repeat.bytes /= visits - 1;
+		repeat.ms /= visits - 1;
+	}
+
+	printf("{\"bench\":\"web_assets\",\"visits\":%u,\"rtt_ms\":%.0f,\"kbps\":%.0f,"
+		"\"library\":{\"requests\":%u,\"bytes\":%llu,\"ms\":%.0f},\"etag\":{\"first\":{\"requests\":%u,\"bytes\":%llu,\"ms\":%.0f},"
+		"\"repeat\":{\"requests\":%u,\"bytes\":%llu,\"ms\":%.0f}}}\n",
+		visits, rtt, kbps, before.requests, (unsigned long long)before.bytes, before.ms,
+		first.requests, (unsigned long long)first.bytes, first.ms, repeat.requests, (unsigned long long)repeat.bytes, repeat.ms);
+
+	TEST_ASSERT_EQUAL_UINT32(before.bytes, first.bytes);				// first visit: everything once
+	if( visits > 1 ) {
+		TEST_ASSERT_EQUAL_UINT32(1, repeat.requests);					// the page, revalidated
+		TEST_ASSERT_EQUAL_UINT32(0, repeat.bytes);
+		TEST_ASSERT_TRUE(repeat.ms < before.ms / 10);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_manifest);
+	RUN_TEST(test_etag);
+	RUN_TEST(test_repeat_visits);
+	return UNITY_END();
+}
@@ -0,0 +1,273 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    WindowAverage against a reference that keeps every sample and averages the ones
+                  in the window, on a random trace with stalls, long gaps, missing clouds/stars and
+                  window changes. The ObservingConditions device: AveragePeriod, instantaneous and
+                  averaged reads, TimeSinceLastUpdate, the settings journal key. Then the latency of
+                  an instantaneous and of a 1 hour averaged read, and of averaging the hour of
+                  samples on every read, as JSON on stdout.
+
+                  WAVG_SAMPLES samples of the random trace, default 400000
+                  WAVG_READS reads per latency measure, default 200000
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+
+#include "WindowAverage.cpp"
+#include "ObservingConditions.cpp"
+#include "SettingsJournal.cpp"
+#include "AlpacaActions.cpp"
+
+Snapshot<WeatherSnapshot> weather_snapshot;
+
+static const char *env(const char *name, const char *def) { const char *v = getenv(name); return v ? v : def; }
+
+/**************************************************************************************************
+  reference: every sample kept, average of the ones in the buckets of the window
+**************************************************************************************************/
+typedef struct {
+	uint32_t ms;
+	WeatherFrame f;
+} Sample_t;
+
+static bool ref_average(const std::vector<Sample_t> &samples, uint8_t channel, uint32_t now_ms, uint32_t window, double &avg)
+{
+	uint32_t head = now_ms / WAVG_BUCKET_MS;
+	double sum = 0;
+	uint32_t n = 0;
+
+	for(auto it = samples.rbegin(); it != samples.rend(); ++it) {
+		if( head - it->ms / WAVG_BUCKET_MS >= window )
+			break;
+		int16_t v = ws_channel(it->f, channel);
+		if( !ws_channel_valid(channel, v) )
+			continue;
+		sum += v;
+		n++;
+	}
+	if( n == 0 )
+		return false;
+	avg = sum / n;
+	return true;
+}
+
+static WeatherFrame make_frame(uint32_t &seed)
+{
+	WeatherFrame f;
+
+	seed = seed * 1664525 + 1013904223;
+	f.tsky = -300 + (int16_t)(( seed >> 4 ) % 250);
+	f.tair = -100 + (int16_t)(( seed >> 6 ) % 400);
+	f.wind = (int16_t)(( seed >> 8 ) % 120);
+	f.hum = (int16_t)(( seed >> 10 ) % 101);
+	f.rain = (( seed >> 12 ) % 50 == 0) ? 1 : 0;
+	f.light = (int16_t)(( seed >> 14 ) % 30000);
+	f.clouds = (( seed >> 16 ) % 4 == 0) ? -1 : (int16_t)(( seed >> 18 ) % 101);	// no sensor now and then
+	f.stars = (( seed >> 20 ) % 3 == 0) ? -1 : (int16_t)(( seed >> 22 ) % 500);
+	return f;
+}
+
+void setUp(void)
+{
+	mock::real_clock = false;
+}
+void tearDown(void) {}
+
+/**************************************************************************************************
+  WindowAverage
+**************************************************************************************************/
+void test_window(void)
+{
+	WindowAverage w;
+
+	TEST_ASSERT_EQUAL_UINT32(WAVG_BUCKET_MS, w.GetWindow());
+	w.SetWindow(0);
+	TEST_ASSERT_EQUAL_UINT32(WAVG_BUCKET_MS, w.GetWindow());
+	w.SetWindow(WAVG_BUCKET_MS + 1);									// rounded up
+	TEST_ASSERT_EQUAL_UINT32(2 * WAVG_BUCKET_MS, w.GetWindow());
+	w.SetWindow(2 * 3600000);											// clamped to the ring
+	TEST_ASSERT_EQUAL_UINT32(WAVG_BUCKETS * WAVG_BUCKET_MS, w.GetWindow());
+
+	float avg;
+	TEST_ASSERT_FALSE(w.Average(WS_CH_TSKY, 1000, avg));				// nothing yet
+	WeatherFrame f = { -200, 100, 10, 50, 0, 0, -1, -1 };
+	w.Add(f, 1000);
+	TEST_ASSERT_TRUE(w.Average(WS_CH_TSKY, 1000, avg));
+	TEST_ASSERT_EQUAL_FLOAT(-200.0f, avg);
+	TEST_ASSERT_FALSE(w.Average(WS_CH_CLOUDS, 1000, avg));				// -1 is no sensor
+	TEST_ASSERT_FALSE(w.Average(WS_CH_TSKY, 1000 + WAVG_BUCKETS * WAVG_BUCKET_MS, avg));	// left the window
+}
+
+void test_against_reference(void)
+{
+	static const uint32_t windows_ms[] = { 15000, 60000, 450000, 3600000, 0, 7200000, 100000 };
+	uint32_t samples = atoi(env("WAVG_SAMPLES", "400000"));
+	std::vector<Sample_t> ref;
+	WindowAverage w;
+	uint32_t seed = 11, now = 5000, window = 1, reads = 0, empty = 0;
+
+	ref.reserve(samples);
+	for(uint32_t i = 0; i < samples; i++) {
+		seed = seed * 1664525 + 1013904223;
+		if( seed % 20011 == 0 )
+			now += ( seed >> 8 ) % 7200000;							// station lost up to 2 hours
+		else if( seed % 13 != 0 )									// else a stall, two frames at once
+			now += 500 + ( seed >> 8 ) % 2500;
+
+		if( i % 25000 == 0 ) {
+			w.SetWindow(windows_ms[( i / 25000 ) % 7]);
+			window = w.GetWindow() / WAVG_BUCKET_MS;
+		}
+
+		WeatherFrame f = make_frame(seed);
+		w.Add(f, now);
+		ref.push_back({ now, f });
+
+		if( i % 7 == 0 ) {												// reads, later than the last sample now and then
+			uint32_t t = now + ((i % 21 == 0) ? ( seed >> 12 ) % 60000 : 0);
+
+			for(uint8_t c = 0; c < WS_FRAME_FIELDS; c++) {
+				float avg;
+				double r;
+				bool valid = w.Average(c, t, avg);
+
+				TEST_ASSERT_EQUAL(ref_average(ref, c, t, window, r), valid);
+				if( valid )
+					TEST_ASSERT_TRUE(fabs(avg - r) <= 1e-5 * fmax(1.0, fabs(r)));
+				else
+					empty++;
+				reads++;
+			}
+			now = t;
+		}
+	}
+	TEST_ASSERT_TRUE(reads > 0);
+	TEST_ASSERT_TRUE(empty > 0);										// the gaps were seen
+}
+
+/**************************************************************************************************
+  ObservingConditions
+**************************************************************************************************/
+static void publish(const WeatherFrame &f, uint32_t frames)
+{
+	WeatherSnapshot s;
+
+	memset(&s, 0, sizeof(s));
+	s.values = f;
+	s.timestamp_ms = millis();
+	s.frames = frames;
+	weather_snapshot.Write(s);
+}
+
+void test_device(void)
+{
+	ObservingConditions oc;
+	WeatherFrame f = { -215, 123, 36, 80, 0, 120, 40, -1 };
+
+	oc.Begin();
+	mock::set_ms(1000);
+	publish(f, 0);
+	TEST_ASSERT_TRUE(std::isnan(oc.SkyTemperature()));						// nothing received yet
+	TEST_ASSERT_EQUAL_FLOAT(-1.0f, (float)oc.TimeSinceLastUpdate(""));
+
+	publish(f, 1);
+	oc.Add(f, millis());
+	mock::set_ms(3500);
+	TEST_ASSERT_EQUAL_FLOAT(2.5f, (float)oc.TimeSinceLastUpdate("SkyTemperature"));
+	TEST_ASSERT_EQUAL_FLOAT(-21.5f, (float)oc.SkyTemperature());		// instantaneous, last frame
+	TEST_ASSERT_EQUAL_FLOAT(12.3f, (float)oc.Temperature());
+	TEST_ASSERT_EQUAL_FLOAT(10.0f, (float)oc.WindSpeed());
+	TEST_ASSERT_EQUAL_FLOAT(80.0f, (float)oc.Humidity());
+	TEST_ASSERT_EQUAL_FLOAT(40.0f, (float)oc.CloudCover());
+	TEST_ASSERT_EQUAL_FLOAT(120.0f, (float)oc.SkyBrightness());
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)oc.RainRate());
+	TEST_ASSERT_TRUE(fabs(oc.DewPoint() - 8.98) < 0.05);				// 12.3°C at 80%
+
+	TEST_ASSERT_FALSE(oc.PutAveragePeriod(-0.1));
+	TEST_ASSERT_FALSE(oc.PutAveragePeriod(OC_MAX_AVERAGE_PERIOD + 0.1));
+	TEST_ASSERT_TRUE(oc.PutAveragePeriod(0.25));
+	TEST_ASSERT_EQUAL_FLOAT(0.25f, (float)oc.AveragePeriod());
+
+	for(uint32_t i = 1; i <= 10; i++) {								// -20.5 .. -11.5°C, 1 every 10 s
+		mock::set_ms(1000 + i * 10000);
+		f.tsky = -215 + 10 * i;
+		f.clouds = -1;
+		publish(f, 1 + i);
+		oc.Add(f, millis());
+	}
+	TEST_ASSERT_TRUE(fabs(oc.SkyTemperature() - ( -215 + 55 * 10 / 11.0 ) / 10.0) < 1e-4);	// with the first frame
+	TEST_ASSERT_EQUAL_FLOAT(40.0f, (float)oc.CloudCover());			// the valid one only
+
+	TEST_ASSERT_TRUE(oc.ApplySetting("ObservingConditions_Configuration", "Average_period", JsonVariantConst()) == false);
+	JsonDocument doc;
+	doc["v"] = 0;
+	TEST_ASSERT_TRUE(oc.ApplySetting("ObservingConditions_Configuration", "Average_period", doc["v"]));
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)oc.AveragePeriod());
+	TEST_ASSERT_TRUE(std::isnan(oc.CloudCover()));							// back to the last frame, -1
+	TEST_ASSERT_FALSE(oc.ApplySetting("ObservingConditions_Configuration", "Other", doc["v"]));
+}
+
+/**************************************************************************************************
+  read latency
+**************************************************************************************************/
+template <typename F>
+static double read_ns(uint32_t reads, F read)
+{
+	volatile double sink = 0;
+
+	auto a = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < reads; i++)
+		sink = sink + read();
+	auto b = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(b - a).count() / reads;
+}
+
+void test_benchmark(void)
+{
+	uint32_t reads = atoi(env("WAVG_READS", "200000"));
+	ObservingConditions oc;
+	std::vector<Sample_t> hour;
+	uint32_t seed = 3, t = 0;
+
+	oc.Begin();
+	for(uint32_t i = 0; i < 3600; i++) {								// an hour of frames at 1 Hz
+		WeatherFrame f = make_frame(seed);
+		t = 1000 + i * 1000;
+		mock::set_ms(t);
+		oc.Add(f, t);
+		publish(f, 1 + i);
+		hour.push_back({ t, f });
+	}
+
+	double instantaneous = read_ns(reads, [&]() { return oc.SkyTemperature(); });
+	TEST_ASSERT_TRUE(oc.PutAveragePeriod(1.0));
+	double averaged = read_ns(reads, [&]() { return oc.SkyTemperature(); });
+	double naive = read_ns(reads / 100 + 1, [&]() {
+		double r = 0;
+		ref_average(hour, WS_CH_TSKY, t, WAVG_BUCKETS, r);
+		return r;
+	});
+
+	printf("{\"bench\":\"window_average\",\"window_s\":%u,\"samples\":%u,\"read_ns\":{\"instantaneous\":%.1f,"
+		"\"averaged\":%.1f,\"recomputed\":%.1f},\"ram_bytes\":%u}\n",
+		(unsigned)(WAVG_BUCKETS * WAVG_BUCKET_MS / 1000), (unsigned)hour.size(), instantaneous, averaged, naive,
+		(unsigned)sizeof(WindowAverage));
+
+	TEST_ASSERT_TRUE(averaged < 3 * instantaneous + 100);				// running sums: same order as the last frame
+	TEST_ASSERT_TRUE(averaged < naive);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_window);
+	RUN_TEST(test_against_reference);
+	RUN_TEST(test_device);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,302 @@
+/**************************************************************************************************
+  Filename:       test_main.cpp
+  Revised:        Date: 2026-10-17
+  Revision:       Revision: 01
+
+  Description:    weather station receiver under bursty UART traffic. A station model sends bursts
+                  of %WS frames with line noise at several baud rates into a UART model with the
+                  ESP32 FIFO and driver buffer, loop() passes of varying length with occasional
+                  stalls drain it through WsReceiver and through the original one byte per pass
+                  reader. Reports frames delivered, frames/s and the worst receive path time per
+                  pass as JSON on stdout.
+**************************************************************************************************/
+#include <unity.h>
+#include <Arduino.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "WsReceiver.cpp"
+
+#define UART_RX_CAPACITY    (128 + 256)     // hardware FIFO and default driver RX buffer
+#define SIM_SECONDS         120
+#define BURST_PERIOD_MS     1000            // station sends a burst every second
+#define BURST_FRAMES        16              // frames per burst, more than the UART buffer holds
+#define LOOP_PASS_US        800             // usual loop() pass
+#define LOOP_STALL_US       20000           // slow alpaca_server.Loop(), every STALL_EVERY passes
+#define STALL_EVERY         97
+
+/**************************************************************************************************
+  UART model: bytes on the wire with arrival times, moved into the receive buffer as time passes
+**************************************************************************************************/
+class MockUart : public Stream
+{
+private:
+	std::deque<std::pair<uint64_t, char>> _wire;		// arrival time in us, byte
+	std::deque<char> _rx;
+
+public:
+	uint32_t lost = 0;						// bytes dropped on a full receive buffer
+
+	void Send(uint64_t t_us, const std::string &bytes, uint32_t baud)
+	{
+		uint64_t byte_us = 10000000ULL / baud;			// 8N1
+		for(char c : bytes) {
+			t_us += byte_us;
+			_wire.push_back({t_us, c});
+		}
+	}
+	uint64_t WireEnd() { return _wire.empty() ? 0 : _wire.back().first; }
+	void Advance(uint64_t now_us)
+	{
+		while( !_wire.empty() && ( _wire.front().first <= now_us )) {
+			if( _rx.size() < UART_RX_CAPACITY )
+				_rx.push_back(_wire.front().second);
+			else
+				lost++;
+			_wire.pop_front();
+		}
+	}
+	bool Idle() { return _wire.empty() && _rx.empty(); }
+
+	int available() override { return _rx.size(); }
+	int read() override
+	{
+		if( _rx.empty() )
+			return -1;
+		char c = _rx.front();
+		_rx.pop_front();
+		return (uint8_t)c;
+	}
+};
+
+// original loop() reader: one byte per pass, NUL terminated frame, buffer cleared after every frame
+class LegacyReceiver
+{
+private:
+	int _idx = 0;
+	char _buffer[UART1_BUFFER];
+
+public:
+	bool Pass(Stream &serial, std::string &frame)
+	{
+		if( serial.available() ) {
+			char in_msg = (char)serial.read();
+			if( in_msg == '%' )
+				_idx = 0;
+			if( _idx >= UART1_BUFFER - 1 )				// the original overflowed here, wrap instead
+				_idx = 0;
+			_buffer[_idx++] = in_msg;
+			if( in_msg == '#' ) {
+				_buffer[_idx++] = 0;
+				if( _buffer[0] == '%' ) {
+					frame = _buffer;
+					memset(_buffer, 0, sizeof(_buffer));
+					_idx = 0;
+					return true;
+				}
+				_idx = 0;
+				_buffer[0] = 0;
+			}
+		}
+		return false;
+	}
+};
+
+/**************************************************************************************************
+  station model and loop simulation
+**************************************************************************************************/
+static uint32_t seed = 1;
+static uint32_t rnd(uint32_t n) { seed = seed * 1664525 + 1013904223; return (seed >> 8) % n; }
+
+static std::string ws_frame()
+{
+	char b[UART1_BUFFER];
+	snprintf(b, sizeof(b), "%%WS,%d,%d,%d,%d,%d,%d,%d,%d#", (int)rnd(400) - 300, (int)rnd(500) - 150, (int)rnd(300),
+		(int)rnd(101), (int)rnd(2), (int)rnd(5000), (int)rnd(101) - 1, (int)rnd(101) - 1);
+	return b;
+}
+
+typedef struct {
+	uint32_t baud;
+	uint32_t sent;
+	uint32_t delivered;				// frames received intact and in order
+	uint32_t corrupt;				// frames received that were never sent
+	uint32_t uart_lost;				// bytes lost in the UART model
+	uint32_t passes;
+	uint32_t max_pass_ns;			// worst receive path time of one loop() pass, host clock
+	uint64_t total_ns;
+	uint32_t max_poll_bytes;
+	uint32_t overruns;
+	uint32_t dropped_bytes;
+} Run_t;
+
+// true if frame matches one of the pending frames, older pending frames are lost
+static bool match(std::deque<std::string> &pending, const std::string &frame)
+{
+	for(size_t i = 0; i < pending.size(); i++)
+		if( pending[i] == frame ) {
+			pending.erase(pending.begin(), pending.begin() + i + 1);
+			return true;
+		}
+	return false;
+}
+
+static Run_t simulate(uint32_t baud, bool legacy)
+{
+	MockUart uart;
+	WsReceiver receiver;
+	LegacyReceiver old_receiver;
+	std::deque<std::string> pending;
+	Run_t r = {};
+
+	seed = baud;
+	r.baud = baud;
+	mock::virtual_us = 0;
+	for(uint64_t t = 0; t < SIM_SECONDS * 1000000ULL; t += BURST_PERIOD_MS * 1000) {
+		uint64_t at = t;
+		for(uint32_t i = 0; i < BURST_FRAMES; i++) {
+			std::string f = ws_frame();
+			std::string line = f + "\r\n";
+			if( rnd(10) == 0 )							// line noise before the frame
+				line = std::string(1 + rnd(6), '~') + line;
+			uart.Send(at, line, baud);
+			at = uart.WireEnd();
+			pending.push_back(f);
+			r.sent++;
+		}
+	}
+
+	for(uint64_t now = 0; !uart.Idle(); ) {
+		std::string frame;
+		const char *p;
+		size_t len;
+
+		now += ( r.passes % STALL_EVERY == STALL_EVERY - 1 ) ? LOOP_STALL_US : LOOP_PASS_US + rnd(400);
+		mock::virtual_us = now;
+		uart.Advance(now);
+
+		auto t0 = std::chrono::steady_clock::now();
+		if( legacy ) {
+			if( old_receiver.Pass(uart, frame) ) {
+				if( match(pending, frame) ) r.delivered++; else r.corrupt++;
+			}
+		} else if( receiver.Poll(uart) > 0 ) {
+			while( receiver.NextFrame(p, len) ) {
+				if( match(pending, std::string(p, len)) ) r.delivered++; else r.corrupt++;
+			}
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+		r.total_ns += ns;
+		if( ns > r.max_pass_ns )
+			r.max_pass_ns = ns;
+		r.passes++;
+	}
+
+	r.uart_lost = uart.lost;
+	r.max_poll_bytes = receiver.GetStats().max_poll_bytes;
+	r.overruns = receiver.GetStats().overruns;
+	r.dropped_bytes = receiver.GetStats().dropped_bytes;
+	return r;
+}
+
+static std::string run_json(const Run_t &r)
+{
+	char b[400];
+	snprintf(b, sizeof(b), "{\"baud\":%u,\"sent\":%u,\"delivered\":%u,\"corrupt\":%u,\"uart_lost_bytes\":%u,\"frames_per_s\":%.1f,"
+		"\"host_frames_per_s\":%.0f,\"max_pass_ns\":%u,\"max_poll_bytes\":%u,\"overruns\":%u,\"dropped_bytes\":%u}",
+		r.baud, r.sent, r.delivered, r.corrupt, r.uart_lost, (double)r.delivered / SIM_SECONDS,
+		r.total_ns ? r.delivered * 1e9 / r.total_ns : 0.0, r.max_pass_ns, r.max_poll_bytes, r.overruns, r.dropped_bytes);
+	return b;
+}
+
+/**************************************************************************************************
+  tests
+**************************************************************************************************/
+void setUp(void) {}
+void tearDown(void) {}
+
+// a frame split over polls and across the end of the ring comes out whole
+void test_wrap_and_split(void)
+{
+	MockUart uart;
+	WsReceiver receiver;
+	const char *p;
+	size_t len;
+	uint32_t frames = 0;
+
+	for(uint32_t i = 0; i < 40; i++) {
+		std::string f = "%WS,-175,-120,24,85,1,1270," + std::to_string(i) + ",-1#";
+		uart.Send(0, f.substr(0, 7), 115200);
+		uart.Advance(UINT64_MAX);
+		receiver.Poll(uart);
+		TEST_ASSERT_FALSE(receiver.NextFrame(p, len));
+		uart.Send(0, f.substr(7) + "\r\n", 115200);
+		uart.Advance(UINT64_MAX);
+		receiver.Poll(uart);
+		TEST_ASSERT_TRUE(receiver.NextFrame(p, len));
+		TEST_ASSERT_EQUAL_STRING(f.c_str(), std::string(p, len).c_str());
+		frames++;
+	}
+	TEST_ASSERT_FALSE(receiver.NextFrame(p, len));								// consumes the last CR LF
+	TEST_ASSERT_EQUAL_UINT32(frames, receiver.GetStats().frames);
+	TEST_ASSERT_EQUAL_UINT32(frames * 2, receiver.GetStats().dropped_bytes);		// CR LF
+}
+
+// an overlong frame is dropped and counted, the next one is received
+void test_overlong_frame(void)
+{
+	MockUart uart;
+	WsReceiver receiver;
+	const char *p;
+	size_t len;
+
+	uart.Send(0, "%WS," + std::string(2 * UART1_BUFFER, '1') + "#%WS,1,2,3,4,5,6,7,8#", 115200);
+	uart.Advance(UINT64_MAX);
+	receiver.Poll(uart);
+	TEST_ASSERT_TRUE(receiver.NextFrame(p, len));
+	TEST_ASSERT_EQUAL_STRING("%WS,1,2,3,4,5,6,7,8#", std::string(p, len).c_str());
+	TEST_ASSERT_FALSE(receiver.NextFrame(p, len));
+	TEST_ASSERT_TRUE(receiver.GetStats().overruns >= 1);
+	TEST_ASSERT_EQUAL_UINT32(1, receiver.GetStats().frames);
+}
+
+// bursts at several baud rates: every frame delivered, the original reader falls behind
+void test_bursts(void)
+{
+	const uint32_t bauds[] = { 9600, 19200, 57600, 115200 };
+	std::string json = "{\"bench\":\"ws_receiver\",\"seconds\":" + std::to_string(SIM_SECONDS) + ",\"burst_frames\":" +
+		std::to_string(BURST_FRAMES) + ",\"stall_us\":" + std::to_string(LOOP_STALL_US) + ",\"ring\":[";
+	std::string legacy_json = "],\"legacy\":[";
+
+	for(size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+		Run_t r = simulate(bauds[i], false);
+		Run_t l = simulate(bauds[i], true);
+
+		json += ( i ? "," : "" ) + run_json(r);
+		legacy_json += ( i ? "," : "" ) + run_json(l);
+
+		// ring full events count as overruns but leave the bytes in the UART buffer, nothing may be lost
+		TEST_ASSERT_EQUAL_UINT32(r.sent, r.delivered);
+		TEST_ASSERT_EQUAL_UINT32(0, r.corrupt);
+		TEST_ASSERT_EQUAL_UINT32(0, r.uart_lost);
+		TEST_ASSERT_TRUE(r.max_poll_bytes <= WS_RX_RING_SIZE);
+		TEST_ASSERT_TRUE(l.delivered <= r.delivered);
+		if( bauds[i] >= 57600 ) {
+			TEST_ASSERT_TRUE(l.delivered < r.delivered);
+		}
+	}
+	printf("%s%s]}\n", json.c_str(), legacy_json.c_str());
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_wrap_and_split);
+	RUN_TEST(test_overlong_frame);
+	RUN_TEST(test_bursts);
+	return UNITY_END();
+}
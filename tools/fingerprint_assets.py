@@ -0,0 +1,69 @@
+# Content hash of the setup page assets, run by PlatformIO before every build (extra_scripts)
+# and usable standalone: python tools/fingerprint_assets.py
+#
+# - writes data/www/assets.json: served url, LittleFS file, hash and size of every asset
+# - updates the ?v=<hash> of the asset links in data/www/setup.html, so a changed asset gets
+#   a new url and the browser can keep the old one cached forever
+import hashlib
+import json
+import os
+import re
+
+HASH_LEN = 16
+SKIP = ("assets.json",)
+
+try:
+    Import("env")                                           # noqa: F821, PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]                        # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+DATA_DIR = os.path.join(PROJECT_DIR, "data")
+WWW_DIR = os.path.join(DATA_DIR, "www")
+PAGE = os.path.join(WWW_DIR, "setup.html")
+LINK = re.compile(r'((?:href|src)=")(/www/[^"?]+)(\?v=[0-9a-f]*)?(")')
+
+
+def file_hash(path):
+    with open(path, "rb") as f:
+        return hashlib.sha256(f.read()).hexdigest()[:HASH_LEN]
+
+
+def scan():
+    assets = {}
+    for root, _, files in os.walk(WWW_DIR):
+        for name in sorted(files):
+            if name in SKIP:
+                continue
+            path = os.path.join(root, name)
+            file = "/" + os.path.relpath(path, DATA_DIR).replace(os.sep, "/")
+            url = file[:-3] if file.endswith(".gz") else file     # AsyncFileResponse adds .gz
+            assets[url] = {"file": file, "hash": file_hash(path), "size": os.path.getsize(path)}
+    return assets
+
+
+def fingerprint_page(assets):
+    with open(PAGE, "r", encoding="utf-8") as f:
+        page = f.read()
+
+    def repl(m):
+        a = assets.get(m.group(2))
+        return m.group(0) if a is None else m.group(1) + m.group(2) + "?v=" + a["hash"] + m.group(4)
+
+    new_page = LINK.sub(repl, page)
+    if new_page != page:
+        with open(PAGE, "w", encoding="utf-8", newline="") as f:
+            f.write(new_page)
+
+
+def main():
+    fingerprint_page(scan())
+    assets = scan()                                         # setup.html hash after its links changed
+    manifest = [dict(url=url, **a) for url, a in sorted(assets.items())]
+    with open(os.path.join(WWW_DIR, "assets.json"), "w", encoding="utf-8", newline="\n") as f:
+        json.dump({"assets": manifest}, f, indent=2)
+        f.write("\n")
+    print("fingerprint_assets: %d assets" % len(manifest))
+
+
+main()